@@ -0,0 +1,168 @@
+#ifndef ANIMATION_CLIP_H
+#define ANIMATION_CLIP_H
+
+#include "../Common/MotionMath.h"
+
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------
+// One bone of an imported rig. Bones are stored parents-first so a single
+// forward pass over the array is always a valid hierarchy traversal.
+struct AnimBone
+{
+    std::string Name;
+    int         Parent;     // -1 for the root
+    Float3      BindT;      // local bind pose
+    Quat4       BindR;
+    Float3      BindS;
+};
+
+struct AnimRig
+{
+    std::vector<AnimBone> Bones;
+
+    int NumBones() const { return (int)Bones.size(); }
+
+    int FindBone(const std::string& name) const
+    {
+        for (int i = 0; i < NumBones(); ++i)
+            if (Bones[i].Name == name)
+                return i;
+        return -1;
+    }
+
+    // Mixamo rigs prefix every bone ("mixamorig:Spine1"), so match the tail
+    int FindBoneBySuffix(const std::string& suffix) const
+    {
+        for (int i = 0; i < NumBones(); ++i)
+        {
+            const std::string& n = Bones[i].Name;
+            if (n.size() >= suffix.size() && n.compare(n.size() - suffix.size(), suffix.size(), suffix) == 0)
+                return i;
+        }
+        return -1;
+    }
+};
+
+//---------------------------------------------------------------------------
+// Local-space pose, one array per channel (SoA) so that blending and
+// sampling can run several bones per SIMD lane.
+struct LocalPose
+{
+    int                NumBones;
+    std::vector<float> Tx, Ty, Tz;
+    std::vector<float> Rx, Ry, Rz, Rw;
+    std::vector<float> Sx, Sy, Sz;
+
+    LocalPose() : NumBones(0) {}
+
+    void Resize(int numBones)
+    {
+        // rounded up to a multiple of 4 so SIMD loops never need a scalar tail
+        NumBones = numBones;
+        size_t padded = (size_t)((numBones + 3) & ~3);
+        std::vector<float>* channels[] = { &Tx, &Ty, &Tz, &Rx, &Ry, &Rz, &Rw, &Sx, &Sy, &Sz };
+        for (int c = 0; c < 10; ++c)
+            channels[c]->assign(padded, 0.0f);
+    }
+
+    void SetBindPose(const AnimRig& rig)
+    {
+        Resize(rig.NumBones());
+        for (int i = 0; i < NumBones; ++i)
+        {
+            const AnimBone& b = rig.Bones[i];
+            SetT(i, b.BindT);
+            SetR(i, b.BindR);
+            SetS(i, b.BindS);
+        }
+    }
+
+    Float3 GetT(int i) const { return MakeFloat3(Tx[i], Ty[i], Tz[i]); }
+    Quat4  GetR(int i) const { return MakeQuat4(Rx[i], Ry[i], Rz[i], Rw[i]); }
+    Float3 GetS(int i) const { return MakeFloat3(Sx[i], Sy[i], Sz[i]); }
+    void   SetT(int i, const Float3& t) { Tx[i] = t.x; Ty[i] = t.y; Tz[i] = t.z; }
+    void   SetR(int i, const Quat4& r) { Rx[i] = r.x; Ry[i] = r.y; Rz[i] = r.z; Rw[i] = r.w; }
+    void   SetS(int i, const Float3& s) { Sx[i] = s.x; Sy[i] = s.y; Sz[i] = s.z; }
+};
+
+// Model-space joint positions and rotations of a local pose. Scale is carried
+// per axis, which is exact for the uniform scales Mixamo rigs use.
+inline void LocalToGlobal(const AnimRig& rig, const LocalPose& pose, std::vector<Float3>& pos, std::vector<Quat4>& rot)
+{
+    int n = rig.NumBones();
+    pos.resize(n);
+    rot.resize(n);
+    std::vector<Float3> scale(n);
+    for (int i = 0; i < n; ++i)
+    {
+        int p = rig.Bones[i].Parent;
+        Float3 t = pose.GetT(i), s = pose.GetS(i);
+        Quat4  r = pose.GetR(i);
+        if (p < 0)
+        {
+            pos[i] = t; rot[i] = r; scale[i] = s;
+            continue;
+        }
+        Float3 ps = scale[p];
+        pos[i] = pos[p] + QuatRotate(rot[p], MakeFloat3(t.x * ps.x, t.y * ps.y, t.z * ps.z));
+        rot[i] = QuatNormalize(QuatMul(rot[p], r));
+        scale[i] = MakeFloat3(ps.x * s.x, ps.y * s.y, ps.z * s.z);
+    }
+}
+
+//---------------------------------------------------------------------------
+// Dense clip as it comes out of the importer: one TRS key per bone per frame,
+// sampled at a fixed rate. Keys are track-major ([bone * NumFrames + frame]).
+struct AnimationClip
+{
+    std::string         Name;
+    float               SampleRate;
+    int                 NumFrames;
+    int                 NumBones;
+    std::vector<Float3> Translations;
+    std::vector<Quat4>  Rotations;
+    std::vector<Float3> Scales;
+
+    AnimationClip() : SampleRate(30.0f), NumFrames(0), NumBones(0) {}
+
+    void Allocate(int numBones, int numFrames)
+    {
+        NumBones = numBones;
+        NumFrames = numFrames;
+        Translations.assign((size_t)numBones * numFrames, MakeFloat3(0.0f, 0.0f, 0.0f));
+        Rotations.assign((size_t)numBones * numFrames, QuatIdentity());
+        Scales.assign((size_t)numBones * numFrames, MakeFloat3(1.0f, 1.0f, 1.0f));
+    }
+
+    float Duration() const { return NumFrames > 1 ? (NumFrames - 1) / SampleRate : 0.0f; }
+
+    size_t Key(int bone, int frame) const { return (size_t)bone * NumFrames + frame; }
+
+    size_t SizeBytes() const
+    {
+        return Translations.size() * sizeof(Float3) + Rotations.size() * sizeof(Quat4) + Scales.size() * sizeof(Float3);
+    }
+
+    // Clamped (non-looping) sample between the two nearest frames
+    void Sample(float time, LocalPose& pose) const
+    {
+        float f = time * SampleRate;
+        if (f < 0.0f) f = 0.0f;
+        if (f > (float)(NumFrames - 1)) f = (float)(NumFrames - 1);
+        int f0 = (int)f;
+        int f1 = f0 + 1 < NumFrames ? f0 + 1 : f0;
+        float t = f - (float)f0;
+
+        for (int b = 0; b < NumBones; ++b)
+        {
+            size_t k0 = Key(b, f0), k1 = Key(b, f1);
+            pose.SetT(b, Lerp(Translations[k0], Translations[k1], t));
+            pose.SetR(b, QuatNlerp(Rotations[k0], Rotations[k1], t));
+            pose.SetS(b, Lerp(Scales[k0], Scales[k1], t));
+        }
+    }
+};
+
+#endif // ANIMATION_CLIP_H
@@ -0,0 +1,132 @@
+#ifndef ANIMATION_IMPORT_H
+#define ANIMATION_IMPORT_H
+
+// Builds AnimRig / AnimationClip from assimp scenes (the Male_Zombie FBX files).
+
+#include "../Common/AnimationClip.h"
+
+#include <assimp/Importer.hpp>      // C++ importer interface
+#include <assimp/scene.h>           // Output data structure
+#include <assimp/postprocess.h>     // Post processing flags
+
+inline void DecomposeNode(const aiMatrix4x4& m, Float3& t, Quat4& r, Float3& s)
+{
+    aiVector3D scaling, position;
+    aiQuaternion rotation;
+    m.Decompose(scaling, rotation, position);
+    t = MakeFloat3(position.x, position.y, position.z);
+    r = MakeQuat4(rotation.x, rotation.y, rotation.z, rotation.w);
+    s = MakeFloat3(scaling.x, scaling.y, scaling.z);
+}
+
+// Depth-first walk, so parents always come before their children
+inline void AddRigNodes(const aiNode* node, int parent, AnimRig& rig)
+{
+    AnimBone bone;
+    bone.Name = node->mName.C_Str();
+    bone.Parent = parent;
+    DecomposeNode(node->mTransformation, bone.BindT, bone.BindR, bone.BindS);
+    rig.Bones.push_back(bone);
+
+    int index = rig.NumBones() - 1;
+    for (unsigned int i = 0; i < node->mNumChildren; ++i)
+        AddRigNodes(node->mChildren[i], index, rig);
+}
+
+template <class KeyType>
+inline unsigned int FindKey(const KeyType* keys, unsigned int numKeys, double tick)
+{
+    unsigned int k = 0;
+    while (k + 1 < numKeys && keys[k + 1].mTime <= tick)
+        ++k;
+    return k;
+}
+
+inline float KeyFactor(double t0, double t1, double tick)
+{
+    return t1 > t0 ? (float)((tick - t0) / (t1 - t0)) : 0.0f;
+}
+
+inline void SampleChannel(const aiNodeAnim* channel, double tick, Float3& t, Quat4& r, Float3& s)
+{
+    if (channel->mNumPositionKeys)
+    {
+        const aiVectorKey* keys = channel->mPositionKeys;
+        unsigned int k = FindKey(keys, channel->mNumPositionKeys, tick);
+        unsigned int n = k + 1 < channel->mNumPositionKeys ? k + 1 : k;
+        aiVector3D v = keys[k].mValue + (keys[n].mValue - keys[k].mValue) * KeyFactor(keys[k].mTime, keys[n].mTime, tick);
+        t = MakeFloat3(v.x, v.y, v.z);
+    }
+    if (channel->mNumRotationKeys)
+    {
+        const aiQuatKey* keys = channel->mRotationKeys;
+        unsigned int k = FindKey(keys, channel->mNumRotationKeys, tick);
+        unsigned int n = k + 1 < channel->mNumRotationKeys ? k + 1 : k;
+        aiQuaternion q;
+        aiQuaternion::Interpolate(q, keys[k].mValue, keys[n].mValue, KeyFactor(keys[k].mTime, keys[n].mTime, tick));
+        r = QuatNormalize(MakeQuat4(q.x, q.y, q.z, q.w));
+    }
+    if (channel->mNumScalingKeys)
+    {
+        const aiVectorKey* keys = channel->mScalingKeys;
+        unsigned int k = FindKey(keys, channel->mNumScalingKeys, tick);
+        unsigned int n = k + 1 < channel->mNumScalingKeys ? k + 1 : k;
+        aiVector3D v = keys[k].mValue + (keys[n].mValue - keys[k].mValue) * KeyFactor(keys[k].mTime, keys[n].mTime, tick);
+        s = MakeFloat3(v.x, v.y, v.z);
+    }
+}
+
+// Resamples every animation of the file into dense clips at sampleRate.
+// If rig is empty it is built from the file's node hierarchy, otherwise the
+// channels are matched to the existing bones by name (Mixamo clips of the same
+// character share one hierarchy).
+inline bool ImportAnimationClips(const std::string& sFile, AnimRig& rig, std::vector<AnimationClip>& clips, float sampleRate = 30.0f)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(sFile, 0);
+    if (!scene || !scene->mRootNode)
+        return false;
+
+    if (rig.Bones.empty())
+        AddRigNodes(scene->mRootNode, -1, rig);
+
+    for (unsigned int a = 0; a < scene->mNumAnimations; ++a)
+    {
+        const aiAnimation* anim = scene->mAnimations[a];
+        double ticksPerSecond = anim->mTicksPerSecond > 0.0 ? anim->mTicksPerSecond : 25.0;
+        double seconds = anim->mDuration / ticksPerSecond;
+
+        AnimationClip clip;
+        clip.Name = sFile + ":" + anim->mName.C_Str();
+        clip.SampleRate = sampleRate;
+        clip.Allocate(rig.NumBones(), (int)(seconds * sampleRate) + 1);
+
+        std::vector<const aiNodeAnim*> channelOf(rig.NumBones(), (const aiNodeAnim*)nullptr);
+        for (unsigned int c = 0; c < anim->mNumChannels; ++c)
+        {
+            int bone = rig.FindBone(anim->mChannels[c]->mNodeName.C_Str());
+            if (bone >= 0)
+                channelOf[bone] = anim->mChannels[c];
+        }
+
+        for (int b = 0; b < clip.NumBones; ++b)
+        {
+            const AnimBone& bone = rig.Bones[b];
+            for (int f = 0; f < clip.NumFrames; ++f)
+            {
+                size_t k = clip.Key(b, f);
+                Float3 t = bone.BindT, s = bone.BindS;
+                Quat4  r = bone.BindR;
+                if (channelOf[b])
+                    SampleChannel(channelOf[b], f / sampleRate * ticksPerSecond, t, r, s);
+                clip.Translations[k] = t;
+                clip.Rotations[k] = r;
+                clip.Scales[k] = s;
+            }
+        }
+        clips.push_back(clip);
+    }
+    return true;
+}
+
+#endif // ANIMATION_IMPORT_H
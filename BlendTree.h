@@ -0,0 +1,271 @@
+#ifndef BLEND_TREE_H
+#define BLEND_TREE_H
+
+// Layered animation blending for one character.
+//
+// Nodes live in a flat array and each owns a preallocated SoA LocalPose, so
+// evaluating the tree never allocates. Leaves are compressed clips or
+// externally written poses (the live Kinect body); inner nodes combine two
+// inputs with an optional per-bone mask:
+//   Override  - result = nlerp(A, B, weight * mask)
+//   Additive  - result = (B * Reference^-1)^(weight * mask) * A
+//   CrossFade - override whose weight ramps 0 -> 1 over FadeDuration
+
+#include "../Common/ClipCompression.h"
+#include "../Common/MotionSimd.h"
+
+#include <chrono>
+
+enum BlendNodeType
+{
+    BlendNode_Clip,
+    BlendNode_Pose,
+    BlendNode_Override,
+    BlendNode_Additive,
+    BlendNode_CrossFade
+};
+
+struct BlendNode
+{
+    BlendNodeType         Type;
+    int                   InputA, InputB;
+    int                   Mask;         // index into BlendTree::Masks, -1 for all bones
+    float                 Weight;
+
+    const CompressedClip* Clip;
+    float                 Time, Speed;
+    bool                  Loop;
+    ClipCursor            Cursor;
+
+    const LocalPose*      Source;       // BlendNode_Pose input, BlendNode_Additive reference
+
+    float                 FadeTime, FadeDuration;
+    unsigned              EvalStamp;
+
+    BlendNode(BlendNodeType type) :
+        Type(type), InputA(-1), InputB(-1), Mask(-1), Weight(1.0f),
+        Clip(nullptr), Time(0.0f), Speed(1.0f), Loop(true),
+        Source(nullptr), FadeTime(0.0f), FadeDuration(0.0f), EvalStamp(0)
+    {}
+};
+
+//---------------------------------------------------------------------------
+// Per-bone mask weights, padded like LocalPose
+inline void BuildSubtreeMask(const AnimRig& rig, int rootBone, float weight, std::vector<float>& mask)
+{
+    mask.assign((size_t)((rig.NumBones() + 3) & ~3), 0.0f);
+    if (rootBone < 0)
+        return;
+    mask[rootBone] = weight;
+    // parents come first, so one pass propagates the subtree
+    for (int i = rootBone + 1; i < rig.NumBones(); ++i)
+    {
+        int p = rig.Bones[i].Parent;
+        if (p >= 0 && mask[p] > 0.0f)
+            mask[i] = weight;
+    }
+}
+
+inline void InvertMask(std::vector<float>& mask)
+{
+    for (size_t i = 0; i < mask.size(); ++i)
+        mask[i] = 1.0f - mask[i];
+}
+
+//---------------------------------------------------------------------------
+// SIMD kernels, four bones per iteration. w holds weight * mask per bone.
+inline void BlendOverride(const LocalPose& a, const LocalPose& b, const float* w, float weight, LocalPose& out)
+{
+    __m128 ws = _mm_set1_ps(weight);
+    for (int i = 0; i < out.NumBones; i += 4)
+    {
+        __m128 t = w ? _mm_mul_ps(_mm_loadu_ps(w + i), ws) : ws;
+        StoreVec3x4(Lerp4(LoadVec3x4(&a.Tx[i], &a.Ty[i], &a.Tz[i]), LoadVec3x4(&b.Tx[i], &b.Ty[i], &b.Tz[i]), t), &out.Tx[i], &out.Ty[i], &out.Tz[i]);
+        StoreVec3x4(Lerp4(LoadVec3x4(&a.Sx[i], &a.Sy[i], &a.Sz[i]), LoadVec3x4(&b.Sx[i], &b.Sy[i], &b.Sz[i]), t), &out.Sx[i], &out.Sy[i], &out.Sz[i]);
+        Quat4x4 r = QuatNlerp4(LoadQuat4x4(&a.Rx[i], &a.Ry[i], &a.Rz[i], &a.Rw[i]), LoadQuat4x4(&b.Rx[i], &b.Ry[i], &b.Rz[i], &b.Rw[i]), t);
+        StoreQuat4x4(r, &out.Rx[i], &out.Ry[i], &out.Rz[i], &out.Rw[i]);
+    }
+}
+
+inline void BlendAdditive(const LocalPose& a, const LocalPose& b, const LocalPose& ref, const float* w, float weight, LocalPose& out)
+{
+    __m128 ws = _mm_set1_ps(weight);
+    __m128 zero = _mm_setzero_ps();
+    Quat4x4 identity = { zero, zero, zero, _mm_set1_ps(1.0f) };
+    for (int i = 0; i < out.NumBones; i += 4)
+    {
+        __m128 t = w ? _mm_mul_ps(_mm_loadu_ps(w + i), ws) : ws;
+
+        Vec3x4 dt = Sub4(LoadVec3x4(&b.Tx[i], &b.Ty[i], &b.Tz[i]), LoadVec3x4(&ref.Tx[i], &ref.Ty[i], &ref.Tz[i]));
+        StoreVec3x4(Add4(LoadVec3x4(&a.Tx[i], &a.Ty[i], &a.Tz[i]), Scale4(dt, t)), &out.Tx[i], &out.Ty[i], &out.Tz[i]);
+        Vec3x4 ds = Sub4(LoadVec3x4(&b.Sx[i], &b.Sy[i], &b.Sz[i]), LoadVec3x4(&ref.Sx[i], &ref.Sy[i], &ref.Sz[i]));
+        StoreVec3x4(Add4(LoadVec3x4(&a.Sx[i], &a.Sy[i], &a.Sz[i]), Scale4(ds, t)), &out.Sx[i], &out.Sy[i], &out.Sz[i]);
+
+        Quat4x4 delta = QuatMul4(LoadQuat4x4(&b.Rx[i], &b.Ry[i], &b.Rz[i], &b.Rw[i]),
+                                 QuatConjugate4(LoadQuat4x4(&ref.Rx[i], &ref.Ry[i], &ref.Rz[i], &ref.Rw[i])));
+        delta = QuatNlerp4(identity, delta, t);
+        Quat4x4 r = QuatNormalize4(QuatMul4(delta, LoadQuat4x4(&a.Rx[i], &a.Ry[i], &a.Rz[i], &a.Rw[i])));
+        StoreQuat4x4(r, &out.Rx[i], &out.Ry[i], &out.Rz[i], &out.Rw[i]);
+    }
+}
+
+//---------------------------------------------------------------------------
+struct BlendTree
+{
+    int                             NumBones;
+    std::vector<BlendNode>          Nodes;
+    std::vector<LocalPose>          Poses;      // output of each node
+    std::vector<std::vector<float>> Masks;
+    LocalPose                       BindPose;
+    int                             Root;
+    unsigned                        Stamp;
+    double                          LastEvaluateUs;
+
+    BlendTree() : NumBones(0), Root(-1), Stamp(0), LastEvaluateUs(0.0) {}
+
+    // Nodes are added after Init so their pose buffers can be sized right away
+    void Init(const AnimRig& rig)
+    {
+        NumBones = rig.NumBones();
+        Nodes.clear();
+        Poses.clear();
+        Masks.clear();
+        BindPose.SetBindPose(rig);
+        Root = -1;
+    }
+
+    int AddNode(const BlendNode& node)
+    {
+        Nodes.push_back(node);
+        Poses.push_back(BindPose);
+        Root = (int)Nodes.size() - 1;
+        return Root;
+    }
+
+    int AddMask(const std::vector<float>& mask)
+    {
+        Masks.push_back(mask);
+        return (int)Masks.size() - 1;
+    }
+
+    int AddClip(const CompressedClip* clip, bool loop = true, float speed = 1.0f)
+    {
+        BlendNode n(BlendNode_Clip);
+        n.Clip = clip;
+        n.Loop = loop;
+        n.Speed = speed;
+        return AddNode(n);
+    }
+
+    int AddPose(const LocalPose* source)
+    {
+        BlendNode n(BlendNode_Pose);
+        n.Source = source;
+        return AddNode(n);
+    }
+
+    int AddOverride(int base, int layer, int mask = -1, float weight = 1.0f)
+    {
+        BlendNode n(BlendNode_Override);
+        n.InputA = base; n.InputB = layer; n.Mask = mask; n.Weight = weight;
+        return AddNode(n);
+    }
+
+    // reference == nullptr uses the bind pose as the additive reference
+    int AddAdditive(int base, int layer, const LocalPose* reference = nullptr, int mask = -1, float weight = 1.0f)
+    {
+        BlendNode n(BlendNode_Additive);
+        n.InputA = base; n.InputB = layer; n.Mask = mask; n.Weight = weight;
+        n.Source = reference;
+        return AddNode(n);
+    }
+
+    int AddCrossFade(int from, int to, float duration)
+    {
+        BlendNode n(BlendNode_CrossFade);
+        n.InputA = from; n.InputB = to;
+        n.FadeDuration = duration;
+        n.FadeTime = duration;
+        n.Weight = 1.0f;
+        return AddNode(n);
+    }
+
+    // Fades a cross-fade node from whatever it currently shows to 'target'
+    void CrossFadeTo(int node, int target, float duration)
+    {
+        BlendNode& n = Nodes[node];
+        n.InputA = n.Weight >= 0.5f ? n.InputB : n.InputA;
+        n.InputB = target;
+        n.FadeTime = 0.0f;
+        n.FadeDuration = duration;
+        n.Weight = 0.0f;
+        if (Nodes[target].Type == BlendNode_Clip)
+            Nodes[target].Time = 0.0f;
+    }
+
+    void Update(float dt)
+    {
+        for (size_t i = 0; i < Nodes.size(); ++i)
+        {
+            BlendNode& n = Nodes[i];
+            if (n.Type == BlendNode_Clip && n.Clip)
+            {
+                float duration = n.Clip->Duration();
+                n.Time += dt * n.Speed;
+                if (n.Loop && duration > 0.0f)
+                    n.Time = fmodf(n.Time, duration);
+            }
+            else if (n.Type == BlendNode_CrossFade)
+            {
+                n.FadeTime = fminf(n.FadeTime + dt, n.FadeDuration);
+                float u = n.FadeDuration > 0.0f ? n.FadeTime / n.FadeDuration : 1.0f;
+                n.Weight = u * u * (3.0f - 2.0f * u);   // smoothstep
+            }
+        }
+    }
+
+    void EvaluateNode(int index)
+    {
+        BlendNode& n = Nodes[index];
+        if (n.EvalStamp == Stamp)
+            return;
+        n.EvalStamp = Stamp;
+
+        LocalPose& out = Poses[index];
+        const float* mask = n.Mask >= 0 ? &Masks[n.Mask][0] : nullptr;
+        switch (n.Type)
+        {
+        case BlendNode_Clip:
+            if (n.Clip)
+                n.Clip->Sample(n.Time, out, n.Cursor);
+            break;
+        case BlendNode_Pose:
+            if (n.Source)
+                out = *n.Source;    // same size, so the assignment reuses the buffers
+            break;
+        case BlendNode_Override:
+        case BlendNode_CrossFade:
+            EvaluateNode(n.InputA);
+            EvaluateNode(n.InputB);
+            BlendOverride(Poses[n.InputA], Poses[n.InputB], mask, n.Weight, out);
+            break;
+        case BlendNode_Additive:
+            EvaluateNode(n.InputA);
+            EvaluateNode(n.InputB);
+            BlendAdditive(Poses[n.InputA], Poses[n.InputB], n.Source ? *n.Source : BindPose, mask, n.Weight, out);
+            break;
+        }
+    }
+
+    const LocalPose& Evaluate()
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        ++Stamp;
+        if (Root >= 0)
+            EvaluateNode(Root);
+        LastEvaluateUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+        return Root >= 0 ? Poses[Root] : BindPose;
+    }
+};
+
+#endif // BLEND_TREE_H
@@ -0,0 +1,416 @@
+#ifndef CLIP_COMPRESSION_H
+#define CLIP_COMPRESSION_H
+
+// Keyframe compression for imported animation clips.
+//
+// Rotations are stored smallest-three (3 x 15 bit + 2 bit index, 6 bytes),
+// translations and scales as 16 bit values against a per-clip, per-bone range,
+// and keys are removed wherever linear interpolation between the remaining
+// keys stays under the bone's positional error. The error of a bone is
+// measured at a virtual vertex as far away as its furthest child, so a small
+// rotation error on a long bone costs more than the same error on a finger.
+
+#include "../Common/AnimationClip.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+
+struct ClipCompressionSettings
+{
+    float              MaxError;            // allowed positional error in rig units
+    std::vector<float> BoneMaxError;        // optional per-bone override, indexed like AnimRig::Bones
+    float              MinVirtualLength;    // virtual vertex distance used for leaf bones
+
+    ClipCompressionSettings() : MaxError(0.01f), MinVirtualLength(0.05f) {}
+
+    float ErrorFor(int bone) const
+    {
+        return bone < (int)BoneMaxError.size() && BoneMaxError[bone] > 0.0f ? BoneMaxError[bone] : MaxError;
+    }
+};
+
+//---------------------------------------------------------------------------
+struct CompressedBoneTrack
+{
+    static const uint32_t ConstantTrack = 0xffffffffu;
+
+    uint32_t FirstKey;      // index into KeyFrames and Rotations (x3)
+    uint32_t NumKeys;
+    uint32_t FirstTrans;    // index into Translations (x3), ConstantTrack if not animated
+    uint32_t FirstScale;    // index into Scales (x3), ConstantTrack if not animated
+    Float3   TransMin, TransStep;
+    Float3   ScaleMin, ScaleStep;
+};
+
+// Remembers the last key pair used per bone so sequential playback does not
+// search the key list on every frame.
+struct ClipCursor
+{
+    std::vector<uint32_t> Key;
+};
+
+struct CompressedClip
+{
+    std::string                      Name;
+    float                            SampleRate;
+    int                              NumFrames;
+    int                              NumBones;
+    std::vector<CompressedBoneTrack> Tracks;
+    std::vector<uint16_t>            KeyFrames;
+    std::vector<uint16_t>            Rotations;
+    std::vector<uint16_t>            Translations;
+    std::vector<uint16_t>            Scales;
+
+    CompressedClip() : SampleRate(30.0f), NumFrames(0), NumBones(0) {}
+
+    float Duration() const { return NumFrames > 1 ? (NumFrames - 1) / SampleRate : 0.0f; }
+
+    size_t SizeBytes() const
+    {
+        return Tracks.size() * sizeof(CompressedBoneTrack) +
+               (KeyFrames.size() + Rotations.size() + Translations.size() + Scales.size()) * sizeof(uint16_t);
+    }
+
+    static Quat4 DecodeRotation(const uint16_t* w)
+    {
+        const float range = 0.70710678f;   // largest possible value of the three smallest components
+        const float inv = 2.0f * range / 32767.0f;
+        int   largest = ((w[0] >> 15) << 1) | (w[1] >> 15);
+        float a = (w[0] & 0x7fff) * inv - range;
+        float b = (w[1] & 0x7fff) * inv - range;
+        float c = (w[2] & 0x7fff) * inv - range;
+        float d = 1.0f - a * a - b * b - c * c;
+        d = d > 0.0f ? sqrtf(d) : 0.0f;
+        switch (largest)
+        {
+        case 0:  return MakeQuat4(d, a, b, c);
+        case 1:  return MakeQuat4(a, d, b, c);
+        case 2:  return MakeQuat4(a, b, d, c);
+        default: return MakeQuat4(a, b, c, d);
+        }
+    }
+
+    static void EncodeRotation(Quat4 q, uint16_t* w)
+    {
+        const float range = 0.70710678f;
+        float c[4] = { q.x, q.y, q.z, q.w };
+        int largest = 0;
+        for (int i = 1; i < 4; ++i)
+            if (fabsf(c[i]) > fabsf(c[largest]))
+                largest = i;
+        // q and -q are the same rotation; keep the dropped component positive
+        float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+        uint16_t v[3];
+        for (int i = 0, j = 0; i < 4; ++i)
+        {
+            if (i == largest)
+                continue;
+            float n = (c[i] * sign + range) / (2.0f * range);
+            n = n < 0.0f ? 0.0f : (n > 1.0f ? 1.0f : n);
+            v[j++] = (uint16_t)(n * 32767.0f + 0.5f);
+        }
+        w[0] = (uint16_t)(v[0] | ((largest >> 1) << 15));
+        w[1] = (uint16_t)(v[1] | ((largest & 1) << 15));
+        w[2] = v[2];
+    }
+
+    static Float3 Dequantize(const uint16_t* w, const Float3& minimum, const Float3& step)
+    {
+        return MakeFloat3(minimum.x + w[0] * step.x, minimum.y + w[1] * step.y, minimum.z + w[2] * step.z);
+    }
+
+    void DecodeKey(const CompressedBoneTrack& tr, uint32_t k, Float3& t, Quat4& r, Float3& s) const
+    {
+        r = DecodeRotation(&Rotations[(size_t)(tr.FirstKey + k) * 3]);
+        t = tr.FirstTrans == CompressedBoneTrack::ConstantTrack ? tr.TransMin
+            : Dequantize(&Translations[(size_t)(tr.FirstTrans + k) * 3], tr.TransMin, tr.TransStep);
+        s = tr.FirstScale == CompressedBoneTrack::ConstantTrack ? tr.ScaleMin
+            : Dequantize(&Scales[(size_t)(tr.FirstScale + k) * 3], tr.ScaleMin, tr.ScaleStep);
+    }
+
+    void SampleBone(int bone, float frame, uint32_t k, LocalPose& pose) const
+    {
+        const CompressedBoneTrack& tr = Tracks[bone];
+        Float3 t0, t1, s0, s1;
+        Quat4  r0, r1;
+        DecodeKey(tr, k, t0, r0, s0);
+        if (k + 1 >= tr.NumKeys)
+        {
+            pose.SetT(bone, t0); pose.SetR(bone, r0); pose.SetS(bone, s0);
+            return;
+        }
+        DecodeKey(tr, k + 1, t1, r1, s1);
+        float f0 = KeyFrames[tr.FirstKey + k];
+        float f1 = KeyFrames[tr.FirstKey + k + 1];
+        float u = (frame - f0) / (f1 - f0);
+        pose.SetT(bone, Lerp(t0, t1, u));
+        pose.SetR(bone, QuatNlerp(r0, r1, u));
+        pose.SetS(bone, Lerp(s0, s1, u));
+    }
+
+    float ClampFrame(float time) const
+    {
+        float f = time * SampleRate;
+        if (f < 0.0f) return 0.0f;
+        if (f > (float)(NumFrames - 1)) return (float)(NumFrames - 1);
+        return f;
+    }
+
+    // Random access: binary search of each bone's key list
+    void Sample(float time, LocalPose& pose) const
+    {
+        float f = ClampFrame(time);
+        for (int b = 0; b < NumBones; ++b)
+        {
+            const CompressedBoneTrack& tr = Tracks[b];
+            uint32_t lo = 0, hi = tr.NumKeys - 1;
+            while (lo + 1 < hi)
+            {
+                uint32_t mid = (lo + hi) >> 1;
+                if (KeyFrames[tr.FirstKey + mid] <= f) lo = mid; else hi = mid;
+            }
+            SampleBone(b, f, lo, pose);
+        }
+    }
+
+    // Sequential playback: the cursor normally moves by zero or one key
+    void Sample(float time, LocalPose& pose, ClipCursor& cursor) const
+    {
+        float f = ClampFrame(time);
+        if ((int)cursor.Key.size() != NumBones)
+            cursor.Key.assign(NumBones, 0);
+        for (int b = 0; b < NumBones; ++b)
+        {
+            const CompressedBoneTrack& tr = Tracks[b];
+            const uint16_t* frames = &KeyFrames[tr.FirstKey];
+            uint32_t k = cursor.Key[b];
+            if (k >= tr.NumKeys) k = 0;
+            while (k > 0 && frames[k] > f) --k;
+            while (k + 1 < tr.NumKeys - 1 && frames[k + 1] <= f) ++k;
+            cursor.Key[b] = k;
+            SampleBone(b, f, k, pose);
+        }
+    }
+};
+
+//---------------------------------------------------------------------------
+// Positional error of a local TRS key against the reference, measured at a
+// virtual vertex 'length' away from the joint: 2 L sin(angle / 2) is the exact
+// worst case for the rotation part.
+inline float KeyError(const Float3& t, const Quat4& r, const Float3& s,
+                      const Float3& rt, const Quat4& rr, const Float3& rs, float length)
+{
+    float rot = 2.0f * length * sinf(0.5f * QuatAngleBetween(r, rr));
+    return Length(t - rt) + rot + Length(s - rs) * length;
+}
+
+inline void ComputeVirtualLengths(const AnimRig& rig, float minLength, std::vector<float>& lengths)
+{
+    lengths.assign(rig.NumBones(), minLength);
+    for (int i = 0; i < rig.NumBones(); ++i)
+    {
+        int p = rig.Bones[i].Parent;
+        if (p >= 0)
+        {
+            float d = Length(rig.Bones[i].BindT);
+            if (d > lengths[p])
+                lengths[p] = d;
+        }
+    }
+}
+
+inline void QuantizeRange(const std::vector<Float3>& keys, size_t first, int count, Float3& minimum, Float3& step, bool& animated)
+{
+    Float3 lo = keys[first], hi = keys[first];
+    for (int i = 1; i < count; ++i)
+    {
+        const Float3& v = keys[first + i];
+        lo = MakeFloat3(fminf(lo.x, v.x), fminf(lo.y, v.y), fminf(lo.z, v.z));
+        hi = MakeFloat3(fmaxf(hi.x, v.x), fmaxf(hi.y, v.y), fmaxf(hi.z, v.z));
+    }
+    Float3 extent = hi - lo;
+    animated = fmaxf(extent.x, fmaxf(extent.y, extent.z)) > 1e-6f;
+    minimum = animated ? lo : keys[first];
+    step = extent * (1.0f / 65535.0f);
+}
+
+inline void Quantize(const Float3& v, const Float3& minimum, const Float3& step, uint16_t* w)
+{
+    float c[3] = { v.x - minimum.x, v.y - minimum.y, v.z - minimum.z };
+    float st[3] = { step.x, step.y, step.z };
+    for (int i = 0; i < 3; ++i)
+    {
+        float q = st[i] > 0.0f ? c[i] / st[i] + 0.5f : 0.0f;
+        w[i] = (uint16_t)(q < 0.0f ? 0.0f : (q > 65535.0f ? 65535.0f : q));
+    }
+}
+
+// Recursive subdivision: keep [first, last], split at the worst interior frame
+// until every frame reconstructs within tolerance.
+inline void ReduceKeys(const Float3* qt, const Quat4* qr, const Float3* qs,
+                       const Float3* rt, const Quat4* rr, const Float3* rs,
+                       int first, int last, float length, float tolerance, std::vector<char>& keep)
+{
+    if (last - first < 2)
+        return;
+    int   worst = -1;
+    float worstError = tolerance;
+    float span = (float)(last - first);
+    for (int f = first + 1; f < last; ++f)
+    {
+        float u = (f - first) / span;
+        float e = KeyError(Lerp(qt[first], qt[last], u), QuatNlerp(qr[first], qr[last], u), Lerp(qs[first], qs[last], u),
+                           rt[f], rr[f], rs[f], length);
+        if (e > worstError)
+        {
+            worstError = e;
+            worst = f;
+        }
+    }
+    if (worst < 0)
+        return;
+    keep[worst] = 1;
+    ReduceKeys(qt, qr, qs, rt, rr, rs, first, worst, length, tolerance, keep);
+    ReduceKeys(qt, qr, qs, rt, rr, rs, worst, last, length, tolerance, keep);
+}
+
+inline void CompressClip(const AnimationClip& clip, const AnimRig& rig, const ClipCompressionSettings& settings, CompressedClip& out)
+{
+    assert(clip.NumBones == rig.NumBones());
+    assert(clip.NumFrames > 0 && clip.NumFrames <= 65536);
+
+    out = CompressedClip();
+    out.Name = clip.Name;
+    out.SampleRate = clip.SampleRate;
+    out.NumFrames = clip.NumFrames;
+    out.NumBones = clip.NumBones;
+    out.Tracks.resize(clip.NumBones);
+
+    std::vector<float> lengths;
+    ComputeVirtualLengths(rig, settings.MinVirtualLength, lengths);
+
+    const int n = clip.NumFrames;
+    std::vector<uint16_t> rotWords(n * 3), transWords(n * 3), scaleWords(n * 3);
+    std::vector<Float3> qt(n), qs(n);
+    std::vector<Quat4> qr(n);
+    std::vector<char> keep(n);
+
+    for (int b = 0; b < clip.NumBones; ++b)
+    {
+        CompressedBoneTrack& tr = out.Tracks[b];
+        size_t first = clip.Key(b, 0);
+        bool transAnimated, scaleAnimated;
+        QuantizeRange(clip.Translations, first, n, tr.TransMin, tr.TransStep, transAnimated);
+        QuantizeRange(clip.Scales, first, n, tr.ScaleMin, tr.ScaleStep, scaleAnimated);
+
+        // Quantize every frame first so key selection sees the values the decoder will see
+        for (int f = 0; f < n; ++f)
+        {
+            CompressedClip::EncodeRotation(QuatNormalize(clip.Rotations[first + f]), &rotWords[f * 3]);
+            qr[f] = CompressedClip::DecodeRotation(&rotWords[f * 3]);
+            Quantize(clip.Translations[first + f], tr.TransMin, tr.TransStep, &transWords[f * 3]);
+            qt[f] = transAnimated ? CompressedClip::Dequantize(&transWords[f * 3], tr.TransMin, tr.TransStep) : tr.TransMin;
+            Quantize(clip.Scales[first + f], tr.ScaleMin, tr.ScaleStep, &scaleWords[f * 3]);
+            qs[f] = scaleAnimated ? CompressedClip::Dequantize(&scaleWords[f * 3], tr.ScaleMin, tr.ScaleStep) : tr.ScaleMin;
+        }
+
+        std::fill(keep.begin(), keep.end(), 0);
+        keep[0] = keep[n - 1] = 1;
+        ReduceKeys(&qt[0], &qr[0], &qs[0], &clip.Translations[first], &clip.Rotations[first], &clip.Scales[first],
+                   0, n - 1, lengths[b], settings.ErrorFor(b), keep);
+
+        tr.FirstKey = (uint32_t)out.KeyFrames.size();
+        tr.FirstTrans = transAnimated ? (uint32_t)(out.Translations.size() / 3) : CompressedBoneTrack::ConstantTrack;
+        tr.FirstScale = scaleAnimated ? (uint32_t)(out.Scales.size() / 3) : CompressedBoneTrack::ConstantTrack;
+        for (int f = 0; f < n; ++f)
+        {
+            if (!keep[f])
+                continue;
+            out.KeyFrames.push_back((uint16_t)f);
+            out.Rotations.insert(out.Rotations.end(), &rotWords[f * 3], &rotWords[f * 3] + 3);
+            if (transAnimated)
+                out.Translations.insert(out.Translations.end(), &transWords[f * 3], &transWords[f * 3] + 3);
+            if (scaleAnimated)
+                out.Scales.insert(out.Scales.end(), &scaleWords[f * 3], &scaleWords[f * 3] + 3);
+        }
+        tr.NumKeys = (uint32_t)out.KeyFrames.size() - tr.FirstKey;
+    }
+}
+
+//---------------------------------------------------------------------------
+struct ClipCompressionStats
+{
+    size_t RawBytes;
+    size_t CompressedBytes;
+    int    RawKeys;
+    int    KeptKeys;
+    float  MaxError;            // worst positional error over all bones and frames
+    double RawSampleUs;         // average cost of one full-pose sample
+    double CompressedSampleUs;  // same, cursor (sequential playback) path
+
+    float Ratio() const { return CompressedBytes ? (float)RawBytes / (float)CompressedBytes : 0.0f; }
+};
+
+inline ClipCompressionStats MeasureClipCompression(const AnimationClip& raw, const AnimRig& rig, const CompressedClip& clip,
+                                                   const ClipCompressionSettings& settings, int numSamples = 1000)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    ClipCompressionStats stats;
+    stats.RawBytes = raw.SizeBytes();
+    stats.CompressedBytes = clip.SizeBytes();
+    stats.RawKeys = raw.NumBones * raw.NumFrames;
+    stats.KeptKeys = (int)clip.KeyFrames.size();
+    stats.MaxError = 0.0f;
+
+    std::vector<float> lengths;
+    ComputeVirtualLengths(rig, settings.MinVirtualLength, lengths);
+
+    LocalPose pose;
+    pose.Resize(raw.NumBones);
+    for (int f = 0; f < raw.NumFrames; ++f)
+    {
+        clip.Sample(f / raw.SampleRate, pose);
+        for (int b = 0; b < raw.NumBones; ++b)
+        {
+            size_t k = raw.Key(b, f);
+            float e = KeyError(pose.GetT(b), pose.GetR(b), pose.GetS(b), raw.Translations[k], raw.Rotations[k], raw.Scales[k], lengths[b]);
+            if (e > stats.MaxError)
+                stats.MaxError = e;
+        }
+    }
+
+    float step = numSamples > 1 ? raw.Duration() / (numSamples - 1) : 0.0f;
+    volatile float sink = 0.0f;
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < numSamples; ++i)
+    {
+        raw.Sample(i * step, pose);
+        sink = sink + pose.Rw[0];
+    }
+    Clock::time_point mid = Clock::now();
+    ClipCursor cursor;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        clip.Sample(i * step, pose, cursor);
+        sink = sink + pose.Rw[0];
+    }
+    Clock::time_point end = Clock::now();
+
+    stats.RawSampleUs = std::chrono::duration<double, std::micro>(mid - start).count() / numSamples;
+    stats.CompressedSampleUs = std::chrono::duration<double, std::micro>(end - mid).count() / numSamples;
+    return stats;
+}
+
+inline void FormatClipCompressionStats(const char* name, const ClipCompressionStats& s, char* buffer, size_t size)
+{
+    snprintf(buffer, size, "clip %s: %u -> %u bytes (%.1fx), keys %d/%d, max error %.4f, sample %.2f us raw / %.2f us compressed\n",
+             name, (unsigned)s.RawBytes, (unsigned)s.CompressedBytes, s.Ratio(), s.KeptKeys, s.RawKeys, s.MaxError,
+             s.RawSampleUs, s.CompressedSampleUs);
+}
+
+#endif // CLIP_COMPRESSION_H
@@ -0,0 +1,327 @@
+#ifndef GAP_FILTER_H
+#define GAP_FILTER_H
+
+// Ingest stage that hides dropped frames and garbage joints.
+//
+// Push() validates every joint of an incoming frame, four joints per SSE op:
+//   - a joint at the sensor origin is untracked,
+//   - a joint that moved faster than MaxJointSpeed since its last valid
+//     sample is a jump,
+//   - a joint whose bone to its parent is off the calibrated length by more
+//     than BoneTolerance (fraction) or BoneSlack (metres), whichever is
+//     larger, is a bad fit; the slack keeps the short, always noisy hand
+//     and foot bones from being flagged all the time.
+// Missing timestamps (a gap of more than 1.5 sample periods) are inserted as
+// fully invalid frames, up to MaxGapFrames.
+//
+// Frames leave through Pop() Lookahead frames late. Each invalid joint is
+// filled between the last emitted frame and its next valid sample inside
+// the lookahead window: a cubic Hermite curve through the positions, or a
+// slerp of the bone direction about the (already filled) parent. With no
+// valid sample in the window the joint holds its last position. Output
+// frames are always complete, so downstream stages never see a hole.
+
+#include "../Common/KinectBoneLengths.h"
+#include "../Common/MotionSimd.h"
+
+enum GapFillMode
+{
+    GapFill_Cubic,
+    GapFill_Slerp
+};
+
+struct GapFilterSettings
+{
+    int         Lookahead;          // output delay in frames
+    int         MaxGapFrames;       // longest run of missing frames that is reconstructed
+    float       MaxJointSpeed;      // m/s
+    float       BoneTolerance;      // allowed relative bone length error
+    float       BoneSlack;          // allowed absolute bone length error (m)
+    float       SampleRate;
+    GapFillMode Mode;
+
+    GapFilterSettings() : Lookahead(3), MaxGapFrames(15), MaxJointSpeed(6.0f), BoneTolerance(0.3f), BoneSlack(0.05f), SampleRate(30.0f), Mode(GapFill_Cubic) {}
+};
+
+struct GapFilterStats
+{
+    int Frames;             // frames emitted
+    int InsertedFrames;     // missing timestamps reconstructed
+    int JointsFlagged;
+    int JointsFilled;
+    int JointsHeld;         // no valid sample in the lookahead window
+    int Overflows;          // frames dropped because nobody popped
+};
+
+struct GapFilter
+{
+    struct Slot
+    {
+        SkeletonFrame Frame;
+        unsigned      Valid;        // bit per joint
+    };
+
+    GapFilterSettings        Settings;
+    const KinectBoneLengths* Bones;         // optional, used once calibrated
+    GapFilterStats           Stats;
+
+    std::vector<Slot>        Ring;
+    int                      Head, Pending;         // oldest pending slot, pending count
+    int                      Emitted;               // emitted frames still in the ring (history)
+    bool                     Flushing;
+    float                    LastX[KINECT_JOINT_STRIDE], LastY[KINECT_JOINT_STRIDE], LastZ[KINECT_JOINT_STRIDE];
+    double                   LastT[KINECT_JOINT_STRIDE];  // time of the last valid sample, < 0 for none
+    double                   LastTime;
+
+    GapFilter() : Bones(nullptr) { Reset(GapFilterSettings(), nullptr); }
+
+    void Reset(const GapFilterSettings& settings, const KinectBoneLengths* bones)
+    {
+        Settings = settings;
+        Bones = bones;
+        Stats = GapFilterStats();
+        // history (2) + gap + lookahead + the frame being pushed
+        Ring.assign(2 + settings.MaxGapFrames + settings.Lookahead + 2, Slot());
+        Head = Pending = Emitted = 0;
+        Flushing = false;
+        for (int j = 0; j < KINECT_JOINT_STRIDE; ++j)
+        {
+            LastX[j] = LastY[j] = LastZ[j] = 0.0f;
+            LastT[j] = -1.0;
+        }
+        LastTime = -1.0;
+    }
+
+    //-----------------------------------------------------------------------
+    void Push(const SkeletonFrame& frame)
+    {
+        Flushing = false;
+        double period = 1.0 / Settings.SampleRate;
+        if (LastTime >= 0.0)
+        {
+            if (frame.Time <= LastTime)
+                return;
+            int missing = (int)((frame.Time - LastTime) / period + 0.5) - 1;
+            if (missing > Settings.MaxGapFrames)
+                missing = Settings.MaxGapFrames;
+            for (int i = 1; i <= missing; ++i)
+            {
+                Slot& s = Append();
+                s.Frame.Clear();
+                s.Frame.Time = LastTime + (frame.Time - LastTime) * i / (missing + 1);
+                s.Valid = 0;
+                ++Stats.InsertedFrames;
+            }
+        }
+        LastTime = frame.Time;
+
+        Slot& s = Append();
+        s.Frame = frame;
+        s.Valid = Validate(frame);
+    }
+
+    // End of stream: the remaining frames are emitted without waiting
+    void Flush() { Flushing = true; }
+
+    bool Pop(SkeletonFrame& out)
+    {
+        if (Pending == 0 || (!Flushing && Pending <= Settings.Lookahead))
+            return false;
+        int e = Head;
+        Fill(e);
+        out = Ring[e].Frame;
+        Head = Wrap(Head + 1);
+        --Pending;
+        if (Emitted < 2)
+            ++Emitted;
+        ++Stats.Frames;
+        return true;
+    }
+
+private:
+    int Wrap(int i) const { int n = (int)Ring.size(); return i >= n ? i - n : (i < 0 ? i + n : i); }
+
+    Slot& Append()
+    {
+        // keep two emitted frames of history behind Head
+        if (Pending + Emitted >= (int)Ring.size())
+        {
+            if (Emitted > 0)
+                --Emitted;
+            else
+            {
+                Head = Wrap(Head + 1);
+                --Pending;
+                ++Stats.Overflows;
+            }
+        }
+        Slot& s = Ring[Wrap(Head + Pending)];
+        ++Pending;
+        return s;
+    }
+
+    unsigned Validate(const SkeletonFrame& f)
+    {
+        __m128 zero = _mm_setzero_ps();
+        // elapsed time since each joint's last valid sample, taken in double:
+        // clock timestamps are far too large to subtract as floats
+        float elapsed[KINECT_JOINT_STRIDE];
+        for (int j = 0; j < KINECT_JOINT_STRIDE; ++j)
+            elapsed[j] = LastT[j] < 0.0 ? -1.0f : (float)(f.Time - LastT[j]);
+        float px[KINECT_JOINT_STRIDE] = {}, py[KINECT_JOINT_STRIDE] = {}, pz[KINECT_JOINT_STRIDE] = {};
+        float lo[KINECT_JOINT_STRIDE] = {}, hi[KINECT_JOINT_STRIDE];
+        bool bones = Bones && Bones->Calibrated();
+        for (int j = 0; j < KINECT_JOINT_STRIDE; ++j)
+        {
+            int p = j < KinectJoint_Count ? KinectJointParent[j] : -1;
+            hi[j] = 1e6f;
+            if (p < 0)
+                continue;
+            px[j] = f.X[p]; py[j] = f.Y[p]; pz[j] = f.Z[p];
+            if (bones && Bones->Length[j] > 0.0f)
+            {
+                float len = Bones->Length[j];
+                float slack = len * Settings.BoneTolerance > Settings.BoneSlack ? len * Settings.BoneTolerance : Settings.BoneSlack;
+                float l0 = len > slack ? len - slack : 0.0f, l1 = len + slack;
+                lo[j] = l0 * l0;
+                hi[j] = l1 * l1;
+            }
+        }
+
+        unsigned valid = 0;
+        __m128 speed = _mm_set1_ps(Settings.MaxJointSpeed);
+        for (int j = 0; j < KINECT_JOINT_STRIDE; j += 4)
+        {
+            Vec3x4 p = LoadVec3x4(&f.X[j], &f.Y[j], &f.Z[j]);
+            __m128 tracked = _mm_cmpgt_ps(Dot4(p, p), _mm_set1_ps(1e-8f));
+
+            // distance since the last valid sample within speed * elapsed
+            __m128 dt = _mm_loadu_ps(&elapsed[j]);
+            Vec3x4 step = Sub4(p, LoadVec3x4(&LastX[j], &LastY[j], &LastZ[j]));
+            __m128 reach = _mm_mul_ps(speed, dt);
+            __m128 slowEnough = _mm_or_ps(_mm_cmplt_ps(dt, zero), _mm_cmple_ps(Dot4(step, step), _mm_mul_ps(reach, reach)));
+
+            Vec3x4 bone = Sub4(p, LoadVec3x4(&px[j], &py[j], &pz[j]));
+            __m128 len2 = Dot4(bone, bone);
+            __m128 boneOk = _mm_and_ps(_mm_cmpge_ps(len2, _mm_loadu_ps(&lo[j])), _mm_cmple_ps(len2, _mm_loadu_ps(&hi[j])));
+
+            valid |= (unsigned)_mm_movemask_ps(_mm_and_ps(tracked, _mm_and_ps(slowEnough, boneOk))) << j;
+        }
+        valid &= (1u << KinectJoint_Count) - 1;
+
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            if (!(valid & (1u << j)))
+            {
+                ++Stats.JointsFlagged;
+                continue;
+            }
+            LastX[j] = f.X[j]; LastY[j] = f.Y[j]; LastZ[j] = f.Z[j];
+            LastT[j] = f.Time;
+        }
+        return valid;
+    }
+
+    // Fills the invalid joints of slot e from the emitted history and the
+    // pending frames after it
+    void Fill(int e)
+    {
+        Slot& s = Ring[e];
+        unsigned all = (1u << KinectJoint_Count) - 1;
+        if (s.Valid == all)
+            return;
+        const Slot* prev = Emitted >= 1 ? &Ring[Wrap(e - 1)] : nullptr;
+        const Slot* prev2 = Emitted >= 2 ? &Ring[Wrap(e - 2)] : nullptr;
+
+        for (int h = 0; h < KinectJoint_Count; ++h)
+        {
+            int j = KinectHierarchyOrder[h];
+            if (s.Valid & (1u << j))
+                continue;
+
+            // next valid sample inside the window
+            const Slot* next = nullptr;
+            const Slot* next2 = nullptr;
+            for (int k = 1; k < Pending; ++k)
+            {
+                const Slot& c = Ring[Wrap(e + k)];
+                if (c.Valid & (1u << j))
+                {
+                    next = &c;
+                    if (k + 1 < Pending && (Ring[Wrap(e + k + 1)].Valid & (1u << j)))
+                        next2 = &Ring[Wrap(e + k + 1)];
+                    break;
+                }
+            }
+
+            if (!prev)
+            {
+                if (next)
+                    s.Frame.Set(j, next->Frame.Get(j));
+                ++Stats.JointsHeld;
+                continue;
+            }
+            if (!next)
+            {
+                s.Frame.Set(j, prev->Frame.Get(j));
+                ++Stats.JointsHeld;
+                continue;
+            }
+
+            // offsets from prev in double, narrowed once they are small
+            double t0 = prev->Frame.Time;
+            float span = (float)(next->Frame.Time - t0);
+            float u = (float)((s.Frame.Time - t0) / (next->Frame.Time - t0));
+            int p = KinectJointParent[j];
+            if (Settings.Mode == GapFill_Slerp && p >= 0)
+            {
+                Float3 a = prev->Frame.Get(j) - prev->Frame.Get(p);
+                Float3 b = next->Frame.Get(j) - next->Frame.Get(p);
+                float la = Length(a), lb = Length(b);
+                Float3 da = la > 0.0f ? a * (1.0f / la) : a, db = lb > 0.0f ? b * (1.0f / lb) : b;
+                Float3 d = QuatRotate(QuatSlerp(QuatIdentity(), QuatFromTo(da, db), u), da);
+                s.Frame.Set(j, s.Frame.Get(p) + d * (la + (lb - la) * u));
+            }
+            else
+            {
+                // Hermite with tangents from the neighbouring samples (secant if missing)
+                Float3 p0 = prev->Frame.Get(j), p1 = next->Frame.Get(j);
+                Float3 secant = (p1 - p0) * (1.0f / span);
+                Float3 m0 = prev2 ? (p0 - prev2->Frame.Get(j)) * (1.0f / (float)(prev->Frame.Time - prev2->Frame.Time)) : secant;
+                Float3 m1 = next2 ? (next2->Frame.Get(j) - p1) * (1.0f / (float)(next2->Frame.Time - next->Frame.Time)) : secant;
+                float u2 = u * u, u3 = u2 * u;
+                float h00 = 2.0f * u3 - 3.0f * u2 + 1.0f, h10 = u3 - 2.0f * u2 + u;
+                float h01 = -2.0f * u3 + 3.0f * u2, h11 = u3 - u2;
+                s.Frame.Set(j, p0 * h00 + m0 * (h10 * span) + p1 * h01 + m1 * (h11 * span));
+            }
+            ++Stats.JointsFilled;
+        }
+        s.Valid = all;
+    }
+};
+
+//---------------------------------------------------------------------------
+// Whole recording through the same filter, so offline and live output match
+inline void FillClipGaps(KinectClip& clip, const GapFilterSettings& settings, const KinectBoneLengths* bones, GapFilterStats* stats)
+{
+    GapFilter filter;
+    GapFilterSettings s = settings;
+    s.SampleRate = clip.SampleRate;
+    filter.Reset(s, bones);
+    SkeletonFrame frame;
+    int out = 0;
+    for (int f = 0; f < clip.NumFrames; ++f)
+    {
+        clip.GetFrame(f, frame);
+        filter.Push(frame);
+        while (filter.Pop(frame))
+            clip.SetFrame(out++, frame);
+    }
+    filter.Flush();
+    while (filter.Pop(frame))
+        clip.SetFrame(out++, frame);
+    if (stats)
+        *stats = filter.Stats;
+}
+
+#endif // GAP_FILTER_H
@@ -0,0 +1,373 @@
+#ifndef IK_SOLVER_H
+#define IK_SOLVER_H
+
+// Position IK for pinning hands and feet (two-bone, analytic) and bending
+// the spine toward a target (FABRIK).
+//
+// Both solvers work on SoA joint positions, so the same bank drives the
+// Kinect 25-joint frame and the model-space joints of the imported rig:
+//   SolveKinect - solves in place and carries the joints outside the chains
+//                 along with their parents (translation only)
+//   SolveRig    - solves the rig's model-space joints, then turns the moved
+//                 bones back into local rotations of the pose
+// Chains are solved four per SSE op. FABRIK chains of equal length share a
+// batch and run in lockstep for at most MaxIterations; a batch stops early
+// once every lane is within Tolerance. Chain joints must be consecutive in
+// the hierarchy (each joint the parent of the next).
+
+#include "../Common/AnimationClip.h"
+#include "../Common/KinectSkeleton.h"
+#include "../Common/MotionSimd.h"
+
+#include <chrono>
+
+#define IK_MAX_CHAIN_JOINTS 8
+
+struct IKTwoBoneChain
+{
+    int    Root, Mid, End;
+    Float3 Target;
+    Float3 Pole;        // bend toward this point; the current mid joint when !UsePole
+    bool   UsePole;
+    float  Weight;      // 0 leaves the chain alone, 1 reaches the target
+};
+
+struct IKFabrikChain
+{
+    int    Joints[IK_MAX_CHAIN_JOINTS];
+    int    NumJoints;
+    Float3 Target;
+    float  Weight;
+};
+
+// Kinect chains
+static const int KinectArmLeftChain[3]  = { KinectJoint_ShoulderLeft, KinectJoint_ElbowLeft, KinectJoint_WristLeft };
+static const int KinectArmRightChain[3] = { KinectJoint_ShoulderRight, KinectJoint_ElbowRight, KinectJoint_WristRight };
+static const int KinectLegLeftChain[3]  = { KinectJoint_HipLeft, KinectJoint_KneeLeft, KinectJoint_AnkleLeft };
+static const int KinectLegRightChain[3] = { KinectJoint_HipRight, KinectJoint_KneeRight, KinectJoint_AnkleRight };
+static const int KinectSpineChain[5]    = { KinectJoint_SpineBase, KinectJoint_SpineMid, KinectJoint_SpineShoulder, KinectJoint_Neck, KinectJoint_Head };
+
+//---------------------------------------------------------------------------
+inline Vec3x4 Reject4(const Vec3x4& v, const Vec3x4& unit)
+{
+    return Sub4(v, Scale4(unit, Dot4(v, unit)));
+}
+
+inline __m128 Length4(const Vec3x4& v)
+{
+    return _mm_sqrt_ps(Dot4(v, v));
+}
+
+// Analytic two-bone solve for four chains. a, b, c are root, mid and end;
+// hint is the point the mid joint should bend toward.
+inline void SolveTwoBone4(Vec3x4& b, Vec3x4& c, const Vec3x4& a, const Vec3x4& target, const Vec3x4& hint)
+{
+    __m128 eps = _mm_set1_ps(1e-4f), one = _mm_set1_ps(1.0f), zero = _mm_setzero_ps();
+    __m128 l1 = Length4(Sub4(b, a)), l2 = Length4(Sub4(c, b));
+
+    Vec3x4 at = Sub4(target, a);
+    __m128 d = Length4(at);
+    Vec3x4 u = Select4(_mm_cmpgt_ps(d, eps), Normalize4(at), Normalize4(Sub4(c, a)));
+    d = Clamp4(d, _mm_add_ps(_mm_max_ps(_mm_sub_ps(l1, l2), _mm_sub_ps(l2, l1)), eps), _mm_sub_ps(_mm_add_ps(l1, l2), eps));
+
+    // law of cosines for the angle at the root
+    __m128 cosA = _mm_div_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(l1, l1), _mm_mul_ps(d, d)), _mm_mul_ps(l2, l2)),
+                             _mm_max_ps(_mm_mul_ps(_mm_set1_ps(2.0f), _mm_mul_ps(l1, d)), eps));
+    cosA = Clamp4(cosA, _mm_set1_ps(-1.0f), one);
+    __m128 sinA = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosA, cosA)), zero));
+
+    // bend direction: the hint, else the current bend, else any perpendicular
+    Vec3x4 ex = { one, zero, zero }, ey = { zero, one, zero };
+    Vec3x4 candidates[4] = { Reject4(Sub4(hint, a), u), Reject4(Sub4(b, a), u), Reject4(ex, u), Reject4(ey, u) };
+    Vec3x4 v = candidates[3];
+    for (int i = 2; i >= 0; --i)
+        v = Select4(_mm_cmpgt_ps(Dot4(candidates[i], candidates[i]), _mm_set1_ps(1e-6f)), candidates[i], v);
+    v = Normalize4(v);
+
+    b = Add4(a, Scale4(Add4(Scale4(u, cosA), Scale4(v, sinA)), l1));
+    c = Add4(a, Scale4(u, d));
+}
+
+//---------------------------------------------------------------------------
+struct IKSolverBank
+{
+    std::vector<IKTwoBoneChain> TwoBone;
+    std::vector<IKFabrikChain>  Fabrik;
+    int                         MaxIterations;
+    float                       Tolerance;          // metres (rig units for SolveRig)
+    int                         LastIterations;     // most FABRIK iterations any batch used
+    double                      LastSolveUs;
+
+    // rig scratch, reused between frames
+    std::vector<Float3>         RigPos, RigOld;
+    std::vector<Quat4>          RigRot;
+    std::vector<float>          RigX, RigY, RigZ;
+
+    IKSolverBank() : MaxIterations(20), Tolerance(0.001f), LastIterations(0), LastSolveUs(0.0) {}
+
+    int AddTwoBone(int root, int mid, int end)
+    {
+        IKTwoBoneChain c;
+        c.Root = root; c.Mid = mid; c.End = end;
+        c.Target = c.Pole = MakeFloat3(0.0f, 0.0f, 0.0f);
+        c.UsePole = false;
+        c.Weight = 0.0f;
+        TwoBone.push_back(c);
+        return (int)TwoBone.size() - 1;
+    }
+
+    int AddTwoBone(const int* joints) { return AddTwoBone(joints[0], joints[1], joints[2]); }
+
+    int AddFabrik(const int* joints, int numJoints)
+    {
+        IKFabrikChain c;
+        c.NumJoints = numJoints < IK_MAX_CHAIN_JOINTS ? numJoints : IK_MAX_CHAIN_JOINTS;
+        for (int i = 0; i < c.NumJoints; ++i)
+            c.Joints[i] = joints[i];
+        c.Target = MakeFloat3(0.0f, 0.0f, 0.0f);
+        c.Weight = 0.0f;
+        Fabrik.push_back(c);
+        return (int)Fabrik.size() - 1;
+    }
+
+    // Rig chains by Mixamo name suffix; -1 when a bone is missing
+    int AddRigTwoBone(const AnimRig& rig, const char* root, const char* mid, const char* end)
+    {
+        int j[3] = { rig.FindBoneBySuffix(root), rig.FindBoneBySuffix(mid), rig.FindBoneBySuffix(end) };
+        if (j[0] < 0 || j[1] < 0 || j[2] < 0)
+            return -1;
+        return AddTwoBone(j);
+    }
+
+    //-----------------------------------------------------------------------
+    void SolveTwoBone(float* x, float* y, float* z)
+    {
+        for (size_t first = 0; first < TwoBone.size(); first += 4)
+        {
+            // gather; short batches repeat the first chain in the spare lanes
+            float ax[4], ay[4], az[4], bx[4], by[4], bz[4], cx[4], cy[4], cz[4], tx[4], ty[4], tz[4], hx[4], hy[4], hz[4];
+            int lanes = 0;
+            for (int l = 0; l < 4; ++l)
+            {
+                size_t i = first + l < TwoBone.size() ? first + l : first;
+                const IKTwoBoneChain& ch = TwoBone[i];
+                if (first + l < TwoBone.size() && ch.Weight > 0.0f)
+                    lanes |= 1 << l;
+                ax[l] = x[ch.Root]; ay[l] = y[ch.Root]; az[l] = z[ch.Root];
+                bx[l] = x[ch.Mid];  by[l] = y[ch.Mid];  bz[l] = z[ch.Mid];
+                cx[l] = x[ch.End];  cy[l] = y[ch.End];  cz[l] = z[ch.End];
+                Float3 t = Lerp(MakeFloat3(cx[l], cy[l], cz[l]), ch.Target, ch.Weight);
+                Float3 h = ch.UsePole ? ch.Pole : MakeFloat3(bx[l], by[l], bz[l]);
+                tx[l] = t.x; ty[l] = t.y; tz[l] = t.z;
+                hx[l] = h.x; hy[l] = h.y; hz[l] = h.z;
+            }
+            if (!lanes)
+                continue;
+
+            Vec3x4 b = LoadVec3x4(bx, by, bz), c = LoadVec3x4(cx, cy, cz);
+            SolveTwoBone4(b, c, LoadVec3x4(ax, ay, az), LoadVec3x4(tx, ty, tz), LoadVec3x4(hx, hy, hz));
+            StoreVec3x4(b, bx, by, bz);
+            StoreVec3x4(c, cx, cy, cz);
+
+            for (int l = 0; l < 4; ++l)
+            {
+                if (!(lanes & (1 << l)))
+                    continue;
+                const IKTwoBoneChain& ch = TwoBone[first + l];
+                x[ch.Mid] = bx[l]; y[ch.Mid] = by[l]; z[ch.Mid] = bz[l];
+                x[ch.End] = cx[l]; y[ch.End] = cy[l]; z[ch.End] = cz[l];
+            }
+        }
+    }
+
+    void SolveFabrik(float* x, float* y, float* z)
+    {
+        LastIterations = 0;
+        for (int n = 2; n <= IK_MAX_CHAIN_JOINTS; ++n)
+        {
+            int batch[4], count = 0;
+            for (size_t i = 0; i <= Fabrik.size(); ++i)
+            {
+                if (i < Fabrik.size() && Fabrik[i].NumJoints == n && Fabrik[i].Weight > 0.0f)
+                    batch[count++] = (int)i;
+                if (count == 4 || (i == Fabrik.size() && count > 0))
+                {
+                    SolveFabrikBatch(x, y, z, batch, count, n);
+                    count = 0;
+                }
+            }
+        }
+    }
+
+    //-----------------------------------------------------------------------
+    // Kinect layout: FABRIK first so the limbs start from the bent spine
+    void SolveKinect(SkeletonFrame& frame)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        SkeletonFrame before = frame;
+        SolveFabrik(frame.X, frame.Y, frame.Z);
+        CarryKinectJoints(before, frame);
+        before = frame;
+        SolveTwoBone(frame.X, frame.Y, frame.Z);
+        CarryKinectJoints(before, frame);
+        LastSolveUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // Rig: solves on model-space joints and writes rotations into the pose.
+    // Targets are in the rig's model space.
+    void SolveRig(const AnimRig& rig, LocalPose& pose)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        if (HasActive(Fabrik))
+        {
+            BeginRig(rig, pose);
+            SolveFabrik(&RigX[0], &RigY[0], &RigZ[0]);
+            for (size_t i = 0; i < Fabrik.size(); ++i)
+                if (Fabrik[i].Weight > 0.0f)
+                    WriteRigChain(rig, Fabrik[i].Joints, Fabrik[i].NumJoints, pose);
+        }
+        if (HasActive(TwoBone))
+        {
+            BeginRig(rig, pose);
+            SolveTwoBone(&RigX[0], &RigY[0], &RigZ[0]);
+            for (size_t i = 0; i < TwoBone.size(); ++i)
+            {
+                const IKTwoBoneChain& c = TwoBone[i];
+                int joints[3] = { c.Root, c.Mid, c.End };
+                if (c.Weight > 0.0f)
+                    WriteRigChain(rig, joints, 3, pose);
+            }
+        }
+        LastSolveUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+private:
+    template <typename T>
+    static bool HasActive(const std::vector<T>& chains)
+    {
+        for (size_t i = 0; i < chains.size(); ++i)
+            if (chains[i].Weight > 0.0f)
+                return true;
+        return false;
+    }
+
+    void SolveFabrikBatch(float* x, float* y, float* z, const int* batch, int count, int n)
+    {
+        Vec3x4 p[IK_MAX_CHAIN_JOINTS];
+        __m128 len[IK_MAX_CHAIN_JOINTS];
+        float gx[4], gy[4], gz[4];
+        for (int j = 0; j < n; ++j)
+        {
+            for (int l = 0; l < 4; ++l)
+            {
+                int joint = Fabrik[batch[l < count ? l : 0]].Joints[j];
+                gx[l] = x[joint]; gy[l] = y[joint]; gz[l] = z[joint];
+            }
+            p[j] = LoadVec3x4(gx, gy, gz);
+        }
+        for (int l = 0; l < 4; ++l)
+        {
+            const IKFabrikChain& c = Fabrik[batch[l < count ? l : 0]];
+            Float3 t = Lerp(MakeFloat3(x[c.Joints[n - 1]], y[c.Joints[n - 1]], z[c.Joints[n - 1]]), c.Target, c.Weight);
+            gx[l] = t.x; gy[l] = t.y; gz[l] = t.z;
+        }
+        Vec3x4 target = LoadVec3x4(gx, gy, gz);
+
+        __m128 total = _mm_setzero_ps();
+        for (int j = 0; j < n - 1; ++j)
+        {
+            len[j] = Length4(Sub4(p[j + 1], p[j]));
+            total = _mm_add_ps(total, len[j]);
+        }
+        Vec3x4 root = p[0];
+
+        // out of reach: the answer is the straight chain toward the target
+        __m128 unreachable = _mm_cmpge_ps(Length4(Sub4(target, root)), total);
+        Vec3x4 dir = Normalize4(Sub4(target, root));
+        Vec3x4 straight[IK_MAX_CHAIN_JOINTS];
+        straight[0] = root;
+        for (int j = 1; j < n; ++j)
+            straight[j] = Add4(straight[j - 1], Scale4(dir, len[j - 1]));
+
+        __m128 tol2 = _mm_set1_ps(Tolerance * Tolerance);
+        int iterations = 0;
+        while (iterations < MaxIterations)
+        {
+            __m128 done = _mm_or_ps(unreachable, _mm_cmplt_ps(Dot4(Sub4(p[n - 1], target), Sub4(p[n - 1], target)), tol2));
+            if (_mm_movemask_ps(done) == 0xf)
+                break;
+            ++iterations;
+
+            p[n - 1] = target;
+            for (int j = n - 2; j >= 0; --j)
+                p[j] = Add4(p[j + 1], Scale4(Normalize4(Sub4(p[j], p[j + 1])), len[j]));
+            p[0] = root;
+            for (int j = 1; j < n; ++j)
+                p[j] = Add4(p[j - 1], Scale4(Normalize4(Sub4(p[j], p[j - 1])), len[j - 1]));
+        }
+        if (iterations > LastIterations)
+            LastIterations = iterations;
+
+        for (int j = 1; j < n; ++j)
+        {
+            StoreVec3x4(Select4(unreachable, straight[j], p[j]), gx, gy, gz);
+            for (int l = 0; l < count; ++l)
+            {
+                int joint = Fabrik[batch[l]].Joints[j];
+                x[joint] = gx[l]; y[joint] = gy[l]; z[joint] = gz[l];
+            }
+        }
+    }
+
+    // Joints outside the chains follow their parent's displacement
+    static void CarryKinectJoints(const SkeletonFrame& before, SkeletonFrame& after)
+    {
+        float dx[KinectJoint_Count], dy[KinectJoint_Count], dz[KinectJoint_Count];
+        for (int h = 0; h < KinectJoint_Count; ++h)
+        {
+            int j = KinectHierarchyOrder[h];
+            int p = KinectJointParent[j];
+            dx[j] = after.X[j] - before.X[j];
+            dy[j] = after.Y[j] - before.Y[j];
+            dz[j] = after.Z[j] - before.Z[j];
+            if (p >= 0 && dx[j] == 0.0f && dy[j] == 0.0f && dz[j] == 0.0f)
+            {
+                dx[j] = dx[p]; dy[j] = dy[p]; dz[j] = dz[p];
+                after.X[j] += dx[j]; after.Y[j] += dy[j]; after.Z[j] += dz[j];
+            }
+        }
+    }
+
+    void BeginRig(const AnimRig& rig, const LocalPose& pose)
+    {
+        LocalToGlobal(rig, pose, RigPos, RigRot);
+        RigOld = RigPos;
+        size_t n = RigPos.size();
+        RigX.resize(n); RigY.resize(n); RigZ.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            RigX[i] = RigPos[i].x; RigY[i] = RigPos[i].y; RigZ[i] = RigPos[i].z;
+        }
+    }
+
+    // Every chain bone turns by the swing between its old and new direction;
+    // the end bone keeps its model-space rotation. Locals are recomputed from
+    // the updated globals, so bones hanging off the chain follow rigidly.
+    void WriteRigChain(const AnimRig& rig, const int* joints, int n, LocalPose& pose)
+    {
+        for (int i = 0; i < n - 1; ++i)
+        {
+            int j = joints[i], k = joints[i + 1];
+            Float3 oldDir = Normalize(RigOld[k] - RigOld[j]);
+            Float3 newDir = Normalize(MakeFloat3(RigX[k] - RigX[j], RigY[k] - RigY[j], RigZ[k] - RigZ[j]));
+            Quat4 endRot = RigRot[k];
+            RigRot[j] = QuatNormalize(QuatMul(QuatFromTo(oldDir, newDir), RigRot[j]));
+            int p = rig.Bones[j].Parent;
+            pose.SetR(j, p >= 0 ? QuatNormalize(QuatMul(QuatConjugate(RigRot[p]), RigRot[j])) : RigRot[j]);
+            if (i == n - 2)
+                pose.SetR(k, QuatNormalize(QuatMul(QuatConjugate(RigRot[j]), endRot)));
+        }
+    }
+};
+
+#endif // IK_SOLVER_H
@@ -0,0 +1,340 @@
+#ifndef JOINT_ANGLES_H
+#define JOINT_ANGLES_H
+
+// Anatomical joint angles over a whole recording.
+//
+// ComputeJointAngles evaluates every angle for every frame of a KinectClip
+// straight from its joint-major channels, WIDE_LANES frames per op (eight
+// when built with /arch:AVX2, four with SSE; the app project builds the SSE
+// path, see WideFloat in MotionSimd.h), then runs a Savitzky-Golay filter along each
+// angle column for the smoothed angle and its angular velocity, and records
+// the range of motion. Results are columnar: one contiguous column per
+// angle and channel, in degrees and degrees per second.
+//
+// Angles, all 0 in the anatomical neutral pose:
+//   elbow / knee flexion       angle between the two segments
+//   shoulder abduction         upper arm elevation towards the side,
+//                              negative across the body
+//   shoulder / hip flexion     upper arm / thigh elevation towards the front,
+//                              negative behind
+//   shoulder elevation         upper arm angle from straight down, in any
+//                              direction (0-180)
+// The trunk frame is rebuilt per frame: up from SpineBase to SpineShoulder,
+// right along the shoulder line, forward = up x right. Elevation (the angle
+// from straight down, 0-180) is split between the sagittal and frontal
+// components by the direction the limb points in the horizontal plane. A
+// goniometer-style projection onto each plane flips by 180 degrees whenever
+// the arm passes above the horizontal in the other plane (every lateral
+// raise); the split is only ambiguous with the limb straight overhead.
+
+#include "../Common/MotionFile.h"
+#include "../Common/MotionSimd.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+enum JointAngle
+{
+    JointAngle_ElbowLeft,
+    JointAngle_ElbowRight,
+    JointAngle_KneeLeft,
+    JointAngle_KneeRight,
+    JointAngle_ShoulderAbductionLeft,
+    JointAngle_ShoulderAbductionRight,
+    JointAngle_ShoulderFlexionLeft,
+    JointAngle_ShoulderFlexionRight,
+    JointAngle_HipFlexionLeft,
+    JointAngle_HipFlexionRight,
+    JointAngle_ShoulderElevationLeft,
+    JointAngle_ShoulderElevationRight,
+    JointAngle_Count
+};
+
+static const char* const JointAngleNames[JointAngle_Count] =
+{
+    "ElbowLeft", "ElbowRight", "KneeLeft", "KneeRight",
+    "ShoulderAbductionLeft", "ShoulderAbductionRight", "ShoulderFlexionLeft", "ShoulderFlexionRight",
+    "HipFlexionLeft", "HipFlexionRight", "ShoulderElevationLeft", "ShoulderElevationRight"
+};
+
+enum JointAngleChannel
+{
+    JointAngleChannel_Raw,          // degrees, straight from the positions
+    JointAngleChannel_Smoothed,     // degrees, Savitzky-Golay
+    JointAngleChannel_Velocity,     // degrees per second, Savitzky-Golay derivative
+    JointAngleChannel_Count
+};
+
+#define JOINT_ANGLE_MAX_HALF_WINDOW 12
+
+struct JointAngleRange
+{
+    float Min, Max;             // smoothed degrees
+    float PeakVelocity;         // |deg/s|
+
+    float Range() const { return Max - Min; }
+};
+
+struct JointAngleTable
+{
+    float              SampleRate;
+    int                NumFrames;
+    int                FrameStride;     // same padding as the source clip
+    int                HalfWindow;      // filter window is 2 * HalfWindow + 1 frames
+    std::vector<float> Data;            // [(angle * JointAngleChannel_Count + channel) * FrameStride + frame]
+    JointAngleRange    Ranges[JointAngle_Count];
+    std::vector<float> Scratch;         // one edge-padded column
+
+    JointAngleTable() : SampleRate(30.0f), NumFrames(0), FrameStride(0), HalfWindow(3) {}
+
+    // Keeps capacity, so one table can be reused across a batch of clips
+    void Allocate(int numFrames, int frameStride, float sampleRate)
+    {
+        NumFrames = numFrames;
+        FrameStride = frameStride;
+        SampleRate = sampleRate;
+        Data.resize((size_t)JointAngle_Count * JointAngleChannel_Count * frameStride);
+        Scratch.resize((size_t)frameStride + 2 * JOINT_ANGLE_MAX_HALF_WINDOW + WIDE_LANES);
+    }
+
+    float* Column(int angle, int channel) { return &Data[(size_t)(angle * JointAngleChannel_Count + channel) * FrameStride]; }
+    const float* Column(int angle, int channel) const { return &Data[(size_t)(angle * JointAngleChannel_Count + channel) * FrameStride]; }
+
+    float Get(int angle, int channel, int frame) const { return Column(angle, channel)[frame]; }
+};
+
+//---------------------------------------------------------------------------
+struct WideVec3
+{
+    WideFloat x, y, z;
+};
+
+inline WideVec3 LoadWideJoint(const KinectClip& clip, int joint, int frame)
+{
+    size_t i = clip.Index(joint, frame);
+    WideVec3 v = { WideLoad(&clip.X[i]), WideLoad(&clip.Y[i]), WideLoad(&clip.Z[i]) };
+    return v;
+}
+
+inline WideVec3 WideSub3(const WideVec3& a, const WideVec3& b)
+{
+    WideVec3 r = { WideSub(a.x, b.x), WideSub(a.y, b.y), WideSub(a.z, b.z) };
+    return r;
+}
+
+inline WideVec3 WideScale3(const WideVec3& a, WideFloat s)
+{
+    WideVec3 r = { WideMul(a.x, s), WideMul(a.y, s), WideMul(a.z, s) };
+    return r;
+}
+
+inline WideFloat WideDot3(const WideVec3& a, const WideVec3& b)
+{
+    return WideMulAdd(a.x, b.x, WideMulAdd(a.y, b.y, WideMul(a.z, b.z)));
+}
+
+inline WideVec3 WideCross3(const WideVec3& a, const WideVec3& b)
+{
+    WideVec3 r = { WideSub(WideMul(a.y, b.z), WideMul(a.z, b.y)),
+                   WideSub(WideMul(a.z, b.x), WideMul(a.x, b.z)),
+                   WideSub(WideMul(a.x, b.y), WideMul(a.y, b.x)) };
+    return r;
+}
+
+inline WideVec3 WideNormalize3(const WideVec3& a)
+{
+    return WideScale3(a, WideDiv(WideSet(1.0f), WideSqrt(WideMax(WideDot3(a, a), WideSet(1e-12f)))));
+}
+
+// Unsigned angle between two segments, degrees
+inline WideFloat WideSegmentAngle(const WideVec3& u, const WideVec3& v)
+{
+    WideVec3 c = WideCross3(u, v);
+    return WideMul(WideAtan2(WideSqrt(WideDot3(c, c)), WideDot3(u, v)), WideSet(57.2957795f));
+}
+
+// Angle of v from 'down', radians
+inline WideFloat WideElevation(const WideVec3& v, const WideVec3& down)
+{
+    WideFloat d = WideDot3(v, down);
+    return WideAtan2(WideSqrt(WideMax(WideSub(WideDot3(v, v), WideMul(d, d)), WideSet(0.0f))), d);
+}
+
+// Elevation of v away from 'down', degrees, carried by the horizontal
+// direction 'towards' in proportion to cos^2 of the limb's heading from it
+inline WideFloat WideElevationPart(const WideVec3& v, const WideVec3& down, const WideVec3& towards, const WideVec3& across)
+{
+    WideFloat t = WideDot3(v, towards), c = WideDot3(v, across);
+    WideFloat horizontal = WideMulAdd(t, t, WideMul(c, c));
+    WideFloat elevation = WideAtan2(WideSqrt(horizontal), WideDot3(v, down));
+    WideFloat share = WideDiv(WideMul(t, WideAbs(t)), WideMax(horizontal, WideSet(1e-12f)));
+    return WideMul(WideMul(elevation, share), WideSet(57.2957795f));
+}
+
+//---------------------------------------------------------------------------
+// Raw angles for frames [0, FrameStride); padding frames hold whatever the
+// clip's zero padding produces and are never read back as results.
+inline void ComputeRawJointAngles(const KinectClip& clip, JointAngleTable& out)
+{
+    WideFloat zero = WideSet(0.0f);
+    for (int f = 0; f < clip.FrameStride; f += WIDE_LANES)
+    {
+        WideVec3 spineBase = LoadWideJoint(clip, KinectJoint_SpineBase, f);
+        WideVec3 spineShoulder = LoadWideJoint(clip, KinectJoint_SpineShoulder, f);
+        WideVec3 shoulderL = LoadWideJoint(clip, KinectJoint_ShoulderLeft, f);
+        WideVec3 shoulderR = LoadWideJoint(clip, KinectJoint_ShoulderRight, f);
+        WideVec3 elbowL = LoadWideJoint(clip, KinectJoint_ElbowLeft, f);
+        WideVec3 elbowR = LoadWideJoint(clip, KinectJoint_ElbowRight, f);
+        WideVec3 wristL = LoadWideJoint(clip, KinectJoint_WristLeft, f);
+        WideVec3 wristR = LoadWideJoint(clip, KinectJoint_WristRight, f);
+        WideVec3 hipL = LoadWideJoint(clip, KinectJoint_HipLeft, f);
+        WideVec3 hipR = LoadWideJoint(clip, KinectJoint_HipRight, f);
+        WideVec3 kneeL = LoadWideJoint(clip, KinectJoint_KneeLeft, f);
+        WideVec3 kneeR = LoadWideJoint(clip, KinectJoint_KneeRight, f);
+        WideVec3 ankleL = LoadWideJoint(clip, KinectJoint_AnkleLeft, f);
+        WideVec3 ankleR = LoadWideJoint(clip, KinectJoint_AnkleRight, f);
+
+        // trunk frame
+        WideVec3 up = WideNormalize3(WideSub3(spineShoulder, spineBase));
+        WideVec3 right = WideSub3(shoulderR, shoulderL);
+        right = WideNormalize3(WideSub3(right, WideScale3(up, WideDot3(right, up))));
+        WideVec3 forward = WideCross3(up, right);
+        WideVec3 down = { WideSub(zero, up.x), WideSub(zero, up.y), WideSub(zero, up.z) };
+        WideVec3 left = { WideSub(zero, right.x), WideSub(zero, right.y), WideSub(zero, right.z) };
+
+        WideVec3 upperArmL = WideSub3(elbowL, shoulderL), upperArmR = WideSub3(elbowR, shoulderR);
+        WideVec3 thighL = WideSub3(kneeL, hipL), thighR = WideSub3(kneeR, hipR);
+
+        WideStore(&out.Column(JointAngle_ElbowLeft, JointAngleChannel_Raw)[f], WideSegmentAngle(upperArmL, WideSub3(wristL, elbowL)));
+        WideStore(&out.Column(JointAngle_ElbowRight, JointAngleChannel_Raw)[f], WideSegmentAngle(upperArmR, WideSub3(wristR, elbowR)));
+        WideStore(&out.Column(JointAngle_KneeLeft, JointAngleChannel_Raw)[f], WideSegmentAngle(thighL, WideSub3(ankleL, kneeL)));
+        WideStore(&out.Column(JointAngle_KneeRight, JointAngleChannel_Raw)[f], WideSegmentAngle(thighR, WideSub3(ankleR, kneeR)));
+        WideStore(&out.Column(JointAngle_ShoulderAbductionLeft, JointAngleChannel_Raw)[f], WideElevationPart(upperArmL, down, left, forward));
+        WideStore(&out.Column(JointAngle_ShoulderAbductionRight, JointAngleChannel_Raw)[f], WideElevationPart(upperArmR, down, right, forward));
+        WideStore(&out.Column(JointAngle_ShoulderFlexionLeft, JointAngleChannel_Raw)[f], WideElevationPart(upperArmL, down, forward, right));
+        WideStore(&out.Column(JointAngle_ShoulderFlexionRight, JointAngleChannel_Raw)[f], WideElevationPart(upperArmR, down, forward, right));
+        WideStore(&out.Column(JointAngle_HipFlexionLeft, JointAngleChannel_Raw)[f], WideElevationPart(thighL, down, forward, right));
+        WideStore(&out.Column(JointAngle_HipFlexionRight, JointAngleChannel_Raw)[f], WideElevationPart(thighR, down, forward, right));
+        WideStore(&out.Column(JointAngle_ShoulderElevationLeft, JointAngleChannel_Raw)[f], WideMul(WideElevation(upperArmL, down), WideSet(57.2957795f)));
+        WideStore(&out.Column(JointAngle_ShoulderElevationRight, JointAngleChannel_Raw)[f], WideMul(WideElevation(upperArmR, down), WideSet(57.2957795f)));
+    }
+}
+
+// Savitzky-Golay weights for a quadratic fit over 2m + 1 samples: the
+// smoothed value and the first derivative (per sample) at the centre.
+inline void SavitzkyGolayWeights(int m, float* smooth, float* slope)
+{
+    float norm = (float)((2 * m - 1) * (2 * m + 1) * (2 * m + 3));
+    float sumK2 = (float)(m * (m + 1) * (2 * m + 1)) / 3.0f;
+    for (int k = -m; k <= m; ++k)
+    {
+        smooth[k + m] = (3.0f * (3 * m * m + 3 * m - 1) - 15.0f * k * k) / norm;
+        slope[k + m] = k / sumK2;
+    }
+}
+
+// Smoothed angle, angular velocity and range of motion for every column.
+// Ends are padded by repeating the first and last frame.
+inline void FilterJointAngles(JointAngleTable& out)
+{
+    int m = std::min(std::max(out.HalfWindow, 1), JOINT_ANGLE_MAX_HALF_WINDOW);
+    int n = out.NumFrames;
+    float smooth[2 * JOINT_ANGLE_MAX_HALF_WINDOW + 1], slope[2 * JOINT_ANGLE_MAX_HALF_WINDOW + 1];
+    SavitzkyGolayWeights(m, smooth, slope);
+    for (int k = 0; k <= 2 * m; ++k)
+        slope[k] *= out.SampleRate;
+
+    float* pad = &out.Scratch[0];
+    for (int a = 0; a < JointAngle_Count; ++a)
+    {
+        JointAngleRange& range = out.Ranges[a];
+        range.Min = range.Max = range.PeakVelocity = 0.0f;
+        if (n == 0)
+            continue;
+
+        const float* raw = out.Column(a, JointAngleChannel_Raw);
+        float* smoothed = out.Column(a, JointAngleChannel_Smoothed);
+        float* velocity = out.Column(a, JointAngleChannel_Velocity);
+        for (int k = 0; k < m; ++k)
+            pad[k] = raw[0];
+        std::copy(raw, raw + n, pad + m);
+        std::fill(pad + m + n, pad + 2 * m + out.FrameStride, raw[n - 1]);
+
+        for (int f = 0; f < out.FrameStride; f += WIDE_LANES)
+        {
+            WideFloat s = WideSet(0.0f), v = WideSet(0.0f);
+            for (int k = 0; k <= 2 * m; ++k)
+            {
+                WideFloat x = WideLoad(pad + f + k);
+                s = WideMulAdd(WideSet(smooth[k]), x, s);
+                v = WideMulAdd(WideSet(slope[k]), x, v);
+            }
+            WideStore(smoothed + f, s);
+            WideStore(velocity + f, v);
+        }
+
+        WideFloat lo = WideSet(smoothed[0]), hi = lo, peak = WideSet(0.0f);
+        int f = 0;
+        for (; f + WIDE_LANES <= n; f += WIDE_LANES)
+        {
+            WideFloat s = WideLoad(smoothed + f);
+            lo = WideMin(lo, s);
+            hi = WideMax(hi, s);
+            peak = WideMax(peak, WideAbs(WideLoad(velocity + f)));
+        }
+        range.Min = WideHorizontalMin(lo);
+        range.Max = WideHorizontalMax(hi);
+        range.PeakVelocity = WideHorizontalMax(peak);
+        for (; f < n; ++f)
+        {
+            range.Min = std::min(range.Min, smoothed[f]);
+            range.Max = std::max(range.Max, smoothed[f]);
+            range.PeakVelocity = std::max(range.PeakVelocity, fabsf(velocity[f]));
+        }
+    }
+}
+
+inline void ComputeJointAngles(const KinectClip& clip, JointAngleTable& out)
+{
+    out.Allocate(clip.NumFrames, clip.FrameStride, clip.SampleRate);
+    ComputeRawJointAngles(clip, out);
+    FilterJointAngles(out);
+}
+
+//---------------------------------------------------------------------------
+inline void FormatRangeOfMotion(const JointAngleTable& table, std::string& out)
+{
+    char line[160];
+    out = "range of motion (min / max / range deg, peak deg/s):\n";
+    for (int a = 0; a < JointAngle_Count; ++a)
+    {
+        const JointAngleRange& r = table.Ranges[a];
+        snprintf(line, sizeof(line), "  %-24s %7.1f / %7.1f / %6.1f  %7.1f\n", JointAngleNames[a], r.Min, r.Max, r.Range(), r.PeakVelocity);
+        out += line;
+    }
+}
+
+// One row per frame: time, then smoothed angle and velocity per joint angle
+inline bool WriteJointAngleCsv(const JointAngleTable& table, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+    fputs("time", file);
+    for (int a = 0; a < JointAngle_Count; ++a)
+        fprintf(file, ",%s,%sVelocity", JointAngleNames[a], JointAngleNames[a]);
+    fputc('\n', file);
+    for (int f = 0; f < table.NumFrames; ++f)
+    {
+        fprintf(file, "%.4f", f / table.SampleRate);
+        for (int a = 0; a < JointAngle_Count; ++a)
+            fprintf(file, ",%.2f,%.2f", table.Get(a, JointAngleChannel_Smoothed, f), table.Get(a, JointAngleChannel_Velocity, f));
+        fputc('\n', file);
+    }
+    return fclose(file) == 0;
+}
+
+#endif // JOINT_ANGLES_H
@@ -0,0 +1,186 @@
+#ifndef JOINT_PREDICTOR_H
+#define JOINT_PREDICTOR_H
+
+// Latency hiding for the Kinect body.
+//
+// The HMD pose is predicted to the display time by the runtime; the body is a
+// 30 Hz stream that arrives 60-90 ms late. JointPredictor extrapolates every
+// joint from its last three samples to the requested time:
+//   p(t0 + h) = p0 + v h (+ a h^2 / 2)
+// and clamps the displacement to a radius that shrinks with the joint's
+// confidence. Confidence is how well the joint's previous velocity predicted
+// its latest sample; jittery or mis-tracked joints get pulled back towards
+// their last measurement. Four joints per SSE op.
+//
+// Frame times and the prediction time must be on the same clock
+// (ovr_GetTimeInSeconds for the live stream).
+
+#include "../Common/MotionFile.h"
+#include "../Common/MotionSimd.h"
+
+#include <stdio.h>
+#include <string>
+
+enum PredictionMode
+{
+    Prediction_Off,             // latest sample as is
+    Prediction_Velocity,
+    Prediction_Acceleration,
+    Prediction_Count
+};
+
+static const char* const PredictionModeNames[Prediction_Count] = { "off", "velocity", "acceleration" };
+
+struct JointPredictor
+{
+    PredictionMode Mode;
+    float          MaxHorizon;      // seconds; never extrapolate further
+    float          MaxOffset;       // metres a fully trusted joint may move
+    float          ResidualLimit;   // one-step error (m) at which a joint gets no offset
+    SkeletonFrame  History[3];      // newest first
+    int            Count;
+    float          Confidence[KINECT_JOINT_STRIDE];
+
+    JointPredictor() : Mode(Prediction_Velocity), MaxHorizon(0.12f), MaxOffset(0.15f), ResidualLimit(0.05f), Count(0)
+    {
+        for (int j = 0; j < KINECT_JOINT_STRIDE; ++j)
+            Confidence[j] = 0.0f;
+    }
+
+    void Reset() { Count = 0; }
+
+    const SkeletonFrame& Latest() const { return History[0]; }
+
+    void Push(const SkeletonFrame& frame)
+    {
+        // a repeated or out-of-order timestamp would divide by zero below
+        if (Count > 0 && frame.Time <= History[0].Time)
+            return;
+        History[2] = History[1];
+        History[1] = History[0];
+        History[0] = frame;
+        if (Count < 3)
+            ++Count;
+    }
+
+    void Predict(double time, SkeletonFrame& out)
+    {
+        out = History[0];
+        if (Mode == Prediction_Off || Count < 2)
+            return;
+
+        float h = (float)(time - History[0].Time);
+        h = h < 0.0f ? 0.0f : (h > MaxHorizon ? MaxHorizon : h);
+        out.Time = History[0].Time + h;
+
+        bool accel = Mode == Prediction_Acceleration && Count == 3;
+        bool residual = Count == 3;
+        float dt01 = (float)(History[0].Time - History[1].Time);
+        float dt12 = residual ? (float)(History[1].Time - History[2].Time) : dt01;
+
+        __m128 inv01 = _mm_set1_ps(1.0f / dt01), inv12 = _mm_set1_ps(1.0f / dt12);
+        __m128 invMid = _mm_set1_ps(2.0f / (dt01 + dt12));
+        __m128 hs = _mm_set1_ps(h), halfH2 = _mm_set1_ps(0.5f * h * h);
+        __m128 d01 = _mm_set1_ps(dt01);
+        __m128 invLimit = _mm_set1_ps(1.0f / ResidualLimit), maxOffset = _mm_set1_ps(MaxOffset);
+        __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+
+        const SkeletonFrame& f0 = History[0];
+        const SkeletonFrame& f1 = History[1];
+        const SkeletonFrame& f2 = History[residual ? 2 : 1];
+        for (int j = 0; j < KINECT_JOINT_STRIDE; j += 4)
+        {
+            Vec3x4 p0 = LoadVec3x4(&f0.X[j], &f0.Y[j], &f0.Z[j]);
+            Vec3x4 p1 = LoadVec3x4(&f1.X[j], &f1.Y[j], &f1.Z[j]);
+            Vec3x4 v0 = Scale4(Sub4(p0, p1), inv01);
+            Vec3x4 offset = Scale4(v0, hs);
+
+            __m128 conf = one;
+            if (residual)
+            {
+                Vec3x4 v1 = Scale4(Sub4(p1, LoadVec3x4(&f2.X[j], &f2.Y[j], &f2.Z[j])), inv12);
+                Vec3x4 miss = Sub4(p0, Add4(p1, Scale4(v1, d01)));
+                conf = Clamp4(_mm_sub_ps(one, _mm_mul_ps(_mm_sqrt_ps(Dot4(miss, miss)), invLimit)), zero, one);
+                if (accel)
+                    offset = Add4(offset, Scale4(Scale4(Sub4(v0, v1), invMid), halfH2));
+            }
+            _mm_storeu_ps(&Confidence[j], conf);
+
+            // |offset| <= MaxOffset * confidence
+            __m128 radius = _mm_mul_ps(maxOffset, conf);
+            __m128 scale = _mm_min_ps(one, _mm_mul_ps(radius, InvSqrt4(Dot4(offset, offset))));
+            StoreVec3x4(Add4(p0, Scale4(offset, scale)), &out.X[j], &out.Y[j], &out.Z[j]);
+        }
+    }
+};
+
+//---------------------------------------------------------------------------
+// Offline evaluation: replays a recording, predicts every frame 'horizon'
+// seconds ahead and compares with the recording itself (linearly
+// interpolated) at that time.
+struct PredictionError
+{
+    float  Horizon;
+    double MeanError;       // metres, over all joints and frames
+    double RmsError;
+    double MaxError;
+    int    Samples;
+};
+
+inline PredictionError EvaluatePrediction(const KinectClip& clip, JointPredictor& predictor, float horizon)
+{
+    PredictionError e = { horizon, 0.0, 0.0, 0.0, 0 };
+    SkeletonFrame frame, predicted, truth, next;
+    predictor.Reset();
+    float lead = horizon * clip.SampleRate;
+    int whole = (int)lead;
+    float frac = lead - whole;
+    for (int f = 0; f + whole + 1 < clip.NumFrames; ++f)
+    {
+        clip.GetFrame(f, frame);
+        predictor.Push(frame);
+        if (f < 2)
+            continue;
+        predictor.Predict(frame.Time + horizon, predicted);
+
+        clip.GetFrame(f + whole, truth);
+        clip.GetFrame(f + whole + 1, next);
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            Float3 t = Lerp(truth.Get(j), next.Get(j), frac);
+            double d = Length(predicted.Get(j) - t);
+            e.MeanError += d;
+            e.RmsError += d * d;
+            if (d > e.MaxError)
+                e.MaxError = d;
+            ++e.Samples;
+        }
+    }
+    if (e.Samples)
+    {
+        e.MeanError /= e.Samples;
+        e.RmsError = sqrt(e.RmsError / e.Samples);
+    }
+    return e;
+}
+
+// Error table for every mode over the given horizons (seconds)
+inline void FormatPredictionReport(const KinectClip& clip, const float* horizons, int numHorizons, std::string& out)
+{
+    char line[160];
+    out = "joint prediction error (mean / rms / max, mm):\n";
+    for (int m = 0; m < Prediction_Count; ++m)
+    {
+        JointPredictor predictor;
+        predictor.Mode = (PredictionMode)m;
+        for (int h = 0; h < numHorizons; ++h)
+        {
+            PredictionError e = EvaluatePrediction(clip, predictor, horizons[h]);
+            snprintf(line, sizeof(line), "  %-12s %4.0f ms: %6.1f / %6.1f / %6.1f\n", PredictionModeNames[m],
+                     horizons[h] * 1000.0f, e.MeanError * 1000.0, e.RmsError * 1000.0, e.MaxError * 1000.0);
+            out += line;
+        }
+    }
+}
+
+#endif // JOINT_PREDICTOR_H
@@ -0,0 +1,148 @@
+#ifndef KINECT_BONE_LENGTHS_H
+#define KINECT_BONE_LENGTHS_H
+
+// Fixed bone lengths for the Kinect body.
+//
+// Sensor bone lengths wobble by centimetres from one frame to the next. The
+// lengths are calibrated once (median over a window of frames, so a few bad
+// samples do not matter) and every frame is then projected onto them: each
+// joint keeps its direction from the parent but sits exactly Length[j] away,
+// walking the hierarchy from the root. Directions are independent of each
+// other and are computed four at a time; only the final accumulation down
+// the tree is sequential.
+
+#include "../Common/MotionFile.h"
+#include "../Common/MotionSimd.h"
+#include "../Common/SkeletonTopology.h"
+
+#include <algorithm>
+#include <math.h>
+
+struct KinectBoneLengths
+{
+    float                           Length[KINECT_JOINT_STRIDE];    // parent -> joint, 0 for the root
+    int                             CalibrationFrames;              // window size
+    int                             NumSamples;
+    std::vector<std::vector<float>> Samples;                        // per joint, while calibrating
+
+    KinectBoneLengths() : CalibrationFrames(30), NumSamples(0)
+    {
+        for (int j = 0; j < KINECT_JOINT_STRIDE; ++j)
+            Length[j] = 0.0f;
+    }
+
+    bool Calibrated() const { return NumSamples >= CalibrationFrames; }
+
+    void Reset(int calibrationFrames)
+    {
+        CalibrationFrames = calibrationFrames;
+        NumSamples = 0;
+        Samples.clear();
+    }
+
+    // Streaming calibration: feed frames until Calibrated() turns true
+    void AddCalibrationFrame(const SkeletonFrame& frame)
+    {
+        if (Calibrated())
+            return;
+        Samples.resize(KinectJoint_Count);
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            int p = KinectJointParent[j];
+            if (p < 0)
+                continue;
+            float len = Length3(frame, j, p);
+            if (len > 1e-4f)      // untracked joints sit on top of each other
+                Samples[j].push_back(len);
+        }
+        if (++NumSamples >= CalibrationFrames)
+            FinishCalibration();
+    }
+
+    // Calibrates from frames [first, first + count) of a recording
+    void Calibrate(const KinectClip& clip, int first, int count)
+    {
+        if (first + count > clip.NumFrames)
+            count = clip.NumFrames - first;
+        Reset(count);
+        SkeletonFrame frame;
+        for (int f = first; f < first + count; ++f)
+        {
+            clip.GetFrame(f, frame);
+            AddCalibrationFrame(frame);
+        }
+    }
+
+    //-----------------------------------------------------------------------
+    // One frame in place
+    void Apply(SkeletonFrame& frame) const
+    {
+        // unit parent -> joint directions scaled to the calibrated length
+        float dx[KINECT_JOINT_STRIDE] = {}, dy[KINECT_JOINT_STRIDE] = {}, dz[KINECT_JOINT_STRIDE] = {};
+        float px[KINECT_JOINT_STRIDE] = {}, py[KINECT_JOINT_STRIDE] = {}, pz[KINECT_JOINT_STRIDE] = {};
+        ForEachBone<KinectV2Topology>([&](int j, int p)
+        {
+            px[j] = frame.X[p]; py[j] = frame.Y[p]; pz[j] = frame.Z[p];
+        });
+        for (int j = 0; j < KINECT_JOINT_STRIDE; j += 4)
+        {
+            Vec3x4 bone = Sub4(LoadVec3x4(&frame.X[j], &frame.Y[j], &frame.Z[j]), LoadVec3x4(&px[j], &py[j], &pz[j]));
+            StoreVec3x4(Scale4(Normalize4(bone), _mm_loadu_ps(&Length[j])), &dx[j], &dy[j], &dz[j]);
+        }
+        SkeletonAccumulateOffsets<KinectV2Topology>(dx, dy, dz, frame.X, frame.Y, frame.Z);
+    }
+
+    // Whole recording in place, four frames per SSE op. A children-first pass
+    // turns every joint into its scaled offset from the (still untouched)
+    // parent, then a parents-first pass adds the offsets back up.
+    void ApplyClip(KinectClip& clip) const
+    {
+        int stride = clip.FrameStride;
+        for (int h = KinectJoint_Count - 1; h > 0; --h)
+        {
+            int j = KinectHierarchyOrder[h];
+            size_t jo = clip.Index(j, 0), po = clip.Index(KinectJointParent[j], 0);
+            __m128 len = _mm_set1_ps(Length[j]);
+            for (int f = 0; f < stride; f += 4)
+            {
+                Vec3x4 bone = Sub4(LoadVec3x4(&clip.X[jo + f], &clip.Y[jo + f], &clip.Z[jo + f]), LoadVec3x4(&clip.X[po + f], &clip.Y[po + f], &clip.Z[po + f]));
+                StoreVec3x4(Scale4(Normalize4(bone), len), &clip.X[jo + f], &clip.Y[jo + f], &clip.Z[jo + f]);
+            }
+        }
+        for (int h = 1; h < KinectJoint_Count; ++h)
+        {
+            int j = KinectHierarchyOrder[h];
+            size_t jo = clip.Index(j, 0), po = clip.Index(KinectJointParent[j], 0);
+            for (int f = 0; f < stride; f += 4)
+            {
+                Vec3x4 pos = Add4(LoadVec3x4(&clip.X[po + f], &clip.Y[po + f], &clip.Z[po + f]), LoadVec3x4(&clip.X[jo + f], &clip.Y[jo + f], &clip.Z[jo + f]));
+                StoreVec3x4(pos, &clip.X[jo + f], &clip.Y[jo + f], &clip.Z[jo + f]);
+            }
+        }
+    }
+
+private:
+    static float Length3(const SkeletonFrame& frame, int a, int b)
+    {
+        float x = frame.X[a] - frame.X[b], y = frame.Y[a] - frame.Y[b], z = frame.Z[a] - frame.Z[b];
+        return sqrtf(x * x + y * y + z * z);
+    }
+
+    void FinishCalibration()
+    {
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            if (j >= (int)Samples.size() || Samples[j].empty())
+            {
+                Length[j] = 0.0f;
+                continue;
+            }
+            std::vector<float>& s = Samples[j];
+            std::nth_element(s.begin(), s.begin() + s.size() / 2, s.end());
+            Length[j] = s[s.size() / 2];
+        }
+        Samples.clear();
+    }
+};
+
+#endif // KINECT_BONE_LENGTHS_H
@@ -0,0 +1,333 @@
+#ifndef KINECT_KEYFRAMES_H
+#define KINECT_KEYFRAMES_H
+
+// Variable-rate keyframes for Kinect recordings.
+//
+// The joints are split into groups that move together (torso, arms, legs);
+// each group keeps its own key frames, chosen by Douglas-Peucker over the
+// group's trajectory: keep the first and last frame, split at the frame
+// farthest from the linear interpolation between them, repeat until every
+// frame of every joint in the group is within the group's MaxError. Slow
+// phases of an exercise collapse to a few keys, fast ones keep most frames.
+//
+// Positions are stored as 16 bit values against the clip's bounding box
+// (about 0.05 mm steps for a 3 m room) and the keys are chosen on the
+// quantized values, so the bound holds for what the decoder reproduces.
+// Because reconstruction and the original are both piecewise linear over the
+// 30 Hz frames, the bound also holds between frames: decoding at any rate
+// stays within MaxError of the original resampled at that rate.
+
+#include "../Common/MotionFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+enum KinectJointGroup
+{
+    KinectJointGroup_Torso,
+    KinectJointGroup_ArmLeft,
+    KinectJointGroup_ArmRight,
+    KinectJointGroup_LegLeft,
+    KinectJointGroup_LegRight,
+    KinectJointGroup_Count
+};
+
+static const char* const KinectJointGroupNames[KinectJointGroup_Count] =
+{
+    "Torso", "ArmLeft", "ArmRight", "LegLeft", "LegRight"
+};
+
+static const int KinectJointGroupOf[KinectJoint_Count] =
+{
+    KinectJointGroup_Torso,    KinectJointGroup_Torso,    KinectJointGroup_Torso,    KinectJointGroup_Torso,     // SpineBase, SpineMid, Neck, Head
+    KinectJointGroup_ArmLeft,  KinectJointGroup_ArmLeft,  KinectJointGroup_ArmLeft,  KinectJointGroup_ArmLeft,   // ShoulderLeft .. HandLeft
+    KinectJointGroup_ArmRight, KinectJointGroup_ArmRight, KinectJointGroup_ArmRight, KinectJointGroup_ArmRight,  // ShoulderRight .. HandRight
+    KinectJointGroup_LegLeft,  KinectJointGroup_LegLeft,  KinectJointGroup_LegLeft,  KinectJointGroup_LegLeft,   // HipLeft .. FootLeft
+    KinectJointGroup_LegRight, KinectJointGroup_LegRight, KinectJointGroup_LegRight, KinectJointGroup_LegRight,  // HipRight .. FootRight
+    KinectJointGroup_Torso,                                                                                      // SpineShoulder
+    KinectJointGroup_ArmLeft,  KinectJointGroup_ArmLeft,  KinectJointGroup_ArmRight, KinectJointGroup_ArmRight   // HandTip, Thumb
+};
+
+struct KeyframeSettings
+{
+    float MaxError;                             // metres, any joint, any time
+    float GroupMaxError[KinectJointGroup_Count]; // per-group override when > 0
+
+    KeyframeSettings() : MaxError(0.01f)
+    {
+        for (int g = 0; g < KinectJointGroup_Count; ++g)
+            GroupMaxError[g] = 0.0f;
+    }
+
+    float ErrorFor(int group) const { return GroupMaxError[group] > 0.0f ? GroupMaxError[group] : MaxError; }
+};
+
+//---------------------------------------------------------------------------
+struct KeyframeGroupTrack
+{
+    uint32_t FirstKey;          // index into KeyFrames; positions at FirstPosition + key * NumJoints
+    uint32_t NumKeys;
+    uint32_t FirstPosition;     // index into Positions (x3)
+    int      NumJoints;
+    int      Joints[KinectJoint_Count];
+
+    KeyframeGroupTrack() : FirstKey(0), NumKeys(0), FirstPosition(0), NumJoints(0) {}
+};
+
+struct KeyframedKinectClip
+{
+    float                           SampleRate;
+    int                             NumFrames;
+    Float3                          Min, Step;      // dequantization: Min + w * Step
+    KeyframeGroupTrack              Groups[KinectJointGroup_Count];
+    std::vector<uint32_t>           KeyFrames;      // source frame of each key; sessions can pass 65536 frames
+    std::vector<uint16_t>           Positions;      // x y z per joint per key
+
+    KeyframedKinectClip() : SampleRate(30.0f), NumFrames(0), Min(MakeFloat3(0.0f, 0.0f, 0.0f)), Step(MakeFloat3(0.0f, 0.0f, 0.0f)) {}
+
+    float Duration() const { return NumFrames > 1 ? (NumFrames - 1) / SampleRate : 0.0f; }
+
+    size_t SizeBytes() const
+    {
+        return sizeof(Groups) + 2 * sizeof(Float3) + KeyFrames.size() * sizeof(uint32_t) + Positions.size() * sizeof(uint16_t);
+    }
+
+    Float3 Dequantize(const uint16_t* w) const
+    {
+        return MakeFloat3(Min.x + w[0] * Step.x, Min.y + w[1] * Step.y, Min.z + w[2] * Step.z);
+    }
+
+    Float3 KeyPosition(const KeyframeGroupTrack& g, uint32_t key, int joint) const
+    {
+        return Dequantize(&Positions[((size_t)g.FirstPosition + (size_t)key * g.NumJoints + joint) * 3]);
+    }
+
+    // Random access: binary search of each group's keys
+    void SampleFrame(float time, SkeletonFrame& out) const
+    {
+        float f = time * SampleRate;
+        f = f < 0.0f ? 0.0f : (f > (float)(NumFrames - 1) ? (float)(NumFrames - 1) : f);
+        out.Clear();
+        out.Time = time;
+        for (int gi = 0; gi < KinectJointGroup_Count; ++gi)
+        {
+            const KeyframeGroupTrack& g = Groups[gi];
+            const uint32_t* frames = &KeyFrames[g.FirstKey];
+            uint32_t k = (uint32_t)(std::upper_bound(frames, frames + g.NumKeys, (uint32_t)f) - frames);
+            k = k > 0 ? k - 1 : 0;
+            uint32_t k1 = std::min(k + 1, g.NumKeys - 1);
+            float u = k1 > k ? (f - frames[k]) / (float)(frames[k1] - frames[k]) : 0.0f;
+            for (int j = 0; j < g.NumJoints; ++j)
+                out.Set(g.Joints[j], Lerp(KeyPosition(g, k, j), KeyPosition(g, k1, j), u));
+        }
+    }
+
+    // Fixed-rate decode into a joint-major clip. Every key interval writes a
+    // straight run of output frames per joint, a + b * frame, which the
+    // compiler vectorizes.
+    void Decode(float sampleRate, KinectClip& out) const
+    {
+        int n = NumFrames > 1 ? (int)floorf(Duration() * sampleRate + 1e-3f) + 1 : NumFrames;
+        out.Parameters.clear();
+        out.SampleRate = sampleRate;
+        out.Allocate(n);
+        float toSource = SampleRate / sampleRate;
+        float* axes[3] = { out.X.data(), out.Y.data(), out.Z.data() };
+        for (int gi = 0; gi < KinectJointGroup_Count; ++gi)
+        {
+            const KeyframeGroupTrack& g = Groups[gi];
+            int f = 0;
+            for (uint32_t k = 0; k < g.NumKeys && f < n; ++k)
+            {
+                uint32_t k1 = std::min(k + 1, g.NumKeys - 1);
+                float f0 = KeyFrames[g.FirstKey + k], f1 = KeyFrames[g.FirstKey + k1];
+                // output frames up to (and on the last key, including) f1
+                int end = k1 == k ? n : std::min(n, (int)ceilf(f1 / toSource - 1e-4f));
+                float inv = f1 > f0 ? 1.0f / (f1 - f0) : 0.0f;
+                for (int j = 0; j < g.NumJoints; ++j)
+                {
+                    Float3 p0 = KeyPosition(g, k, j), p1 = KeyPosition(g, k1, j);
+                    float a[3] = { p0.x, p0.y, p0.z }, d[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        float* dst = axes[c] + out.Index(g.Joints[j], 0);
+                        float slope = d[c] * inv * toSource, base = a[c] - d[c] * inv * f0;
+                        for (int i = f; i < end; ++i)
+                            dst[i] = base + slope * (float)i;
+                    }
+                }
+                f = std::max(f, end);
+            }
+        }
+    }
+};
+
+//---------------------------------------------------------------------------
+// Worst distance of any of the group's joints at frame f from the straight
+// line between the key frames first and last
+inline float GroupInterpolationError(const std::vector<Float3>& quantized, const KinectClip& clip, const KeyframeGroupTrack& g,
+                                     int first, int last, int f)
+{
+    float u = (float)(f - first) / (float)(last - first), worst = 0.0f;
+    for (int j = 0; j < g.NumJoints; ++j)
+    {
+        const Float3* q = &quantized[(size_t)j * clip.NumFrames];
+        Float3 p = Lerp(q[first], q[last], u);
+        worst = std::max(worst, Length(p - clip.Get(g.Joints[j], f)));
+    }
+    return worst;
+}
+
+// Douglas-Peucker on [first, last]: both ends are kept already
+inline void ReduceGroupKeys(const std::vector<Float3>& quantized, const KinectClip& clip, const KeyframeGroupTrack& g,
+                            int first, int last, float tolerance, std::vector<char>& keep)
+{
+    if (last - first < 2)
+        return;
+    int   worst = -1;
+    float worstError = tolerance;
+    for (int f = first + 1; f < last; ++f)
+    {
+        float e = GroupInterpolationError(quantized, clip, g, first, last, f);
+        if (e > worstError)
+        {
+            worstError = e;
+            worst = f;
+        }
+    }
+    if (worst < 0)
+        return;
+    keep[worst] = 1;
+    ReduceGroupKeys(quantized, clip, g, first, worst, tolerance, keep);
+    ReduceGroupKeys(quantized, clip, g, worst, last, tolerance, keep);
+}
+
+// False for an empty clip ('out' is then empty too)
+inline bool ReduceKinectClip(const KinectClip& clip, const KeyframeSettings& settings, KeyframedKinectClip& out)
+{
+    out = KeyframedKinectClip();
+    if (clip.NumFrames <= 0)
+        return false;
+    out.SampleRate = clip.SampleRate;
+    out.NumFrames = clip.NumFrames;
+    int n = clip.NumFrames;
+
+    Float3 lo = clip.Get(0, 0), hi = lo;
+    for (int j = 0; j < KinectJoint_Count; ++j)
+        for (int f = 0; f < n; ++f)
+        {
+            Float3 p = clip.Get(j, f);
+            lo = MakeFloat3(fminf(lo.x, p.x), fminf(lo.y, p.y), fminf(lo.z, p.z));
+            hi = MakeFloat3(fmaxf(hi.x, p.x), fmaxf(hi.y, p.y), fmaxf(hi.z, p.z));
+        }
+    out.Min = lo;
+    out.Step = (hi - lo) * (1.0f / 65535.0f);
+    float step[3] = { out.Step.x, out.Step.y, out.Step.z };
+
+    for (int j = 0; j < KinectJoint_Count; ++j)
+    {
+        KeyframeGroupTrack& g = out.Groups[KinectJointGroupOf[j]];
+        g.Joints[g.NumJoints++] = j;
+    }
+
+    // quantize every frame first so key selection sees what the decoder will see
+    std::vector<uint16_t> words;
+    std::vector<Float3> quantized;
+    std::vector<char> keep(n);
+    for (int gi = 0; gi < KinectJointGroup_Count; ++gi)
+    {
+        KeyframeGroupTrack& g = out.Groups[gi];
+        words.resize((size_t)g.NumJoints * n * 3);
+        quantized.resize((size_t)g.NumJoints * n);
+        for (int j = 0; j < g.NumJoints; ++j)
+            for (int f = 0; f < n; ++f)
+            {
+                Float3 p = clip.Get(g.Joints[j], f);
+                float c[3] = { p.x - lo.x, p.y - lo.y, p.z - lo.z };
+                uint16_t* w = &words[((size_t)j * n + f) * 3];
+                for (int i = 0; i < 3; ++i)
+                {
+                    float q = step[i] > 0.0f ? c[i] / step[i] + 0.5f : 0.0f;
+                    w[i] = (uint16_t)(q < 0.0f ? 0.0f : (q > 65535.0f ? 65535.0f : q));
+                }
+                quantized[(size_t)j * n + f] = out.Dequantize(w);
+            }
+
+        std::fill(keep.begin(), keep.end(), 0);
+        keep[0] = keep[n - 1] = 1;
+        ReduceGroupKeys(quantized, clip, g, 0, n - 1, settings.ErrorFor(gi), keep);
+
+        g.FirstKey = (uint32_t)out.KeyFrames.size();
+        g.FirstPosition = (uint32_t)(out.Positions.size() / 3);
+        for (int f = 0; f < n; ++f)
+        {
+            if (!keep[f])
+                continue;
+            out.KeyFrames.push_back((uint32_t)f);
+            for (int j = 0; j < g.NumJoints; ++j)
+                out.Positions.insert(out.Positions.end(), &words[((size_t)j * n + f) * 3], &words[((size_t)j * n + f) * 3] + 3);
+        }
+        g.NumKeys = (uint32_t)out.KeyFrames.size() - g.FirstKey;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+struct KeyframeReductionStats
+{
+    size_t RawBytes;                            // x y z floats per joint per frame
+    size_t ReducedBytes;
+    int    Frames;
+    int    Keys[KinectJointGroup_Count];
+    float  MaxError[KinectJointGroup_Count];    // worst joint distance over all frames, metres
+    double DecodeUs;                            // whole clip at its own rate
+
+    float Ratio() const { return ReducedBytes ? (float)RawBytes / (float)ReducedBytes : 0.0f; }
+};
+
+inline KeyframeReductionStats MeasureKeyframeReduction(const KinectClip& raw, const KeyframedKinectClip& reduced)
+{
+    KeyframeReductionStats stats;
+    stats.RawBytes = (size_t)raw.NumFrames * KinectJoint_Count * 3 * sizeof(float);
+    stats.ReducedBytes = reduced.SizeBytes();
+    stats.Frames = raw.NumFrames;
+
+    KinectClip decoded;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    reduced.Decode(raw.SampleRate, decoded);
+    stats.DecodeUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+
+    for (int g = 0; g < KinectJointGroup_Count; ++g)
+    {
+        stats.Keys[g] = (int)reduced.Groups[g].NumKeys;
+        stats.MaxError[g] = 0.0f;
+    }
+    for (int j = 0; j < KinectJoint_Count; ++j)
+        for (int f = 0; f < raw.NumFrames && f < decoded.NumFrames; ++f)
+        {
+            float& e = stats.MaxError[KinectJointGroupOf[j]];
+            e = std::max(e, Length(decoded.Get(j, f) - raw.Get(j, f)));
+        }
+    return stats;
+}
+
+inline void FormatKeyframeReport(const KeyframeReductionStats& stats, std::string& out)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "keyframes: %d frames, %u -> %u bytes (%.1fx), decoded in %.1f us\n",
+             stats.Frames, (unsigned)stats.RawBytes, (unsigned)stats.ReducedBytes, stats.Ratio(), stats.DecodeUs);
+    out = line;
+    for (int g = 0; g < KinectJointGroup_Count; ++g)
+    {
+        snprintf(line, sizeof(line), "  %-9s %5d keys (%4.1f%%), max error %.1f mm\n", KinectJointGroupNames[g],
+                 stats.Keys[g], 100.0f * stats.Keys[g] / (stats.Frames > 0 ? stats.Frames : 1), stats.MaxError[g] * 1000.0f);
+        out += line;
+    }
+}
+
+#endif // KINECT_KEYFRAMES_H
@@ -0,0 +1,372 @@
+#ifndef KINECT_RETARGET_H
+#define KINECT_RETARGET_H
+
+// Drives an imported rig (Male_Zombie) from Kinect joint positions.
+//
+// Each retarget segment is a Kinect joint pair (From -> To) that aims one rig
+// bone, optionally with a side pair that fixes the twist about the segment.
+// Build() resolves the rig bones by name, falls back to the nearest bind-pose
+// joint when a name is missing (given a calibration frame of the subject, both
+// bodies compared at unit height), and precomputes per segment
+//   - the rest direction and rest side vector in model space,
+//   - the bone's bind global rotation,
+//   - the constant correction C = Bind(parent)^-1 * Bind(mapped ancestor),
+// so that a frame is: global = twist * swing * bindGlobal (independent per
+// segment, four segments per SSE iteration), then
+// local = C * global(ancestor)^-1 * global. Rig bones without a segment keep
+// their bind rotation. Only rotations are written; root motion is left to the
+// caller.
+
+#include "../Common/AnimationClip.h"
+#include "../Common/KinectSkeleton.h"
+#include "../Common/MotionSimd.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct RetargetSegment
+{
+    int         From, To;           // Kinect joints giving the bone direction
+    int         SideFrom, SideTo;   // Kinect joints giving the twist reference, -1 for none
+    const char* RigBone;            // bone aimed by the segment (name suffix)
+};
+
+static const RetargetSegment KinectRetargetSegments[] =
+{
+    { KinectJoint_SpineBase,     KinectJoint_SpineMid,      KinectJoint_HipLeft,      KinectJoint_HipRight,      "Hips" },
+    { KinectJoint_SpineMid,      KinectJoint_SpineShoulder, KinectJoint_ShoulderLeft, KinectJoint_ShoulderRight, "Spine1" },
+    { KinectJoint_SpineShoulder, KinectJoint_Neck,          KinectJoint_ShoulderLeft, KinectJoint_ShoulderRight, "Spine2" },
+    { KinectJoint_Neck,          KinectJoint_Head,          -1,                       -1,                        "Neck" },
+    { KinectJoint_SpineShoulder, KinectJoint_ShoulderLeft,  -1,                       -1,                        "LeftShoulder" },
+    { KinectJoint_ShoulderLeft,  KinectJoint_ElbowLeft,     -1,                       -1,                        "LeftArm" },
+    { KinectJoint_ElbowLeft,     KinectJoint_WristLeft,     KinectJoint_HandLeft,     KinectJoint_ThumbLeft,     "LeftForeArm" },
+    { KinectJoint_WristLeft,     KinectJoint_HandLeft,      KinectJoint_HandLeft,     KinectJoint_ThumbLeft,     "LeftHand" },
+    { KinectJoint_SpineShoulder, KinectJoint_ShoulderRight, -1,                       -1,                        "RightShoulder" },
+    { KinectJoint_ShoulderRight, KinectJoint_ElbowRight,    -1,                       -1,                        "RightArm" },
+    { KinectJoint_ElbowRight,    KinectJoint_WristRight,    KinectJoint_HandRight,    KinectJoint_ThumbRight,    "RightForeArm" },
+    { KinectJoint_WristRight,    KinectJoint_HandRight,     KinectJoint_HandRight,    KinectJoint_ThumbRight,    "RightHand" },
+    { KinectJoint_HipLeft,       KinectJoint_KneeLeft,      -1,                       -1,                        "LeftUpLeg" },
+    { KinectJoint_KneeLeft,      KinectJoint_AnkleLeft,     KinectJoint_AnkleLeft,    KinectJoint_FootLeft,      "LeftLeg" },
+    { KinectJoint_AnkleLeft,     KinectJoint_FootLeft,      -1,                       -1,                        "LeftFoot" },
+    { KinectJoint_HipRight,      KinectJoint_KneeRight,     -1,                       -1,                        "RightUpLeg" },
+    { KinectJoint_KneeRight,     KinectJoint_AnkleRight,    KinectJoint_AnkleRight,   KinectJoint_FootRight,     "RightLeg" },
+    { KinectJoint_AnkleRight,    KinectJoint_FootRight,     -1,                       -1,                        "RightFoot" }
+};
+
+static const int KinectRetargetSegmentCount = sizeof(KinectRetargetSegments) / sizeof(KinectRetargetSegments[0]);
+
+// Rig joint located at each Kinect joint (Mixamo naming, matched as a suffix)
+static const char* const KinectRigJointNames[KinectJoint_Count] =
+{
+    "Hips", "Spine1", "Neck", "Head",
+    "LeftArm", "LeftForeArm", "LeftHand", "LeftHandMiddle1",
+    "RightArm", "RightForeArm", "RightHand", "RightHandMiddle1",
+    "LeftUpLeg", "LeftLeg", "LeftFoot", "LeftToeBase",
+    "RightUpLeg", "RightLeg", "RightFoot", "RightToeBase",
+    "Spine2", "LeftHandMiddle4", "LeftHandThumb2", "RightHandMiddle4", "RightHandThumb2"
+};
+
+enum RetargetMatch
+{
+    RetargetMatch_None,
+    RetargetMatch_Name,
+    RetargetMatch_Geometry
+};
+
+struct RetargetCoverage
+{
+    int SegmentsMapped;
+    int SegmentsByGeometry;
+    int SegmentsWithTwist;
+    int RigBonesDriven;
+    int RigBones;
+    int JointsByName;
+    int JointsByGeometry;
+};
+
+//---------------------------------------------------------------------------
+struct KinectRetargeter
+{
+    Quat4              SensorToRig;     // Kinect camera space -> rig model space
+    int                NumEntries;      // mapped segments; arrays below are padded to a multiple of 4
+    std::vector<int>   Segment, Bone, Ancestor;
+    std::vector<float> RestDirX, RestDirY, RestDirZ;
+    std::vector<float> RestSideX, RestSideY, RestSideZ;
+    std::vector<float> BindRx, BindRy, BindRz, BindRw;
+    std::vector<float> CorrRx, CorrRy, CorrRz, CorrRw;
+
+    int                SegmentMatch[KinectRetargetSegmentCount];
+    int                JointBone[KinectJoint_Count];
+    int                JointMatch[KinectJoint_Count];
+    int                NumRigBones;
+
+    // per-frame scratch, sized once in Build
+    float              JointX[KINECT_JOINT_STRIDE], JointY[KINECT_JOINT_STRIDE], JointZ[KINECT_JOINT_STRIDE];
+    std::vector<float> DirX, DirY, DirZ, SideX, SideY, SideZ, HasSide;
+    std::vector<float> GlobalRx, GlobalRy, GlobalRz, GlobalRw;
+    std::vector<float> AncRx, AncRy, AncRz, AncRw;
+
+    KinectRetargeter() : SensorToRig(MakeQuat4(0.0f, 1.0f, 0.0f, 0.0f)), NumEntries(0), NumRigBones(0) {}
+
+    Float3 ToRig(const SkeletonFrame& frame, int joint) const
+    {
+        return QuatRotate(SensorToRig, frame.Get(joint));
+    }
+
+    // Positions relative to the root joint, divided by body height
+    static void NormalizeBody(std::vector<Float3>& p, int root)
+    {
+        float lo = p[0].y, hi = p[0].y;
+        for (size_t i = 1; i < p.size(); ++i)
+        {
+            lo = fminf(lo, p[i].y);
+            hi = fmaxf(hi, p[i].y);
+        }
+        float inv = hi > lo ? 1.0f / (hi - lo) : 1.0f;
+        Float3 origin = p[root];
+        for (size_t i = 0; i < p.size(); ++i)
+            p[i] = (p[i] - origin) * inv;
+    }
+
+    // calibration (optional) is a frame of the subject standing upright; it
+    // enables the geometric fallback for rig bones whose names do not match.
+    bool Build(const AnimRig& rig, const SkeletonFrame* calibration = nullptr, float maxGeometryDistance = 0.08f)
+    {
+        NumRigBones = rig.NumBones();
+
+        LocalPose bind;
+        bind.SetBindPose(rig);
+        std::vector<Float3> bindPos;
+        std::vector<Quat4>  bindRot;
+        LocalToGlobal(rig, bind, bindPos, bindRot);
+
+        std::vector<Float3> rigNorm = bindPos, kinectNorm(KinectJoint_Count);
+        if (calibration)
+        {
+            for (int j = 0; j < KinectJoint_Count; ++j)
+                kinectNorm[j] = ToRig(*calibration, j);
+            NormalizeBody(kinectNorm, KinectJoint_SpineBase);
+            int hips = rig.FindBoneBySuffix(KinectRigJointNames[KinectJoint_SpineBase]);
+            NormalizeBody(rigNorm, hips >= 0 ? hips : 0);
+        }
+
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            JointBone[j] = rig.FindBoneBySuffix(KinectRigJointNames[j]);
+            JointMatch[j] = JointBone[j] >= 0 ? RetargetMatch_Name : RetargetMatch_None;
+            if (JointBone[j] < 0 && calibration)
+            {
+                JointBone[j] = NearestBone(rigNorm, kinectNorm[j], maxGeometryDistance);
+                JointMatch[j] = JointBone[j] >= 0 ? RetargetMatch_Geometry : RetargetMatch_None;
+            }
+        }
+
+        // bone -> entry, to find each entry's nearest mapped ancestor
+        std::vector<int> entryOfBone(NumRigBones, -1);
+        Segment.clear(); Bone.clear();
+        for (int s = 0; s < KinectRetargetSegmentCount; ++s)
+        {
+            const RetargetSegment& seg = KinectRetargetSegments[s];
+            int bone = rig.FindBoneBySuffix(seg.RigBone);
+            SegmentMatch[s] = RetargetMatch_Name;
+            // the joint's bone stands in only for a segment that aims that same
+            // bone; SpineShoulder's bone is Spine2, not either shoulder
+            if (bone < 0 && strcmp(seg.RigBone, KinectRigJointNames[seg.From]) == 0)
+            {
+                bone = JointBone[seg.From];
+                SegmentMatch[s] = bone >= 0 ? JointMatch[seg.From] : RetargetMatch_None;
+            }
+            if (bone < 0 || JointBone[seg.To] < 0 || entryOfBone[bone] >= 0)
+            {
+                SegmentMatch[s] = RetargetMatch_None;
+                continue;
+            }
+            if (JointMatch[seg.To] == RetargetMatch_Geometry)
+                SegmentMatch[s] = RetargetMatch_Geometry;
+            entryOfBone[bone] = (int)Segment.size();
+            Segment.push_back(s);
+            Bone.push_back(bone);
+        }
+
+        NumEntries = (int)Segment.size();
+        size_t padded = (size_t)((NumEntries + 3) & ~3);
+        std::vector<float>* arrays[] = { &RestDirX, &RestDirY, &RestDirZ, &RestSideX, &RestSideY, &RestSideZ,
+                                         &BindRx, &BindRy, &BindRz, &BindRw, &CorrRx, &CorrRy, &CorrRz, &CorrRw,
+                                         &DirX, &DirY, &DirZ, &SideX, &SideY, &SideZ, &HasSide,
+                                         &GlobalRx, &GlobalRy, &GlobalRz, &GlobalRw, &AncRx, &AncRy, &AncRz, &AncRw };
+        for (size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a)
+            arrays[a]->assign(padded, 0.0f);
+        Ancestor.assign(padded, -1);
+
+        for (int e = 0; e < NumEntries; ++e)
+        {
+            const RetargetSegment& seg = KinectRetargetSegments[Segment[e]];
+            int b = Bone[e];
+            Float3 dir = Normalize(bindPos[JointBone[seg.To]] - bindPos[b]);
+            RestDirX[e] = dir.x; RestDirY[e] = dir.y; RestDirZ[e] = dir.z;
+            if (seg.SideFrom >= 0 && JointBone[seg.SideFrom] >= 0 && JointBone[seg.SideTo] >= 0)
+            {
+                Float3 side = Normalize(bindPos[JointBone[seg.SideTo]] - bindPos[JointBone[seg.SideFrom]]);
+                RestSideX[e] = side.x; RestSideY[e] = side.y; RestSideZ[e] = side.z;
+                HasSide[e] = 1.0f;
+            }
+            BindRx[e] = bindRot[b].x; BindRy[e] = bindRot[b].y; BindRz[e] = bindRot[b].z; BindRw[e] = bindRot[b].w;
+
+            int p = rig.Bones[b].Parent;
+            int anc = p;
+            while (anc >= 0 && entryOfBone[anc] < 0)
+                anc = rig.Bones[anc].Parent;
+            Ancestor[e] = anc >= 0 ? entryOfBone[anc] : -1;
+            Quat4 parentBind = p >= 0 ? bindRot[p] : QuatIdentity();
+            Quat4 corr = QuatConjugate(parentBind);
+            if (anc >= 0)
+                corr = QuatMul(corr, bindRot[anc]);
+            CorrRx[e] = corr.x; CorrRy[e] = corr.y; CorrRz[e] = corr.z; CorrRw[e] = corr.w;
+        }
+        return NumEntries > 0;
+    }
+
+    static int NearestBone(const std::vector<Float3>& rigNorm, const Float3& target, float maxDistance)
+    {
+        int best = -1;
+        float bestDistance = maxDistance;
+        for (size_t i = 0; i < rigNorm.size(); ++i)
+        {
+            float d = Length(rigNorm[i] - target);
+            if (d < bestDistance)
+            {
+                bestDistance = d;
+                best = (int)i;
+            }
+        }
+        return best;
+    }
+
+    // Writes the local rotation of every mapped bone; other bones are untouched
+    void Retarget(const SkeletonFrame& frame, LocalPose& pose)
+    {
+        // all joints into rig space once
+        Quat4x4 toRig = { _mm_set1_ps(SensorToRig.x), _mm_set1_ps(SensorToRig.y), _mm_set1_ps(SensorToRig.z), _mm_set1_ps(SensorToRig.w) };
+        for (int j = 0; j < KINECT_JOINT_STRIDE; j += 4)
+            StoreVec3x4(QuatRotate4(toRig, LoadVec3x4(&frame.X[j], &frame.Y[j], &frame.Z[j])), &JointX[j], &JointY[j], &JointZ[j]);
+
+        // gather segment and side vectors (scalar: two joints per entry)
+        for (int e = 0; e < NumEntries; ++e)
+        {
+            const RetargetSegment& seg = KinectRetargetSegments[Segment[e]];
+            DirX[e] = JointX[seg.To] - JointX[seg.From];
+            DirY[e] = JointY[seg.To] - JointY[seg.From];
+            DirZ[e] = JointZ[seg.To] - JointZ[seg.From];
+            if (HasSide[e] != 0.0f)
+            {
+                SideX[e] = JointX[seg.SideTo] - JointX[seg.SideFrom];
+                SideY[e] = JointY[seg.SideTo] - JointY[seg.SideFrom];
+                SideZ[e] = JointZ[seg.SideTo] - JointZ[seg.SideFrom];
+            }
+        }
+
+        // global = twist * swing * bind, four entries at a time
+        for (int e = 0; e < NumEntries; e += 4)
+        {
+            Vec3x4 dir = Normalize4(LoadVec3x4(&DirX[e], &DirY[e], &DirZ[e]));
+            Vec3x4 restDir = LoadVec3x4(&RestDirX[e], &RestDirY[e], &RestDirZ[e]);
+            Quat4x4 swing = QuatFromTo4(restDir, dir);
+
+            // twist: rotate the swung rest side onto the measured side, both
+            // projected onto the plane perpendicular to the bone
+            Vec3x4 restSide = QuatRotate4(swing, LoadVec3x4(&RestSideX[e], &RestSideY[e], &RestSideZ[e]));
+            Vec3x4 side = LoadVec3x4(&SideX[e], &SideY[e], &SideZ[e]);
+            restSide = Normalize4(Sub4(restSide, Scale4(dir, Dot4(restSide, dir))));
+            side = Normalize4(Sub4(side, Scale4(dir, Dot4(side, dir))));
+            Quat4x4 twist = QuatFromTo4(restSide, side);
+            __m128 useTwist = _mm_cmpgt_ps(_mm_mul_ps(_mm_loadu_ps(&HasSide[e]), Dot4(side, side)), _mm_set1_ps(0.5f));
+            twist.x = _mm_and_ps(useTwist, twist.x);
+            twist.y = _mm_and_ps(useTwist, twist.y);
+            twist.z = _mm_and_ps(useTwist, twist.z);
+            twist.w = _mm_or_ps(_mm_and_ps(useTwist, twist.w), _mm_andnot_ps(useTwist, _mm_set1_ps(1.0f)));
+
+            Quat4x4 bind = LoadQuat4x4(&BindRx[e], &BindRy[e], &BindRz[e], &BindRw[e]);
+            Quat4x4 global = QuatMul4(twist, QuatMul4(swing, bind));
+            StoreQuat4x4(global, &GlobalRx[e], &GlobalRy[e], &GlobalRz[e], &GlobalRw[e]);
+        }
+
+        for (int e = 0; e < NumEntries; ++e)
+        {
+            int a = Ancestor[e];
+            AncRx[e] = a >= 0 ? GlobalRx[a] : 0.0f;
+            AncRy[e] = a >= 0 ? GlobalRy[a] : 0.0f;
+            AncRz[e] = a >= 0 ? GlobalRz[a] : 0.0f;
+            AncRw[e] = a >= 0 ? GlobalRw[a] : 1.0f;
+        }
+
+        // local = C * global(ancestor)^-1 * global
+        for (int e = 0; e < NumEntries; e += 4)
+        {
+            Quat4x4 global = LoadQuat4x4(&GlobalRx[e], &GlobalRy[e], &GlobalRz[e], &GlobalRw[e]);
+            Quat4x4 anc = QuatConjugate4(LoadQuat4x4(&AncRx[e], &AncRy[e], &AncRz[e], &AncRw[e]));
+            Quat4x4 corr = LoadQuat4x4(&CorrRx[e], &CorrRy[e], &CorrRz[e], &CorrRw[e]);
+            Quat4x4 local = QuatNormalize4(QuatMul4(corr, QuatMul4(anc, global)));
+            StoreQuat4x4(local, &GlobalRx[e], &GlobalRy[e], &GlobalRz[e], &GlobalRw[e]);
+            // GlobalR* now holds locals; ancestors were already copied out above
+        }
+
+        for (int e = 0; e < NumEntries; ++e)
+            pose.SetR(Bone[e], MakeQuat4(GlobalRx[e], GlobalRy[e], GlobalRz[e], GlobalRw[e]));
+    }
+
+    RetargetCoverage Coverage() const
+    {
+        RetargetCoverage c = {};
+        for (int s = 0; s < KinectRetargetSegmentCount; ++s)
+        {
+            if (SegmentMatch[s] == RetargetMatch_None)
+                continue;
+            ++c.SegmentsMapped;
+            if (SegmentMatch[s] == RetargetMatch_Geometry)
+                ++c.SegmentsByGeometry;
+        }
+        for (int e = 0; e < NumEntries; ++e)
+            if (HasSide[e] != 0.0f)
+                ++c.SegmentsWithTwist;
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            if (JointMatch[j] == RetargetMatch_Name) ++c.JointsByName;
+            if (JointMatch[j] == RetargetMatch_Geometry) ++c.JointsByGeometry;
+        }
+        c.RigBonesDriven = NumEntries;
+        c.RigBones = NumRigBones;
+        return c;
+    }
+
+    // Human-readable mapping table for the validation log
+    void FormatCoverage(const AnimRig& rig, std::string& out) const
+    {
+        static const char* const matchNames[] = { "unmapped", "name", "geometry" };
+        char line[256];
+        RetargetCoverage c = Coverage();
+        snprintf(line, sizeof(line), "retarget: %d/%d segments mapped (%d by geometry, %d with twist), %d/%d rig bones driven, joints %d by name %d by geometry\n",
+                 c.SegmentsMapped, KinectRetargetSegmentCount, c.SegmentsByGeometry, c.SegmentsWithTwist,
+                 c.RigBonesDriven, c.RigBones, c.JointsByName, c.JointsByGeometry);
+        out = line;
+        for (int s = 0; s < KinectRetargetSegmentCount; ++s)
+        {
+            const RetargetSegment& seg = KinectRetargetSegments[s];
+            int bone = -1;
+            for (int e = 0; e < NumEntries; ++e)
+                if (Segment[e] == s)
+                    bone = Bone[e];
+            snprintf(line, sizeof(line), "  %-13s -> %-13s : %-24s (%s)\n", KinectJointNames[seg.From], KinectJointNames[seg.To],
+                     bone >= 0 ? rig.Bones[bone].Name.c_str() : "-", matchNames[SegmentMatch[s]]);
+            out += line;
+        }
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            if (JointMatch[j] != RetargetMatch_Geometry)
+                continue;
+            snprintf(line, sizeof(line), "  joint %-13s at %-24s (geometry, no %s)\n", KinectJointNames[j], rig.Bones[JointBone[j]].Name.c_str(), KinectRigJointNames[j]);
+            out += line;
+        }
+    }
+};
+
+#endif // KINECT_RETARGET_H
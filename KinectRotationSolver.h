@@ -0,0 +1,247 @@
+#ifndef KINECT_ROTATION_SOLVER_H
+#define KINECT_ROTATION_SOLVER_H
+
+// Joint orientations from Kinect joint positions.
+//
+// Every joint with a child gets a frame whose +Y runs along the bone to that
+// child and whose +X is a twist reference with the bone direction removed:
+// the hip line for the pelvis, the shoulder line up the spine, the forearm
+// for the upper arm (the bend plane), the thumb for forearm and hand, the
+// foot for the leg. When the bone or its reference collapses (lost joint,
+// straight arm) the parent's axes stand in, and leaves (head, hand tips,
+// thumbs, feet) inherit the parent's orientation.
+// Local rotations are conj(parentGlobal) * global, parent per KinectJointParent.
+//
+// SolveClipRotations runs four frames per SSE op, joint by joint in hierarchy
+// order; SolveFrameRotations runs four joints per op for the live stream.
+
+#include "../Common/MotionFile.h"
+#include "../Common/MotionSimd.h"
+
+struct KinectBoneFrame
+{
+    int Child;              // -1 for leaves
+    int RefFrom, RefTo;     // twist reference direction
+};
+
+static const KinectBoneFrame KinectBoneFrames[KinectJoint_Count] =
+{
+    { KinectJoint_SpineMid,      KinectJoint_HipLeft,      KinectJoint_HipRight },      // SpineBase
+    { KinectJoint_SpineShoulder, KinectJoint_ShoulderLeft, KinectJoint_ShoulderRight }, // SpineMid
+    { KinectJoint_Head,          KinectJoint_ShoulderLeft, KinectJoint_ShoulderRight }, // Neck
+    { -1, -1, -1 },                                                                     // Head
+    { KinectJoint_ElbowLeft,     KinectJoint_ElbowLeft,    KinectJoint_WristLeft },     // ShoulderLeft
+    { KinectJoint_WristLeft,     KinectJoint_WristLeft,    KinectJoint_ThumbLeft },     // ElbowLeft
+    { KinectJoint_HandLeft,      KinectJoint_WristLeft,    KinectJoint_ThumbLeft },     // WristLeft
+    { KinectJoint_HandTipLeft,   KinectJoint_HandLeft,     KinectJoint_ThumbLeft },     // HandLeft
+    { KinectJoint_ElbowRight,    KinectJoint_ElbowRight,   KinectJoint_WristRight },    // ShoulderRight
+    { KinectJoint_WristRight,    KinectJoint_WristRight,   KinectJoint_ThumbRight },    // ElbowRight
+    { KinectJoint_HandRight,     KinectJoint_WristRight,   KinectJoint_ThumbRight },    // WristRight
+    { KinectJoint_HandTipRight,  KinectJoint_HandRight,    KinectJoint_ThumbRight },    // HandRight
+    { KinectJoint_KneeLeft,      KinectJoint_AnkleLeft,    KinectJoint_FootLeft },      // HipLeft
+    { KinectJoint_AnkleLeft,     KinectJoint_AnkleLeft,    KinectJoint_FootLeft },      // KneeLeft
+    { KinectJoint_FootLeft,      KinectJoint_KneeLeft,     KinectJoint_AnkleLeft },     // AnkleLeft
+    { -1, -1, -1 },                                                                     // FootLeft
+    { KinectJoint_KneeRight,     KinectJoint_AnkleRight,   KinectJoint_FootRight },     // HipRight
+    { KinectJoint_AnkleRight,    KinectJoint_AnkleRight,   KinectJoint_FootRight },     // KneeRight
+    { KinectJoint_FootRight,     KinectJoint_KneeRight,    KinectJoint_AnkleRight },    // AnkleRight
+    { -1, -1, -1 },                                                                     // FootRight
+    { KinectJoint_Neck,          KinectJoint_ShoulderLeft, KinectJoint_ShoulderRight }, // SpineShoulder
+    { -1, -1, -1 },                                                                     // HandTipLeft
+    { -1, -1, -1 },                                                                     // ThumbLeft
+    { -1, -1, -1 },                                                                     // HandTipRight
+    { -1, -1, -1 }                                                                      // ThumbRight
+};
+
+//---------------------------------------------------------------------------
+// Orientations of one body sample
+struct SkeletonRotations
+{
+    float Gx[KINECT_JOINT_STRIDE], Gy[KINECT_JOINT_STRIDE], Gz[KINECT_JOINT_STRIDE], Gw[KINECT_JOINT_STRIDE];   // sensor space
+    float Lx[KINECT_JOINT_STRIDE], Ly[KINECT_JOINT_STRIDE], Lz[KINECT_JOINT_STRIDE], Lw[KINECT_JOINT_STRIDE];   // parent space
+
+    Quat4 Global(int joint) const { return MakeQuat4(Gx[joint], Gy[joint], Gz[joint], Gw[joint]); }
+    Quat4 Local(int joint) const { return MakeQuat4(Lx[joint], Ly[joint], Lz[joint], Lw[joint]); }
+};
+
+// Orientations of a whole recording, laid out like KinectClip
+struct KinectRotationClip
+{
+    float              SampleRate;
+    int                NumFrames;
+    int                FrameStride;     // MotionFrameStride(NumFrames), as the source clip
+    std::vector<float> Gx, Gy, Gz, Gw;  // [joint * FrameStride + frame]
+    std::vector<float> Lx, Ly, Lz, Lw;
+
+    KinectRotationClip() : SampleRate(30.0f), NumFrames(0), FrameStride(0) {}
+
+    void Allocate(int numFrames, float sampleRate)
+    {
+        SampleRate = sampleRate;
+        NumFrames = numFrames;
+        FrameStride = MotionFrameStride(numFrames);
+        std::vector<float>* channels[] = { &Gx, &Gy, &Gz, &Gw, &Lx, &Ly, &Lz, &Lw };
+        for (int c = 0; c < 8; ++c)
+            channels[c]->assign((size_t)KinectJoint_Count * FrameStride, 0.0f);
+    }
+
+    size_t Index(int joint, int frame) const { return (size_t)joint * FrameStride + frame; }
+
+    Quat4 Global(int joint, int frame) const { size_t i = Index(joint, frame); return MakeQuat4(Gx[i], Gy[i], Gz[i], Gw[i]); }
+    Quat4 Local(int joint, int frame) const { size_t i = Index(joint, frame); return MakeQuat4(Lx[i], Ly[i], Lz[i], Lw[i]); }
+};
+
+//---------------------------------------------------------------------------
+// Global orientation of four joints from their bone and twist reference
+// vectors. 'parent' supplies the fallback axes; lanes that needed them are
+// set in *fellBack.
+inline Quat4x4 SolveJointFrame4(const Vec3x4& bone, const Vec3x4& ref, const Quat4x4& parent, __m128* fellBack)
+{
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    Vec3x4 ex = { one, zero, zero }, ey = { zero, one, zero };
+    Vec3x4 px = QuatRotate4(parent, ex), py = QuatRotate4(parent, ey);
+
+    __m128 boneOk = _mm_cmpgt_ps(Dot4(bone, bone), _mm_set1_ps(1e-8f));
+    Vec3x4 y = Select4(boneOk, Normalize4(bone), py);
+
+    // reject the bone direction from the reference; a near-parallel reference
+    // (sine below ~0.03) carries no usable twist
+    Vec3x4 x = Sub4(ref, Scale4(y, Dot4(ref, y)));
+    __m128 refOk = _mm_cmpgt_ps(Dot4(x, x), _mm_mul_ps(_mm_set1_ps(1e-3f), Dot4(ref, ref)));
+    Vec3x4 alt = Sub4(px, Scale4(y, Dot4(px, y)));
+    __m128 altOk = _mm_cmpgt_ps(Dot4(alt, alt), _mm_set1_ps(1e-3f));
+    alt = Select4(altOk, alt, Sub4(py, Scale4(y, Dot4(py, y))));
+    x = Normalize4(Select4(refOk, x, alt));
+
+    if (fellBack)
+        *fellBack = _mm_andnot_ps(_mm_and_ps(boneOk, refOk), _mm_cmpeq_ps(zero, zero));
+    return QuatFromBasis4(x, y, Cross4(x, y));
+}
+
+//---------------------------------------------------------------------------
+// Whole recording in one pass. Consecutive keys of every joint are kept on
+// the same hemisphere so later stages can filter or lerp them componentwise.
+inline void SolveClipRotations(const KinectClip& clip, KinectRotationClip& out)
+{
+    out.Allocate(clip.NumFrames, clip.SampleRate);
+    __m128 zero = _mm_setzero_ps();
+    Quat4x4 identity = { zero, zero, zero, _mm_set1_ps(1.0f) };
+
+    for (int h = 0; h < KinectJoint_Count; ++h)
+    {
+        int j = KinectHierarchyOrder[h];
+        int p = KinectJointParent[j];
+        const KinectBoneFrame& rule = KinectBoneFrames[j];
+        size_t ji = clip.Index(j, 0), jo = out.Index(j, 0), po = p >= 0 ? out.Index(p, 0) : 0;
+
+        for (int f = 0; f < out.FrameStride; f += 4)
+        {
+            Quat4x4 parent = p >= 0 ? LoadQuat4x4(&out.Gx[po + f], &out.Gy[po + f], &out.Gz[po + f], &out.Gw[po + f]) : identity;
+            Quat4x4 g = parent, l = identity;
+            if (rule.Child >= 0)
+            {
+                size_t co = clip.Index(rule.Child, f), fo = clip.Index(rule.RefFrom, f), to = clip.Index(rule.RefTo, f);
+                Vec3x4 pos = LoadVec3x4(&clip.X[ji + f], &clip.Y[ji + f], &clip.Z[ji + f]);
+                Vec3x4 bone = Sub4(LoadVec3x4(&clip.X[co], &clip.Y[co], &clip.Z[co]), pos);
+                Vec3x4 ref = Sub4(LoadVec3x4(&clip.X[to], &clip.Y[to], &clip.Z[to]), LoadVec3x4(&clip.X[fo], &clip.Y[fo], &clip.Z[fo]));
+                g = SolveJointFrame4(bone, ref, parent, nullptr);
+                l = p >= 0 ? QuatNormalize4(QuatMul4(QuatConjugate4(parent), g)) : g;
+            }
+            StoreQuat4x4(g, &out.Gx[jo + f], &out.Gy[jo + f], &out.Gz[jo + f], &out.Gw[jo + f]);
+            StoreQuat4x4(l, &out.Lx[jo + f], &out.Ly[jo + f], &out.Lz[jo + f], &out.Lw[jo + f]);
+        }
+    }
+
+    // hemisphere continuity; parents were solved from the unflipped keys,
+    // which is fine since q and -q are the same rotation
+    std::vector<float>* sets[2][4] = { { &out.Gx, &out.Gy, &out.Gz, &out.Gw }, { &out.Lx, &out.Ly, &out.Lz, &out.Lw } };
+    for (int s = 0; s < 2; ++s)
+    {
+        float* qx = &(*sets[s][0])[0];
+        float* qy = &(*sets[s][1])[0];
+        float* qz = &(*sets[s][2])[0];
+        float* qw = &(*sets[s][3])[0];
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            size_t o = out.Index(j, 0);
+            for (int f = 1; f < out.NumFrames; ++f)
+            {
+                size_t a = o + f - 1, b = o + f;
+                if (qx[a] * qx[b] + qy[a] * qy[b] + qz[a] * qz[b] + qw[a] * qw[b] < 0.0f)
+                {
+                    qx[b] = -qx[b]; qy[b] = -qy[b]; qz[b] = -qz[b]; qw[b] = -qw[b];
+                }
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// One live frame: all joints against the sensor axes first, then the few
+// that fell back (and the leaves) again against their solved parent.
+inline void SolveFrameRotations(const SkeletonFrame& frame, SkeletonRotations& out)
+{
+    float bx[KINECT_JOINT_STRIDE] = {}, by[KINECT_JOINT_STRIDE] = {}, bz[KINECT_JOINT_STRIDE] = {};
+    float rx[KINECT_JOINT_STRIDE] = {}, ry[KINECT_JOINT_STRIDE] = {}, rz[KINECT_JOINT_STRIDE] = {};
+    for (int j = 0; j < KinectJoint_Count; ++j)
+    {
+        const KinectBoneFrame& rule = KinectBoneFrames[j];
+        if (rule.Child < 0)
+            continue;
+        bx[j] = frame.X[rule.Child] - frame.X[j];
+        by[j] = frame.Y[rule.Child] - frame.Y[j];
+        bz[j] = frame.Z[rule.Child] - frame.Z[j];
+        rx[j] = frame.X[rule.RefTo] - frame.X[rule.RefFrom];
+        ry[j] = frame.Y[rule.RefTo] - frame.Y[rule.RefFrom];
+        rz[j] = frame.Z[rule.RefTo] - frame.Z[rule.RefFrom];
+    }
+
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    Quat4x4 identity = { zero, zero, zero, one };
+    int fellBack = 0;
+    for (int j = 0; j < KINECT_JOINT_STRIDE; j += 4)
+    {
+        __m128 fell;
+        Quat4x4 g = SolveJointFrame4(LoadVec3x4(&bx[j], &by[j], &bz[j]), LoadVec3x4(&rx[j], &ry[j], &rz[j]), identity, &fell);
+        StoreQuat4x4(g, &out.Gx[j], &out.Gy[j], &out.Gz[j], &out.Gw[j]);
+        fellBack |= _mm_movemask_ps(fell) << j;
+    }
+
+    for (int h = 1; h < KinectJoint_Count; ++h)
+    {
+        int j = KinectHierarchyOrder[h];
+        int p = KinectJointParent[j];
+        if (KinectBoneFrames[j].Child < 0)
+        {
+            out.Gx[j] = out.Gx[p]; out.Gy[j] = out.Gy[p]; out.Gz[j] = out.Gz[p]; out.Gw[j] = out.Gw[p];
+        }
+        else if (fellBack & (1 << j))
+        {
+            Quat4x4 parent = { _mm_set1_ps(out.Gx[p]), _mm_set1_ps(out.Gy[p]), _mm_set1_ps(out.Gz[p]), _mm_set1_ps(out.Gw[p]) };
+            Vec3x4 bone = { _mm_set1_ps(bx[j]), _mm_set1_ps(by[j]), _mm_set1_ps(bz[j]) };
+            Vec3x4 ref = { _mm_set1_ps(rx[j]), _mm_set1_ps(ry[j]), _mm_set1_ps(rz[j]) };
+            Quat4x4 g = SolveJointFrame4(bone, ref, parent, nullptr);
+            out.Gx[j] = _mm_cvtss_f32(g.x); out.Gy[j] = _mm_cvtss_f32(g.y);
+            out.Gz[j] = _mm_cvtss_f32(g.z); out.Gw[j] = _mm_cvtss_f32(g.w);
+        }
+    }
+
+    // gather parent globals (identity for the root and the padding lanes)
+    float px[KINECT_JOINT_STRIDE], py[KINECT_JOINT_STRIDE], pz[KINECT_JOINT_STRIDE], pw[KINECT_JOINT_STRIDE];
+    for (int j = 0; j < KINECT_JOINT_STRIDE; ++j)
+    {
+        int p = j < KinectJoint_Count ? KinectJointParent[j] : -1;
+        px[j] = p >= 0 ? out.Gx[p] : 0.0f;
+        py[j] = p >= 0 ? out.Gy[p] : 0.0f;
+        pz[j] = p >= 0 ? out.Gz[p] : 0.0f;
+        pw[j] = p >= 0 ? out.Gw[p] : 1.0f;
+    }
+    for (int j = 0; j < KINECT_JOINT_STRIDE; j += 4)
+    {
+        Quat4x4 parent = LoadQuat4x4(&px[j], &py[j], &pz[j], &pw[j]);
+        Quat4x4 g = LoadQuat4x4(&out.Gx[j], &out.Gy[j], &out.Gz[j], &out.Gw[j]);
+        StoreQuat4x4(QuatNormalize4(QuatMul4(QuatConjugate4(parent), g)), &out.Lx[j], &out.Ly[j], &out.Lz[j], &out.Lw[j]);
+    }
+}
+
+#endif // KINECT_ROTATION_SOLVER_H
@@ -0,0 +1,112 @@
+#ifndef KINECT_SKELETON_H
+#define KINECT_SKELETON_H
+
+// Kinect v2 body topology. Joint order is the sensor's (and the order of the
+// 25 x/y/z triples per row in the motion files). The tables are constexpr so
+// that KinectV2Topology (SkeletonTopology.h) can derive its bones from them.
+
+#include "../Common/MotionMath.h"
+
+enum KinectJoint
+{
+    KinectJoint_SpineBase     = 0,
+    KinectJoint_SpineMid      = 1,
+    KinectJoint_Neck          = 2,
+    KinectJoint_Head          = 3,
+    KinectJoint_ShoulderLeft  = 4,
+    KinectJoint_ElbowLeft     = 5,
+    KinectJoint_WristLeft     = 6,
+    KinectJoint_HandLeft      = 7,
+    KinectJoint_ShoulderRight = 8,
+    KinectJoint_ElbowRight    = 9,
+    KinectJoint_WristRight    = 10,
+    KinectJoint_HandRight     = 11,
+    KinectJoint_HipLeft       = 12,
+    KinectJoint_KneeLeft      = 13,
+    KinectJoint_AnkleLeft     = 14,
+    KinectJoint_FootLeft      = 15,
+    KinectJoint_HipRight      = 16,
+    KinectJoint_KneeRight     = 17,
+    KinectJoint_AnkleRight    = 18,
+    KinectJoint_FootRight     = 19,
+    KinectJoint_SpineShoulder = 20,
+    KinectJoint_HandTipLeft   = 21,
+    KinectJoint_ThumbLeft     = 22,
+    KinectJoint_HandTipRight  = 23,
+    KinectJoint_ThumbRight    = 24,
+    KinectJoint_Count         = 25
+};
+
+// SoA arrays are padded to a multiple of four joints for the SSE loops
+#define KINECT_JOINT_STRIDE 28
+
+static constexpr int KinectJointParent[KinectJoint_Count] =
+{
+    -1,                                                 // SpineBase
+    KinectJoint_SpineBase,                              // SpineMid
+    KinectJoint_SpineShoulder,                          // Neck
+    KinectJoint_Neck,                                   // Head
+    KinectJoint_SpineShoulder,                          // ShoulderLeft
+    KinectJoint_ShoulderLeft,                           // ElbowLeft
+    KinectJoint_ElbowLeft,                              // WristLeft
+    KinectJoint_WristLeft,                              // HandLeft
+    KinectJoint_SpineShoulder,                          // ShoulderRight
+    KinectJoint_ShoulderRight,                          // ElbowRight
+    KinectJoint_ElbowRight,                             // WristRight
+    KinectJoint_WristRight,                             // HandRight
+    KinectJoint_SpineBase,                              // HipLeft
+    KinectJoint_HipLeft,                                // KneeLeft
+    KinectJoint_KneeLeft,                               // AnkleLeft
+    KinectJoint_AnkleLeft,                              // FootLeft
+    KinectJoint_SpineBase,                              // HipRight
+    KinectJoint_HipRight,                               // KneeRight
+    KinectJoint_KneeRight,                              // AnkleRight
+    KinectJoint_AnkleRight,                             // FootRight
+    KinectJoint_SpineMid,                               // SpineShoulder
+    KinectJoint_HandLeft,                               // HandTipLeft
+    KinectJoint_WristLeft,                              // ThumbLeft
+    KinectJoint_HandRight,                              // HandTipRight
+    KinectJoint_WristRight                              // ThumbRight
+};
+
+// Parents before children
+static constexpr int KinectHierarchyOrder[KinectJoint_Count] =
+{
+    KinectJoint_SpineBase, KinectJoint_SpineMid, KinectJoint_SpineShoulder, KinectJoint_Neck, KinectJoint_Head,
+    KinectJoint_ShoulderLeft, KinectJoint_ElbowLeft, KinectJoint_WristLeft, KinectJoint_HandLeft, KinectJoint_HandTipLeft, KinectJoint_ThumbLeft,
+    KinectJoint_ShoulderRight, KinectJoint_ElbowRight, KinectJoint_WristRight, KinectJoint_HandRight, KinectJoint_HandTipRight, KinectJoint_ThumbRight,
+    KinectJoint_HipLeft, KinectJoint_KneeLeft, KinectJoint_AnkleLeft, KinectJoint_FootLeft,
+    KinectJoint_HipRight, KinectJoint_KneeRight, KinectJoint_AnkleRight, KinectJoint_FootRight
+};
+
+static const char* const KinectJointNames[KinectJoint_Count] =
+{
+    "SpineBase", "SpineMid", "Neck", "Head",
+    "ShoulderLeft", "ElbowLeft", "WristLeft", "HandLeft",
+    "ShoulderRight", "ElbowRight", "WristRight", "HandRight",
+    "HipLeft", "KneeLeft", "AnkleLeft", "FootLeft",
+    "HipRight", "KneeRight", "AnkleRight", "FootRight",
+    "SpineShoulder", "HandTipLeft", "ThumbLeft", "HandTipRight", "ThumbRight"
+};
+
+//---------------------------------------------------------------------------
+// One body sample, SoA so that per-joint math runs four joints per SSE op.
+struct SkeletonFrame
+{
+    float  X[KINECT_JOINT_STRIDE];
+    float  Y[KINECT_JOINT_STRIDE];
+    float  Z[KINECT_JOINT_STRIDE];
+    double Time;                        // seconds
+
+    void Clear()
+    {
+        for (int j = 0; j < KINECT_JOINT_STRIDE; ++j)
+            X[j] = Y[j] = Z[j] = 0.0f;
+        Time = 0.0;
+    }
+
+    Float3 Get(int joint) const { return MakeFloat3(X[joint], Y[joint], Z[joint]); }
+    void   Set(int joint, const Float3& p) { X[joint] = p.x; Y[joint] = p.y; Z[joint] = p.z; }
+};
+
+#endif // KINECT_SKELETON_H
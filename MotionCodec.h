@@ -0,0 +1,759 @@
+#ifndef MOTION_CODEC_H
+#define MOTION_CODEC_H
+
+// Compact binary coding of Kinect skeletons, for archive files (*.kmc) and
+// for the live stream.
+//
+// Every coordinate becomes a 16 bit millimetre value: SpineBase absolute,
+// every other joint as an offset from SpineBase, so the quantization error
+// is at most 0.5 mm per axis. Frames are predicted linearly from the two
+// before (2 * previous - the one before that) and the residuals are Rice
+// coded with a per-channel parameter that both sides adapt from the recent
+// residual sizes, so no tables are transmitted. A key frame stores the 75
+// values plainly and resets prediction and adaptation; after it each
+// channel costs a few bits per frame instead of the ~9 bytes of text.
+//
+// Archive files have a key frame every BlockFrames frames and an offset
+// table, so any frame decodes after at most one block. The stream sends
+// one packet per frame with a key frame every KeyInterval packets; its
+// delta packets are predicted from that key alone, so a lost packet costs
+// only its own frame (see MotionStreamEncoder).
+//
+// Decoding is a scalar bit reader for the residuals and an SSE2 pass that
+// adds the prediction and converts to metres, four channels per op.
+
+#include "../Common/MotionFile.h"
+
+#include <algorithm>
+#include <emmintrin.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define MOTION_CODEC_CHANNELS   (3 * KINECT_JOINT_STRIDE)   // x y z per joint, padded like SkeletonFrame
+#define MOTION_CODEC_MAX_K      16
+#define MOTION_CODEC_ESCAPE     16                          // unary length that escapes to a raw value
+#define MOTION_CODEC_RAW_BITS   18                          // zigzag residuals of 16 bit values fit
+
+static const char MotionCodecMagic[4] = { 'K', 'M', 'C', '1' };
+
+//---------------------------------------------------------------------------
+// LSB-first bit packing
+
+struct MotionBitWriter
+{
+    std::vector<uint8_t>* Out;
+    uint64_t              Bits;
+    int                   Count;
+
+    explicit MotionBitWriter(std::vector<uint8_t>& out) : Out(&out), Bits(0), Count(0) {}
+
+    void Put(uint32_t value, int n)     // n <= 32
+    {
+        Bits |= (uint64_t)value << Count;
+        Count += n;
+        while (Count >= 8)
+        {
+            Out->push_back((uint8_t)Bits);
+            Bits >>= 8;
+            Count -= 8;
+        }
+    }
+
+    void Flush()
+    {
+        if (Count > 0)
+            Out->push_back((uint8_t)Bits);
+        Bits = 0;
+        Count = 0;
+    }
+};
+
+struct MotionBitReader
+{
+    const uint8_t* Data;
+    const uint8_t* End;
+    uint64_t       Bits;
+    int            Count;
+    int            Padding;     // zero bits appended past the end
+    bool           Overrun;     // consumed some of them
+
+    MotionBitReader(const uint8_t* data, size_t size) : Data(data), End(data + size), Bits(0), Count(0), Padding(0), Overrun(false) {}
+
+    uint32_t Peek32()
+    {
+        while (Count <= 56)
+        {
+            if (Data < End)
+                Bits |= (uint64_t)*Data++ << Count;
+            else if (Count >= 32)
+                break;
+            else
+                Padding += 8;
+            Count += 8;
+        }
+        return (uint32_t)Bits;
+    }
+
+    void Skip(int n)
+    {
+        Bits >>= n;
+        Count -= n;
+        if (Count < Padding)
+            Overrun = true;
+    }
+
+    uint32_t Get(int n)         // n <= 32
+    {
+        uint32_t v = Peek32() & (uint32_t)(((uint64_t)1 << n) - 1);
+        Skip(n);
+        return v;
+    }
+};
+
+inline int MotionTrailingOnes(uint32_t v)
+{
+    uint32_t zeros = ~v;
+    if (!zeros)
+        return 32;
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, zeros);
+    return (int)index;
+#else
+    return __builtin_ctz(zeros);
+#endif
+}
+
+inline int MotionHighestBit(uint32_t v)     // v != 0
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, v);
+    return (int)index;
+#else
+    return 31 - __builtin_clz(v);
+#endif
+}
+
+//---------------------------------------------------------------------------
+// Channel layout is the one of SkeletonFrame: [axis * KINECT_JOINT_STRIDE + joint]
+
+inline int32_t MotionClampInt16(float v)
+{
+    v = floorf(v + 0.5f);
+    return (int32_t)(v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v));
+}
+
+inline void QuantizeSkeleton(const SkeletonFrame& frame, int32_t* q)
+{
+    const float* axes[3] = { frame.X, frame.Y, frame.Z };
+    for (int c = 0; c < 3; ++c)
+    {
+        int32_t* dst = q + c * KINECT_JOINT_STRIDE;
+        int32_t base = MotionClampInt16(axes[c][KinectJoint_SpineBase] * 1000.0f);
+        dst[KinectJoint_SpineBase] = base;
+        for (int j = 1; j < KINECT_JOINT_STRIDE; ++j)
+            dst[j] = j < KinectJoint_Count ? MotionClampInt16(axes[c][j] * 1000.0f - (float)base) : 0;
+    }
+}
+
+// Lanes that get SpineBase added back: every joint but SpineBase itself and the padding
+static const int32_t MotionRelativeMask[KINECT_JOINT_STRIDE] =
+{
+    0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0
+};
+
+// Quantized channels (SpineBase absolute, the rest relative to it) to metres
+inline void MotionSkeletonToMetres(const int32_t* q, SkeletonFrame& out)
+{
+    float* axes[3] = { out.X, out.Y, out.Z };
+    __m128 scale = _mm_set1_ps(0.001f);
+    for (int c = 0; c < 3; ++c)
+    {
+        const int32_t* v = q + c * KINECT_JOINT_STRIDE;
+        __m128i base = _mm_set1_epi32(v[KinectJoint_SpineBase]);
+        for (int j = 0; j < KINECT_JOINT_STRIDE; j += 4)
+        {
+            __m128i mask = _mm_loadu_si128((const __m128i*)(MotionRelativeMask + j));
+            __m128i mm = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(v + j)), _mm_and_si128(base, mask));
+            _mm_storeu_ps(axes[c] + j, _mm_mul_ps(_mm_cvtepi32_ps(mm), scale));
+        }
+    }
+}
+
+// SIMD half of the decoder: v = 2 * prev - prev2 + residual, then metres
+inline void ReconstructSkeleton(const int32_t* residual, int32_t* prev, int32_t* prev2, SkeletonFrame& out)
+{
+    for (int i = 0; i < MOTION_CODEC_CHANNELS; i += 4)
+    {
+        __m128i p1 = _mm_loadu_si128((const __m128i*)(prev + i));
+        __m128i p2 = _mm_loadu_si128((const __m128i*)(prev2 + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(residual + i));
+        __m128i v = _mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(p1, 1), p2), r);
+        _mm_storeu_si128((__m128i*)(prev2 + i), p1);
+        _mm_storeu_si128((__m128i*)(prev + i), v);
+    }
+    MotionSkeletonToMetres(prev, out);
+}
+
+//---------------------------------------------------------------------------
+// Prediction and Rice parameter state shared by encoder and decoder
+
+// Smallest k with count << k >= sum (sum: of |residual|): the bit length
+// difference or one more
+inline int MotionRiceParameter(uint32_t sum, uint32_t count)
+{
+    if (sum <= count)
+        return 0;
+    int k = MotionHighestBit(sum) - MotionHighestBit(count);
+    if ((count << k) < sum)
+        ++k;
+    return k < MOTION_CODEC_MAX_K ? k : MOTION_CODEC_MAX_K;
+}
+
+struct MotionCoderState
+{
+    int32_t  Prev[MOTION_CODEC_CHANNELS];
+    int32_t  Prev2[MOTION_CODEC_CHANNELS];
+    uint32_t Sum[MOTION_CODEC_CHANNELS];       // recent |residual| sum
+    uint32_t Count[MOTION_CODEC_CHANNELS];
+    int      FramesSinceKey;                    // -1 before the first key frame
+
+    MotionCoderState() { Reset(); }
+
+    void Reset()
+    {
+        memset(Prev, 0, sizeof(Prev));
+        memset(Prev2, 0, sizeof(Prev2));
+        FramesSinceKey = -1;
+    }
+
+    // After a key frame: predict "no motion" once, sizes start at ~8 mm
+    void StartKey()
+    {
+        memcpy(Prev2, Prev, sizeof(Prev));
+        for (int i = 0; i < MOTION_CODEC_CHANNELS; ++i)
+        {
+            Sum[i] = 8;
+            Count[i] = 1;
+        }
+        FramesSinceKey = 0;
+    }
+
+    int RiceParameter(int ch) const { return MotionRiceParameter(Sum[ch], Count[ch]); }
+
+    void Adapt(int ch, uint32_t zigzag)
+    {
+        Sum[ch] += zigzag >> 1;
+        if (++Count[ch] >= 16)
+        {
+            Sum[ch] >>= 1;
+            Count[ch] >>= 1;
+        }
+    }
+};
+
+inline uint32_t MotionZigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t  MotionUnzigzag(uint32_t u) { return (int32_t)(u >> 1) ^ -(int32_t)(u & 1); }
+
+// One Rice coded zigzag value; quotients from MOTION_CODEC_ESCAPE on are sent raw
+inline void PutMotionRice(MotionBitWriter& out, uint32_t u, int k)
+{
+    uint32_t quotient = u >> k;
+    if (quotient < MOTION_CODEC_ESCAPE)
+    {
+        out.Put((1u << quotient) - 1, (int)quotient + 1);
+        out.Put(u & ((1u << k) - 1), k);
+    }
+    else
+    {
+        out.Put((1u << MOTION_CODEC_ESCAPE) - 1, MOTION_CODEC_ESCAPE);
+        out.Put(u, MOTION_CODEC_RAW_BITS);
+    }
+}
+
+inline uint32_t GetMotionRice(MotionBitReader& in, int k)
+{
+    uint32_t bits = in.Peek32();
+    int quotient = MotionTrailingOnes(bits);
+    if (quotient < MOTION_CODEC_ESCAPE)
+    {
+        in.Skip(quotient + 1 + k);
+        return ((uint32_t)quotient << k) | ((bits >> (quotient + 1)) & ((1u << k) - 1));
+    }
+    in.Skip(MOTION_CODEC_ESCAPE);
+    return in.Get(MOTION_CODEC_RAW_BITS);
+}
+
+inline void EncodeSkeleton(const SkeletonFrame& frame, bool key, MotionCoderState& state, MotionBitWriter& out)
+{
+    int32_t q[MOTION_CODEC_CHANNELS];
+    QuantizeSkeleton(frame, q);
+    if (key || state.FramesSinceKey < 0)
+    {
+        for (int c = 0; c < 3; ++c)
+            for (int j = 0; j < KinectJoint_Count; ++j)
+                out.Put((uint16_t)q[c * KINECT_JOINT_STRIDE + j], 16);
+        memcpy(state.Prev, q, sizeof(q));
+        state.StartKey();
+        return;
+    }
+    for (int c = 0; c < 3; ++c)
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            int ch = c * KINECT_JOINT_STRIDE + j;
+            uint32_t u = MotionZigzag(q[ch] - (2 * state.Prev[ch] - state.Prev2[ch]));
+            PutMotionRice(out, u, state.RiceParameter(ch));
+            state.Adapt(ch, u);
+        }
+    memcpy(state.Prev2, state.Prev, sizeof(q));
+    memcpy(state.Prev, q, sizeof(q));
+    ++state.FramesSinceKey;
+}
+
+inline void DecodeSkeleton(bool key, MotionCoderState& state, MotionBitReader& in, SkeletonFrame& out)
+{
+    int32_t residual[MOTION_CODEC_CHANNELS];
+    memset(residual, 0, sizeof(residual));
+    if (key)
+    {
+        for (int c = 0; c < 3; ++c)
+            for (int j = 0; j < KinectJoint_Count; ++j)
+                residual[c * KINECT_JOINT_STRIDE + j] = (int16_t)in.Get(16);
+        // prev = prev2 = 0, so the reconstruction passes the values through
+        memset(state.Prev, 0, sizeof(state.Prev));
+        memset(state.Prev2, 0, sizeof(state.Prev2));
+        ReconstructSkeleton(residual, state.Prev, state.Prev2, out);
+        state.StartKey();
+        return;
+    }
+    for (int c = 0; c < 3; ++c)
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            int ch = c * KINECT_JOINT_STRIDE + j;
+            uint32_t u = GetMotionRice(in, state.RiceParameter(ch));
+            residual[ch] = MotionUnzigzag(u);
+            state.Adapt(ch, u);
+        }
+    ReconstructSkeleton(residual, state.Prev, state.Prev2, out);
+    ++state.FramesSinceKey;
+}
+
+//---------------------------------------------------------------------------
+// Archive clips
+
+struct EncodedMotionClip
+{
+    std::vector<MotionParameter> Parameters;
+    float                        SampleRate;
+    int                          NumFrames;
+    int                          BlockFrames;
+    std::vector<uint32_t>        BlockOffsets;  // into Data, one per block
+    std::vector<uint8_t>         Data;
+
+    EncodedMotionClip() : SampleRate(30.0f), NumFrames(0), BlockFrames(32) {}
+
+    int NumBlocks() const { return (int)BlockOffsets.size(); }
+
+    size_t BlockBytes(int block) const
+    {
+        return (block + 1 < NumBlocks() ? BlockOffsets[block + 1] : (uint32_t)Data.size()) - BlockOffsets[block];
+    }
+
+    size_t SizeBytes() const { return BlockOffsets.size() * sizeof(uint32_t) + Data.size(); }
+};
+
+inline void EncodeMotionClip(const KinectClip& clip, int blockFrames, EncodedMotionClip& out)
+{
+    out.Parameters = clip.Parameters;
+    out.SampleRate = clip.SampleRate;
+    out.NumFrames = clip.NumFrames;
+    out.BlockFrames = blockFrames > 0 ? blockFrames : 32;
+    out.BlockOffsets.clear();
+    out.Data.clear();
+
+    MotionCoderState state;
+    SkeletonFrame frame;
+    for (int first = 0; first < clip.NumFrames; first += out.BlockFrames)
+    {
+        out.BlockOffsets.push_back((uint32_t)out.Data.size());
+        MotionBitWriter writer(out.Data);
+        int end = std::min(clip.NumFrames, first + out.BlockFrames);
+        for (int f = first; f < end; ++f)
+        {
+            clip.GetFrame(f, frame);
+            EncodeSkeleton(frame, f == first, state, writer);
+        }
+        writer.Flush();    // blocks start on a byte
+    }
+}
+
+// Decodes block 'block' into the matching frames of 'out' (already allocated)
+inline bool DecodeMotionBlock(const EncodedMotionClip& clip, int block, KinectClip& out)
+{
+    MotionCoderState state;
+    MotionBitReader reader(&clip.Data[clip.BlockOffsets[block]], clip.BlockBytes(block));
+    SkeletonFrame frame;
+    int first = block * clip.BlockFrames, end = std::min(clip.NumFrames, first + clip.BlockFrames);
+    for (int f = first; f < end; ++f)
+    {
+        DecodeSkeleton(f == first, state, reader, frame);
+        out.SetFrame(f, frame);
+    }
+    return !reader.Overrun;
+}
+
+// The same into frames (BlockFrames of them, the last block may fill fewer),
+// stamped with their time in the clip; returns how many, -1 on a bad block
+inline int DecodeMotionBlock(const EncodedMotionClip& clip, int block, SkeletonFrame* out)
+{
+    MotionCoderState state;
+    MotionBitReader reader(&clip.Data[clip.BlockOffsets[block]], clip.BlockBytes(block));
+    int first = block * clip.BlockFrames, n = std::min(clip.NumFrames - first, clip.BlockFrames);
+    for (int i = 0; i < n; ++i)
+    {
+        DecodeSkeleton(i == 0, state, reader, out[i]);
+        out[i].Time = (first + i) / clip.SampleRate;
+    }
+    return reader.Overrun ? -1 : n;
+}
+
+inline bool DecodeMotionClip(const EncodedMotionClip& clip, KinectClip& out)
+{
+    out.Parameters = clip.Parameters;
+    out.SampleRate = clip.SampleRate;
+    out.Allocate(clip.NumFrames);
+    bool ok = true;
+    for (int b = 0; b < clip.NumBlocks(); ++b)
+        ok = DecodeMotionBlock(clip, b, out) && ok;
+    return ok && clip.NumFrames > 0;
+}
+
+// Random access to one frame: decodes its block up to it
+inline bool DecodeMotionFrame(const EncodedMotionClip& clip, int frameIndex, SkeletonFrame& out)
+{
+    if (frameIndex < 0 || frameIndex >= clip.NumFrames)
+        return false;
+    int block = frameIndex / clip.BlockFrames;
+    MotionCoderState state;
+    MotionBitReader reader(&clip.Data[clip.BlockOffsets[block]], clip.BlockBytes(block));
+    for (int f = block * clip.BlockFrames; f <= frameIndex; ++f)
+        DecodeSkeleton(f == block * clip.BlockFrames, state, reader, out);
+    out.Time = frameIndex / clip.SampleRate;
+    return !reader.Overrun;
+}
+
+//---------------------------------------------------------------------------
+// *.kmc files:
+//
+//   "KMC1" float sampleRate, u32 frames, u32 blockFrames, u32 blocks, u32 parameters
+//   parameters: u16 name length, name, u16 value length, value
+//   u32 block offsets, then the block data
+//
+// little-endian, like the hosts this runs on.
+
+inline void PutMotionString(std::vector<uint8_t>& out, const std::string& s)
+{
+    uint16_t n = (uint16_t)std::min(s.size(), (size_t)65535);
+    out.insert(out.end(), (const uint8_t*)&n, (const uint8_t*)&n + 2);
+    out.insert(out.end(), s.begin(), s.begin() + n);
+}
+
+inline bool SaveEncodedMotionFile(const std::string& sFile, const EncodedMotionClip& clip)
+{
+    std::vector<uint8_t> header(MotionCodecMagic, MotionCodecMagic + 4);
+    uint32_t fields[5];
+    memcpy(&fields[0], &clip.SampleRate, 4);
+    fields[1] = (uint32_t)clip.NumFrames;
+    fields[2] = (uint32_t)clip.BlockFrames;
+    fields[3] = (uint32_t)clip.NumBlocks();
+    fields[4] = (uint32_t)clip.Parameters.size();
+    header.insert(header.end(), (const uint8_t*)fields, (const uint8_t*)(fields + 5));
+    for (size_t i = 0; i < clip.Parameters.size(); ++i)
+    {
+        PutMotionString(header, clip.Parameters[i].Name);
+        PutMotionString(header, clip.Parameters[i].Value);
+    }
+
+    FILE* f = fopen(sFile.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(header.data(), 1, header.size(), f) == header.size();
+    if (clip.NumBlocks() > 0)
+        ok = ok && fwrite(clip.BlockOffsets.data(), sizeof(uint32_t), clip.BlockOffsets.size(), f) == clip.BlockOffsets.size();
+    if (!clip.Data.empty())
+        ok = ok && fwrite(clip.Data.data(), 1, clip.Data.size(), f) == clip.Data.size();
+    return fclose(f) == 0 && ok;
+}
+
+// Sample rate as read from a file header: every frame time is divided by it
+inline bool ValidMotionSampleRate(float rate)
+{
+    return isfinite(rate) && rate > 0.0f;
+}
+
+// Fewest bytes a block of 'frames' frames can take: a plain key frame and at
+// least one bit per channel after it. Loaders check counts from a file
+// against it before allocating anything.
+inline size_t MotionBlockMinBytes(uint32_t frames)
+{
+    if (frames == 0)
+        return 0;
+    return (size_t)(((uint64_t)KinectJoint_Count * 3 * 16 + (uint64_t)(frames - 1) * KinectJoint_Count * 3 + 7) / 8);
+}
+
+inline bool LoadEncodedMotionFile(const std::string& sFile, EncodedMotionClip& clip)
+{
+    FILE* f = fopen(sFile.c_str(), "rb");
+    if (!f)
+        return false;
+    std::vector<uint8_t> file;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        file.insert(file.end(), chunk, chunk + n);
+    fclose(f);
+
+    size_t at = 0;
+    uint32_t fields[5];
+    if (file.size() < 24 || memcmp(file.data(), MotionCodecMagic, 4) != 0)
+        return false;
+    memcpy(fields, &file[4], sizeof(fields));
+    at = 24;
+    memcpy(&clip.SampleRate, &fields[0], 4);
+    clip.NumFrames = (int)fields[1];
+    clip.BlockFrames = (int)fields[2];
+    uint32_t blocks = fields[3];
+    if (!ValidMotionSampleRate(clip.SampleRate) || clip.NumFrames < 0 || clip.BlockFrames <= 0 || blocks != ((uint64_t)fields[1] + fields[2] - 1) / fields[2])
+        return false;
+
+    // every parameter takes at least its two lengths
+    if (fields[4] > (file.size() - at) / 4)
+        return false;
+    clip.Parameters.resize(fields[4]);
+    for (uint32_t i = 0; i < fields[4]; ++i)
+    {
+        std::string* dst[2] = { &clip.Parameters[i].Name, &clip.Parameters[i].Value };
+        for (int s = 0; s < 2; ++s)
+        {
+            uint16_t len;
+            if (at + 2 > file.size())
+                return false;
+            memcpy(&len, &file[at], 2);
+            if (at + 2 + len > file.size())
+                return false;
+            dst[s]->assign((const char*)&file[at + 2], len);
+            at += 2 + len;
+        }
+    }
+
+    if (at + blocks * sizeof(uint32_t) > file.size())
+        return false;
+    clip.BlockOffsets.resize(blocks);
+    if (blocks)
+        memcpy(clip.BlockOffsets.data(), &file[at], blocks * sizeof(uint32_t));
+    at += blocks * sizeof(uint32_t);
+    clip.Data.assign(file.begin() + at, file.end());
+    for (uint32_t b = 0; b < blocks; ++b)
+        if (clip.BlockOffsets[b] > clip.Data.size() || (b > 0 && clip.BlockOffsets[b] < clip.BlockOffsets[b - 1]))
+            return false;
+    // NumFrames is what decoding allocates: the blocks must be able to hold it
+    for (uint32_t b = 0; b < blocks; ++b)
+        if (clip.BlockBytes((int)b) < MotionBlockMinBytes(std::min(fields[2], fields[1] - b * fields[2])))
+            return false;
+    return true;
+}
+
+// Either kind of recording, told apart by the magic
+inline bool LoadRecording(const std::string& sFile, KinectClip& clip)
+{
+    char magic[4] = { 0 };
+    if (FILE* f = fopen(sFile.c_str(), "rb"))
+    {
+        size_t n = fread(magic, 1, 4, f);
+        fclose(f);
+        if (n == 4 && memcmp(magic, MotionCodecMagic, 4) == 0)
+        {
+            EncodedMotionClip encoded;
+            return LoadEncodedMotionFile(sFile, encoded) && DecodeMotionClip(encoded, clip);
+        }
+    }
+    return LoadMotionFile(sFile, clip);
+}
+
+//---------------------------------------------------------------------------
+// Live stream: one self-describing packet per frame
+//
+//   u16 sequence, u16 key sequence, u8 flags (bit 0: key frame), f64 time, coded skeleton
+//
+// Unlike archive blocks, stream frames are not predicted from the frames
+// before them but only from the last key frame, whose sequence number every
+// packet carries. A delta packet is each channel's difference to that key,
+// Rice coded with a fixed parameter per channel that the key packet sends
+// along (4 bits each, picked by the encoder from the differences of the
+// interval before). So the decoder only needs the last key:
+//   lost delta packet   that frame is missing, the next one decodes
+//   lost key packet     the frames up to the next key are skipped
+//   late packet         dropped, frames are never delivered out of order
+// Deltas against a key up to a second old cost more than frame-to-frame
+// prediction would: ~90 bytes per packet on the test recording instead of
+// ~50, under 3 KB/s at 30 Hz.
+
+#define MOTION_PACKET_HEADER    13
+#define MOTION_STREAM_K_BITS    4
+
+struct MotionStreamKey
+{
+    int32_t Values[MOTION_CODEC_CHANNELS];  // quantized, as QuantizeSkeleton
+    uint8_t K[MOTION_CODEC_CHANNELS];       // Rice parameter of the deltas against it
+};
+
+struct MotionStreamEncoder
+{
+    int             KeyInterval;        // frames; a lost key costs up to this many
+    uint16_t        Sequence, KeySequence;
+    int             FramesSinceKey;     // -1 before the first key frame
+    MotionStreamKey Key;
+    uint32_t        Sum[MOTION_CODEC_CHANNELS];    // |delta| since the key, for the next key's parameters
+    uint32_t        Count;
+
+    MotionStreamEncoder() : KeyInterval(30) { Reset(); }
+
+    void Reset()
+    {
+        Sequence = 0;
+        KeySequence = 0;
+        FramesSinceKey = -1;
+        memset(Sum, 0, sizeof(Sum));
+        Count = 0;
+    }
+
+    void Encode(const SkeletonFrame& frame, std::vector<uint8_t>& packet)
+    {
+        bool key = FramesSinceKey < 0 || FramesSinceKey + 1 >= KeyInterval;
+        int32_t q[MOTION_CODEC_CHANNELS];
+        QuantizeSkeleton(frame, q);
+        if (key)
+        {
+            // ~8 mm until there is an interval to go by
+            for (int ch = 0; ch < MOTION_CODEC_CHANNELS; ++ch)
+                Key.K[ch] = (uint8_t)std::min(Count ? MotionRiceParameter(Sum[ch], Count) : 3, (1 << MOTION_STREAM_K_BITS) - 1);
+            memcpy(Key.Values, q, sizeof(q));
+            memset(Sum, 0, sizeof(Sum));
+            Count = 0;
+            KeySequence = Sequence;
+            FramesSinceKey = 0;
+        }
+        else
+            ++FramesSinceKey;
+
+        packet.resize(MOTION_PACKET_HEADER);
+        memcpy(&packet[0], &Sequence, 2);
+        memcpy(&packet[2], &KeySequence, 2);
+        packet[4] = key ? 1 : 0;
+        memcpy(&packet[5], &frame.Time, 8);
+        MotionBitWriter writer(packet);
+        for (int c = 0; c < 3; ++c)
+            for (int j = 0; j < KinectJoint_Count; ++j)
+            {
+                int ch = c * KINECT_JOINT_STRIDE + j;
+                if (key)
+                {
+                    writer.Put((uint16_t)q[ch], 16);
+                    writer.Put(Key.K[ch], MOTION_STREAM_K_BITS);
+                    continue;
+                }
+                uint32_t u = MotionZigzag(q[ch] - Key.Values[ch]);
+                PutMotionRice(writer, u, Key.K[ch]);
+                Sum[ch] += u >> 1;
+            }
+        writer.Flush();
+        if (!key && ++Count >= 4096)
+        {
+            // long intervals: keep the sums in range, the mean is what counts
+            for (int ch = 0; ch < MOTION_CODEC_CHANNELS; ++ch)
+                Sum[ch] >>= 1;
+            Count >>= 1;
+        }
+        ++Sequence;
+    }
+};
+
+struct MotionStreamDecoder
+{
+    uint16_t        Expected;
+    bool            Started;
+    bool            HasKey;
+    uint16_t        KeySequence;
+    MotionStreamKey Key;
+    int             Lost;               // packets missing from the sequence
+    int             Skipped;            // late, or delta packets of a key that was lost
+
+    MotionStreamDecoder() : Expected(0), Started(false), HasKey(false), KeySequence(0), Lost(0), Skipped(0) {}
+
+    // False when the packet cannot be decoded: malformed, late, or a delta
+    // packet whose key never arrived
+    bool Decode(const uint8_t* packet, size_t size, SkeletonFrame& out)
+    {
+        if (size < MOTION_PACKET_HEADER)
+            return false;
+        uint16_t sequence, keySequence;
+        memcpy(&sequence, packet, 2);
+        memcpy(&keySequence, packet + 2, 2);
+        bool key = (packet[4] & 1) != 0;
+        if (Started)
+        {
+            int16_t ahead = (int16_t)(uint16_t)(sequence - Expected);
+            if (ahead < 0)
+            {
+                ++Skipped;
+                return false;
+            }
+            Lost += ahead;
+        }
+        Started = true;
+        Expected = (uint16_t)(sequence + 1);
+        if (!key && (!HasKey || keySequence != KeySequence))
+        {
+            ++Skipped;
+            return false;
+        }
+
+        MotionBitReader reader(packet + MOTION_PACKET_HEADER, size - MOTION_PACKET_HEADER);
+        int32_t q[MOTION_CODEC_CHANNELS];
+        memset(q, 0, sizeof(q));
+        for (int c = 0; c < 3; ++c)
+            for (int j = 0; j < KinectJoint_Count; ++j)
+            {
+                int ch = c * KINECT_JOINT_STRIDE + j;
+                if (key)
+                {
+                    q[ch] = (int16_t)reader.Get(16);
+                    Key.K[ch] = (uint8_t)reader.Get(MOTION_STREAM_K_BITS);
+                }
+                else
+                    q[ch] = Key.Values[ch] + MotionUnzigzag(GetMotionRice(reader, Key.K[ch]));
+            }
+        if (key)
+        {
+            memcpy(Key.Values, q, sizeof(q));
+            KeySequence = sequence;
+            HasKey = !reader.Overrun;
+        }
+        if (reader.Overrun)
+            return false;
+        MotionSkeletonToMetres(q, out);
+        memcpy(&out.Time, packet + 5, 8);
+        return true;
+    }
+};
+
+#endif // MOTION_CODEC_H
@@ -0,0 +1,232 @@
+// Converts text recordings to the compact *.kmc archive format.
+//
+//   MotionCodecTool [-block frames] [-stream key-interval] [-scrub seconds [-budget KB]] <directory | file>...
+//
+// Every *.txt (see CollectRecordings) is written next to itself as *.kmc,
+// replacing an earlier conversion, with a key frame every -block frames (32
+// by default), read back and compared against the text: sizes, worst
+// coordinate error, decode time. The same frames are also run through the
+// live stream coder to report the packet size. *.kmc inputs without a text
+// source are only checked.
+//
+// -scrub plays each archive through MotionPlayback for that many seconds
+// of a 90 Hz UI that scrubs like a therapist on the timeline: speed changes
+// between -4x and 4x, now and then a jump to anywhere. It reports the cache
+// hit rate and the lookup times next to decoding every frame uncached;
+// -budget sets the cache size.
+//
+// Build standalone, no OVR / GL needed:
+//   cl /O2 /EHsc MotionCodecTool.cpp
+//   g++ -std=c++14 -O2 MotionCodecTool.cpp
+
+#include "../Common/RecordingArchive.h"
+#include "../Common/MotionCodec.h"
+#include "../Common/MotionPlayback.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static long FileBytes(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+static float MaxCoordinateError(const KinectClip& a, const KinectClip& b)
+{
+    float worst = a.NumFrames == b.NumFrames ? 0.0f : INFINITY;
+    for (int j = 0; j < KinectJoint_Count && worst < INFINITY; ++j)
+        for (int f = 0; f < a.NumFrames; ++f)
+        {
+            Float3 d = a.Get(j, f) - b.Get(j, f);
+            worst = std::max(worst, std::max(fabsf(d.x), std::max(fabsf(d.y), fabsf(d.z))));
+        }
+    return worst;
+}
+
+static double Percentile(std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    size_t i = std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+static void Scrub(const EncodedMotionClip& clip, double seconds, const MotionPlaybackSettings& settings)
+{
+    typedef std::chrono::steady_clock Steady;
+    static const float speeds[] = { -4.0f, -2.0f, -1.0f, -0.5f, 0.5f, 1.0f, 2.0f, 4.0f };
+    MotionPlayback playback;
+    if (!playback.Open(clip, settings))
+        return;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<double> cachedUs, uncachedUs;
+    const double tick = 1.0 / 90.0;
+    double duration = playback.Duration(), position = 0.0, speed = 1.0;
+    SkeletonFrame frame;
+    Steady::time_point start = Steady::now();
+    for (long long n = 0; n * tick < seconds; ++n)
+    {
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<Steady::duration>(std::chrono::duration<double>(n * tick)));
+        double r = uniform(rng);
+        if (r < 0.005)
+            position = uniform(rng) * duration;
+        else if (r < 0.03)
+            speed = speeds[(int)(uniform(rng) * 8) & 7];
+        position += speed * tick;
+        if (position < 0.0 || position >= duration)
+        {
+            position = std::max(0.0, std::min(position, duration - 1e-3));
+            speed = -speed;
+        }
+
+        // both timed warm: the sleep above leaves the caches cold for whichever goes first
+        int f = (int)(position * clip.SampleRate);
+        DecodeMotionFrame(clip, f, frame);
+        Steady::time_point t0 = Steady::now();
+        playback.Sample(position, frame);
+        Steady::time_point t1 = Steady::now();
+        DecodeMotionFrame(clip, f, frame);
+        if (f + 1 < clip.NumFrames)
+            DecodeMotionFrame(clip, f + 1, frame);
+        Steady::time_point t2 = Steady::now();
+        cachedUs.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        uncachedUs.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+    }
+    MotionPlaybackStats stats = playback.Stats();
+    printf("  scrub: %d of %d blocks in %.0f KB, hit rate %.1f%% (%llu lookups, %llu misses), %llu blocks prefetched, %llu evicted\n",
+           stats.Slots, clip.NumBlocks(), stats.MemoryBytes / 1024.0, stats.HitRate() * 100.0, (unsigned long long)stats.Requests,
+           (unsigned long long)stats.Misses, (unsigned long long)stats.Prefetched, (unsigned long long)stats.Evicted);
+    printf("  sample: cached p50 %.2f us  p99 %.2f us  max %.1f us | uncached p50 %.2f us  p99 %.2f us\n",
+           Percentile(cachedUs, 0.5), Percentile(cachedUs, 0.99), Percentile(cachedUs, 1.0),
+           Percentile(uncachedUs, 0.5), Percentile(uncachedUs, 0.99));
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr, "usage: MotionCodecTool [-block frames] [-stream key-interval] [-scrub seconds [-budget KB]] <directory | file>...\n");
+}
+
+int main(int argc, char** argv)
+{
+    int blockFrames = 32, keyInterval = 30;
+    double scrubSeconds = 0.0;
+    MotionPlaybackSettings playback;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-block" && i + 1 < argc)
+            blockFrames = atoi(argv[++i]);
+        else if (arg == "-stream" && i + 1 < argc)
+            keyInterval = atoi(argv[++i]);
+        else if (arg == "-scrub" && i + 1 < argc)
+            scrubSeconds = atof(argv[++i]);
+        else if (arg == "-budget" && i + 1 < argc)
+            playback.MemoryBytes = (size_t)(atof(argv[++i]) * 1024.0);
+        else if (arg[0] == '-')
+        {
+            PrintUsage();
+            return 2;
+        }
+        else
+            CollectRecordings(arg, files, ".txt");
+    }
+    if (files.empty() || blockFrames < 1 || keyInterval < 1)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    long long textBytes = 0, codedBytes = 0, packetBytes = 0, frames = 0;
+    double decodeUs = 0.0;
+    float worst = 0.0f;
+    int failed = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const std::string& path = files[i];
+        bool isText = !HasExtension(path, ".kmc");
+        KinectClip clip, decoded;
+        EncodedMotionClip encoded;
+        std::string out = isText ? path.substr(0, path.size() - (HasExtension(path, ".txt") ? 4 : 0)) + ".kmc" : path;
+        if (isText)
+        {
+            if (!LoadMotionFile(path, clip))
+            {
+                fprintf(stderr, "cannot read %s\n", path.c_str());
+                ++failed;
+                continue;
+            }
+            EncodeMotionClip(clip, blockFrames, encoded);
+            if (!SaveEncodedMotionFile(out, encoded))
+            {
+                fprintf(stderr, "cannot write %s\n", out.c_str());
+                ++failed;
+                continue;
+            }
+        }
+
+        EncodedMotionClip loaded;
+        bool ok = LoadEncodedMotionFile(out, loaded);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        ok = ok && DecodeMotionClip(loaded, decoded);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+        if (!ok)
+        {
+            fprintf(stderr, "cannot decode %s\n", out.c_str());
+            ++failed;
+            continue;
+        }
+        if (!isText)
+            clip = decoded;
+        float error = MaxCoordinateError(clip, decoded);
+
+        MotionStreamEncoder stream;
+        stream.KeyInterval = keyInterval;
+        std::vector<uint8_t> packet;
+        SkeletonFrame frame;
+        long long packets = 0;
+        for (int f = 0; f < clip.NumFrames; ++f)
+        {
+            clip.GetFrame(f, frame);
+            stream.Encode(frame, packet);
+            packets += (long long)packet.size();
+        }
+
+        long text = isText ? FileBytes(path) : 0, coded = FileBytes(out);
+        if (isText)
+            printf("%-40s %6d frames  %8ld -> %7ld bytes (%5.1fx)  max error %.2f mm  decode %.0f us  %.1f bytes/packet\n",
+                   path.c_str(), clip.NumFrames, text, coded, coded > 0 ? (double)text / coded : 0.0, error * 1000.0f, us,
+                   clip.NumFrames ? (double)packets / clip.NumFrames : 0.0);
+        else
+            printf("%-40s %6d frames  %7ld bytes  decode %.0f us  %.1f bytes/packet\n",
+                   path.c_str(), clip.NumFrames, coded, us, clip.NumFrames ? (double)packets / clip.NumFrames : 0.0);
+        textBytes += text;
+        codedBytes += isText ? coded : 0;
+        packetBytes += packets;
+        frames += clip.NumFrames;
+        decodeUs += us;
+        worst = std::max(worst, error);
+        if (scrubSeconds > 0.0)
+            Scrub(loaded, scrubSeconds, playback);
+    }
+    if (frames > 0)
+        printf("total: %lld frames, text %lld -> %lld bytes (%.1fx), max error %.2f mm, decode %.2f us/frame, stream %.1f bytes/frame\n",
+               frames, textBytes, codedBytes, codedBytes ? (double)textBytes / codedBytes : 0.0, worst * 1000.0f,
+               decodeUs / frames, (double)packetBytes / frames);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,284 @@
+#ifndef MOTION_FILE_H
+#define MOTION_FILE_H
+
+// Reader for the exercise recordings (motionBothArms_Lars.txt):
+//
+//   [Parameters]
+//   training: 2 HipFlexionRight
+//   ...
+//   [Motion]
+//   x0 y0 z0 x1 y1 z1 ... x24 y24 z24     <- one row per 30 Hz frame
+//
+// Recordings of several people carry the further bodies on the same row,
+// 75 values each (LoadMotionBodies); LoadMotionFile reads the first.
+//
+// Frames are stored joint-major and padded so that whole-clip kernels can
+// load four (SSE) or eight (AVX2) consecutive frames of one joint with a
+// single load.
+
+#include "../Common/KinectSkeleton.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct MotionParameter
+{
+    std::string Name;
+    std::string Value;
+};
+
+// Padded frame count of every joint-major per-frame table (clips, rotation
+// tracks): a multiple of 8 so the widest kernel never reads past a joint row.
+// Tables derived from a clip must use this too so one Index() fits both.
+inline int MotionFrameStride(int numFrames) { return (numFrames + 7) & ~7; }
+
+struct KinectClip
+{
+    std::vector<MotionParameter> Parameters;
+    float                        SampleRate;
+    int                          NumFrames;
+    int                          FrameStride;   // MotionFrameStride(NumFrames)
+    std::vector<float>           X, Y, Z;       // [joint * FrameStride + frame]
+
+    KinectClip() : SampleRate(30.0f), NumFrames(0), FrameStride(0) {}
+
+    void Allocate(int numFrames)
+    {
+        NumFrames = numFrames;
+        FrameStride = MotionFrameStride(numFrames);
+        X.assign((size_t)KinectJoint_Count * FrameStride, 0.0f);
+        Y.assign((size_t)KinectJoint_Count * FrameStride, 0.0f);
+        Z.assign((size_t)KinectJoint_Count * FrameStride, 0.0f);
+    }
+
+    float Duration() const { return NumFrames > 1 ? (NumFrames - 1) / SampleRate : 0.0f; }
+
+    size_t Index(int joint, int frame) const { return (size_t)joint * FrameStride + frame; }
+
+    Float3 Get(int joint, int frame) const
+    {
+        size_t i = Index(joint, frame);
+        return MakeFloat3(X[i], Y[i], Z[i]);
+    }
+
+    void Set(int joint, int frame, const Float3& p)
+    {
+        size_t i = Index(joint, frame);
+        X[i] = p.x; Y[i] = p.y; Z[i] = p.z;
+    }
+
+    void GetFrame(int frame, SkeletonFrame& out) const
+    {
+        out.Clear();
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            size_t i = Index(j, frame);
+            out.X[j] = X[i]; out.Y[j] = Y[i]; out.Z[j] = Z[i];
+        }
+        out.Time = frame / SampleRate;
+    }
+
+    void SetFrame(int frame, const SkeletonFrame& in)
+    {
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            size_t i = Index(j, frame);
+            X[i] = in.X[j]; Y[i] = in.Y[j]; Z[i] = in.Z[j];
+        }
+    }
+
+    const char* FindParameter(const char* name) const
+    {
+        for (size_t i = 0; i < Parameters.size(); ++i)
+            if (Parameters[i].Name == name)
+                return Parameters[i].Value.c_str();
+        return nullptr;
+    }
+};
+
+//---------------------------------------------------------------------------
+// Plain decimal ("-0.115309", "2.5e-3") without going through strtof, which
+// dominates loading time. Anything else (inf, nan, hex) falls back to it.
+inline float ParseMotionFloat(const char* p, char** end)
+{
+    static const double Pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+    const char* s = p;
+    while (*s == ' ' || *s == '\t')
+        ++s;
+    bool negative = *s == '-';
+    if (*s == '-' || *s == '+')
+        ++s;
+    unsigned long long mantissa = 0;
+    int digits = 0, scale = 0;
+    for (; *s >= '0' && *s <= '9'; ++s, ++digits)
+        mantissa = mantissa * 10 + (*s - '0');
+    if (*s == '.')
+        for (++s; *s >= '0' && *s <= '9'; ++s, ++digits, --scale)
+            mantissa = mantissa * 10 + (*s - '0');
+    if (digits == 0 || digits > 18)
+        return strtof(p, end);
+    if (*s == 'e' || *s == 'E')
+    {
+        const char* e = s + 1;
+        bool negativeExp = *e == '-';
+        if (*e == '-' || *e == '+')
+            ++e;
+        if (*e < '0' || *e > '9')
+            return strtof(p, end);
+        int exponent = 0;
+        for (; *e >= '0' && *e <= '9'; ++e)
+            exponent = exponent * 10 + (*e - '0');
+        scale += negativeExp ? -exponent : exponent;
+        s = e;
+    }
+    if (scale < -18 || scale > 18)
+        return strtof(p, end);
+    *end = (char*)s;
+    double v = scale < 0 ? (double)mantissa / Pow10[-scale] : (double)mantissa * Pow10[scale];
+    return (float)(negative ? -v : v);
+}
+
+// Parses one body (75 floats) of a motion row into a frame; false on a
+// short row. 'rest', when given, receives where the next body starts.
+inline bool ParseMotionRow(const char* line, SkeletonFrame& frame, const char** rest = nullptr)
+{
+    frame.Clear();
+    const char* p = line;
+    for (int j = 0; j < KinectJoint_Count; ++j)
+    {
+        float* dst[3] = { &frame.X[j], &frame.Y[j], &frame.Z[j] };
+        for (int c = 0; c < 3; ++c)
+        {
+            char* end;
+            *dst[c] = ParseMotionFloat(p, &end);
+            if (end == p)
+                return false;
+            p = end;
+        }
+    }
+    if (rest)
+        *rest = p;
+    return true;
+}
+
+// "name: value" of the [Parameters] section
+inline void ParseMotionParameter(const char* line, std::vector<MotionParameter>& parameters)
+{
+    const char* colon = strchr(line, ':');
+    if (!colon)
+        return;
+    MotionParameter param;
+    param.Name.assign(line, colon - line);
+    const char* v = colon + 1;
+    while (*v == ' ') ++v;
+    param.Value = v;
+    while (!param.Value.empty() && (param.Value.back() == '\n' || param.Value.back() == '\r' || param.Value.back() == ' '))
+        param.Value.pop_back();
+    parameters.push_back(param);
+}
+
+inline bool LoadMotionFile(const std::string& sFile, KinectClip& clip)
+{
+    FILE* f = fopen(sFile.c_str(), "rb");
+    if (!f)
+        return false;
+
+    std::vector<SkeletonFrame> frames;
+    std::vector<MotionParameter> parameters;
+    bool inMotion = false;
+    char line[4096];
+    while (fgets(line, sizeof(line), f))
+    {
+        if (line[0] == '[')
+        {
+            inMotion = strncmp(line, "[Motion]", 8) == 0;
+            continue;
+        }
+        if (inMotion)
+        {
+            SkeletonFrame frame;
+            if (ParseMotionRow(line, frame))
+                frames.push_back(frame);
+            continue;
+        }
+        ParseMotionParameter(line, parameters);
+    }
+    fclose(f);
+
+    clip.Parameters = parameters;
+    clip.Allocate((int)frames.size());
+    for (int i = 0; i < clip.NumFrames; ++i)
+        clip.SetFrame(i, frames[i]);
+    return clip.NumFrames > 0;
+}
+
+// Every body of a recording, one clip each (same parameters and frame
+// count); the number of bodies is that of the widest row, up to maxBodies.
+// A frame without a body holds the body's previous pose, or before its first
+// row the first pose, so a person who walks in later does not start at the
+// sensor origin.
+inline bool LoadMotionBodies(const std::string& sFile, std::vector<KinectClip>& bodies, int maxBodies)
+{
+    FILE* f = fopen(sFile.c_str(), "rb");
+    if (!f)
+        return false;
+
+    std::vector<std::vector<SkeletonFrame> > frames(maxBodies);
+    std::vector<int> present;                  // bodies per row
+    std::vector<MotionParameter> parameters;
+    bool inMotion = false;
+    int numBodies = 0;
+    std::vector<char> buffer(16384);           // six bodies of 75 values
+    char* line = buffer.data();
+    while (fgets(line, (int)buffer.size(), f))
+    {
+        if (line[0] == '[')
+        {
+            inMotion = strncmp(line, "[Motion]", 8) == 0;
+            continue;
+        }
+        if (!inMotion)
+        {
+            ParseMotionParameter(line, parameters);
+            continue;
+        }
+        const char* p = line;
+        SkeletonFrame frame;
+        int n = 0;
+        while (n < maxBodies && ParseMotionRow(p, frame, &p))
+        {
+            if ((int)frames[n].size() < (int)present.size())
+                frames[n].resize(present.size(), frames[n].empty() ? frame : frames[n].back());
+            frames[n].push_back(frame);
+            ++n;
+        }
+        if (n == 0)
+            continue;
+        present.push_back(n);
+        numBodies = std::max(numBodies, n);
+    }
+    fclose(f);
+
+    bodies.resize(numBodies);
+    for (int b = 0; b < numBodies; ++b)
+    {
+        KinectClip& clip = bodies[b];
+        clip.Parameters = parameters;
+        clip.Allocate((int)present.size());
+        SkeletonFrame last;
+        last.Clear();
+        for (int i = 0; i < clip.NumFrames; ++i)
+        {
+            if (i < (int)frames[b].size())
+                last = frames[b][i];
+            clip.SetFrame(i, last);
+        }
+    }
+    return numBodies > 0;
+}
+
+#endif // MOTION_FILE_H
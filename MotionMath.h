@@ -0,0 +1,128 @@
+#ifndef MOTION_MATH_H
+#define MOTION_MATH_H
+
+// Small POD vector/quaternion helpers shared by the animation and skeleton
+// processing code. These stay free of OVR/glm so that the offline tools can
+// use the same code without a GL context.
+
+#include <math.h>
+
+struct Float3
+{
+    float x, y, z;
+};
+
+struct Quat4
+{
+    float x, y, z, w;
+};
+
+inline Float3 MakeFloat3(float x, float y, float z) { Float3 r = { x, y, z }; return r; }
+inline Quat4  MakeQuat4(float x, float y, float z, float w) { Quat4 r = { x, y, z, w }; return r; }
+inline Quat4  QuatIdentity() { return MakeQuat4(0.0f, 0.0f, 0.0f, 1.0f); }
+
+inline Float3 operator+(const Float3& a, const Float3& b) { return MakeFloat3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Float3 operator-(const Float3& a, const Float3& b) { return MakeFloat3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Float3 operator*(const Float3& a, float s) { return MakeFloat3(a.x * s, a.y * s, a.z * s); }
+
+inline float  Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float  Length(const Float3& a) { return sqrtf(Dot(a, a)); }
+inline Float3 Cross(const Float3& a, const Float3& b)
+{
+    return MakeFloat3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+inline Float3 Normalize(const Float3& a)
+{
+    float len = Length(a);
+    return len > 1e-8f ? a * (1.0f / len) : MakeFloat3(0.0f, 0.0f, 0.0f);
+}
+inline Float3 Lerp(const Float3& a, const Float3& b, float t) { return a + (b - a) * t; }
+
+inline float QuatDot(const Quat4& a, const Quat4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+inline Quat4 QuatConjugate(const Quat4& q) { return MakeQuat4(-q.x, -q.y, -q.z, q.w); }
+
+inline Quat4 QuatNormalize(const Quat4& q)
+{
+    float len = sqrtf(QuatDot(q, q));
+    if (len < 1e-8f)
+        return QuatIdentity();
+    float inv = 1.0f / len;
+    return MakeQuat4(q.x * inv, q.y * inv, q.z * inv, q.w * inv);
+}
+
+// a * b applies b first, then a
+inline Quat4 QuatMul(const Quat4& a, const Quat4& b)
+{
+    return MakeQuat4(a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+                     a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+                     a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+                     a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z);
+}
+
+inline Float3 QuatRotate(const Quat4& q, const Float3& v)
+{
+    // v' = v + 2w(u x v) + 2u x (u x v)
+    Float3 u = MakeFloat3(q.x, q.y, q.z);
+    Float3 t = Cross(u, v) * 2.0f;
+    return v + t * q.w + Cross(u, t);
+}
+
+inline Quat4 QuatFromAxisAngle(const Float3& axis, float angle)
+{
+    Float3 n = Normalize(axis);
+    float s = sinf(angle * 0.5f);
+    return MakeQuat4(n.x * s, n.y * s, n.z * s, cosf(angle * 0.5f));
+}
+
+// Shortest rotation taking direction a onto direction b (both unit length)
+inline Quat4 QuatFromTo(const Float3& a, const Float3& b)
+{
+    float d = Dot(a, b);
+    if (d < -0.999999f)
+    {
+        // opposite directions: rotate 180 degrees about any axis orthogonal to a
+        Float3 axis = Cross(MakeFloat3(1.0f, 0.0f, 0.0f), a);
+        if (Dot(axis, axis) < 1e-6f)
+            axis = Cross(MakeFloat3(0.0f, 1.0f, 0.0f), a);
+        axis = Normalize(axis);
+        return MakeQuat4(axis.x, axis.y, axis.z, 0.0f);
+    }
+    Float3 c = Cross(a, b);
+    return QuatNormalize(MakeQuat4(c.x, c.y, c.z, 1.0f + d));
+}
+
+// Normalized lerp along the shortest arc; accurate enough between dense keys
+inline Quat4 QuatNlerp(const Quat4& a, const Quat4& b, float t)
+{
+    float sign = QuatDot(a, b) < 0.0f ? -1.0f : 1.0f;
+    float s = 1.0f - t;
+    float u = t * sign;
+    return QuatNormalize(MakeQuat4(a.x * s + b.x * u, a.y * s + b.y * u, a.z * s + b.z * u, a.w * s + b.w * u));
+}
+
+inline Quat4 QuatSlerp(const Quat4& a, const Quat4& b, float t)
+{
+    Quat4 e = b;
+    float d = QuatDot(a, b);
+    if (d < 0.0f)
+    {
+        d = -d;
+        e = MakeQuat4(-b.x, -b.y, -b.z, -b.w);
+    }
+    if (d > 0.9995f)
+        return QuatNlerp(a, e, t);
+    float theta = acosf(d);
+    float inv = 1.0f / sinf(theta);
+    float s = sinf((1.0f - t) * theta) * inv;
+    float u = sinf(t * theta) * inv;
+    return MakeQuat4(a.x * s + e.x * u, a.y * s + e.y * u, a.z * s + e.z * u, a.w * s + e.w * u);
+}
+
+// Angle of the rotation between two orientations, in radians
+inline float QuatAngleBetween(const Quat4& a, const Quat4& b)
+{
+    float d = fabsf(QuatDot(a, b));
+    return d >= 1.0f ? 0.0f : 2.0f * acosf(d);
+}
+
+#endif // MOTION_MATH_H
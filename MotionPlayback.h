@@ -0,0 +1,320 @@
+#ifndef MOTION_PLAYBACK_H
+#define MOTION_PLAYBACK_H
+
+// Playback of an archived session (*.kmc, MotionCodec.h) for a timeline
+// that is scrubbed back and forth.
+//
+// The clip stays encoded; decoded blocks (BlockFrames SkeletonFrames each)
+// live in a fixed set of cache slots sized from a memory budget. A lookup
+// finds its block through a block -> slot table and copies the frame out
+// under a mutex that the prefetch thread only holds for bookkeeping, so a
+// cached frame costs a lock and a 344 byte copy. A frame whose block is not
+// decoded yet is decoded on the caller's thread, alone (at most one block
+// of frames), and counted as a miss.
+//
+// Every lookup moves the playhead. When it enters another block the
+// prefetch thread wakes and decodes the window around it: the playhead's
+// block, then alternately AheadBlocks in the direction the playhead last
+// moved and BehindBlocks against it, nearest first. Slots are reused least
+// recently used first, never while their block is inside the window.
+
+#include "../Common/MotionCodec.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <math.h>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+struct MotionPlaybackSettings
+{
+    size_t MemoryBytes;         // budget for decoded frames
+    int    AheadBlocks;         // prefetched in the direction of play
+    int    BehindBlocks;        // and against it
+
+    MotionPlaybackSettings() : MemoryBytes(4 << 20), AheadBlocks(6), BehindBlocks(3) {}
+};
+
+struct MotionPlaybackStats
+{
+    uint64_t Requests;          // frame lookups
+    uint64_t Hits;              // served from a decoded block
+    uint64_t Misses;            // decoded on the caller's thread
+    uint64_t Prefetched;        // blocks decoded by the prefetch thread
+    uint64_t Evicted;
+    int      CachedBlocks;
+    int      Slots;
+    size_t   MemoryBytes;       // of the slots
+
+    double HitRate() const { return Requests ? (double)Hits / Requests : 0.0; }
+};
+
+class MotionPlayback
+{
+public:
+    MotionPlayback() : Clip(nullptr), Playhead(0), Direction(1), Moved(false), Quit(false), Tick(0) { ResetStats(); }
+    ~MotionPlayback() { Close(); }
+
+    // 'clip' must outlive the playback (or the next Close)
+    bool Open(const EncodedMotionClip& clip, const MotionPlaybackSettings& settings = MotionPlaybackSettings())
+    {
+        Close();
+        if (clip.NumFrames < 1 || clip.NumBlocks() < 1 || clip.BlockFrames < 1)
+            return false;
+        Clip = &clip;
+        Settings = settings;
+        size_t blockBytes = clip.BlockFrames * sizeof(SkeletonFrame);
+        size_t slots = std::min((size_t)clip.NumBlocks(), std::max((size_t)2, settings.MemoryBytes / blockBytes));
+        Slots.resize(slots);
+        for (size_t s = 0; s < slots; ++s)
+        {
+            Slots[s].Frames.resize(clip.BlockFrames);
+            Slots[s].Block = -1;
+            Slots[s].Ready = false;
+            Slots[s].LastUse = 0;
+        }
+        SlotOf.assign(clip.NumBlocks(), -1);
+        // the window always fits, with one slot left for LRU reuse
+        Ahead = std::max(0, std::min(settings.AheadBlocks, (int)slots - 2));
+        Behind = std::max(0, std::min(settings.BehindBlocks, (int)slots - 2 - Ahead));
+        Playhead = 0;
+        Direction = 1;
+        Moved = true;
+        Quit = false;
+        Tick = 0;
+        ResetStats();
+        Thread = std::thread(&MotionPlayback::Main, this);
+        return true;
+    }
+
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Quit = true;
+        }
+        Wake.notify_one();
+        if (Thread.joinable())
+            Thread.join();
+        Clip = nullptr;
+        Slots.clear();
+        SlotOf.clear();
+    }
+
+    bool IsOpen() const { return Clip != nullptr; }
+    int NumFrames() const { return Clip ? Clip->NumFrames : 0; }
+    float Duration() const { return Clip ? Clip->NumFrames / Clip->SampleRate : 0.0f; }
+
+    // UI thread: frame 'index' (clamped), with its time in the clip; moves
+    // the playhead there
+    bool GetFrame(int index, SkeletonFrame& out)
+    {
+        return Clip && Lookup(std::max(0, std::min(index, Clip->NumFrames - 1)), true, out);
+    }
+
+    // UI thread: the body at 'seconds' into the clip, between the two
+    // nearest frames
+    bool Sample(double seconds, SkeletonFrame& out)
+    {
+        if (!Clip)
+            return false;
+        double position = std::max(0.0, seconds * Clip->SampleRate);
+        int f = (int)position;
+        float t = (float)(position - f);
+        f = std::min(f, Clip->NumFrames - 1);
+        if (f == Clip->NumFrames - 1 || t <= 0.0f)
+        {
+            bool ok = Lookup(f, true, out);
+            out.Time = seconds;
+            return ok;
+        }
+        // the playhead stays on f, or every sample would flip the direction
+        SkeletonFrame next;
+        if (!Lookup(f, true, out) || !Lookup(f + 1, false, next))
+            return false;
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            out.X[j] += (next.X[j] - out.X[j]) * t;
+            out.Y[j] += (next.Y[j] - out.Y[j]) * t;
+            out.Z[j] += (next.Z[j] - out.Z[j]) * t;
+        }
+        out.Time = seconds;
+        return true;
+    }
+
+    // Any thread; a snapshot
+    MotionPlaybackStats Stats() const
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        MotionPlaybackStats stats;
+        stats.Requests = Requests;
+        stats.Hits = Hits;
+        stats.Misses = Misses;
+        stats.Prefetched = Prefetched;
+        stats.Evicted = Evicted;
+        stats.CachedBlocks = 0;
+        for (size_t s = 0; s < Slots.size(); ++s)
+            stats.CachedBlocks += Slots[s].Ready ? 1 : 0;
+        stats.Slots = (int)Slots.size();
+        stats.MemoryBytes = Slots.size() * (Clip ? Clip->BlockFrames : 0) * sizeof(SkeletonFrame);
+        return stats;
+    }
+
+    void ResetStats()
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Requests = Hits = Misses = Prefetched = Evicted = 0;
+    }
+
+private:
+    struct CacheSlot
+    {
+        std::vector<SkeletonFrame> Frames;
+        int                        Block;       // -1 when empty
+        bool                       Ready;       // false while the prefetch thread decodes into it
+        uint64_t                   LastUse;
+    };
+
+    bool Lookup(int index, bool movePlayhead, SkeletonFrame& out)
+    {
+        int block = index / Clip->BlockFrames;
+        bool wake, hit;
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            wake = movePlayhead && MovePlayhead(index);
+            ++Requests;
+            int s = SlotOf[block];
+            hit = s >= 0 && Slots[s].Ready;
+            if (hit)
+            {
+                Slots[s].LastUse = ++Tick;
+                out = Slots[s].Frames[index - block * Clip->BlockFrames];
+                ++Hits;
+            }
+            else
+                ++Misses;
+        }
+        if (wake)
+            Wake.notify_one();
+        // not decoded yet, or being decoded right now
+        return hit || DecodeMotionFrame(*Clip, index, out);
+    }
+
+    // Under Mutex; true when the prefetch window changed
+    bool MovePlayhead(int index)
+    {
+        int direction = index == Playhead ? Direction : index > Playhead ? 1 : -1;
+        bool moved = index / Clip->BlockFrames != Playhead / Clip->BlockFrames || direction != Direction;
+        Direction = direction;
+        Playhead = index;
+        Moved = Moved || moved;
+        return moved;
+    }
+
+    // Under Mutex: the k-th block of the window in priority order (playhead,
+    // 1 ahead, 1 behind, 2 ahead, ...); false past its end. 'block' is -1
+    // where that side is shorter or the clip ends.
+    bool WindowBlock(int k, int& block) const
+    {
+        if (k > 2 * std::max(Ahead, Behind))
+            return false;
+        int step = (k + 1) / 2;
+        bool ahead = (k & 1) != 0;
+        block = Playhead / Clip->BlockFrames + (ahead ? step : -step) * Direction;
+        if ((ahead ? step > Ahead : step > Behind) || block < 0 || block >= Clip->NumBlocks())
+            block = -1;
+        return true;
+    }
+
+    bool InWindow(int block) const
+    {
+        int offset = (block - Playhead / Clip->BlockFrames) * Direction;
+        return offset >= -Behind && offset <= Ahead;
+    }
+
+    // Under Mutex: the first block of the window that is not cached, -1 when all are
+    int NextBlockToLoad() const
+    {
+        int block;
+        for (int k = 0; WindowBlock(k, block); ++k)
+            if (block >= 0 && SlotOf[block] == -1)
+                return block;
+        return -1;
+    }
+
+    // Under Mutex: an empty slot, else the least recently used one outside the window
+    int Victim() const
+    {
+        int best = -1;
+        for (size_t s = 0; s < Slots.size(); ++s)
+        {
+            if (Slots[s].Block < 0)
+                return (int)s;
+            if (Slots[s].Ready && !InWindow(Slots[s].Block) && (best < 0 || Slots[s].LastUse < Slots[best].LastUse))
+                best = (int)s;
+        }
+        return best;
+    }
+
+    void Main()
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        while (!Quit)
+        {
+            int block = NextBlockToLoad();
+            int s = block >= 0 ? Victim() : -1;
+            if (s < 0)
+            {
+                Wake.wait(lock, [this] { return Quit || Moved; });
+                Moved = false;
+                continue;
+            }
+            CacheSlot& slot = Slots[s];
+            if (slot.Block >= 0)
+            {
+                SlotOf[slot.Block] = -1;
+                ++Evicted;
+            }
+            slot.Block = block;
+            slot.Ready = false;
+            SlotOf[block] = s;
+
+            lock.unlock();
+            bool ok = DecodeMotionBlock(*Clip, block, slot.Frames.data()) >= 0;
+            lock.lock();
+
+            if (ok)
+            {
+                slot.Ready = true;
+                slot.LastUse = ++Tick;
+                ++Prefetched;
+            }
+            else
+            {
+                // a damaged block: leave it to DecodeMotionFrame on every lookup
+                slot.Block = -1;
+                SlotOf[block] = -2;
+            }
+        }
+    }
+
+    const EncodedMotionClip* Clip;
+    MotionPlaybackSettings   Settings;
+    int                      Ahead, Behind;
+    std::vector<CacheSlot>   Slots;
+    std::vector<int>         SlotOf;     // per block: its slot, -1 not cached, -2 undecodable
+
+    mutable std::mutex       Mutex;      // guards everything below and the slot bookkeeping
+    std::condition_variable  Wake;
+    std::thread              Thread;
+    int                      Playhead;   // frame
+    int                      Direction;  // +1 / -1
+    bool                     Moved;
+    bool                     Quit;
+    uint64_t                 Tick;
+    uint64_t                 Requests, Hits, Misses, Prefetched, Evicted;
+};
+
+#endif // MOTION_PLAYBACK_H
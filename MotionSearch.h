@@ -0,0 +1,514 @@
+#ifndef MOTION_SEARCH_H
+#define MOTION_SEARCH_H
+
+// Nearest-neighbour search for motion snippets across a library of sessions.
+//
+// Every library frame starts one segment of SegmentFrames frames (if the
+// clip is long enough). A query snippet is resampled to the same length and
+// segments are ranked by banded DTW (Sakoe-Chiba, BandFraction of the
+// segment) over pose features (PoseFeatures), so tempo differences within
+// the band and body size do not matter. Distance is the rms per frame.
+//
+// A segment's key is the mean of each of its MOTION_SEARCH_BLOCKS blocks of
+// BlockFrames frames, scaled by sqrt(BlockFrames). The index product-
+// quantizes the keys with one codebook of 256 k-means centroids shared by
+// all block positions, so a block is coded by one byte stored at its first
+// frame: the library costs one code byte per frame and segment f's code is
+// Codes[f + b * BlockFrames]. A query scores every segment from a
+// MOTION_SEARCH_BLOCKS x 256 table of centroid distances (no feature access),
+// and the best Candidates segments go through the exact cascade:
+//   key box distance   the key against the query's envelope (min/max over
+//                      the band), taken per block: a lower bound of LB_Keogh
+//   LB_Keogh           per frame, early abandoning
+//   DTW                row by row, early abandoning on the LB_Keogh tail
+// SearchExact runs the cascade over every segment instead, which is what the
+// quantized search is measured against.
+
+#include "../Common/PoseFeatures.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <queue>
+#include <random>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#define MOTION_SEARCH_BLOCKS 6
+#define MOTION_SEARCH_KEY_DIM (MOTION_SEARCH_BLOCKS * POSE_FEATURE_DIM)
+#define MOTION_SEARCH_CENTROIDS 256
+
+struct MotionSearchSettings
+{
+    int   SegmentFrames;        // query and segment length after resampling
+    float BandFraction;         // DTW band, fraction of the segment
+    int   Candidates;           // segments per query checked exactly
+    int   TrainingBlocks;       // k-means sample
+    int   TrainingIterations;
+
+    MotionSearchSettings() : SegmentFrames(30), BandFraction(0.1f), Candidates(1024), TrainingBlocks(16384), TrainingIterations(8) {}
+};
+
+struct MotionSearchHit
+{
+    int   Clip;
+    int   Frame;                // first frame of the segment within the clip
+    float Distance;             // rms DTW distance per frame
+};
+
+struct MotionSearchStats
+{
+    long long Scanned;          // segments scored from their codes
+    long long Checked;          // segments entering the exact cascade
+    long long PrunedKey, PrunedKeogh, Abandoned, Completed;
+    double    Ms;
+};
+
+// Pose features of every session, back to back
+struct MotionLibrary
+{
+    std::vector<std::string> Names;
+    std::vector<int>         ClipFirst;     // first library frame of each clip
+    std::vector<int>         ClipFrames;
+    std::vector<float>       Features;      // [frame * POSE_FEATURE_DIM + d]
+
+    int NumClips() const { return (int)Names.size(); }
+    int NumFrames() const { return (int)(Features.size() / POSE_FEATURE_DIM); }
+
+    void Clear()
+    {
+        Names.clear();
+        ClipFirst.clear();
+        ClipFrames.clear();
+        Features.clear();
+    }
+
+    int AddClip(const std::string& name, const float* features, int numFrames)
+    {
+        Names.push_back(name);
+        ClipFirst.push_back(NumFrames());
+        ClipFrames.push_back(numFrames);
+        Features.insert(Features.end(), features, features + (size_t)numFrames * POSE_FEATURE_DIM);
+        return NumClips() - 1;
+    }
+
+    int AddClip(const std::string& name, const KinectClip& clip)
+    {
+        std::vector<float> features;
+        ComputeClipPoseFeatures(clip, 0, clip.NumFrames, features);
+        return AddClip(name, features.data(), clip.NumFrames);
+    }
+
+    const float* Frame(int frame) const { return &Features[(size_t)frame * POSE_FEATURE_DIM]; }
+
+    // Clip holding library frame 'frame'
+    int FindClip(int frame) const
+    {
+        return (int)(std::upper_bound(ClipFirst.begin(), ClipFirst.end(), frame) - ClipFirst.begin()) - 1;
+    }
+};
+
+//---------------------------------------------------------------------------
+struct MotionSearchIndex
+{
+    const MotionLibrary* Library;
+    MotionSearchSettings Settings;
+    int                  Band;
+    int                  BlockFrames;   // SegmentFrames / MOTION_SEARCH_BLOCKS
+    int                  NumSegments;
+    std::vector<uint8_t> Codes;         // per library frame: the block starting there
+    std::vector<float>   Centroids;     // [d * MOTION_SEARCH_CENTROIDS + c]
+    double               BuildMs;
+
+    MotionSearchIndex() : Library(nullptr), Band(0), BlockFrames(0), NumSegments(0), BuildMs(0.0) {}
+
+    size_t MemoryBytes() const { return Codes.size() + Centroids.size() * sizeof(float); }
+
+    // The library must outlive the index and not change after Build
+    void Build(const MotionLibrary& library, const MotionSearchSettings& settings = MotionSearchSettings())
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        Library = &library;
+        Settings = settings;
+        BlockFrames = std::max(1, (Settings.SegmentFrames + MOTION_SEARCH_BLOCKS - 1) / MOTION_SEARCH_BLOCKS);
+        Settings.SegmentFrames = BlockFrames * MOTION_SEARCH_BLOCKS;
+        Band = std::max(1, (int)(Settings.BandFraction * Settings.SegmentFrames + 0.5f));
+
+        NumSegments = 0;
+        for (int c = 0; c < library.NumClips(); ++c)
+            NumSegments += std::max(0, library.ClipFrames[c] - Settings.SegmentFrames + 1);
+
+        Train();
+        Codes.assign(library.NumFrames(), 0);
+        float key[POSE_FEATURE_DIM];
+        for (int c = 0; c < library.NumClips(); ++c)
+            for (int f = 0; f + BlockFrames <= library.ClipFrames[c]; ++f)
+            {
+                ComputeBlockKey(library.Frame(library.ClipFirst[c] + f), key);
+                Codes[library.ClipFirst[c] + f] = (uint8_t)NearestCentroid(key);
+            }
+        BuildMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // The k best non-overlapping segments for a query of numFrames frames
+    // (frame-major features), best first. Segments of one clip overlapping
+    // by half or more are one hit. The query is resampled to SegmentFrames,
+    // so a snippet of another length finds the motion at another tempo.
+    int Search(const float* query, int numFrames, int k, std::vector<MotionSearchHit>& hits, MotionSearchStats* stats = nullptr) const
+    {
+        return Run(query, numFrames, k, hits, stats, false);
+    }
+
+    int SearchExact(const float* query, int numFrames, int k, std::vector<MotionSearchHit>& hits, MotionSearchStats* stats = nullptr) const
+    {
+        return Run(query, numFrames, k, hits, stats, true);
+    }
+
+private:
+    struct Query
+    {
+        std::vector<float>  Frames, Lower, Upper;   // [frame * POSE_FEATURE_DIM + d]
+        float               Key[MOTION_SEARCH_KEY_DIM];
+        float               BoxLower[MOTION_SEARCH_KEY_DIM], BoxUpper[MOTION_SEARCH_KEY_DIM];
+        float               Table[MOTION_SEARCH_BLOCKS * MOTION_SEARCH_CENTROIDS];
+        std::vector<float>  Tail, Rows;
+        std::vector<MotionSearchHit> Best;          // library frames until returned
+        std::vector<float>  Costs;                  // summed DTW cost of Best
+        int                 K;
+        MotionSearchStats   Stats;
+
+        float Bound() const { return (int)Costs.size() < K ? FLT_MAX : Costs.back(); }
+    };
+
+    // sqrt(BlockFrames) * mean of the BlockFrames frames from 'frames' on
+    void ComputeBlockKey(const float* frames, float* key) const
+    {
+        WideFloat scale = WideSet(1.0f / sqrtf((float)BlockFrames));
+        for (int d = 0; d < POSE_FEATURE_DIM; d += WIDE_LANES)
+        {
+            WideFloat sum = WideSet(0.0f);
+            for (int i = 0; i < BlockFrames; ++i)
+                sum = WideAdd(sum, WideLoad(frames + i * POSE_FEATURE_DIM + d));
+            WideStore(key + d, WideMul(sum, scale));
+        }
+    }
+
+    void ComputeKey(const float* frames, float* key) const
+    {
+        for (int b = 0; b < MOTION_SEARCH_BLOCKS; ++b)
+            ComputeBlockKey(frames + b * BlockFrames * POSE_FEATURE_DIM, key + b * POSE_FEATURE_DIM);
+    }
+
+    // Squared distances from x to every centroid, four independent sums of
+    // WIDE_LANES centroids at a time
+    void CentroidDistances(const float* x, float* out) const
+    {
+        for (int c = 0; c < MOTION_SEARCH_CENTROIDS; c += 4 * WIDE_LANES)
+        {
+            WideFloat sum0 = WideSet(0.0f), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+            for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+            {
+                const float* row = &Centroids[d * MOTION_SEARCH_CENTROIDS + c];
+                WideFloat v = WideSet(x[d]);
+                WideFloat d0 = WideSub(v, WideLoad(row)), d1 = WideSub(v, WideLoad(row + WIDE_LANES));
+                WideFloat d2 = WideSub(v, WideLoad(row + 2 * WIDE_LANES)), d3 = WideSub(v, WideLoad(row + 3 * WIDE_LANES));
+                sum0 = WideMulAdd(d0, d0, sum0);
+                sum1 = WideMulAdd(d1, d1, sum1);
+                sum2 = WideMulAdd(d2, d2, sum2);
+                sum3 = WideMulAdd(d3, d3, sum3);
+            }
+            WideStore(out + c, sum0);
+            WideStore(out + c + WIDE_LANES, sum1);
+            WideStore(out + c + 2 * WIDE_LANES, sum2);
+            WideStore(out + c + 3 * WIDE_LANES, sum3);
+        }
+    }
+
+    int NearestCentroid(const float* x) const
+    {
+        float distances[MOTION_SEARCH_CENTROIDS];
+        CentroidDistances(x, distances);
+        WideFloat best = WideLoad(distances), group = WideSet(0.0f);
+        for (int c = WIDE_LANES; c < MOTION_SEARCH_CENTROIDS; c += WIDE_LANES)
+        {
+            WideFloat d = WideLoad(distances + c);
+            WideFloat closer = WideLess(d, best);
+            best = WideSelect(closer, d, best);
+            group = WideSelect(closer, WideSet((float)c), group);
+        }
+        float lanes[WIDE_LANES], groups[WIDE_LANES];
+        WideStore(lanes, best);
+        WideStore(groups, group);
+        int nearest = 0;
+        for (int i = 1; i < WIDE_LANES; ++i)
+            if (lanes[i] < lanes[nearest])
+                nearest = i;
+        return (int)groups[nearest] + nearest;
+    }
+
+    // Distance estimate of the segment starting at 'code' from the query's
+    // table, summed pairwise so the adds do not form one dependency chain
+    float CodeScore(const float* table, const uint8_t* code) const
+    {
+        static_assert(MOTION_SEARCH_BLOCKS == 6, "CodeScore sums six blocks");
+        int s = BlockFrames;
+        float a = table[code[0]] + table[MOTION_SEARCH_CENTROIDS + code[s]];
+        float b = table[2 * MOTION_SEARCH_CENTROIDS + code[2 * s]] + table[3 * MOTION_SEARCH_CENTROIDS + code[3 * s]];
+        float c = table[4 * MOTION_SEARCH_CENTROIDS + code[4 * s]] + table[5 * MOTION_SEARCH_CENTROIDS + code[5 * s]];
+        return (a + b) + c;
+    }
+
+    // k-means over block keys sampled from the whole library; every block
+    // position shares the codebook, so each frame is encoded once
+    void Train()
+    {
+        Centroids.assign((size_t)MOTION_SEARCH_CENTROIDS * POSE_FEATURE_DIM, 0.0f);
+        std::vector<int> starts;
+        for (int c = 0; c < Library->NumClips(); ++c)
+            for (int f = 0; f + BlockFrames <= Library->ClipFrames[c]; ++f)
+                starts.push_back(Library->ClipFirst[c] + f);
+        if (starts.empty())
+            return;
+        std::mt19937 rng(1);
+        int n = std::min((int)starts.size(), std::max(Settings.TrainingBlocks, MOTION_SEARCH_CENTROIDS));
+        std::vector<float> sample((size_t)n * POSE_FEATURE_DIM);
+        for (int i = 0; i < n; ++i)
+            ComputeBlockKey(Library->Frame(starts[rng() % starts.size()]), &sample[(size_t)i * POSE_FEATURE_DIM]);
+
+        for (int c = 0; c < MOTION_SEARCH_CENTROIDS; ++c)
+        {
+            const float* x = &sample[(size_t)(rng() % n) * POSE_FEATURE_DIM];
+            for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+                Centroids[d * MOTION_SEARCH_CENTROIDS + c] = x[d];
+        }
+        std::vector<double> sum((size_t)MOTION_SEARCH_CENTROIDS * POSE_FEATURE_DIM);
+        std::vector<int> count(MOTION_SEARCH_CENTROIDS);
+        for (int iteration = 0; iteration < Settings.TrainingIterations; ++iteration)
+        {
+            std::fill(sum.begin(), sum.end(), 0.0);
+            std::fill(count.begin(), count.end(), 0);
+            for (int i = 0; i < n; ++i)
+            {
+                const float* x = &sample[(size_t)i * POSE_FEATURE_DIM];
+                int c = NearestCentroid(x);
+                ++count[c];
+                for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+                    sum[c * POSE_FEATURE_DIM + d] += x[d];
+            }
+            for (int c = 0; c < MOTION_SEARCH_CENTROIDS; ++c)
+            {
+                // an empty centroid restarts on a random key
+                const float* x = &sample[(size_t)(rng() % n) * POSE_FEATURE_DIM];
+                for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+                    Centroids[d * MOTION_SEARCH_CENTROIDS + c] = count[c] ? (float)(sum[c * POSE_FEATURE_DIM + d] / count[c]) : x[d];
+            }
+        }
+    }
+
+    int Run(const float* query, int numFrames, int k, std::vector<MotionSearchHit>& hits, MotionSearchStats* stats, bool exact) const
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        hits.clear();
+        if (!Library || !NumSegments || numFrames < 1 || k < 1)
+            return 0;
+
+        Query q;
+        q.K = k;
+        q.Stats = MotionSearchStats();
+        PrepareQuery(query, numFrames, q);
+        if (exact)
+        {
+            for (int c = 0; c < Library->NumClips(); ++c)
+                for (int f = 0; f + Settings.SegmentFrames <= Library->ClipFrames[c]; ++f)
+                    Consider(Library->ClipFirst[c] + f, q);
+        }
+        else
+        {
+            // the Candidates segments nearest to the query in code space
+            typedef std::pair<float, int> Scored;
+            std::priority_queue<Scored> nearest;
+            size_t limit = (size_t)std::max(Settings.Candidates, k);
+            float worst = FLT_MAX;      // the queue's top once it is full
+            for (int c = 0; c < Library->NumClips(); ++c)
+            {
+                int first = Library->ClipFirst[c], end = first + Library->ClipFrames[c] - Settings.SegmentFrames;
+                const uint8_t* code = Codes.data() + first;
+                for (int f = first; f <= end; ++f, ++code)
+                {
+                    float score = CodeScore(q.Table, code);
+                    if (score >= worst)
+                        continue;
+                    if (nearest.size() == limit)
+                        nearest.pop();
+                    nearest.push(Scored(score, f));
+                    if (nearest.size() == limit)
+                        worst = nearest.top().first;
+                }
+            }
+            q.Stats.Scanned = NumSegments;
+            std::vector<Scored> candidates;
+            candidates.reserve(nearest.size());
+            for (; !nearest.empty(); nearest.pop())
+                candidates.push_back(nearest.top());
+            for (size_t i = candidates.size(); i-- > 0;)
+                Consider(candidates[i].second, q);
+        }
+
+        hits = q.Best;
+        for (size_t i = 0; i < hits.size(); ++i)
+            hits[i].Frame -= Library->ClipFirst[hits[i].Clip];
+        q.Stats.Ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        if (stats)
+            *stats = q.Stats;
+        return (int)hits.size();
+    }
+
+    void PrepareQuery(const float* query, int numFrames, Query& q) const
+    {
+        int s = Settings.SegmentFrames;
+        q.Frames.resize((size_t)s * POSE_FEATURE_DIM);
+        for (int i = 0; i < s; ++i)
+        {
+            float src = numFrames > 1 ? (float)i * (numFrames - 1) / (s - 1) : 0.0f;
+            int a = std::min((int)src, numFrames - 1), b = std::min(a + 1, numFrames - 1);
+            float w = src - a;
+            for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+                q.Frames[i * POSE_FEATURE_DIM + d] = query[a * POSE_FEATURE_DIM + d] * (1.0f - w) + query[b * POSE_FEATURE_DIM + d] * w;
+        }
+        q.Lower.resize(q.Frames.size());
+        q.Upper.resize(q.Frames.size());
+        for (int i = 0; i < s; ++i)
+            for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+            {
+                float lo = FLT_MAX, hi = -FLT_MAX;
+                for (int j = std::max(0, i - Band); j <= std::min(s - 1, i + Band); ++j)
+                {
+                    lo = std::min(lo, q.Frames[j * POSE_FEATURE_DIM + d]);
+                    hi = std::max(hi, q.Frames[j * POSE_FEATURE_DIM + d]);
+                }
+                q.Lower[i * POSE_FEATURE_DIM + d] = lo;
+                q.Upper[i * POSE_FEATURE_DIM + d] = hi;
+            }
+
+        // the block box holds the envelope of every frame of the block, scaled
+        // like the keys; a key's distance to it is at most the segment's LB_Keogh
+        ComputeKey(q.Frames.data(), q.Key);
+        float scale = sqrtf((float)BlockFrames);
+        for (int b = 0; b < MOTION_SEARCH_BLOCKS; ++b)
+        {
+            for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+            {
+                float lo = FLT_MAX, hi = -FLT_MAX;
+                for (int i = b * BlockFrames; i < (b + 1) * BlockFrames; ++i)
+                {
+                    lo = std::min(lo, q.Lower[i * POSE_FEATURE_DIM + d]);
+                    hi = std::max(hi, q.Upper[i * POSE_FEATURE_DIM + d]);
+                }
+                q.BoxLower[b * POSE_FEATURE_DIM + d] = lo * scale;
+                q.BoxUpper[b * POSE_FEATURE_DIM + d] = hi * scale;
+            }
+            CentroidDistances(q.Key + b * POSE_FEATURE_DIM, q.Table + b * MOTION_SEARCH_CENTROIDS);
+        }
+        q.Tail.resize(s + 1);
+        q.Rows.resize(2 * (2 * Band + 3));
+    }
+
+    void Consider(int item, Query& q) const
+    {
+        ++q.Stats.Checked;
+        float bound = q.Bound();
+        float key[MOTION_SEARCH_KEY_DIM], keyBound = 0.0f;
+        ComputeKey(Library->Frame(item), key);
+        for (int b = 0; b < MOTION_SEARCH_KEY_DIM && keyBound < bound; b += POSE_FEATURE_DIM)
+            keyBound += PoseEnvelopeDistance2(key + b, q.BoxLower + b, q.BoxUpper + b);
+        if (keyBound >= bound)
+        {
+            ++q.Stats.PrunedKey;
+            return;
+        }
+
+        // LB_Keogh from the end, so Tail[j] bounds frames [j, s)
+        int s = Settings.SegmentFrames;
+        q.Tail[s] = 0.0f;
+        for (int j = s - 1; j >= 0; --j)
+        {
+            q.Tail[j] = q.Tail[j + 1] + PoseEnvelopeDistance2(Library->Frame(item + j), &q.Lower[(size_t)j * POSE_FEATURE_DIM], &q.Upper[(size_t)j * POSE_FEATURE_DIM]);
+            if (q.Tail[j] >= bound)
+            {
+                ++q.Stats.PrunedKeogh;
+                return;
+            }
+        }
+
+        float cost = Dtw(item, bound, q);
+        if (cost >= bound)
+        {
+            ++q.Stats.Abandoned;
+            return;
+        }
+        ++q.Stats.Completed;
+        Insert(item, cost, q);
+    }
+
+    // Banded DTW of the query against the segment at 'item'; FLT_MAX once over bound
+    float Dtw(int item, float bound, Query& q) const
+    {
+        int s = Settings.SegmentFrames, r = Band, width = 2 * r + 3;
+        float* prev = &q.Rows[0];
+        float* cur = &q.Rows[width];
+        std::fill(prev, prev + width, FLT_MAX);
+        for (int i = 0; i < s; ++i)
+        {
+            // column j of row i sits at j - i + r + 1
+            std::fill(cur, cur + width, FLT_MAX);
+            const float* qi = &q.Frames[(size_t)i * POSE_FEATURE_DIM];
+            float rowMin = FLT_MAX;
+            int j0 = std::max(0, i - r), j1 = std::min(s - 1, i + r);
+            for (int j = j0; j <= j1; ++j)
+            {
+                int c = j - i + r + 1;
+                float best = i == 0 && j == 0 ? 0.0f : std::min(std::min(prev[c + 1], prev[c]), cur[c - 1]);
+                if (best == FLT_MAX)
+                    continue;
+                cur[c] = best + PoseFeatureDistance2(qi, Library->Frame(item + j));
+                rowMin = std::min(rowMin, cur[c]);
+            }
+            if (rowMin + (j1 + 1 < s ? q.Tail[j1 + 1] : 0.0f) >= bound)
+                return FLT_MAX;
+            std::swap(prev, cur);
+        }
+        return prev[r + 1];
+    }
+
+    // Keeps Best sorted and free of overlapping segments from one clip
+    void Insert(int item, float cost, Query& q) const
+    {
+        int s = Settings.SegmentFrames, clip = Library->FindClip(item);
+        for (size_t i = 0; i < q.Best.size(); ++i)
+        {
+            if (q.Best[i].Clip != clip || abs(q.Best[i].Frame - item) * 2 >= s)
+                continue;
+            if (q.Costs[i] <= cost)
+                return;
+            q.Best.erase(q.Best.begin() + i);
+            q.Costs.erase(q.Costs.begin() + i);
+            --i;
+        }
+        size_t at = std::upper_bound(q.Costs.begin(), q.Costs.end(), cost) - q.Costs.begin();
+        if ((int)at >= q.K)
+            return;
+        MotionSearchHit hit = { clip, item, sqrtf(cost / s) };
+        q.Best.insert(q.Best.begin() + at, hit);
+        q.Costs.insert(q.Costs.begin() + at, cost);
+        if ((int)q.Best.size() > q.K)
+        {
+            q.Best.pop_back();
+            q.Costs.pop_back();
+        }
+    }
+};
+
+#endif // MOTION_SEARCH_H
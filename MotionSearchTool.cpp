@@ -0,0 +1,227 @@
+// Finds the segments of an archive most similar to a snippet of motion.
+//
+//   MotionSearchTool [-k hits] [-frames segment] [-candidates n] [-synthetic copies]
+//                    [-queries n] [-q recording first count] <directory | file>...
+//
+// Every recording (see CollectRecordings) is cleaned like in the session
+// analytics and added to one MotionLibrary, which is indexed once. -q looks
+// up frames [first, first + count) of a recording; segments are as long as
+// the snippet unless -frames says otherwise. Without -q the tool
+// benchmarks: it times random snippets of a perturbed copy of the first
+// recording against the index and measures the recall of the first few
+// against the exact search. -synthetic replaces the library by
+// that many perturbed copies of every input (time warped, rescaled, turned,
+// moved, noisy), to try the index at archive scale from one sample file.
+//
+// Build standalone, no OVR / GL needed:
+//   cl /O2 /EHsc /arch:AVX2 MotionSearchTool.cpp
+//   g++ -std=c++14 -O2 -mavx2 MotionSearchTool.cpp
+
+#include "../Common/RecordingArchive.h"
+#include "../Common/SessionAnalytics.h"
+#include "../Common/MotionSearch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// Pose features of a randomly perturbed copy of 'clip'
+static void PerturbRecording(const KinectClip& clip, std::mt19937& rng, std::vector<float>& features)
+{
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::normal_distribution<float> noise(0.0f, 0.005f);
+    float speed = 0.85f + 0.3f * uniform(rng), wobble = 0.1f * uniform(rng), phase = 6.2831853f * uniform(rng);
+    float scale = 0.85f + 0.3f * uniform(rng), yaw = (uniform(rng) - 0.5f) * 1.0f;
+    Float3 offset = MakeFloat3(uniform(rng) - 0.5f, 0.2f * uniform(rng), 1.0f * uniform(rng));
+    float c = cosf(yaw), s = sinf(yaw);
+
+    features.clear();
+    SkeletonFrame a, b, frame;
+    frame.Clear();
+    float src = 0.0f;
+    for (int f = 0; src < clip.NumFrames - 1; ++f)
+    {
+        int i = (int)src;
+        float w = src - i;
+        clip.GetFrame(i, a);
+        clip.GetFrame(i + 1, b);
+        Float3 base = a.Get(KinectJoint_SpineBase);
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            Float3 p = (a.Get(j) * (1.0f - w) + b.Get(j) * w - base) * scale;
+            Float3 q = MakeFloat3(c * p.x + s * p.z + noise(rng), p.y + noise(rng), c * p.z - s * p.x + noise(rng));
+            frame.Set(j, q + base + offset);
+        }
+        size_t at = features.size();
+        features.resize(at + POSE_FEATURE_DIM);
+        ComputePoseFeatures(frame, &features[at]);
+        src += speed * (1.0f + wobble * sinf(f * 0.05f + phase));
+    }
+}
+
+static void PrintHits(const MotionLibrary& library, const std::vector<MotionSearchHit>& hits)
+{
+    for (size_t i = 0; i < hits.size(); ++i)
+        printf("%2d  %-40s frame %6d  distance %.4f\n", (int)i + 1, library.Names[hits[i].Clip].c_str(), hits[i].Frame, hits[i].Distance);
+}
+
+static void PrintUsage()
+{
+    fprintf(stderr, "usage: MotionSearchTool [-k hits] [-frames segment] [-candidates n] [-synthetic copies] [-queries n] [-q recording first count] <directory | file>...\n");
+}
+
+int main(int argc, char** argv)
+{
+    int k = 5, copies = 0, queries = 100, segmentFrames = 0;
+    MotionSearchSettings settings;
+    const char* queryFile = nullptr;
+    int queryFirst = 0, queryCount = 0;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-k" && i + 1 < argc)
+            k = atoi(argv[++i]);
+        else if (arg == "-frames" && i + 1 < argc)
+            segmentFrames = atoi(argv[++i]);
+        else if (arg == "-candidates" && i + 1 < argc)
+            settings.Candidates = atoi(argv[++i]);
+        else if (arg == "-synthetic" && i + 1 < argc)
+            copies = atoi(argv[++i]);
+        else if (arg == "-queries" && i + 1 < argc)
+            queries = atoi(argv[++i]);
+        else if (arg == "-q" && i + 3 < argc)
+        {
+            queryFile = argv[++i];
+            queryFirst = atoi(argv[++i]);
+            queryCount = atoi(argv[++i]);
+        }
+        else if (arg[0] == '-')
+        {
+            PrintUsage();
+            return 2;
+        }
+        else
+            CollectRecordings(arg, files);
+    }
+    if (files.empty())
+    {
+        PrintUsage();
+        return 2;
+    }
+    if (segmentFrames > 0)
+        settings.SegmentFrames = segmentFrames;
+    else if (queryFile)
+        settings.SegmentFrames = queryCount;
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    MotionLibrary library;
+    std::vector<KinectClip> sources;
+    std::mt19937 rng(7);
+    std::vector<float> features;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        KinectClip clip;
+        KinectBoneLengths bones;
+        if (!LoadRecording(files[i], clip))
+        {
+            fprintf(stderr, "cannot read %s\n", files[i].c_str());
+            continue;
+        }
+        CleanRecording(clip, bones, nullptr, nullptr);
+        if (copies <= 0)
+            library.AddClip(files[i], clip);
+        for (int c = 0; c < copies; ++c)
+        {
+            PerturbRecording(clip, rng, features);
+            library.AddClip(files[i] + "#" + std::to_string(c + 1), features.data(), (int)(features.size() / POSE_FEATURE_DIM));
+        }
+        sources.push_back(clip);
+    }
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if (sources.empty())
+        return 1;
+
+    MotionSearchIndex index;
+    index.Build(library, settings);
+    printf("%d clip(s), %d frames (%.1f MB) loaded in %.0f ms, indexed in %.0f ms (%.1f MB)\n",
+           library.NumClips(), library.NumFrames(), library.Features.size() * sizeof(float) / 1048576.0, loadMs, index.BuildMs, index.MemoryBytes() / 1048576.0);
+
+    std::vector<MotionSearchHit> hits, exact;
+    MotionSearchStats stats;
+    if (queryFile)
+    {
+        KinectClip clip;
+        KinectBoneLengths bones;
+        if (!LoadRecording(queryFile, clip) || queryFirst < 0 || queryCount < 1 || queryFirst + queryCount > clip.NumFrames)
+        {
+            fprintf(stderr, "cannot read frames %d-%d of %s\n", queryFirst, queryFirst + queryCount - 1, queryFile);
+            return 1;
+        }
+        CleanRecording(clip, bones, nullptr, nullptr);
+        ComputeClipPoseFeatures(clip, queryFirst, queryCount, features);
+        index.Search(features.data(), queryCount, k, hits, &stats);
+        PrintHits(library, hits);
+        printf("%.3f ms, %lld segments scanned, %lld checked: %lld pruned by key, %lld by LB_Keogh, %lld DTW abandoned, %lld completed\n",
+               stats.Ms, stats.Scanned, stats.Checked, stats.PrunedKey, stats.PrunedKeogh, stats.Abandoned, stats.Completed);
+        return 0;
+    }
+
+    // benchmark: snippets of an unseen perturbed copy
+    std::vector<float> probe;
+    PerturbRecording(sources[0], rng, probe);
+    int probeFrames = (int)(probe.size() / POSE_FEATURE_DIM);
+    std::vector<double> times;
+    MotionSearchStats total = MotionSearchStats();
+    int checked = 0, expected = 0, found = 0;
+    double exactMs = 0.0, ratio = 0.0;
+    for (int q = 0; q < queries; ++q)
+    {
+        int count = index.Settings.SegmentFrames;
+        int first = (int)(rng() % (probeFrames - count));
+        index.Search(&probe[(size_t)first * POSE_FEATURE_DIM], count, k, hits, &stats);
+        times.push_back(stats.Ms);
+        total.Checked += stats.Checked;
+        total.PrunedKey += stats.PrunedKey;
+        total.PrunedKeogh += stats.PrunedKeogh;
+        total.Abandoned += stats.Abandoned;
+        total.Completed += stats.Completed;
+        if (q == 0)
+            PrintHits(library, hits);
+        if (q >= 10)
+            continue;
+
+        // recall: exact hits with an index hit on the same spot
+        index.SearchExact(&probe[(size_t)first * POSE_FEATURE_DIM], count, k, exact, &stats);
+        exactMs += stats.Ms;
+        ++checked;
+        for (size_t i = 0; i < exact.size(); ++i)
+        {
+            ++expected;
+            for (size_t j = 0; j < hits.size(); ++j)
+                if (hits[j].Clip == exact[i].Clip && abs(hits[j].Frame - exact[i].Frame) * 2 < index.Settings.SegmentFrames)
+                {
+                    ++found;
+                    break;
+                }
+        }
+        if (!exact.empty() && !hits.empty())
+            ratio += hits.back().Distance / exact.back().Distance;
+    }
+    std::sort(times.begin(), times.end());
+    double sum = 0.0;
+    for (size_t i = 0; i < times.size(); ++i)
+        sum += times[i];
+    printf("%d queries, k = %d: mean %.3f ms, median %.3f ms, p99 %.3f ms\n", queries, k,
+           sum / queries, times[times.size() / 2], times[std::min(times.size() - 1, times.size() * 99 / 100)]);
+    printf("per query: %d segments scanned, %.0f checked: %.0f pruned by key, %.0f by LB_Keogh, %.0f DTW abandoned, %.0f completed\n",
+           index.NumSegments, (double)total.Checked / queries, (double)total.PrunedKey / queries,
+           (double)total.PrunedKeogh / queries, (double)total.Abandoned / queries, (double)total.Completed / queries);
+    printf("against exact search (%.1f ms per query): recall@%d %.3f, k-th distance %.3f x exact\n",
+           exactMs / checked, k, expected ? (double)found / expected : 1.0, ratio / checked);
+    return 0;
+}
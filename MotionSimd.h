@@ -0,0 +1,310 @@
+#ifndef MOTION_SIMD_H
+#define MOTION_SIMD_H
+
+// SSE helpers for SoA skeleton data: every __m128 holds one component of four
+// joints (or four bones, or four frames). SSE2 is always available on x64, so
+// these are used unconditionally; wider AVX2 paths check __AVX2__ themselves.
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+
+struct Vec3x4
+{
+    __m128 x, y, z;
+};
+
+struct Quat4x4
+{
+    __m128 x, y, z, w;
+};
+
+inline Vec3x4 LoadVec3x4(const float* x, const float* y, const float* z)
+{
+    Vec3x4 v = { _mm_loadu_ps(x), _mm_loadu_ps(y), _mm_loadu_ps(z) };
+    return v;
+}
+
+inline void StoreVec3x4(const Vec3x4& v, float* x, float* y, float* z)
+{
+    _mm_storeu_ps(x, v.x);
+    _mm_storeu_ps(y, v.y);
+    _mm_storeu_ps(z, v.z);
+}
+
+inline Quat4x4 LoadQuat4x4(const float* x, const float* y, const float* z, const float* w)
+{
+    Quat4x4 q = { _mm_loadu_ps(x), _mm_loadu_ps(y), _mm_loadu_ps(z), _mm_loadu_ps(w) };
+    return q;
+}
+
+inline void StoreQuat4x4(const Quat4x4& q, float* x, float* y, float* z, float* w)
+{
+    _mm_storeu_ps(x, q.x);
+    _mm_storeu_ps(y, q.y);
+    _mm_storeu_ps(z, q.z);
+    _mm_storeu_ps(w, q.w);
+}
+
+inline Vec3x4 Add4(const Vec3x4& a, const Vec3x4& b) { Vec3x4 r = { _mm_add_ps(a.x, b.x), _mm_add_ps(a.y, b.y), _mm_add_ps(a.z, b.z) }; return r; }
+inline Vec3x4 Sub4(const Vec3x4& a, const Vec3x4& b) { Vec3x4 r = { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) }; return r; }
+inline Vec3x4 Scale4(const Vec3x4& a, __m128 s) { Vec3x4 r = { _mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s) }; return r; }
+
+inline __m128 Dot4(const Vec3x4& a, const Vec3x4& b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+inline Vec3x4 Cross4(const Vec3x4& a, const Vec3x4& b)
+{
+    Vec3x4 r = { _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+                 _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+                 _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x)) };
+    return r;
+}
+
+inline Vec3x4 Lerp4(const Vec3x4& a, const Vec3x4& b, __m128 t)
+{
+    return Add4(a, Scale4(Sub4(b, a), t));
+}
+
+// 1/sqrt(v) with one Newton step on top of the 12 bit estimate; v == 0 returns 0
+inline __m128 InvSqrt4(__m128 v)
+{
+    __m128 e = _mm_rsqrt_ps(v);
+    e = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), e), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(_mm_mul_ps(v, e), e)));
+    return _mm_and_ps(e, _mm_cmpgt_ps(v, _mm_set1_ps(1e-12f)));
+}
+
+inline Vec3x4 Normalize4(const Vec3x4& a)
+{
+    return Scale4(a, InvSqrt4(Dot4(a, a)));
+}
+
+inline __m128 QuatDot4(const Quat4x4& a, const Quat4x4& b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)),
+                      _mm_add_ps(_mm_mul_ps(a.z, b.z), _mm_mul_ps(a.w, b.w)));
+}
+
+inline Quat4x4 QuatNormalize4(const Quat4x4& q)
+{
+    __m128 s = InvSqrt4(QuatDot4(q, q));
+    Quat4x4 r = { _mm_mul_ps(q.x, s), _mm_mul_ps(q.y, s), _mm_mul_ps(q.z, s), _mm_mul_ps(q.w, s) };
+    return r;
+}
+
+inline Quat4x4 QuatConjugate4(const Quat4x4& q)
+{
+    __m128 neg = _mm_set1_ps(-0.0f);
+    Quat4x4 r = { _mm_xor_ps(q.x, neg), _mm_xor_ps(q.y, neg), _mm_xor_ps(q.z, neg), q.w };
+    return r;
+}
+
+// a * b applies b first, then a (same convention as QuatMul)
+inline Quat4x4 QuatMul4(const Quat4x4& a, const Quat4x4& b)
+{
+    Quat4x4 r;
+    r.x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a.w, b.x), _mm_mul_ps(a.x, b.w)), _mm_mul_ps(a.y, b.z)), _mm_mul_ps(a.z, b.y));
+    r.y = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(a.w, b.y), _mm_mul_ps(a.x, b.z)), _mm_mul_ps(a.y, b.w)), _mm_mul_ps(a.z, b.x));
+    r.z = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(a.w, b.z), _mm_mul_ps(a.x, b.y)), _mm_mul_ps(a.y, b.x)), _mm_mul_ps(a.z, b.w));
+    r.w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(a.w, b.w), _mm_mul_ps(a.x, b.x)), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+    return r;
+}
+
+inline Vec3x4 QuatRotate4(const Quat4x4& q, const Vec3x4& v)
+{
+    Vec3x4 u = { q.x, q.y, q.z };
+    Vec3x4 t = Cross4(u, v);
+    t = Add4(t, t);
+    return Add4(Add4(v, Scale4(t, q.w)), Cross4(u, t));
+}
+
+// Shortest-arc nlerp, per lane weight t
+inline Quat4x4 QuatNlerp4(const Quat4x4& a, const Quat4x4& b, __m128 t)
+{
+    __m128 signMask = _mm_and_ps(QuatDot4(a, b), _mm_set1_ps(-0.0f));
+    __m128 s = _mm_sub_ps(_mm_set1_ps(1.0f), t);
+    __m128 u = _mm_xor_ps(t, signMask);
+    Quat4x4 r = { _mm_add_ps(_mm_mul_ps(a.x, s), _mm_mul_ps(b.x, u)),
+                  _mm_add_ps(_mm_mul_ps(a.y, s), _mm_mul_ps(b.y, u)),
+                  _mm_add_ps(_mm_mul_ps(a.z, s), _mm_mul_ps(b.z, u)),
+                  _mm_add_ps(_mm_mul_ps(a.w, s), _mm_mul_ps(b.w, u)) };
+    return QuatNormalize4(r);
+}
+
+// Shortest rotation taking unit direction a onto unit direction b, per lane.
+// Opposite directions fall back to a half turn about an axis orthogonal to a.
+inline Quat4x4 QuatFromTo4(const Vec3x4& a, const Vec3x4& b)
+{
+    Vec3x4 c = Cross4(a, b);
+    __m128 w = _mm_add_ps(_mm_set1_ps(1.0f), Dot4(a, b));
+    __m128 opposite = _mm_cmplt_ps(w, _mm_set1_ps(1e-6f));
+    // axis = a x (1,0,0) or, when a is along x, a x (0,1,0)
+    __m128 zero = _mm_setzero_ps();
+    __m128 useY = _mm_cmpgt_ps(_mm_mul_ps(a.x, a.x), _mm_set1_ps(0.9f));
+    Vec3x4 alt = { _mm_and_ps(useY, _mm_sub_ps(zero, a.z)),
+                   _mm_andnot_ps(useY, a.z),
+                   _mm_sub_ps(_mm_and_ps(useY, a.x), _mm_andnot_ps(useY, a.y)) };
+    Quat4x4 r = { _mm_or_ps(_mm_and_ps(opposite, alt.x), _mm_andnot_ps(opposite, c.x)),
+                  _mm_or_ps(_mm_and_ps(opposite, alt.y), _mm_andnot_ps(opposite, c.y)),
+                  _mm_or_ps(_mm_and_ps(opposite, alt.z), _mm_andnot_ps(opposite, c.z)),
+                  _mm_andnot_ps(opposite, w) };
+    return QuatNormalize4(r);
+}
+
+inline __m128 Clamp4(__m128 v, __m128 lo, __m128 hi)
+{
+    return _mm_min_ps(_mm_max_ps(v, lo), hi);
+}
+
+// mask ? a : b per lane
+inline __m128 Select4(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline Vec3x4 Select4(__m128 mask, const Vec3x4& a, const Vec3x4& b)
+{
+    Vec3x4 r = { Select4(mask, a.x, b.x), Select4(mask, a.y, b.y), Select4(mask, a.z, b.z) };
+    return r;
+}
+
+// Rotation whose columns are the orthonormal axes x, y, z. Branch-free
+// Shepperd: every lane builds the quaternion from its largest component.
+inline Quat4x4 QuatFromBasis4(const Vec3x4& x, const Vec3x4& y, const Vec3x4& z)
+{
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 tw = _mm_add_ps(one, _mm_add_ps(_mm_add_ps(x.x, y.y), z.z));
+    __m128 tx = _mm_add_ps(one, _mm_sub_ps(_mm_sub_ps(x.x, y.y), z.z));
+    __m128 ty = _mm_add_ps(one, _mm_sub_ps(_mm_sub_ps(y.y, x.x), z.z));
+    __m128 tz = _mm_add_ps(one, _mm_sub_ps(_mm_sub_ps(z.z, x.x), y.y));
+    __m128 t = _mm_max_ps(_mm_max_ps(tw, tx), _mm_max_ps(ty, tz));
+
+    __m128 useW = _mm_cmpeq_ps(tw, t);
+    __m128 useX = _mm_andnot_ps(useW, _mm_cmpeq_ps(tx, t));
+    __m128 useY = _mm_andnot_ps(_mm_or_ps(useW, useX), _mm_cmpeq_ps(ty, t));
+
+    __m128 a = _mm_sub_ps(y.z, z.y), b = _mm_sub_ps(z.x, x.z), c = _mm_sub_ps(x.y, y.x);
+    __m128 d = _mm_add_ps(y.x, x.y), e = _mm_add_ps(z.x, x.z), f = _mm_add_ps(z.y, y.z);
+
+    Quat4x4 q;
+    q.x = Select4(useW, a, Select4(useX, t, Select4(useY, d, e)));
+    q.y = Select4(useW, b, Select4(useX, d, Select4(useY, t, f)));
+    q.z = Select4(useW, c, Select4(useX, e, Select4(useY, f, t)));
+    q.w = Select4(useW, t, Select4(useX, a, Select4(useY, b, c)));
+    __m128 s = _mm_mul_ps(_mm_set1_ps(0.5f), InvSqrt4(t));
+    Quat4x4 r = { _mm_mul_ps(q.x, s), _mm_mul_ps(q.y, s), _mm_mul_ps(q.z, s), _mm_mul_ps(q.w, s) };
+    return QuatNormalize4(r);
+}
+
+//---------------------------------------------------------------------------
+// WideFloat: the widest float vector the build targets, for whole-clip
+// kernels that stream one channel over many frames. Eight lanes with AVX2,
+// otherwise four; kernels written against these helpers step WIDE_LANES
+// frames at a time and compile to either. The choice is made at compile time
+// with no runtime dispatch: MSVC only defines __AVX2__ under /arch:AVX2, which
+// the app project does not set, so the app builds the SSE path. The AVX2 path
+// is taken by tools built with /arch:AVX2 (or -mavx2 -mfma).
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+typedef __m256 WideFloat;
+#define WIDE_LANES 8
+
+inline WideFloat WideLoad(const float* p)             { return _mm256_loadu_ps(p); }
+inline void      WideStore(float* p, WideFloat v)     { _mm256_storeu_ps(p, v); }
+inline WideFloat WideSet(float v)                     { return _mm256_set1_ps(v); }
+inline WideFloat WideAdd(WideFloat a, WideFloat b)    { return _mm256_add_ps(a, b); }
+inline WideFloat WideSub(WideFloat a, WideFloat b)    { return _mm256_sub_ps(a, b); }
+inline WideFloat WideMul(WideFloat a, WideFloat b)    { return _mm256_mul_ps(a, b); }
+inline WideFloat WideDiv(WideFloat a, WideFloat b)    { return _mm256_div_ps(a, b); }
+inline WideFloat WideMin(WideFloat a, WideFloat b)    { return _mm256_min_ps(a, b); }
+inline WideFloat WideMax(WideFloat a, WideFloat b)    { return _mm256_max_ps(a, b); }
+inline WideFloat WideSqrt(WideFloat a)                { return _mm256_sqrt_ps(a); }
+inline WideFloat WideAnd(WideFloat a, WideFloat b)    { return _mm256_and_ps(a, b); }
+inline WideFloat WideXor(WideFloat a, WideFloat b)    { return _mm256_xor_ps(a, b); }
+inline WideFloat WideLess(WideFloat a, WideFloat b)   { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline WideFloat WideSelect(WideFloat mask, WideFloat a, WideFloat b) { return _mm256_blendv_ps(b, a, mask); }
+inline WideFloat WideMulAdd(WideFloat a, WideFloat b, WideFloat c)    { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+
+inline float WideHorizontalMin(WideFloat v)
+{
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+inline float WideHorizontalMax(WideFloat v)
+{
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+inline float WideHorizontalSum(WideFloat v)
+{
+    __m128 m = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_add_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_add_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+#else
+
+typedef __m128 WideFloat;
+#define WIDE_LANES 4
+
+inline WideFloat WideLoad(const float* p)             { return _mm_loadu_ps(p); }
+inline void      WideStore(float* p, WideFloat v)     { _mm_storeu_ps(p, v); }
+inline WideFloat WideSet(float v)                     { return _mm_set1_ps(v); }
+inline WideFloat WideAdd(WideFloat a, WideFloat b)    { return _mm_add_ps(a, b); }
+inline WideFloat WideSub(WideFloat a, WideFloat b)    { return _mm_sub_ps(a, b); }
+inline WideFloat WideMul(WideFloat a, WideFloat b)    { return _mm_mul_ps(a, b); }
+inline WideFloat WideDiv(WideFloat a, WideFloat b)    { return _mm_div_ps(a, b); }
+inline WideFloat WideMin(WideFloat a, WideFloat b)    { return _mm_min_ps(a, b); }
+inline WideFloat WideMax(WideFloat a, WideFloat b)    { return _mm_max_ps(a, b); }
+inline WideFloat WideSqrt(WideFloat a)                { return _mm_sqrt_ps(a); }
+inline WideFloat WideAnd(WideFloat a, WideFloat b)    { return _mm_and_ps(a, b); }
+inline WideFloat WideXor(WideFloat a, WideFloat b)    { return _mm_xor_ps(a, b); }
+inline WideFloat WideLess(WideFloat a, WideFloat b)   { return _mm_cmplt_ps(a, b); }
+inline WideFloat WideSelect(WideFloat mask, WideFloat a, WideFloat b) { return Select4(mask, a, b); }
+inline WideFloat WideMulAdd(WideFloat a, WideFloat b, WideFloat c)    { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+inline float WideHorizontalMin(WideFloat v)
+{
+    __m128 m = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+inline float WideHorizontalMax(WideFloat v)
+{
+    __m128 m = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+inline float WideHorizontalSum(WideFloat v)
+{
+    __m128 m = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(m, _mm_shuffle_ps(m, m, 1)));
+}
+
+#endif
+
+inline WideFloat WideAbs(WideFloat a) { return WideXor(a, WideAnd(a, WideSet(-0.0f))); }
+
+// atan2(y, x) per lane, max error about 1e-5 rad; atan2(0, 0) = 0
+inline WideFloat WideAtan2(WideFloat y, WideFloat x)
+{
+    WideFloat ax = WideAbs(x), ay = WideAbs(y);
+    WideFloat hi = WideMax(ax, ay), lo = WideMin(ax, ay);
+    WideFloat a = WideDiv(lo, WideMax(hi, WideSet(1e-30f)));
+    WideFloat s = WideMul(a, a);
+    WideFloat p = WideMulAdd(WideSet(-0.0464964749f), s, WideSet(0.15931422f));
+    p = WideMulAdd(p, s, WideSet(-0.327622764f));
+    WideFloat r = WideMulAdd(WideMul(p, s), a, a);
+    r = WideSelect(WideLess(ax, ay), WideSub(WideSet(1.57079637f), r), r);
+    r = WideSelect(WideLess(x, WideSet(0.0f)), WideSub(WideSet(3.14159274f), r), r);
+    return WideXor(r, WideAnd(y, WideSet(-0.0f)));
+}
+
+#endif // MOTION_SIMD_H
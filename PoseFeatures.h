@@ -0,0 +1,84 @@
+#ifndef POSE_FEATURES_H
+#define POSE_FEATURES_H
+
+// Body-size and placement invariant pose descriptor for motion matching.
+//
+// The limb joints (elbows, wrists, knees, ankles) relative to SpineBase,
+// turned about the vertical so that the hip line points along +X and divided
+// by the torso length (SpineBase -> SpineShoulder). Two people doing the same
+// exercise anywhere in front of the sensor produce similar features; a
+// feature distance of 0.1 is roughly a tenth of a torso. POSE_FEATURE_DIM is
+// a multiple of eight so that distances run whole WideFloat ops.
+
+#include "../Common/MotionFile.h"
+#include "../Common/MotionSimd.h"
+
+#include <math.h>
+#include <vector>
+
+static const int PoseFeatureJoints[8] =
+{
+    KinectJoint_ElbowLeft, KinectJoint_WristLeft, KinectJoint_ElbowRight, KinectJoint_WristRight,
+    KinectJoint_KneeLeft, KinectJoint_AnkleLeft, KinectJoint_KneeRight, KinectJoint_AnkleRight
+};
+
+#define POSE_FEATURE_DIM 24
+
+// out[POSE_FEATURE_DIM]: x y z per PoseFeatureJoints entry
+inline void ComputePoseFeatures(const SkeletonFrame& frame, float* out)
+{
+    Float3 base = frame.Get(KinectJoint_SpineBase);
+    Float3 torso = frame.Get(KinectJoint_SpineShoulder) - base;
+    float length = Length(torso);
+    float scale = length > 1e-4f ? 1.0f / length : 0.0f;
+
+    Float3 hips = frame.Get(KinectJoint_HipRight) - frame.Get(KinectJoint_HipLeft);
+    float h = sqrtf(hips.x * hips.x + hips.z * hips.z);
+    float c = h > 1e-6f ? hips.x / h : 1.0f, s = h > 1e-6f ? hips.z / h : 0.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        Float3 p = frame.Get(PoseFeatureJoints[i]) - base;
+        out[i * 3 + 0] = (c * p.x + s * p.z) * scale;
+        out[i * 3 + 1] = p.y * scale;
+        out[i * 3 + 2] = (c * p.z - s * p.x) * scale;
+    }
+}
+
+// Frames [first, first + count) of a clip, frame-major: out[f * POSE_FEATURE_DIM + d]
+inline void ComputeClipPoseFeatures(const KinectClip& clip, int first, int count, std::vector<float>& out)
+{
+    out.resize((size_t)count * POSE_FEATURE_DIM);
+    SkeletonFrame frame;
+    for (int f = 0; f < count; ++f)
+    {
+        clip.GetFrame(first + f, frame);
+        ComputePoseFeatures(frame, &out[(size_t)f * POSE_FEATURE_DIM]);
+    }
+}
+
+// Squared distance between two feature vectors
+inline float PoseFeatureDistance2(const float* a, const float* b)
+{
+    WideFloat sum = WideSet(0.0f);
+    for (int d = 0; d < POSE_FEATURE_DIM; d += WIDE_LANES)
+    {
+        WideFloat diff = WideSub(WideLoad(a + d), WideLoad(b + d));
+        sum = WideMulAdd(diff, diff, sum);
+    }
+    return WideHorizontalSum(sum);
+}
+
+// Squared distance from a feature vector to the box [lower, upper]
+inline float PoseEnvelopeDistance2(const float* a, const float* lower, const float* upper)
+{
+    WideFloat sum = WideSet(0.0f), zero = WideSet(0.0f);
+    for (int d = 0; d < POSE_FEATURE_DIM; d += WIDE_LANES)
+    {
+        WideFloat x = WideLoad(a + d);
+        WideFloat out = WideAdd(WideMax(WideSub(x, WideLoad(upper + d)), zero), WideMax(WideSub(WideLoad(lower + d), x), zero));
+        sum = WideMulAdd(out, out, sum);
+    }
+    return WideHorizontalSum(sum);
+}
+
+#endif // POSE_FEATURES_H
@@ -0,0 +1,98 @@
+#ifndef RECORDING_ARCHIVE_H
+#define RECORDING_ARCHIVE_H
+
+// Finding the recordings of an archive for the command line tools: every
+// *.txt and *.kmc (see MotionCodec.h) in a directory (not recursive),
+// sorted by name, or a file named directly. LoadRecording reads either.
+//
+// MotionCodecTool writes x.kmc next to x.txt, so a converted recording is
+// there twice; a directory lists it once, as the *.kmc by default (the
+// compact copy, faster to load) or as the text when the caller prefers
+// ".txt" (the converter, which re-encodes its sources). Files named
+// directly are always taken as they are.
+
+#include <algorithm>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+inline bool HasExtension(const std::string& name, const char* ext)
+{
+    size_t n = strlen(ext);
+    return name.size() > n && name.compare(name.size() - n, n, ext) == 0;
+}
+
+// Appends the recordings in 'path' (a directory or a single file), one per
+// file name stem, the one with extension 'preferred' where both exist
+inline void CollectRecordings(const std::string& path, std::vector<std::string>& files, const char* preferred = ".kmc")
+{
+#if defined(_WIN32)
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        files.push_back(path);
+        return;
+    }
+    std::vector<std::string> found;
+    static const char* const Patterns[] = { "\\*.txt", "\\*.kmc" };
+    for (int p = 0; p < 2; ++p)
+    {
+        WIN32_FIND_DATAA data;
+        HANDLE find = FindFirstFileA((path + Patterns[p]).c_str(), &data);
+        if (find == INVALID_HANDLE_VALUE)
+            continue;
+        do
+        {
+            if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                found.push_back(path + "\\" + data.cFileName);
+        } while (FindNextFileA(find, &data));
+        FindClose(find);
+    }
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        files.push_back(path);
+        return;
+    }
+    std::vector<std::string> found;
+    if (DIR* dir = opendir(path.c_str()))
+    {
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (HasExtension(name, ".txt") || HasExtension(name, ".kmc"))
+                found.push_back(path + "/" + name);
+        }
+        closedir(dir);
+    }
+#endif
+    // both extensions are four characters; sort by stem, preferred first
+    std::sort(found.begin(), found.end(), [preferred](const std::string& a, const std::string& b)
+    {
+        int c = a.compare(0, a.size() - 4, b, 0, b.size() - 4);
+        if (c != 0)
+            return c < 0;
+        return HasExtension(a, preferred) && !HasExtension(b, preferred);
+    });
+    found.erase(std::unique(found.begin(), found.end(), [](const std::string& a, const std::string& b)
+    {
+        return a.compare(0, a.size() - 4, b, 0, b.size() - 4) == 0;
+    }), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+}
+
+#endif // RECORDING_ARCHIVE_H
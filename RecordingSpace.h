@@ -0,0 +1,373 @@
+#ifndef RECORDING_SPACE_H
+#define RECORDING_SPACE_H
+
+// Coordinate-space normalization for recordings.
+//
+// Some recordings switch coordinate frames part way through (the tail of
+// motionBothArms_Lars.txt jumps from z ~ 2.5 m camera space to a different
+// origin with negative y). NormalizeRecordingSpace
+//   1. tracks the torso centroid and flags frames that leave a constant
+//      velocity path by more than MaxTorsoJump,
+//   2. treats a flagged frame as a frame switch if the following
+//      MinSegmentFrames frames are consistent again (a lone spike is an
+//      outlier and is left for the gap filter),
+//   3. aligns each new segment to the previous one with a rigid fit (Kabsch,
+//      solved with Horn's quaternion method) of the torso joints against
+//      where the previous segment was heading; if the torso itself changed
+//      shape across the switch (fit worse than MaxFitResidual) only the
+//      translation is used,
+//   4. optionally moves everything into a canonical space: mean spine
+//      direction along +Y, the feet's floor at y = 0 and the first pelvis
+//      position above the origin. Facing is kept, so sensor-space consumers
+//      (rotation solver, retargeter) still apply.
+// Every frame is rewritten exactly once, four frames per SSE op.
+
+#include "../Common/MotionFile.h"
+#include "../Common/MotionSimd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+static const int KinectTorsoJoints[8] =
+{
+    KinectJoint_SpineBase, KinectJoint_SpineMid, KinectJoint_SpineShoulder, KinectJoint_Neck,
+    KinectJoint_ShoulderLeft, KinectJoint_ShoulderRight, KinectJoint_HipLeft, KinectJoint_HipRight
+};
+
+struct RecordingSpaceSettings
+{
+    float MaxTorsoJump;         // metres off the constant velocity path per frame
+    int   MinSegmentFrames;     // a switch must be followed by this many clean frames
+    float MaxFitResidual;       // rms metres; a worse rigid fit falls back to translation only
+    float FloorPercentile;      // lowest-foot height taken as the floor
+    bool  Canonical;
+
+    RecordingSpaceSettings() : MaxTorsoJump(0.15f), MinSegmentFrames(3), MaxFitResidual(0.05f), FloorPercentile(0.05f), Canonical(true) {}
+};
+
+struct RecordingSegment
+{
+    int    First;       // first frame of the segment
+    Quat4  R;           // raw segment -> first segment
+    Float3 T;
+    float  Residual;    // rms torso fit error (m) at the switch
+    bool   Rigid;       // false when only the translation could be trusted
+};
+
+struct RecordingSpaceReport
+{
+    std::vector<RecordingSegment> Segments;
+    int                           Outliers;     // flagged frames that were not switches
+    Quat4                         CanonicalR;
+    Float3                        CanonicalT;
+    double                        Ms;
+};
+
+//---------------------------------------------------------------------------
+// Cyclic Jacobi on a symmetric 4x4: a ends up diagonal (the eigenvalues),
+// column k of v is the eigenvector of a[k][k]. Sweeps until the off-diagonal
+// part is negligible against the diagonal; quadratic convergence makes that
+// a handful of sweeps, the cap only guards against NaN input.
+inline void SymmetricEigen4(double a[4][4], double v[4][4])
+{
+    for (int u = 0; u < 4; ++u)
+        for (int w = 0; w < 4; ++w)
+            v[u][w] = u == w ? 1.0 : 0.0;
+    for (int sweep = 0; sweep < 32; ++sweep)
+    {
+        double off = 0.0, diag = 0.0;
+        for (int p = 0; p < 4; ++p)
+        {
+            diag += a[p][p] * a[p][p];
+            for (int q = p + 1; q < 4; ++q)
+                off += a[p][q] * a[p][q];
+        }
+        if (off <= 1e-30 * diag || off == 0.0)
+            return;
+        for (int p = 0; p < 3; ++p)
+            for (int q = p + 1; q < 4; ++q)
+            {
+                if (a[p][q] == 0.0)
+                    continue;
+                // rotation zeroing a[p][q]: t = tan of the angle, the smaller root
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = fabs(theta) > 1e150 ? 0.5 / theta : (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                double c = 1.0 / sqrt(t * t + 1.0), s = t * c;
+                for (int k = 0; k < 4; ++k)
+                {
+                    double kp = a[k][p], kq = a[k][q];
+                    a[k][p] = c * kp - s * kq;
+                    a[k][q] = s * kp + c * kq;
+                }
+                for (int k = 0; k < 4; ++k)
+                {
+                    double pk = a[p][k], qk = a[q][k];
+                    a[p][k] = c * pk - s * qk;
+                    a[q][k] = s * pk + c * qk;
+                }
+                for (int k = 0; k < 4; ++k)
+                {
+                    double kp = v[k][p], kq = v[k][q];
+                    v[k][p] = c * kp - s * kq;
+                    v[k][q] = s * kp + c * kq;
+                }
+            }
+    }
+}
+
+//---------------------------------------------------------------------------
+// Rigid transform taking points b onto points a (a ~ R b + t), least squares
+inline float FitRigid(const Float3* a, const Float3* b, int n, Quat4& r, Float3& t)
+{
+    Float3 ca = MakeFloat3(0.0f, 0.0f, 0.0f), cb = ca;
+    for (int i = 0; i < n; ++i)
+    {
+        ca = ca + a[i];
+        cb = cb + b[i];
+    }
+    ca = ca * (1.0f / n);
+    cb = cb * (1.0f / n);
+
+    double s[3][3] = {};
+    for (int i = 0; i < n; ++i)
+    {
+        Float3 p = b[i] - cb, q = a[i] - ca;
+        double pv[3] = { p.x, p.y, p.z }, qv[3] = { q.x, q.y, q.z };
+        for (int u = 0; u < 3; ++u)
+            for (int v = 0; v < 3; ++v)
+                s[u][v] += pv[u] * qv[v];
+    }
+
+    // Horn: the rotation is the eigenvector of N's largest eigenvalue, as (w, x, y, z)
+    double m[4][4] =
+    {
+        { s[0][0] + s[1][1] + s[2][2], s[1][2] - s[2][1],            s[2][0] - s[0][2],            s[0][1] - s[1][0] },
+        { s[1][2] - s[2][1],            s[0][0] - s[1][1] - s[2][2], s[0][1] + s[1][0],            s[2][0] + s[0][2] },
+        { s[2][0] - s[0][2],            s[0][1] + s[1][0],           -s[0][0] + s[1][1] - s[2][2], s[1][2] + s[2][1] },
+        { s[0][1] - s[1][0],            s[2][0] + s[0][2],            s[1][2] + s[2][1],           -s[0][0] - s[1][1] + s[2][2] }
+    };
+    double e[4][4];
+    SymmetricEigen4(m, e);
+    int col = 0;
+    for (int v = 1; v < 4; ++v)
+        if (m[v][v] > m[col][col])
+            col = v;
+    r = QuatNormalize(MakeQuat4((float)e[1][col], (float)e[2][col], (float)e[3][col], (float)e[0][col]));
+    t = ca - QuatRotate(r, cb);
+
+    double err = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        Float3 d = QuatRotate(r, b[i]) + t - a[i];
+        err += Dot(d, d);
+    }
+    return (float)sqrt(err / n);
+}
+
+//---------------------------------------------------------------------------
+// Rewrites 'clip' with the segment transforms of 'rep'; also how the further
+// bodies of a multi-body recording follow the frame switches found on the first
+inline void ApplyRecordingSpace(KinectClip& clip, const RecordingSpaceReport& rep)
+{
+    if (rep.Segments.empty())
+        return;
+    int stride = clip.FrameStride;
+
+    // per-frame 3x4 matrices, so the rewrite below is branch free
+    std::vector<float> mat((size_t)12 * stride, 0.0f);
+    size_t si = 0;
+    for (int f = 0; f < stride; ++f)
+    {
+        while (si + 1 < rep.Segments.size() && rep.Segments[si + 1].First <= f)
+            ++si;
+        const RecordingSegment& s = rep.Segments[si];
+        Float3 ax = QuatRotate(s.R, MakeFloat3(1.0f, 0.0f, 0.0f));
+        Float3 ay = QuatRotate(s.R, MakeFloat3(0.0f, 1.0f, 0.0f));
+        Float3 az = QuatRotate(s.R, MakeFloat3(0.0f, 0.0f, 1.0f));
+        float m[12] = { ax.x, ax.y, ax.z, ay.x, ay.y, ay.z, az.x, az.y, az.z, s.T.x, s.T.y, s.T.z };
+        for (int c = 0; c < 12; ++c)
+            mat[(size_t)c * stride + f] = m[c];
+    }
+    for (int j = 0; j < KinectJoint_Count; ++j)
+    {
+        size_t o = clip.Index(j, 0);
+        for (int f = 0; f < stride; f += 4)
+        {
+            __m128 m[12];
+            for (int c = 0; c < 12; ++c)
+                m[c] = _mm_loadu_ps(&mat[(size_t)c * stride + f]);
+            Vec3x4 p = LoadVec3x4(&clip.X[o + f], &clip.Y[o + f], &clip.Z[o + f]);
+            Vec3x4 q;
+            q.x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], p.x), _mm_mul_ps(m[3], p.y)), _mm_add_ps(_mm_mul_ps(m[6], p.z), m[9]));
+            q.y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[1], p.x), _mm_mul_ps(m[4], p.y)), _mm_add_ps(_mm_mul_ps(m[7], p.z), m[10]));
+            q.z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[2], p.x), _mm_mul_ps(m[5], p.y)), _mm_add_ps(_mm_mul_ps(m[8], p.z), m[11]));
+            StoreVec3x4(q, &clip.X[o + f], &clip.Y[o + f], &clip.Z[o + f]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+inline void NormalizeRecordingSpace(KinectClip& clip, const RecordingSpaceSettings& settings, RecordingSpaceReport* report)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    int n = clip.NumFrames, stride = clip.FrameStride;
+    RecordingSpaceReport local;
+    RecordingSpaceReport& rep = report ? *report : local;
+    rep.Segments.clear();
+    rep.Outliers = 0;
+    rep.CanonicalR = QuatIdentity();
+    rep.CanonicalT = MakeFloat3(0.0f, 0.0f, 0.0f);
+    rep.Ms = 0.0;
+    if (n < 3)
+        return;
+
+    // torso centroid per frame, four frames at a time
+    std::vector<float> cx(stride + 2, 0.0f), cy(cx.size(), 0.0f), cz(cx.size(), 0.0f);
+    __m128 eighth = _mm_set1_ps(1.0f / 8.0f);
+    for (int f = 0; f < stride; f += 4)
+    {
+        Vec3x4 sum = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+        for (int k = 0; k < 8; ++k)
+        {
+            size_t i = clip.Index(KinectTorsoJoints[k], f);
+            sum = Add4(sum, LoadVec3x4(&clip.X[i], &clip.Y[i], &clip.Z[i]));
+        }
+        StoreVec3x4(Scale4(sum, eighth), &cx[f + 2], &cy[f + 2], &cz[f + 2]);  // shifted by two for the f-2 loads
+    }
+
+    // deviation from the constant velocity path: c[f] - 2 c[f-1] + c[f-2]
+    std::vector<unsigned char> flagged(stride, 0);
+    __m128 limit = _mm_set1_ps(settings.MaxTorsoJump * settings.MaxTorsoJump);
+    for (int f = 0; f < stride; f += 4)
+    {
+        Vec3x4 c0 = LoadVec3x4(&cx[f + 2], &cy[f + 2], &cz[f + 2]);
+        Vec3x4 c1 = LoadVec3x4(&cx[f + 1], &cy[f + 1], &cz[f + 1]);
+        Vec3x4 c2 = LoadVec3x4(&cx[f], &cy[f], &cz[f]);
+        Vec3x4 d = Add4(Sub4(c0, Add4(c1, c1)), c2);
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(Dot4(d, d), limit));
+        for (int l = 0; l < 4; ++l)
+            flagged[f + l] = (mask >> l) & 1;
+    }
+    flagged[0] = flagged[1] = 0;    // no history yet
+
+    // segment transforms, composed back to the first segment
+    RecordingSegment seg = { 0, QuatIdentity(), MakeFloat3(0.0f, 0.0f, 0.0f), 0.0f, true };
+    rep.Segments.push_back(seg);
+    for (int f = 2; f < n; ++f)
+    {
+        if (!flagged[f])
+            continue;
+        // a jump at f also bends the path at f + 1 and f + 2, so the new
+        // segment is checked from f + 2 on; a switch also leaves f + 1 off
+        // the old path, while a lone spike returns to it
+        bool settled = f + settings.MinSegmentFrames + 1 < n;
+        for (int k = 2; settled && k <= settings.MinSegmentFrames + 1; ++k)
+            settled = !flagged[f + k];
+        if (settled)
+        {
+            Float3 c1 = MakeFloat3(cx[f + 1], cy[f + 1], cz[f + 1]), c2 = MakeFloat3(cx[f], cy[f], cz[f]);
+            Float3 next = MakeFloat3(cx[f + 3], cy[f + 3], cz[f + 3]);
+            Float3 miss = next - (c1 * 3.0f - c2 * 2.0f);
+            settled = Dot(miss, miss) > settings.MaxTorsoJump * settings.MaxTorsoJump;
+        }
+        if (!settled)
+        {
+            ++rep.Outliers;
+            f += 2;
+            continue;
+        }
+
+        // where the torso was heading vs where the new segment puts it
+        Float3 a[8], b[8];
+        for (int k = 0; k < 8; ++k)
+        {
+            int j = KinectTorsoJoints[k];
+            a[k] = clip.Get(j, f - 1) * 2.0f - clip.Get(j, f - 2);
+            b[k] = clip.Get(j, f);
+        }
+        Quat4 r;
+        Float3 t;
+        float residual = FitRigid(a, b, 8, r, t);
+        bool rigid = residual <= settings.MaxFitResidual;
+        if (!rigid)
+        {
+            // the torso changed shape across the switch (e.g. legs leaving
+            // the view); a rotation fitted to it would tilt the whole tail
+            Float3 d = MakeFloat3(0.0f, 0.0f, 0.0f);
+            for (int k = 0; k < 8; ++k)
+                d = d + (a[k] - b[k]);
+            r = QuatIdentity();
+            t = d * (1.0f / 8.0f);
+        }
+
+        const RecordingSegment& prev = rep.Segments.back();
+        seg.First = f;
+        seg.R = QuatNormalize(QuatMul(prev.R, r));
+        seg.T = QuatRotate(prev.R, t) + prev.T;
+        seg.Residual = residual;
+        seg.Rigid = rigid;
+        rep.Segments.push_back(seg);
+        ++f;
+    }
+
+    // canonical space on top of the stitched recording
+    if (settings.Canonical)
+    {
+        Float3 up = MakeFloat3(0.0f, 0.0f, 0.0f);
+        size_t si = 0;
+        for (int f = 0; f < n; ++f)
+        {
+            while (si + 1 < rep.Segments.size() && rep.Segments[si + 1].First <= f)
+                ++si;
+            up = up + QuatRotate(rep.Segments[si].R, clip.Get(KinectJoint_SpineShoulder, f) - clip.Get(KinectJoint_SpineBase, f));
+        }
+        if (Dot(up, up) > 1e-8f)
+            rep.CanonicalR = QuatFromTo(Normalize(up), MakeFloat3(0.0f, 1.0f, 0.0f));
+
+        std::vector<float> floor(n);
+        si = 0;
+        for (int f = 0; f < n; ++f)
+        {
+            while (si + 1 < rep.Segments.size() && rep.Segments[si + 1].First <= f)
+                ++si;
+            const RecordingSegment& s = rep.Segments[si];
+            Float3 l = QuatRotate(rep.CanonicalR, QuatRotate(s.R, clip.Get(KinectJoint_FootLeft, f)) + s.T);
+            Float3 r = QuatRotate(rep.CanonicalR, QuatRotate(s.R, clip.Get(KinectJoint_FootRight, f)) + s.T);
+            floor[f] = std::min(l.y, r.y);
+        }
+        size_t k = (size_t)(settings.FloorPercentile * (n - 1));
+        std::nth_element(floor.begin(), floor.begin() + k, floor.end());
+        Float3 pelvis = QuatRotate(rep.CanonicalR, QuatRotate(rep.Segments[0].R, clip.Get(KinectJoint_SpineBase, 0)) + rep.Segments[0].T);
+        rep.CanonicalT = MakeFloat3(-pelvis.x, -floor[k], -pelvis.z);
+
+        for (size_t i = 0; i < rep.Segments.size(); ++i)
+        {
+            RecordingSegment& s = rep.Segments[i];
+            s.T = QuatRotate(rep.CanonicalR, s.T) + rep.CanonicalT;
+            s.R = QuatNormalize(QuatMul(rep.CanonicalR, s.R));
+        }
+    }
+
+    ApplyRecordingSpace(clip, rep);
+    rep.Ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+inline void FormatRecordingSpaceReport(const RecordingSpaceReport& rep, std::string& out)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "recording space: %d segment(s), %d outlier frame(s), %.2f ms\n",
+             (int)rep.Segments.size(), rep.Outliers, rep.Ms);
+    out = line;
+    for (size_t i = 1; i < rep.Segments.size(); ++i)
+    {
+        const RecordingSegment& s = rep.Segments[i];
+        snprintf(line, sizeof(line), "  switch at frame %d, torso fit rms %.1f mm%s\n", s.First, s.Residual * 1000.0f,
+                 s.Rigid ? "" : " (translation only)");
+        out += line;
+    }
+}
+
+#endif // RECORDING_SPACE_H
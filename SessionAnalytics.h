@@ -0,0 +1,647 @@
+#ifndef SESSION_ANALYTICS_H
+#define SESSION_ANALYTICS_H
+
+// Per-session exercise analytics for recordings in the motion file format.
+//
+// AnalyzeSession loads one recording (text or *.kmc), cleans it the same way the scene
+// does (space normalization, gap fill, bone lengths), computes the joint
+// angles and reduces them to one SessionSummary:
+//   reps         hysteresis on the exercise's primary angle; the angle
+//                named by the 'training' parameter, or the one with the
+//                widest range when the named one barely moves (the sample
+//                recording is labelled HipFlexionRight but is a bilateral
+//                arm raise). Ranges here are
+//                percentiles, so a few mis-tracked frames cannot pick the
+//                angle or move the thresholds
+//   violations   episodes (MinViolationFrames or longer) of the rules given
+//                in the file's [Parameters] section, see SessionRule
+//   ROM          min / max / peak velocity of every JointAngle
+//   smoothness   log dimensionless jerk and velocity peaks per rep of the
+//                primary angle
+// All per-session memory lives in a SessionScratch that the caller reuses,
+// so a batch needs one scratch per thread regardless of its size.
+// WriteSessionColumns stores a batch of summaries column by column.
+
+#include "../Common/GapFilter.h"
+#include "../Common/JointAngles.h"
+#include "../Common/KinectBoneLengths.h"
+#include "../Common/MotionCodec.h"
+#include "../Common/RecordingSpace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Cleans a freshly loaded recording in place: one space, gaps filled,
+// calibrated bone lengths. 'bones' receives the calibration.
+inline void CleanRecording(KinectClip& clip, KinectBoneLengths& bones, RecordingSpaceReport* space, GapFilterStats* gaps)
+{
+    NormalizeRecordingSpace(clip, RecordingSpaceSettings(), space);
+    bones.Calibrate(clip, 0, 30);
+    FillClipGaps(clip, GapFilterSettings(), &bones, gaps);
+    bones.ApplyClip(clip);
+}
+
+// The same for a further body of a multi-body recording (LoadMotionBodies):
+// it follows the space found on the first body, 'space' from that body's
+// CleanRecording, so the people keep their places relative to each other
+inline void CleanRecordingBody(KinectClip& clip, const RecordingSpaceReport& space, KinectBoneLengths& bones, GapFilterStats* gaps)
+{
+    ApplyRecordingSpace(clip, space);
+    bones.Calibrate(clip, 0, 30);
+    FillClipGaps(clip, GapFilterSettings(), &bones, gaps);
+    bones.ApplyClip(clip);
+}
+
+//---------------------------------------------------------------------------
+// Rules, named as in the [Parameters] section:
+//   BentKnee<Side>: target tolerance
+//       interior knee angle (180 = straight) must stay within tolerance of
+//       target
+//   WrongPlane<Part>: ax ay az  tx ty tz  mx my mz
+//       plane orientation, per-axis tolerance and axis mask. x is the
+//       sagittal axis, z the frontal one. Only the masked tolerances are
+//       used; UpperBody limits the trunk's lean from vertical, the arm rules
+//       limit how far the upper arm leaves the movement's plane while it is
+//       raised and moving in that direction (abduction: sideways, flexion:
+//       forwards, extension: backwards).
+enum SessionRule
+{
+    SessionRule_BentKneeLeft,
+    SessionRule_BentKneeRight,
+    SessionRule_WrongPlaneUpperBody,
+    SessionRule_WrongPlaneAbductionLeft,
+    SessionRule_WrongPlaneAbductionRight,
+    SessionRule_WrongPlaneFlexionLeft,
+    SessionRule_WrongPlaneFlexionRight,
+    SessionRule_WrongPlaneExtensionLeft,
+    SessionRule_WrongPlaneExtensionRight,
+    SessionRule_Count
+};
+
+static const char* const SessionRuleNames[SessionRule_Count] =
+{
+    "BentKneeLeft", "BentKneeRight", "WrongPlaneUpperBody",
+    "WrongPlaneAbductionLeft", "WrongPlaneAbductionRight",
+    "WrongPlaneFlexionLeft", "WrongPlaneFlexionRight",
+    "WrongPlaneExtensionLeft", "WrongPlaneExtensionRight"
+};
+
+struct SessionRuleConfig
+{
+    bool  Enabled;
+    float Target[3];
+    float Tolerance[3];
+    bool  Axis[3];
+};
+
+inline void ParseSessionRules(const KinectClip& clip, SessionRuleConfig* rules)
+{
+    for (int r = 0; r < SessionRule_Count; ++r)
+    {
+        SessionRuleConfig& rule = rules[r];
+        rule = SessionRuleConfig();
+        const char* value = clip.FindParameter(SessionRuleNames[r]);
+        if (!value)
+            continue;
+        float v[9] = {};
+        int n = sscanf(value, "%f %f %f %f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]);
+        if (n == 2)
+        {
+            rule.Enabled = true;
+            rule.Target[0] = v[0];
+            rule.Tolerance[0] = v[1];
+            rule.Axis[0] = true;
+        }
+        else if (n == 9)
+        {
+            rule.Enabled = true;
+            for (int a = 0; a < 3; ++a)
+            {
+                rule.Target[a] = v[a];
+                rule.Tolerance[a] = v[3 + a];
+                rule.Axis[a] = v[6 + a] != 0.0f;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+struct SessionSettings
+{
+    float MinRepRange;          // degrees; a named primary angle must move at least this much
+    float MinRepShare;          // ... and at least this fraction of the widest range
+    float RangePercentile;      // robust range is [p, 1 - p] of the smoothed angle
+    float RepProminence;        // a rep rises and falls this fraction of the robust range around its peak
+    float MinRepSeconds;        // peak width at half height; narrower peaks are tracking glitches
+    int   MinViolationFrames;   // shorter rule breaks are tracking noise
+    float MinElevation;         // degrees; arm plane rules apply above this
+
+    SessionSettings() : MinRepRange(20.0f), MinRepShare(0.5f), RangePercentile(0.02f), RepProminence(0.3f), MinRepSeconds(0.5f), MinViolationFrames(5), MinElevation(30.0f) {}
+};
+
+struct SessionSummary
+{
+    std::string     File;
+    bool            Loaded;
+    int             Frames;
+    float           Duration;               // seconds
+    int             ExpectedReps;           // set x repetition, 0 when not given
+    int             Reps;
+    int             PrimaryAngle;           // JointAngle
+    float           Jerk;                   // log dimensionless jerk, closer to 0 is smoother
+    float           PeaksPerRep;            // velocity peaks; 2 for a clean up-and-down rep
+    int             Violations[SessionRule_Count];  // episodes, -1 when the rule is not configured
+    JointAngleRange Ranges[JointAngle_Count];
+    int             JointsFilled;
+    float           Ms;                     // load + analysis
+};
+
+struct SessionScratch
+{
+    KinectClip        Clip;
+    KinectBoneLengths Bones;
+    JointAngleTable   Angles;
+    std::vector<float> Deviation;           // one rule's per-frame excess over its limit
+    std::vector<float> Sorted;              // percentile scratch
+    float              RobustMin[JointAngle_Count], RobustMax[JointAngle_Count];
+};
+
+// Angle (degrees) of unit direction d away from the plane with unit normal n
+inline float AngleFromPlane(const Float3& d, const Float3& n)
+{
+    float s = fabsf(Dot(d, n));
+    return asinf(s > 1.0f ? 1.0f : s) * 57.2957795f;
+}
+
+// Fills scratch.Deviation with how far each frame breaks the rule, in
+// degrees beyond its tolerance (<= 0 when the frame is fine)
+inline void EvaluateSessionRule(int r, const SessionRuleConfig& rule, const SessionSettings& settings, SessionScratch& scratch)
+{
+    const KinectClip& clip = scratch.Clip;
+    const JointAngleTable& angles = scratch.Angles;
+    std::vector<float>& dev = scratch.Deviation;
+    dev.assign(clip.NumFrames, 0.0f);
+
+    if (r == SessionRule_BentKneeLeft || r == SessionRule_BentKneeRight)
+    {
+        const float* knee = angles.Column(r == SessionRule_BentKneeLeft ? JointAngle_KneeLeft : JointAngle_KneeRight, JointAngleChannel_Smoothed);
+        for (int f = 0; f < clip.NumFrames; ++f)
+            dev[f] = fabsf(180.0f - knee[f] - rule.Target[0]) - rule.Tolerance[0];
+        return;
+    }
+
+    bool left = r == SessionRule_WrongPlaneAbductionLeft || r == SessionRule_WrongPlaneFlexionLeft || r == SessionRule_WrongPlaneExtensionLeft;
+    int shoulder = left ? KinectJoint_ShoulderLeft : KinectJoint_ShoulderRight;
+    int elbow = left ? KinectJoint_ElbowLeft : KinectJoint_ElbowRight;
+    float cosMinElevation = cosf(settings.MinElevation / 57.2957795f);
+    Float3 worldUp = MakeFloat3(0.0f, 1.0f, 0.0f);
+    for (int f = 0; f < clip.NumFrames; ++f)
+    {
+        Float3 up = Normalize(clip.Get(KinectJoint_SpineShoulder, f) - clip.Get(KinectJoint_SpineBase, f));
+        Float3 right = clip.Get(KinectJoint_ShoulderRight, f) - clip.Get(KinectJoint_ShoulderLeft, f);
+        right = Normalize(right - up * Dot(right, up));
+        Float3 forward = Cross(up, right);
+
+        if (r == SessionRule_WrongPlaneUpperBody)
+        {
+            // lean towards the front (about x) and the side (about z) of the canonical vertical
+            float excess = -1e9f;
+            Float3 normals[3] = { right, up, forward };
+            for (int a = 0; a < 3; a += 2)
+            {
+                if (!rule.Axis[a])
+                    continue;
+                Float3 n = Normalize(normals[a] - worldUp * Dot(normals[a], worldUp));
+                Float3 inPlane = Normalize(up - n * Dot(up, n));
+                float lean = acosf(std::min(1.0f, std::max(-1.0f, Dot(inPlane, worldUp)))) * 57.2957795f;
+                excess = std::max(excess, lean - rule.Tolerance[a]);
+            }
+            dev[f] = excess;
+            continue;
+        }
+
+        Float3 arm = Normalize(clip.Get(elbow, f) - clip.Get(shoulder, f));
+        if (-Dot(arm, up) > cosMinElevation)
+        {
+            dev[f] = -1.0f;     // hanging arm, no plane to leave
+            continue;
+        }
+        float side = fabsf(Dot(arm, right)), front = Dot(arm, forward);
+        bool applies, frontal;
+        if (r == SessionRule_WrongPlaneAbductionLeft || r == SessionRule_WrongPlaneAbductionRight)
+            applies = side >= fabsf(front), frontal = true;
+        else if (r == SessionRule_WrongPlaneFlexionLeft || r == SessionRule_WrongPlaneFlexionRight)
+            applies = front > side, frontal = false;
+        else
+            applies = -front > side, frontal = false;
+        if (!applies)
+        {
+            dev[f] = -1.0f;
+            continue;
+        }
+        // abduction leaves the frontal plane (normal: forward), flexion and
+        // extension the sagittal one (normal: right)
+        int axis = frontal ? 2 : 0;
+        float tolerance = rule.Axis[axis] ? rule.Tolerance[axis] : std::max(rule.Tolerance[0], std::max(rule.Tolerance[1], rule.Tolerance[2]));
+        dev[f] = AngleFromPlane(arm, frontal ? forward : right) - tolerance;
+    }
+}
+
+// Runs of at least minFrames frames with a positive deviation
+inline int CountViolationEpisodes(const std::vector<float>& dev, int numFrames, int minFrames)
+{
+    int episodes = 0, run = 0;
+    for (int f = 0; f < numFrames; ++f)
+    {
+        run = dev[f] > 0.0f ? run + 1 : 0;
+        if (run == minFrames)
+            ++episodes;
+    }
+    return episodes;
+}
+
+inline void ComputeRobustRanges(const JointAngleTable& angles, float percentile, std::vector<float>& sorted, float* robustMin, float* robustMax)
+{
+    int n = angles.NumFrames;
+    int lo = (int)(percentile * (n - 1)), hi = n - 1 - lo;
+    for (int a = 0; a < JointAngle_Count; ++a)
+    {
+        const float* angle = angles.Column(a, JointAngleChannel_Smoothed);
+        sorted.assign(angle, angle + n);
+        std::nth_element(sorted.begin(), sorted.begin() + lo, sorted.end());
+        robustMin[a] = sorted[lo];
+        std::nth_element(sorted.begin() + lo, sorted.begin() + hi, sorted.end());
+        robustMax[a] = sorted[hi];
+    }
+}
+
+inline void ComputeRobustRanges(const SessionSettings& settings, SessionScratch& scratch)
+{
+    ComputeRobustRanges(scratch.Angles, settings.RangePercentile, scratch.Sorted, scratch.RobustMin, scratch.RobustMax);
+}
+
+inline int ChoosePrimaryAngle(const KinectClip& clip, const float* robustMin, const float* robustMax, const SessionSettings& settings)
+{
+    int widest = 0;
+    for (int a = 1; a < JointAngle_Count; ++a)
+        if (robustMax[a] - robustMin[a] > robustMax[widest] - robustMin[widest])
+            widest = a;
+    const char* training = clip.FindParameter("training");
+    for (int a = 0; training && a < JointAngle_Count; ++a)
+    {
+        if (!strstr(training, JointAngleNames[a]))
+            continue;
+        float range = robustMax[a] - robustMin[a];
+        if (range >= settings.MinRepRange && range >= settings.MinRepShare * (robustMax[widest] - robustMin[widest]))
+            return a;
+    }
+    return widest;
+}
+
+inline int ChoosePrimaryAngle(const KinectClip& clip, const SessionScratch& scratch, const SessionSettings& settings)
+{
+    return ChoosePrimaryAngle(clip, scratch.RobustMin, scratch.RobustMax, settings);
+}
+
+// Reps are found by peak prominence, so a submaximal rep counts as long as
+// it rises and falls by RepProminence of the robust range (and at least
+// MinRepRange degrees) around its own peak. Valleys and peaks alternate: a
+// valley is confirmed once the angle climbs delta above it, a peak once it
+// drops delta below. Each peak is then checked against the higher of its
+// two valleys; narrower than MinRepSeconds at half that height it is a
+// tracking glitch. A rep's start is the rest frame its rise starts from, the
+// lowest frame since the previous rep's peak. Returns the rep count; starts
+// may be null.
+inline int FindRepPeaks(const float* angle, int numFrames, float sampleRate, float min, float max, const SessionSettings& settings, std::vector<int>* starts)
+{
+    if (starts)
+        starts->clear();
+    float delta = settings.RepProminence * (max - min);
+    if (delta < settings.MinRepRange)
+        delta = settings.MinRepRange;
+    int minWidth = (int)(settings.MinRepSeconds * sampleRate + 0.5f);
+
+    int reps = 0, rest = 0;     // rest: first frame after the last rep's peak
+    auto accept = [&](int v0, int p, int v1)
+    {
+        float base = angle[v0] > angle[v1] ? angle[v0] : angle[v1];
+        float half = angle[p] - 0.5f * (angle[p] - base);
+        int l = p, r = p;
+        while (l > v0 && angle[l - 1] > half)
+            --l;
+        while (r < v1 && angle[r + 1] > half)
+            ++r;
+        if (r - l + 1 < minWidth)
+            return;
+        ++reps;
+        if (starts)
+        {
+            int s = rest;
+            for (int f = rest + 1; f <= p; ++f)
+                if (angle[f] <= angle[s])
+                    s = f;
+            starts->push_back(s);
+        }
+        rest = p + 1;
+    };
+
+    bool seekValley = true;
+    int lo = 0, hi = 0, valley = -1, peak = -1;
+    for (int f = 1; f < numFrames; ++f)
+    {
+        if (seekValley)
+        {
+            if (angle[f] < angle[lo])
+                lo = f;
+            else if (angle[f] >= angle[lo] + delta)
+            {
+                if (peak >= 0)
+                    accept(valley, peak, lo);
+                valley = lo;
+                peak = -1;
+                hi = f;
+                seekValley = false;
+            }
+        }
+        else if (angle[f] > angle[hi])
+            hi = f;
+        else if (angle[f] <= angle[hi] - delta)
+        {
+            peak = hi;
+            lo = f;
+            seekValley = true;
+        }
+    }
+    if (peak >= 0)
+        accept(valley, peak, lo);
+    return reps;
+}
+
+inline int CountReps(const float* angle, int numFrames, float sampleRate, float min, float max, const SessionSettings& settings)
+{
+    return FindRepPeaks(angle, numFrames, sampleRate, min, max, settings, nullptr);
+}
+
+// Rep starts of a cleaned recording on its primary angle; returns that angle
+inline int FindRecordingReps(const KinectClip& clip, const JointAngleTable& angles, const SessionSettings& settings, std::vector<int>& starts)
+{
+    std::vector<float> sorted;
+    float robustMin[JointAngle_Count], robustMax[JointAngle_Count];
+    ComputeRobustRanges(angles, settings.RangePercentile, sorted, robustMin, robustMax);
+    int p = ChoosePrimaryAngle(clip, robustMin, robustMax, settings);
+    FindRepPeaks(angles.Column(p, JointAngleChannel_Smoothed), angles.NumFrames, clip.SampleRate, robustMin[p], robustMax[p], settings, &starts);
+    return p;
+}
+
+// Log dimensionless jerk of an angular velocity signal:
+//   -ln( T^3 / peak^2 * integral(jerk^2 dt) )
+inline float LogDimensionlessJerk(const float* velocity, int numFrames, float sampleRate, float peak)
+{
+    if (numFrames < 3 || peak <= 0.0f)
+        return 0.0f;
+    double sum = 0.0;
+    float rate2 = sampleRate * sampleRate;
+    for (int f = 1; f + 1 < numFrames; ++f)
+    {
+        double jerk = (velocity[f + 1] - 2.0f * velocity[f] + velocity[f - 1]) * rate2;
+        sum += jerk * jerk;
+    }
+    double T = (numFrames - 1) / sampleRate;
+    return (float)-log(T * T * T / ((double)peak * peak) * sum / sampleRate);
+}
+
+inline int CountVelocityPeaks(const float* velocity, int numFrames, float peak)
+{
+    float floor = 0.1f * peak;
+    int peaks = 0;
+    for (int f = 1; f + 1 < numFrames; ++f)
+    {
+        float v = fabsf(velocity[f]);
+        if (v > floor && v >= fabsf(velocity[f - 1]) && v > fabsf(velocity[f + 1]))
+            ++peaks;
+    }
+    return peaks;
+}
+
+inline bool AnalyzeSession(const std::string& path, const SessionSettings& settings, SessionScratch& scratch, SessionSummary& out)
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    out = SessionSummary();
+    out.File = path;
+    for (int r = 0; r < SessionRule_Count; ++r)
+        out.Violations[r] = -1;
+    out.PrimaryAngle = -1;
+
+    KinectClip& clip = scratch.Clip;
+    out.Loaded = LoadRecording(path, clip) && clip.NumFrames >= 2;
+    if (!out.Loaded)
+        return false;
+
+    GapFilterStats gaps;
+    CleanRecording(clip, scratch.Bones, nullptr, &gaps);
+    ComputeJointAngles(clip, scratch.Angles);
+    const JointAngleTable& angles = scratch.Angles;
+
+    out.Frames = clip.NumFrames;
+    out.Duration = clip.Duration();
+    out.JointsFilled = gaps.JointsFilled;
+    for (int a = 0; a < JointAngle_Count; ++a)
+        out.Ranges[a] = angles.Ranges[a];
+
+    const char* set = clip.FindParameter("set");
+    const char* repetition = clip.FindParameter("repetition");
+    out.ExpectedReps = set && repetition ? atoi(set) * atoi(repetition) : 0;
+
+    ComputeRobustRanges(settings, scratch);
+    int p = out.PrimaryAngle = ChoosePrimaryAngle(clip, scratch, settings);
+    const JointAngleRange& range = angles.Ranges[p];
+    const float* velocity = angles.Column(p, JointAngleChannel_Velocity);
+    out.Reps = CountReps(angles.Column(p, JointAngleChannel_Smoothed), clip.NumFrames, clip.SampleRate, scratch.RobustMin[p], scratch.RobustMax[p], settings);
+    out.Jerk = LogDimensionlessJerk(velocity, clip.NumFrames, clip.SampleRate, range.PeakVelocity);
+    out.PeaksPerRep = (float)CountVelocityPeaks(velocity, clip.NumFrames, range.PeakVelocity) / (out.Reps > 0 ? out.Reps : 1);
+
+    SessionRuleConfig rules[SessionRule_Count];
+    ParseSessionRules(clip, rules);
+    for (int r = 0; r < SessionRule_Count; ++r)
+    {
+        if (!rules[r].Enabled)
+            continue;
+        EvaluateSessionRule(r, rules[r], settings, scratch);
+        out.Violations[r] = CountViolationEpisodes(scratch.Deviation, clip.NumFrames, settings.MinViolationFrames);
+    }
+
+    out.Ms = (float)std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Column store for a batch of summaries:
+//   "MCOL" u32 version, u32 columns, u32 rows
+//   per column: u8 type (0 int32, 1 float32, 2 string), u16 name length, name
+//   per column, in the same order: rows values (strings as u32 length + bytes)
+// Every field is little endian.
+enum SessionColumnType
+{
+    SessionColumn_Int,
+    SessionColumn_Float,
+    SessionColumn_String
+};
+
+struct SessionColumn
+{
+    std::string       Name;
+    SessionColumnType Type;
+    int               Field;        // what the column holds, see SessionColumnValue
+    int               Index;        // rule or angle
+};
+
+enum SessionField
+{
+    SessionField_File, SessionField_Frames, SessionField_Duration, SessionField_ExpectedReps, SessionField_Reps,
+    SessionField_PrimaryAngle, SessionField_Jerk, SessionField_PeaksPerRep, SessionField_JointsFilled, SessionField_Ms,
+    SessionField_Violations, SessionField_RangeMin, SessionField_RangeMax, SessionField_PeakVelocity
+};
+
+inline void GetSessionColumns(std::vector<SessionColumn>& columns)
+{
+    static const SessionColumn fixed[] =
+    {
+        { "file", SessionColumn_String, SessionField_File, 0 },
+        { "frames", SessionColumn_Int, SessionField_Frames, 0 },
+        { "duration", SessionColumn_Float, SessionField_Duration, 0 },
+        { "expectedReps", SessionColumn_Int, SessionField_ExpectedReps, 0 },
+        { "reps", SessionColumn_Int, SessionField_Reps, 0 },
+        { "primaryAngle", SessionColumn_String, SessionField_PrimaryAngle, 0 },
+        { "jerk", SessionColumn_Float, SessionField_Jerk, 0 },
+        { "peaksPerRep", SessionColumn_Float, SessionField_PeaksPerRep, 0 },
+        { "jointsFilled", SessionColumn_Int, SessionField_JointsFilled, 0 },
+        { "ms", SessionColumn_Float, SessionField_Ms, 0 },
+    };
+    columns.assign(fixed, fixed + sizeof(fixed) / sizeof(fixed[0]));
+    for (int r = 0; r < SessionRule_Count; ++r)
+    {
+        SessionColumn c = { SessionRuleNames[r], SessionColumn_Int, SessionField_Violations, r };
+        columns.push_back(c);
+    }
+    for (int a = 0; a < JointAngle_Count; ++a)
+    {
+        SessionColumn mn = { std::string(JointAngleNames[a]) + "Min", SessionColumn_Float, SessionField_RangeMin, a };
+        SessionColumn mx = { std::string(JointAngleNames[a]) + "Max", SessionColumn_Float, SessionField_RangeMax, a };
+        SessionColumn pv = { std::string(JointAngleNames[a]) + "PeakVelocity", SessionColumn_Float, SessionField_PeakVelocity, a };
+        columns.push_back(mn);
+        columns.push_back(mx);
+        columns.push_back(pv);
+    }
+}
+
+inline float SessionColumnValue(const SessionSummary& s, const SessionColumn& c)
+{
+    switch (c.Field)
+    {
+    case SessionField_Frames:       return (float)s.Frames;
+    case SessionField_Duration:     return s.Duration;
+    case SessionField_ExpectedReps: return (float)s.ExpectedReps;
+    case SessionField_Reps:         return (float)s.Reps;
+    case SessionField_Jerk:         return s.Jerk;
+    case SessionField_PeaksPerRep:  return s.PeaksPerRep;
+    case SessionField_JointsFilled: return (float)s.JointsFilled;
+    case SessionField_Ms:           return s.Ms;
+    case SessionField_Violations:   return (float)s.Violations[c.Index];
+    case SessionField_RangeMin:     return s.Ranges[c.Index].Min;
+    case SessionField_RangeMax:     return s.Ranges[c.Index].Max;
+    case SessionField_PeakVelocity: return s.Ranges[c.Index].PeakVelocity;
+    }
+    return 0.0f;
+}
+
+inline std::string SessionColumnString(const SessionSummary& s, const SessionColumn& c)
+{
+    if (c.Field == SessionField_File)
+        return s.File;
+    return s.PrimaryAngle >= 0 ? JointAngleNames[s.PrimaryAngle] : "";
+}
+
+inline bool WriteSessionColumns(const std::vector<SessionSummary>& sessions, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    std::vector<SessionColumn> columns;
+    GetSessionColumns(columns);
+    uint32_t header[4];
+    memcpy(header, "MCOL", 4);
+    header[1] = 1;
+    header[2] = (uint32_t)columns.size();
+    header[3] = (uint32_t)sessions.size();
+    fwrite(header, sizeof(header), 1, file);
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        uint8_t type = (uint8_t)columns[c].Type;
+        uint16_t len = (uint16_t)columns[c].Name.size();
+        fwrite(&type, 1, 1, file);
+        fwrite(&len, 2, 1, file);
+        fwrite(columns[c].Name.data(), 1, len, file);
+    }
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        const SessionColumn& col = columns[c];
+        for (size_t i = 0; i < sessions.size(); ++i)
+        {
+            if (col.Type == SessionColumn_String)
+            {
+                std::string v = SessionColumnString(sessions[i], col);
+                uint32_t len = (uint32_t)v.size();
+                fwrite(&len, 4, 1, file);
+                fwrite(v.data(), 1, len, file);
+            }
+            else if (col.Type == SessionColumn_Int)
+            {
+                int32_t v = (int32_t)SessionColumnValue(sessions[i], col);
+                fwrite(&v, 4, 1, file);
+            }
+            else
+            {
+                float v = SessionColumnValue(sessions[i], col);
+                fwrite(&v, 4, 1, file);
+            }
+        }
+    }
+    return fclose(file) == 0;
+}
+
+// Same table as CSV, one row per session
+inline bool WriteSessionCsv(const std::vector<SessionSummary>& sessions, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+    std::vector<SessionColumn> columns;
+    GetSessionColumns(columns);
+    for (size_t c = 0; c < columns.size(); ++c)
+        fprintf(file, c ? ",%s" : "%s", columns[c].Name.c_str());
+    fputc('\n', file);
+    for (size_t i = 0; i < sessions.size(); ++i)
+    {
+        for (size_t c = 0; c < columns.size(); ++c)
+        {
+            const SessionColumn& col = columns[c];
+            if (c)
+                fputc(',', file);
+            if (col.Type == SessionColumn_String)
+                fprintf(file, "\"%s\"", SessionColumnString(sessions[i], col).c_str());
+            else if (col.Type == SessionColumn_Int)
+                fprintf(file, "%d", (int)SessionColumnValue(sessions[i], col));
+            else
+                fprintf(file, "%.3f", SessionColumnValue(sessions[i], col));
+        }
+        fputc('\n', file);
+    }
+    return fclose(file) == 0;
+}
+
+#endif // SESSION_ANALYTICS_H
@@ -0,0 +1,113 @@
+// Headless batch analytics over an archive of motion recordings.
+//
+//   SessionAnalyticsTool [-j threads] [-o sessions.mcol] [-csv sessions.csv] [-index] <directory | file>...
+//
+// Every *.txt or *.kmc under the given directories (not recursive) and every file
+// named directly is one session. Sessions are sharded over a work-stealing
+// pool; each worker streams one recording at a time through its own
+// SessionScratch, so memory is bounded by the thread count, not the archive
+// size. The summaries are written as one column store (and optionally CSV)
+// in input order. -index also writes each recording's window index next to
+// it (<recording>.widx).
+//
+// Build standalone, no OVR / GL needed:
+//   cl /O2 /EHsc /arch:AVX2 SessionAnalyticsTool.cpp
+//   g++ -std=c++14 -O2 -mavx2 -pthread SessionAnalyticsTool.cpp
+
+#include "../Common/RecordingArchive.h"
+#include "../Common/SessionAnalytics.h"
+#include "../Common/WindowIndex.h"
+#include "../Common/WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static void PrintUsage()
+{
+    fprintf(stderr, "usage: SessionAnalyticsTool [-j threads] [-o sessions.mcol] [-csv sessions.csv] [-index] <directory | file>...\n");
+}
+
+int main(int argc, char** argv)
+{
+    int threads = 0;
+    const char* columnPath = "sessions.mcol";
+    const char* csvPath = nullptr;
+    bool writeIndex = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc)
+            columnPath = argv[++i];
+        else if (arg == "-csv" && i + 1 < argc)
+            csvPath = argv[++i];
+        else if (arg == "-index")
+            writeIndex = true;
+        else if (arg[0] == '-')
+        {
+            PrintUsage();
+            return 2;
+        }
+        else
+            CollectRecordings(arg, files);
+    }
+    if (files.empty())
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    WorkStealingPool pool(threads);
+    std::vector<SessionScratch> scratch(pool.NumThreads());
+    std::vector<WindowIndex> indexes(writeIndex ? pool.NumThreads() : 0);
+    std::vector<SessionSummary> sessions(files.size());
+    std::atomic<int> indexFailures(0);
+    SessionSettings settings;
+    pool.Run((int)files.size(), [&](int index, int worker)
+    {
+        if (!AnalyzeSession(files[index], settings, scratch[worker], sessions[index]) || !writeIndex)
+            return;
+        BuildWindowIndex(scratch[worker].Clip, scratch[worker].Angles, indexes[worker]);
+        if (!WriteWindowIndex(indexes[worker], WindowIndexPath(files[index]).c_str()))
+            ++indexFailures;
+    });
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    int failed = 0;
+    double frames = 0.0;
+    for (size_t i = 0; i < sessions.size(); ++i)
+    {
+        if (!sessions[i].Loaded)
+        {
+            fprintf(stderr, "cannot read %s\n", sessions[i].File.c_str());
+            ++failed;
+        }
+        frames += sessions[i].Frames;
+    }
+
+    if (indexFailures)
+        fprintf(stderr, "%d window index(es) could not be written\n", (int)indexFailures);
+
+    if (!WriteSessionColumns(sessions, columnPath))
+    {
+        fprintf(stderr, "cannot write %s\n", columnPath);
+        return 1;
+    }
+    if (csvPath && !WriteSessionCsv(sessions, csvPath))
+    {
+        fprintf(stderr, "cannot write %s\n", csvPath);
+        return 1;
+    }
+
+    printf("%d session(s), %d unreadable, %.0f frames on %d thread(s) in %.1f ms (%.0f sessions/min, %d steals)\n",
+           (int)sessions.size(), failed, frames, pool.NumThreads(), ms, sessions.size() * 60000.0 / ms, pool.StealCount());
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,422 @@
+#ifndef SESSION_RECORDER_H
+#define SESSION_RECORDER_H
+
+// Records a therapy session from the render loop without touching the disk
+// on the render thread.
+//
+// Record() is one SkeletonRing push. A writer thread drains the ring,
+// codes the frames with the stream coder of MotionCodec.h (key frame at
+// every block start, ~4 bits per coordinate) and appends them to a journal
+// (<path>.kmj) as self-checking records:
+//
+//   header   "KMJ1" float sampleRate, u32 parameters, parameters as in *.kmc
+//   record   "KMJB" u32 firstFrame, u32 frames, u32 bytes, u32 crc32, f64 firstTime, data
+//
+// A record is a whole block, so each one decodes on its own. Blocks close at
+// BlockFrames or at a checkpoint (every SyncInterval seconds), which writes
+// what is pending and syncs the file; a crash loses at most the frames since
+// the last checkpoint. While frames arrive faster than checkpoints come
+// (several bodies, long intervals) they are written in 4 KB multiples once
+// BatchBytes are pending, so the file grows in large page-aligned writes.
+// The file is unbuffered: a batch is one write call.
+//
+// Stop() only tells the writer to finish: it drains the ring, closes the
+// journal, reads it back, writes the session as a normal *.kmc (fixed
+// blocks, offset table) and removes the journal, all on its own thread
+// (a 30 minute session takes a few hundred ms). The render thread calls
+// Poll() every frame to learn when the file is done; Finish() waits for it.
+// RecoverSessionJournal() reads a journal left by a crash up to its first
+// torn or corrupt record.
+
+#include "../Common/MotionCodec.h"
+#include "../Common/SkeletonStream.h"
+
+#include <atomic>
+#include <chrono>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define SESSION_JOURNAL_HEADER_BYTES    28      // record header: tag, first, frames, bytes, crc, time
+#define SESSION_WRITE_ALIGN             4096
+
+static const char SessionJournalMagic[4] = { 'K', 'M', 'J', '1' };
+static const char SessionBlockTag[4] = { 'K', 'M', 'J', 'B' };
+
+typedef SkeletonRing<256> SessionRecorderRing;     // 8.5 s at 30 Hz
+
+inline uint32_t SessionCrc32(const uint8_t* data, size_t size)
+{
+    // built once, thread-safely: the writer and a recovering reader may both get here first
+    struct Table { uint32_t Entry[256]; };
+    static const Table table = []
+    {
+        Table t;
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t.Entry[i] = c;
+        }
+        return t;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+        crc = table.Entry[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+inline bool SyncSessionFile(FILE* f)
+{
+    if (fflush(f) != 0)
+        return false;
+#if defined(_WIN32)
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+// Reading a journal back; stops at the first record that is cut off or
+// fails its checksum. False only when the header itself is unusable.
+inline bool RecoverSessionJournal(const std::string& sFile, KinectClip& clip, size_t* validBytes = nullptr)
+{
+    std::vector<uint8_t> file;
+    FILE* f = fopen(sFile.c_str(), "rb");
+    if (!f)
+        return false;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        file.insert(file.end(), chunk, chunk + n);
+    fclose(f);
+
+    if (file.size() < 12 || memcmp(file.data(), SessionJournalMagic, 4) != 0)
+        return false;
+    uint32_t numParameters;
+    memcpy(&clip.SampleRate, &file[4], 4);
+    memcpy(&numParameters, &file[8], 4);
+    size_t at = 12;
+    if (!ValidMotionSampleRate(clip.SampleRate) || numParameters > (file.size() - at) / 4)
+        return false;
+    clip.Parameters.resize(numParameters);
+    for (uint32_t i = 0; i < numParameters; ++i)
+    {
+        std::string* dst[2] = { &clip.Parameters[i].Name, &clip.Parameters[i].Value };
+        for (int s = 0; s < 2; ++s)
+        {
+            uint16_t len;
+            if (at + 2 > file.size())
+                return false;
+            memcpy(&len, &file[at], 2);
+            if (at + 2 + len > file.size())
+                return false;
+            dst[s]->assign((const char*)&file[at + 2], len);
+            at += 2 + len;
+        }
+    }
+
+    // pass 1: find the valid records, pass 2: decode them. A record whose
+    // frame count its data cannot hold counts as corrupt, checksum or not.
+    std::vector<size_t> records;
+    uint32_t frames = 0;
+    while (at + SESSION_JOURNAL_HEADER_BYTES <= file.size() && memcmp(&file[at], SessionBlockTag, 4) == 0)
+    {
+        uint32_t header[4];
+        memcpy(header, &file[at + 4], sizeof(header));
+        if (header[0] != frames || header[1] == 0 || header[1] > (uint32_t)INT_MAX - frames ||
+            at + SESSION_JOURNAL_HEADER_BYTES + header[2] > file.size() || header[2] < MotionBlockMinBytes(header[1]) ||
+            SessionCrc32(&file[at + SESSION_JOURNAL_HEADER_BYTES], header[2]) != header[3])
+            break;
+        records.push_back(at);
+        frames += header[1];
+        at += SESSION_JOURNAL_HEADER_BYTES + header[2];
+    }
+    if (validBytes)
+        *validBytes = at;
+
+    clip.Allocate((int)frames);
+    SkeletonFrame frame;
+    for (size_t r = 0; r < records.size(); ++r)
+    {
+        uint32_t header[4];
+        memcpy(header, &file[records[r] + 4], sizeof(header));
+        MotionCoderState state;
+        MotionBitReader reader(&file[records[r] + SESSION_JOURNAL_HEADER_BYTES], header[2]);
+        for (uint32_t i = 0; i < header[1]; ++i)
+        {
+            DecodeSkeleton(i == 0, state, reader, frame);
+            clip.SetFrame((int)(header[0] + i), frame);
+        }
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+struct SessionRecorderSettings
+{
+    int    BlockFrames;         // longest journal block
+    size_t BatchBytes;          // pending bytes that trigger an aligned write between checkpoints
+    double SyncInterval;        // seconds between checkpoints (write + fsync)
+    int    ArchiveBlockFrames;  // block size of the final *.kmc
+
+    SessionRecorderSettings() : BlockFrames(32), BatchBytes(64 * 1024), SyncInterval(1.0), ArchiveBlockFrames(32) {}
+};
+
+enum SessionRecorderState
+{
+    SessionRecorder_Idle,
+    SessionRecorder_Recording,
+    SessionRecorder_Finishing,     // stopped, the writer is completing the *.kmc
+    SessionRecorder_Saved,
+    SessionRecorder_Failed         // I/O error, the journal is kept for RecoverSessionJournal
+};
+
+struct SessionRecorderStats
+{
+    uint32_t Frames;            // written to the journal
+    uint32_t Dropped;           // ring full: the writer fell 256 frames behind
+    uint64_t Bytes;
+    uint32_t Writes;
+    uint32_t Syncs;
+    double   MaxSyncMs;         // slowest checkpoint, writer thread
+};
+
+class SessionRecorder
+{
+public:
+    SessionRecorder() : Running(false), State(SessionRecorder_Idle), File(nullptr), Written(0), Failed(false),
+                        Frames(0), Bytes(0), Writes(0), Syncs(0), MaxSyncUs(0) {}
+    ~SessionRecorder() { Finish(); }
+
+    // Starts a journal for 'sFile' (the *.kmc written after Stop); false
+    // while the previous session is recording or being finished, or until
+    // its Saved / Failed result has been taken by Poll() or Finish()
+    bool Start(const std::string& sFile, float sampleRate, const std::vector<MotionParameter>& parameters,
+               const SessionRecorderSettings& settings = SessionRecorderSettings())
+    {
+        if (State.load() != SessionRecorder_Idle)
+            return false;
+        Path = sFile;
+        JournalPath = sFile + ".kmj";
+        Settings = settings;
+        File = fopen(JournalPath.c_str(), "wb");
+        if (!File)
+            return false;
+        setvbuf(File, nullptr, _IONBF, 0);
+
+        Pending.clear();
+        Pending.reserve(Settings.BatchBytes + SESSION_WRITE_ALIGN * 4);
+        Pending.insert(Pending.end(), SessionJournalMagic, SessionJournalMagic + 4);
+        uint32_t numParameters = (uint32_t)parameters.size();
+        Pending.insert(Pending.end(), (const uint8_t*)&sampleRate, (const uint8_t*)&sampleRate + 4);
+        Pending.insert(Pending.end(), (const uint8_t*)&numParameters, (const uint8_t*)&numParameters + 4);
+        for (size_t i = 0; i < parameters.size(); ++i)
+        {
+            PutMotionString(Pending, parameters[i].Name);
+            PutMotionString(Pending, parameters[i].Value);
+        }
+        Written = 0;
+        Frames.store(0);
+        Bytes.store(0);
+        Writes.store(0);
+        Syncs.store(0);
+        MaxSyncUs.store(0);
+        Failed = false;
+        State.store(SessionRecorder_Recording);
+        Running.store(true);
+        Thread = std::thread(&SessionRecorder::Main, this);
+        return true;
+    }
+
+    // Render thread: one enqueue; false when the writer is behind (frame dropped)
+    bool Record(const SkeletonFrame& frame) { return Running.load(std::memory_order_relaxed) && Queue.Push(frame); }
+
+    // Render thread: ends the session without waiting for the writer
+    void Stop()
+    {
+        if (Running.load())
+        {
+            State.store(SessionRecorder_Finishing);
+            Running.store(false);
+        }
+    }
+
+    // Render thread, once per frame: Finishing until the writer is done, then
+    // Saved or Failed for exactly one call, Idle after that
+    SessionRecorderState Poll()
+    {
+        SessionRecorderState state = (SessionRecorderState)State.load();
+        if ((state == SessionRecorder_Saved || state == SessionRecorder_Failed) && Thread.joinable())
+        {
+            Thread.join();
+            State.store(SessionRecorder_Idle);
+            return state;
+        }
+        return state == SessionRecorder_Recording || state == SessionRecorder_Finishing ? state : SessionRecorder_Idle;
+    }
+
+    // Stops and waits for the *.kmc; true when it was written (or nothing
+    // was recording). For shutdown and the tools, not for the render loop.
+    bool Finish()
+    {
+        if (!Thread.joinable())
+            return true;
+        Stop();
+        Thread.join();
+        bool ok = State.load() == SessionRecorder_Saved;
+        State.store(SessionRecorder_Idle);
+        return ok;
+    }
+
+    bool IsRecording() const { return Running.load(std::memory_order_relaxed); }
+    const std::string& FilePath() const { return Path; }
+
+    // Any thread; a snapshot
+    SessionRecorderStats Stats() const
+    {
+        SessionRecorderStats stats;
+        stats.Frames = Frames.load(std::memory_order_relaxed);
+        stats.Dropped = Queue.DroppedFrames();
+        stats.Bytes = Bytes.load(std::memory_order_relaxed);
+        stats.Writes = Writes.load(std::memory_order_relaxed);
+        stats.Syncs = Syncs.load(std::memory_order_relaxed);
+        stats.MaxSyncMs = MaxSyncUs.load(std::memory_order_relaxed) * 1e-3;
+        return stats;
+    }
+
+private:
+    void Main()
+    {
+        typedef std::chrono::steady_clock Steady;
+        Steady::duration interval = std::chrono::duration_cast<Steady::duration>(std::chrono::duration<double>(Settings.SyncInterval));
+        Steady::time_point nextSync = Steady::now() + interval;
+        std::vector<uint8_t> block;
+        MotionBitWriter writer(block);
+        MotionCoderState state;
+        uint32_t blockFirst = 0, blockFrames = 0;
+        double blockTime = 0.0;
+        SkeletonFrame frame;
+        for (;;)
+        {
+            bool running = Running.load();
+            bool any = false;
+            while (Queue.Pop(frame))
+            {
+                any = true;
+                if (blockFrames == 0)
+                    blockTime = frame.Time;
+                EncodeSkeleton(frame, blockFrames == 0, state, writer);
+                if (++blockFrames == (uint32_t)Settings.BlockFrames)
+                    CloseBlock(writer, block, blockFirst, blockFrames, blockTime);
+            }
+            if (!running || Steady::now() >= nextSync)
+            {
+                Steady::time_point start = Steady::now();
+                if (blockFrames)
+                    CloseBlock(writer, block, blockFirst, blockFrames, blockTime);
+                WritePending(Pending.size());
+                if (!SyncSessionFile(File))
+                    Failed = true;
+                Syncs.fetch_add(1, std::memory_order_relaxed);
+                uint64_t us = (uint64_t)std::chrono::duration<double, std::micro>(Steady::now() - start).count();
+                if (us > MaxSyncUs.load(std::memory_order_relaxed))
+                    MaxSyncUs.store(us, std::memory_order_relaxed);
+                nextSync = Steady::now() + interval;
+            }
+            else if (Pending.size() >= Settings.BatchBytes)
+            {
+                // up to a page boundary of the file, the rest waits for the next batch
+                size_t end = (Written + Pending.size()) & ~(size_t)(SESSION_WRITE_ALIGN - 1);
+                if (end > Written)
+                    WritePending(end - Written);
+            }
+            if (!running)
+                break;
+            if (!any)
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        State.store(WriteArchive() ? SessionRecorder_Saved : SessionRecorder_Failed);
+    }
+
+    // Writer thread, after the last checkpoint: the journal is closed on
+    // every path, the *.kmc written from it and the journal removed
+    bool WriteArchive()
+    {
+        bool ok = !Failed;
+        if (fclose(File) != 0)
+            ok = false;
+        File = nullptr;
+
+        KinectClip clip;
+        ok = ok && RecoverSessionJournal(JournalPath, clip);
+        if (ok && clip.NumFrames > 0)
+        {
+            EncodedMotionClip encoded;
+            EncodeMotionClip(clip, Settings.ArchiveBlockFrames, encoded);
+            ok = SaveEncodedMotionFile(Path, encoded);
+        }
+        if (ok)
+            remove(JournalPath.c_str());
+        return ok;
+    }
+
+    // Appends the open block as a record and starts the next one
+    void CloseBlock(MotionBitWriter& writer, std::vector<uint8_t>& block, uint32_t& first, uint32_t& frames, double time)
+    {
+        writer.Flush();
+        uint32_t header[4] = { first, frames, (uint32_t)block.size(), SessionCrc32(block.data(), block.size()) };
+        Pending.insert(Pending.end(), SessionBlockTag, SessionBlockTag + 4);
+        Pending.insert(Pending.end(), (const uint8_t*)header, (const uint8_t*)(header + 4));
+        Pending.insert(Pending.end(), (const uint8_t*)&time, (const uint8_t*)&time + 8);
+        Pending.insert(Pending.end(), block.begin(), block.end());
+        block.clear();
+        Frames.fetch_add(frames, std::memory_order_relaxed);
+        first += frames;
+        frames = 0;
+    }
+
+    void WritePending(size_t n)
+    {
+        if (n == 0)
+            return;
+        if (fwrite(Pending.data(), 1, n, File) != n)
+            Failed = true;
+        Pending.erase(Pending.begin(), Pending.begin() + n);
+        Written += n;
+        Bytes.fetch_add(n, std::memory_order_relaxed);
+        Writes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    SessionRecorderRing          Queue;
+    std::atomic<bool>            Running;
+    std::atomic<int>             State;         // SessionRecorderState
+    std::thread                  Thread;
+    SessionRecorderSettings      Settings;
+    std::string                  Path, JournalPath;
+
+    // writer thread
+    FILE*                        File;
+    std::vector<uint8_t>         Pending;       // records not yet written
+    size_t                       Written;       // file size
+    bool                         Failed;
+
+    std::atomic<uint32_t>        Frames;
+    std::atomic<uint64_t>        Bytes;
+    std::atomic<uint32_t>        Writes, Syncs;
+    std::atomic<uint64_t>        MaxSyncUs;
+};
+
+#endif // SESSION_RECORDER_H
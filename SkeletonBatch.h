@@ -0,0 +1,427 @@
+#ifndef SKELETON_BATCH_H
+#define SKELETON_BATCH_H
+
+// Every body the sensor tracks in one SoA buffer.
+//
+// Kinect v2 reports up to six bodies per frame in fixed slots, each with a
+// tracking id that stays with the person while they are in view. A
+// SkeletonBatch keeps the slots as lanes: X[joint][lane], padded to eight
+// lanes, so one WideFloat op (one AVX2 op, two SSE ops) does the same joint
+// of every body. Per-body work becomes per-batch work: filtering,
+// resampling, rule evaluation and the vertex update for drawing all run one
+// pass over the 25 joints whatever the number of people, and a group class
+// costs about what a single patient does. Empty lanes (tracking id 0) are
+// computed along and ignored.
+//
+// SkeletonBatchFilter is the live filter: jitter suppression and Holt
+// double exponential smoothing per joint (the Kinect SDK's joint filter,
+// with time-aware trend so dropped frames do not bend it), prediction to
+// display time from the trend. A lane whose tracking id changes starts over.
+//
+// Multi-body recordings (LoadMotionBodies) become a SkeletonBatchClip of one
+// batch per frame, sampled between frames by LerpSkeletonBatch; the scene
+// replays the further people of one next to the live body.
+
+#include "../Common/MotionFile.h"
+#include "../Common/MotionSimd.h"
+#include "../Common/SessionAnalytics.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#define KINECT_MAX_BODIES     6
+#define SKELETON_BATCH_LANES  8     // KINECT_MAX_BODIES rounded up to whole WideFloats
+
+static_assert(SKELETON_BATCH_LANES % WIDE_LANES == 0 && SKELETON_BATCH_LANES >= KINECT_MAX_BODIES, "lanes must fill whole vectors");
+
+struct SkeletonBatch
+{
+    float    X[KinectJoint_Count][SKELETON_BATCH_LANES];
+    float    Y[KinectJoint_Count][SKELETON_BATCH_LANES];
+    float    Z[KinectJoint_Count][SKELETON_BATCH_LANES];
+    uint64_t TrackingId[SKELETON_BATCH_LANES];      // 0: no body in this lane
+    double   Time;
+
+    void Clear()
+    {
+        memset(X, 0, sizeof(X));
+        memset(Y, 0, sizeof(Y));
+        memset(Z, 0, sizeof(Z));
+        memset(TrackingId, 0, sizeof(TrackingId));
+        Time = 0.0;
+    }
+
+    int Count() const
+    {
+        int n = 0;
+        for (int l = 0; l < KINECT_MAX_BODIES; ++l)
+            n += TrackingId[l] != 0;
+        return n;
+    }
+
+    int FindLane(uint64_t id) const
+    {
+        for (int l = 0; l < KINECT_MAX_BODIES; ++l)
+            if (TrackingId[l] == id)
+                return l;
+        return -1;
+    }
+
+    void SetBody(int lane, uint64_t id, const SkeletonFrame& body)
+    {
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            X[j][lane] = body.X[j];
+            Y[j][lane] = body.Y[j];
+            Z[j][lane] = body.Z[j];
+        }
+        TrackingId[lane] = id;
+    }
+
+    void GetBody(int lane, SkeletonFrame& body) const
+    {
+        body.Clear();
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            body.X[j] = X[j][lane];
+            body.Y[j] = Y[j][lane];
+            body.Z[j] = Z[j][lane];
+        }
+        body.Time = Time;
+    }
+
+    void ClearBody(int lane)
+    {
+        for (int j = 0; j < KinectJoint_Count; ++j)
+            X[j][lane] = Y[j][lane] = Z[j][lane] = 0.0f;
+        TrackingId[lane] = 0;
+    }
+
+    // All bits set in the lanes that hold a body, for WideSelect
+    void LaneMask(float* mask) const
+    {
+        for (int l = 0; l < SKELETON_BATCH_LANES; ++l)
+        {
+            uint32_t bits = TrackingId[l] ? 0xffffffffu : 0u;
+            memcpy(&mask[l], &bits, 4);
+        }
+    }
+};
+
+inline WideVec3 LoadBatchJoint(const SkeletonBatch& batch, int joint, int lane)
+{
+    WideVec3 v = { WideLoad(&batch.X[joint][lane]), WideLoad(&batch.Y[joint][lane]), WideLoad(&batch.Z[joint][lane]) };
+    return v;
+}
+
+inline void StoreBatchJoint(SkeletonBatch& batch, int joint, int lane, const WideVec3& v)
+{
+    WideStore(&batch.X[joint][lane], v.x);
+    WideStore(&batch.Y[joint][lane], v.y);
+    WideStore(&batch.Z[joint][lane], v.z);
+}
+
+inline WideVec3 WideAdd3(const WideVec3& a, const WideVec3& b)
+{
+    WideVec3 r = { WideAdd(a.x, b.x), WideAdd(a.y, b.y), WideAdd(a.z, b.z) };
+    return r;
+}
+
+inline WideVec3 WideSelect3(WideFloat mask, const WideVec3& a, const WideVec3& b)
+{
+    WideVec3 r = { WideSelect(mask, a.x, b.x), WideSelect(mask, a.y, b.y), WideSelect(mask, a.z, b.z) };
+    return r;
+}
+
+//---------------------------------------------------------------------------
+// Resampling: a + (b - a) t for the bodies present in both (same tracking
+// id), b's lane as is for the others
+inline void LerpSkeletonBatch(const SkeletonBatch& a, const SkeletonBatch& b, float t, SkeletonBatch& out)
+{
+    float same[SKELETON_BATCH_LANES];
+    for (int l = 0; l < SKELETON_BATCH_LANES; ++l)
+    {
+        uint32_t bits = a.TrackingId[l] && a.TrackingId[l] == b.TrackingId[l] ? 0xffffffffu : 0u;
+        memcpy(&same[l], &bits, 4);
+        out.TrackingId[l] = b.TrackingId[l];
+    }
+    WideFloat ts = WideSet(t);
+    for (int l = 0; l < SKELETON_BATCH_LANES; l += WIDE_LANES)
+    {
+        WideFloat mask = WideLoad(&same[l]);
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            WideVec3 pa = LoadBatchJoint(a, j, l), pb = LoadBatchJoint(b, j, l);
+            StoreBatchJoint(out, j, l, WideSelect3(mask, WideAdd3(pa, WideScale3(WideSub3(pb, pa), ts)), pb));
+        }
+    }
+    out.Time = a.Time + (b.Time - a.Time) * t;
+}
+
+// A multi-body recording, one batch per frame; lane b is body b of the file
+struct SkeletonBatchClip
+{
+    std::vector<SkeletonBatch> Frames;
+    float                      SampleRate;
+
+    SkeletonBatchClip() : SampleRate(30.0f) {}
+
+    int NumFrames() const { return (int)Frames.size(); }
+
+    // The bodies at 'seconds', between the two nearest frames
+    void Sample(double seconds, SkeletonBatch& out) const
+    {
+        double position = seconds * SampleRate;
+        int last = NumFrames() - 1;
+        if (last < 0)
+        {
+            out.Clear();
+            return;
+        }
+        if (position <= 0.0 || position >= last)
+        {
+            out = Frames[position <= 0.0 ? 0 : last];
+            out.Time = seconds;
+            return;
+        }
+        int f = (int)position;
+        LerpSkeletonBatch(Frames[f], Frames[f + 1], (float)(position - f), out);
+        out.Time = seconds;
+    }
+};
+
+// Interleaves per-body clips (up to KINECT_MAX_BODIES, same rate) into
+// batches; a body shorter than the longest leaves its lane empty afterwards
+inline void MakeSkeletonBatchClip(const std::vector<KinectClip>& bodies, SkeletonBatchClip& out)
+{
+    int numBodies = std::min((int)bodies.size(), KINECT_MAX_BODIES), numFrames = 0;
+    for (int b = 0; b < numBodies; ++b)
+        numFrames = std::max(numFrames, bodies[b].NumFrames);
+    out.SampleRate = numBodies ? bodies[0].SampleRate : 30.0f;
+    out.Frames.resize(numFrames);
+    for (int f = 0; f < numFrames; ++f)
+    {
+        SkeletonBatch& batch = out.Frames[f];
+        batch.Clear();
+        batch.Time = f / out.SampleRate;
+        for (int b = 0; b < numBodies; ++b)
+        {
+            const KinectClip& clip = bodies[b];
+            if (f >= clip.NumFrames)
+                continue;
+            for (int j = 0; j < KinectJoint_Count; ++j)
+            {
+                size_t i = clip.Index(j, f);
+                batch.X[j][b] = clip.X[i];
+                batch.Y[j][b] = clip.Y[i];
+                batch.Z[j][b] = clip.Z[i];
+            }
+            batch.TrackingId[b] = (uint64_t)b + 1;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+struct SkeletonBatchFilterSettings
+{
+    float Smoothing;            // 0 passes the raw joint, towards 1 follows the prediction
+    float Correction;           // how fast the trend follows the filtered motion
+    float JitterRadius;         // metres; smaller moves are damped before smoothing
+    float MaxHorizon;           // seconds; never extrapolate further
+    float MaxOffset;            // metres a joint may be extrapolated
+
+    SkeletonBatchFilterSettings() : Smoothing(0.5f), Correction(0.5f), JitterRadius(0.03f), MaxHorizon(0.12f), MaxOffset(0.15f) {}
+};
+
+class SkeletonBatchFilter
+{
+public:
+    SkeletonBatchFilterSettings Settings;
+
+    SkeletonBatchFilter() { Reset(); }
+
+    void Reset()
+    {
+        Filtered.Clear();
+        memset(TX, 0, sizeof(TX));
+        memset(TY, 0, sizeof(TY));
+        memset(TZ, 0, sizeof(TZ));
+        Count = 0;
+    }
+
+    // The smoothed bodies of the last Push
+    const SkeletonBatch& Latest() const { return Filtered; }
+    bool HasBodies() const { return Count > 0 && Filtered.Count() > 0; }
+
+    void Push(const SkeletonBatch& raw)
+    {
+        // a repeated or out-of-order timestamp would divide by zero below
+        if (Count > 0 && raw.Time <= Filtered.Time)
+            return;
+        float dt = Count > 0 ? (float)(raw.Time - Filtered.Time) : 0.0f;
+
+        // new people (or a lane that changed hands) start at their raw pose
+        for (int l = 0; l < SKELETON_BATCH_LANES; ++l)
+        {
+            if (raw.TrackingId[l] == Filtered.TrackingId[l] && Count > 0)
+                continue;
+            for (int j = 0; j < KinectJoint_Count; ++j)
+            {
+                Filtered.X[j][l] = raw.X[j][l];
+                Filtered.Y[j][l] = raw.Y[j][l];
+                Filtered.Z[j][l] = raw.Z[j][l];
+                TX[j][l] = TY[j][l] = TZ[j][l] = 0.0f;
+            }
+            Filtered.TrackingId[l] = raw.TrackingId[l];
+        }
+
+        WideFloat smoothing = WideSet(Settings.Smoothing), keep = WideSet(1.0f - Settings.Smoothing);
+        WideFloat correction = WideSet(Settings.Correction), inertia = WideSet(1.0f - Settings.Correction);
+        WideFloat invJitter = WideSet(1.0f / Settings.JitterRadius), one = WideSet(1.0f);
+        WideFloat dts = WideSet(dt), invDt = WideSet(dt > 0.0f ? 1.0f / dt : 0.0f);
+        for (int l = 0; l < SKELETON_BATCH_LANES; l += WIDE_LANES)
+            for (int j = 0; j < KinectJoint_Count; ++j)
+            {
+                WideVec3 p = LoadBatchJoint(raw, j, l), prev = LoadBatchJoint(Filtered, j, l);
+                WideVec3 trend = { WideLoad(&TX[j][l]), WideLoad(&TY[j][l]), WideLoad(&TZ[j][l]) };
+
+                // moves inside the jitter radius count only in proportion to their size
+                WideVec3 d = WideSub3(p, prev);
+                WideFloat w = WideMin(one, WideMul(WideSqrt(WideDot3(d, d)), invJitter));
+                p = WideAdd3(prev, WideScale3(d, w));
+
+                WideVec3 predicted = WideAdd3(prev, WideScale3(trend, dts));
+                WideVec3 filtered = WideAdd3(WideScale3(p, keep), WideScale3(predicted, smoothing));
+                WideVec3 velocity = WideScale3(WideSub3(filtered, prev), invDt);
+                trend = WideAdd3(WideScale3(velocity, correction), WideScale3(trend, inertia));
+
+                StoreBatchJoint(Filtered, j, l, filtered);
+                WideStore(&TX[j][l], trend.x);
+                WideStore(&TY[j][l], trend.y);
+                WideStore(&TZ[j][l], trend.z);
+            }
+        Filtered.Time = raw.Time;
+        ++Count;
+    }
+
+    // Every body as it should look at 'time' (same clock as the pushed batches)
+    void Predict(double time, SkeletonBatch& out) const
+    {
+        float h = (float)(time - Filtered.Time);
+        h = h < 0.0f ? 0.0f : (h > Settings.MaxHorizon ? Settings.MaxHorizon : h);
+        WideFloat hs = WideSet(h), maxOffset = WideSet(Settings.MaxOffset), one = WideSet(1.0f), tiny = WideSet(1e-12f);
+        for (int l = 0; l < SKELETON_BATCH_LANES; l += WIDE_LANES)
+            for (int j = 0; j < KinectJoint_Count; ++j)
+            {
+                WideVec3 trend = { WideLoad(&TX[j][l]), WideLoad(&TY[j][l]), WideLoad(&TZ[j][l]) };
+                WideVec3 offset = WideScale3(trend, hs);
+                WideFloat length = WideSqrt(WideMax(WideDot3(offset, offset), tiny));
+                WideFloat scale = WideMin(one, WideDiv(maxOffset, length));
+                StoreBatchJoint(out, j, l, WideAdd3(LoadBatchJoint(Filtered, j, l), WideScale3(offset, scale)));
+            }
+        memcpy(out.TrackingId, Filtered.TrackingId, sizeof(out.TrackingId));
+        out.Time = Filtered.Time + h;
+    }
+
+private:
+    SkeletonBatch Filtered;
+    float         TX[KinectJoint_Count][SKELETON_BATCH_LANES];     // trend, metres per second
+    float         TY[KinectJoint_Count][SKELETON_BATCH_LANES];
+    float         TZ[KinectJoint_Count][SKELETON_BATCH_LANES];
+    int           Count;
+};
+
+//---------------------------------------------------------------------------
+// The session rules (SessionAnalytics.h) for every body of one frame: the
+// same geometry as EvaluateSessionRule, one lane per body, on the raw knee
+// angle (the live stream has no smoothed angle column). deviation[r][lane]
+// is degrees beyond the rule's tolerance, <= 0 when fine; -1 for rules that
+// are not configured and for empty lanes.
+inline void EvaluateSessionRulesBatch(const SkeletonBatch& batch, const SessionRuleConfig* rules, const SessionSettings& settings,
+                                      float deviation[SessionRule_Count][SKELETON_BATCH_LANES])
+{
+    float lanes[SKELETON_BATCH_LANES];
+    batch.LaneMask(lanes);
+    WideFloat zero = WideSet(0.0f), one = WideSet(1.0f), none = WideSet(-1.0f), degrees = WideSet(57.2957795f);
+    WideFloat cosMinElevation = WideSet(cosf(settings.MinElevation / 57.2957795f));
+    for (int l = 0; l < SKELETON_BATCH_LANES; l += WIDE_LANES)
+    {
+        WideFloat tracked = WideLoad(&lanes[l]);
+        WideVec3 spineBase = LoadBatchJoint(batch, KinectJoint_SpineBase, l);
+        WideVec3 spineShoulder = LoadBatchJoint(batch, KinectJoint_SpineShoulder, l);
+        WideVec3 shoulderL = LoadBatchJoint(batch, KinectJoint_ShoulderLeft, l);
+        WideVec3 shoulderR = LoadBatchJoint(batch, KinectJoint_ShoulderRight, l);
+
+        WideVec3 up = WideNormalize3(WideSub3(spineShoulder, spineBase));
+        WideVec3 right = WideSub3(shoulderR, shoulderL);
+        right = WideNormalize3(WideSub3(right, WideScale3(up, WideDot3(right, up))));
+        WideVec3 forward = WideCross3(up, right);
+
+        for (int r = 0; r < SessionRule_Count; ++r)
+        {
+            const SessionRuleConfig& rule = rules[r];
+            WideFloat dev = none;
+            if (!rule.Enabled)
+            {
+                WideStore(&deviation[r][l], none);
+                continue;
+            }
+            if (r == SessionRule_BentKneeLeft || r == SessionRule_BentKneeRight)
+            {
+                bool left = r == SessionRule_BentKneeLeft;
+                WideVec3 hip = LoadBatchJoint(batch, left ? KinectJoint_HipLeft : KinectJoint_HipRight, l);
+                WideVec3 knee = LoadBatchJoint(batch, left ? KinectJoint_KneeLeft : KinectJoint_KneeRight, l);
+                WideVec3 ankle = LoadBatchJoint(batch, left ? KinectJoint_AnkleLeft : KinectJoint_AnkleRight, l);
+                WideFloat flexion = WideSegmentAngle(WideSub3(knee, hip), WideSub3(ankle, knee));
+                dev = WideSub(WideAbs(WideSub(WideSet(180.0f - rule.Target[0]), flexion)), WideSet(rule.Tolerance[0]));
+            }
+            else if (r == SessionRule_WrongPlaneUpperBody)
+            {
+                // lean towards the front (about x) and the side (about z) of the canonical vertical
+                WideVec3 normals[3] = { right, up, forward };
+                dev = WideSet(-1e9f);
+                for (int a = 0; a < 3; a += 2)
+                {
+                    if (!rule.Axis[a])
+                        continue;
+                    WideVec3 n = normals[a];
+                    n.y = zero;                                     // minus its world up part
+                    n = WideNormalize3(n);
+                    WideVec3 inPlane = WideNormalize3(WideSub3(up, WideScale3(n, WideDot3(up, n))));
+                    WideFloat c = WideMax(WideSet(-1.0f), WideMin(one, inPlane.y));
+                    WideFloat lean = WideMul(WideAtan2(WideSqrt(WideMax(WideSub(one, WideMul(c, c)), zero)), c), degrees);
+                    dev = WideMax(dev, WideSub(lean, WideSet(rule.Tolerance[a])));
+                }
+            }
+            else
+            {
+                bool left = r == SessionRule_WrongPlaneAbductionLeft || r == SessionRule_WrongPlaneFlexionLeft || r == SessionRule_WrongPlaneExtensionLeft;
+                bool frontal = r == SessionRule_WrongPlaneAbductionLeft || r == SessionRule_WrongPlaneAbductionRight;
+                WideVec3 shoulder = left ? shoulderL : shoulderR;
+                WideVec3 arm = WideNormalize3(WideSub3(LoadBatchJoint(batch, left ? KinectJoint_ElbowLeft : KinectJoint_ElbowRight, l), shoulder));
+                WideFloat side = WideAbs(WideDot3(arm, right)), front = WideDot3(arm, forward);
+                // not applicable: abduction needs side >= |front|, flexion front > side, extension -front > side
+                WideFloat off;
+                if (frontal)
+                    off = WideLess(side, WideAbs(front));
+                else if (r == SessionRule_WrongPlaneFlexionLeft || r == SessionRule_WrongPlaneFlexionRight)
+                    off = WideLess(front, side);
+                else
+                    off = WideLess(WideSub(zero, front), side);
+                // hanging arm, no plane to leave
+                WideFloat hanging = WideLess(cosMinElevation, WideSub(zero, WideDot3(arm, up)));
+
+                int axis = frontal ? 2 : 0;
+                float tolerance = rule.Axis[axis] ? rule.Tolerance[axis] : std::max(rule.Tolerance[0], std::max(rule.Tolerance[1], rule.Tolerance[2]));
+                WideFloat s = WideMin(one, WideAbs(WideDot3(arm, frontal ? forward : right)));
+                WideFloat fromPlane = WideMul(WideAtan2(s, WideSqrt(WideMax(WideSub(one, WideMul(s, s)), zero))), degrees);
+                dev = WideSelect(hanging, none, WideSelect(off, none, WideSub(fromPlane, WideSet(tolerance))));
+            }
+            WideStore(&deviation[r][l], WideSelect(tracked, dev, none));
+        }
+    }
+}
+
+#endif // SKELETON_BATCH_H
@@ -0,0 +1,190 @@
+#ifndef SKELETON_STREAM_H
+#define SKELETON_STREAM_H
+
+// Hand-off of live skeleton frames from the thread that produces them (the
+// Kinect, or a recording replayed at its frame rate) to the render loop.
+//
+// SkeletonRing is a bounded single-producer / single-consumer queue of
+// whole SkeletonFrames. Push and Pop are wait-free: one relaxed load of the
+// own index, an acquire load of the other side's index only when the cached
+// copy says full / empty, a copy of the frame and a release store. Nothing
+// locks or allocates. The two indices live on separate cache lines (by
+// padding, so it holds wherever the owner is allocated) and each side keeps
+// a private copy of the other's index, so the sensor thread and the render
+// thread only share a line when the queue looks full or empty.
+//
+// A full ring drops the new frame and counts it: the render loop drains
+// several times per sensor frame, so this only happens while it stalls.
+// The consumer either pops every pending frame in order (filters that need
+// each sample) or jumps to the newest one.
+
+#include "../Common/MotionFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <thread>
+
+#define SKELETON_STREAM_CACHE_LINE 64
+
+template <uint32_t Capacity>
+class SkeletonRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    SkeletonRing() : Head(0), CachedTail(0), Tail(0), CachedHead(0), Dropped(0) {}
+
+    // Producer thread only
+    bool Push(const SkeletonFrame& frame)
+    {
+        uint32_t head = Head.load(std::memory_order_relaxed);
+        if (head - CachedTail == Capacity)
+        {
+            CachedTail = Tail.load(std::memory_order_acquire);
+            if (head - CachedTail == Capacity)
+            {
+                Dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        Slots[head & (Capacity - 1)] = frame;
+        Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only: the oldest pending frame
+    bool Pop(SkeletonFrame& out)
+    {
+        uint32_t tail = Tail.load(std::memory_order_relaxed);
+        if (tail == CachedHead)
+        {
+            CachedHead = Head.load(std::memory_order_acquire);
+            if (tail == CachedHead)
+                return false;
+        }
+        out = Slots[tail & (Capacity - 1)];
+        Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only: the newest frame, discarding the older pending
+    // ones; returns how many were discarded, -1 when there was none
+    int PopLatest(SkeletonFrame& out)
+    {
+        uint32_t tail = Tail.load(std::memory_order_relaxed);
+        CachedHead = Head.load(std::memory_order_acquire);
+        if (tail == CachedHead)
+            return -1;
+        out = Slots[(CachedHead - 1) & (Capacity - 1)];
+        Tail.store(CachedHead, std::memory_order_release);
+        return (int)(CachedHead - 1 - tail);
+    }
+
+    // Either thread; a snapshot
+    uint32_t Size() const { return Head.load(std::memory_order_acquire) - Tail.load(std::memory_order_acquire); }
+    uint32_t DroppedFrames() const { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+    char                  PadFront[SKELETON_STREAM_CACHE_LINE];     // away from the owner's other members
+    // producer line
+    std::atomic<uint32_t> Head;         // next slot to write
+    uint32_t              CachedTail;
+    char                  PadProducer[SKELETON_STREAM_CACHE_LINE - sizeof(std::atomic<uint32_t>) - sizeof(uint32_t)];
+    // consumer line
+    std::atomic<uint32_t> Tail;         // next slot to read
+    uint32_t              CachedHead;
+    char                  PadConsumer[SKELETON_STREAM_CACHE_LINE - sizeof(std::atomic<uint32_t>) - sizeof(uint32_t)];
+    std::atomic<uint32_t> Dropped;
+    char                  PadDropped[SKELETON_STREAM_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+    SkeletonFrame         Slots[Capacity];
+};
+
+// Two seconds of Kinect frames
+typedef SkeletonRing<64> LiveSkeletonRing;
+
+//---------------------------------------------------------------------------
+// Whatever feeds the ring from its own thread: the Kinect, a replayed
+// recording, the network. 'clock' is the consumer's time base (the LibOVR
+// clock in the scene); frames are stamped with their capture time on it, so
+// gap filling and prediction to display time work the same for all.
+class SkeletonSource
+{
+public:
+    virtual ~SkeletonSource() {}
+
+    // 'ring' must outlive the source (or the next Stop)
+    virtual bool Start(LiveSkeletonRing& ring, double (*clock)()) = 0;
+    virtual void Stop() = 0;
+    virtual const char* Name() const = 0;
+};
+
+//---------------------------------------------------------------------------
+// Stand-in for the sensor: pushes the frames of a recording at its sample
+// rate, looping
+class SkeletonReplay : public SkeletonSource
+{
+public:
+    SkeletonReplay() : Running(false), Clip(nullptr), Ring(nullptr), Clock(nullptr), Loop(true) {}
+    ~SkeletonReplay() { Stop(); }
+
+    // 'clip' must outlive the replay
+    void Open(const KinectClip& clip, bool loop = true)
+    {
+        Clip = &clip;
+        Loop = loop;
+    }
+
+    bool Start(LiveSkeletonRing& ring, double (*clock)())
+    {
+        if (Running.load() || !Clip || Clip->NumFrames < 1 || Clip->SampleRate <= 0.0f || !clock)
+            return false;
+        if (Thread.joinable())
+            Thread.join();      // finished a non-looping replay
+        Ring = &ring;
+        Clock = clock;
+        Running.store(true);
+        Thread = std::thread(&SkeletonReplay::Main, this);
+        return true;
+    }
+
+    void Stop()
+    {
+        Running.store(false);
+        if (Thread.joinable())
+            Thread.join();
+    }
+
+    const char* Name() const { return "replay"; }
+
+    bool IsRunning() const { return Running.load(); }
+
+private:
+    void Main()
+    {
+        typedef std::chrono::steady_clock Steady;
+        double period = 1.0 / Clip->SampleRate;
+        Steady::time_point start = Steady::now();
+        double base = Clock();
+        SkeletonFrame frame;
+        for (long long n = 0; Running.load(std::memory_order_relaxed); ++n)
+        {
+            if (!Loop && n >= Clip->NumFrames)
+                break;
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Steady::duration>(std::chrono::duration<double>(period * n)));
+            Clip->GetFrame((int)(n % Clip->NumFrames), frame);
+            frame.Time = base + period * n;
+            Ring->Push(frame);
+        }
+        Running.store(false);
+    }
+
+    std::atomic<bool>   Running;
+    std::thread         Thread;
+    const KinectClip*   Clip;
+    LiveSkeletonRing*   Ring;
+    double              (*Clock)();
+    bool                Loop;
+};
+
+#endif // SKELETON_STREAM_H
@@ -0,0 +1,293 @@
+// Stand-in for the Kinect: replays recordings over localhost UDP.
+//
+//   SkeletonStreamServer [-port n] [-jitter ms] [-drop p] [-loss p] [-burst every-s hold-ms]
+//                        [-key frames] [-loop] [-seed n] [-bench seconds] <recording>...
+//
+// Frames go out at the recording's rate (30 Hz), each one:
+//   -drop p      never captured, like a frame the sensor skips
+//   -loss p      captured but the datagram is not sent (the receiver loses
+//                that frame, or up to -key frames when it was a key)
+//   -jitter ms   sent late by |N(0, ms)|, in order
+//   -burst s ms  on average every s seconds the sensor stalls for ms and the
+//                held frames go out back to back
+// Packets carry the capture time on the steady clock (see SkeletonUdp.h).
+// The scene listens when SKELETON_STREAM_PORT is set in its environment.
+//
+// -bench runs the receiving side in the same process for that many seconds:
+// a UdpSkeletonReceiver feeding a LiveSkeletonRing, drained by a 90 Hz loop
+// through the scene's live chain (gap filter, bone lengths, predictor), and
+// reports where the latency goes. No headset, GL or sensor needed.
+//
+// Build standalone:
+//   cl /O2 /EHsc SkeletonStreamServer.cpp
+//   g++ -std=c++14 -O2 -pthread SkeletonStreamServer.cpp
+
+#include "../Common/RecordingArchive.h"
+#include "../Common/SkeletonUdp.h"
+#include "../Common/GapFilter.h"
+#include "../Common/JointPredictor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ReplaySettings
+{
+    int    Port;
+    double JitterMs;
+    double DropRate;
+    double LossRate;
+    double BurstEvery;      // seconds, 0 for none
+    double BurstMs;
+    int    KeyInterval;
+    bool   Loop;
+    int    Seed;
+
+    ReplaySettings() : Port(SKELETON_STREAM_PORT), JitterMs(0.0), DropRate(0.0), LossRate(0.0), BurstEvery(0.0), BurstMs(0.0),
+                       KeyInterval(30), Loop(false), Seed(1) {}
+};
+
+struct ReplayCounts
+{
+    long long Captured, Dropped, Lost, Sent, Bursts;
+};
+
+static void Replay(const std::vector<KinectClip>& clips, const ReplaySettings& settings, const std::atomic<bool>& quit, ReplayCounts& counts)
+{
+    typedef std::chrono::steady_clock Steady;
+    counts = ReplayCounts();
+    UdpSkeletonSender sender;
+    if (!sender.Open(settings.Port))
+    {
+        fprintf(stderr, "cannot open a socket\n");
+        return;
+    }
+    sender.Encoder.KeyInterval = settings.KeyInterval;
+
+    std::mt19937 rng(settings.Seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> jitter(0.0, settings.JitterMs * 1e-3);
+    std::exponential_distribution<double> burstGap(settings.BurstEvery > 0.0 ? 1.0 / settings.BurstEvery : 1.0);
+
+    double start = SkeletonSteadySeconds() + 0.05, capture = start, lastSend = start;
+    double burstStart = settings.BurstEvery > 0.0 ? start + burstGap(rng) : INFINITY, burstEnd = -1.0;
+    std::vector<uint8_t> packet;
+    SkeletonFrame frame;
+    do
+    {
+        for (size_t c = 0; c < clips.size() && !quit.load(); ++c)
+        {
+            const KinectClip& clip = clips[c];
+            double period = 1.0 / clip.SampleRate;
+            for (int f = 0; f < clip.NumFrames && !quit.load(); ++f, capture += period)
+            {
+                if (capture >= burstStart)
+                {
+                    burstEnd = burstStart + settings.BurstMs * 1e-3;
+                    burstStart = burstEnd + burstGap(rng);
+                    ++counts.Bursts;
+                }
+                if (uniform(rng) < settings.DropRate)
+                {
+                    ++counts.Dropped;
+                    continue;
+                }
+                double send = std::max(capture + fabs(jitter(rng)), lastSend);
+                if (capture < burstEnd)
+                    send = std::max(send, burstEnd);
+                lastSend = send;
+                std::this_thread::sleep_until(Steady::time_point(std::chrono::duration_cast<Steady::duration>(std::chrono::duration<double>(send))));
+
+                clip.GetFrame(f, frame);
+                frame.Time = capture;
+                sender.Encode(frame, packet);
+                ++counts.Captured;
+                if (uniform(rng) < settings.LossRate)
+                {
+                    ++counts.Lost;
+                    continue;
+                }
+                if (sender.Send(packet))
+                    ++counts.Sent;
+            }
+        }
+    } while (settings.Loop && !quit.load());
+}
+
+//---------------------------------------------------------------------------
+// -bench: the consuming side
+
+static double BenchClock()
+{
+    return SkeletonSteadySeconds();
+}
+
+static double Percentile(std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0.0;
+    size_t i = std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+static void PrintLatency(const char* name, std::vector<double>& ms)
+{
+    printf("  %-30s p50 %6.1f ms  p90 %6.1f ms  p99 %6.1f ms  max %6.1f ms\n", name,
+           Percentile(ms, 0.5), Percentile(ms, 0.9), Percentile(ms, 0.99), Percentile(ms, 1.0));
+}
+
+static void Bench(const ReplaySettings& settings, double seconds, const std::atomic<bool>& serverDone)
+{
+    static LiveSkeletonRing ring;
+    UdpSkeletonReceiver receiver;
+    if (!receiver.Open(settings.Port) || !receiver.Start(ring, BenchClock))
+    {
+        fprintf(stderr, "cannot listen on port %d\n", settings.Port);
+        return;
+    }
+
+    // the scene's live chain, see Scene::SetLiveSkeleton / UpdateLiveBody
+    KinectBoneLengths bones;
+    GapFilter gaps;
+    gaps.Reset(GapFilterSettings(), &bones);
+    JointPredictor predictor;
+
+    std::vector<double> arrivalAge, bodyAge, predictedAge, pumpUs;
+    const double tick = 1.0 / 90.0;
+    double start = BenchClock();
+    long long ticks = 0, frames = 0;
+    SkeletonFrame frame, body;      // body: the newest output of the chain
+    for (double next = start; next < start + seconds && !serverDone.load(); next += tick)
+    {
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(next))));
+        double now = BenchClock();
+        while (ring.Pop(frame))
+        {
+            arrivalAge.push_back((now - frame.Time) * 1e3);
+            gaps.Push(frame);
+            while (gaps.Pop(body))
+            {
+                if (bones.Calibrated())
+                    bones.Apply(body);
+                else
+                    bones.AddCalibrationFrame(body);
+                predictor.Push(body);
+            }
+            ++frames;
+        }
+        // display one tick ahead, as ovr_GetPredictedDisplayTime roughly is
+        double display = now + tick;
+        if (predictor.Count)
+        {
+            SkeletonFrame predicted;
+            predictor.Predict(display, predicted);
+            bodyAge.push_back((display - body.Time) * 1e3);
+            predictedAge.push_back((display - predicted.Time) * 1e3);
+        }
+        pumpUs.push_back((BenchClock() - now) * 1e6);
+        ++ticks;
+    }
+    receiver.Stop();
+
+    UdpReceiverStats stats = receiver.Stats();
+    printf("bench: %lld ticks at 90 Hz, %lld frames consumed\n", ticks, frames);
+    printf("  received %u packets, decoded %u, lost %u, skipped %u late or keyless, ring drops %u, gap filter inserted %d\n",
+           stats.Packets, stats.Frames, stats.Lost, stats.Skipped, ring.DroppedFrames(), gaps.Stats.InsertedFrames);
+    printf("  %-30s mean %6.1f ms  max %6.1f ms\n", "capture -> receive",
+           stats.Frames ? stats.LatencySum / stats.Frames * 1e3 : 0.0, stats.LatencyMax * 1e3);
+    PrintLatency("capture -> render loop", arrivalAge);
+    PrintLatency("capture -> display (raw)", bodyAge);
+    PrintLatency("predicted pose behind display", predictedAge);
+    std::vector<double> pump = pumpUs;
+    printf("  %-30s p50 %6.1f us  p99 %6.1f us\n", "live chain per tick", Percentile(pump, 0.5), Percentile(pump, 0.99));
+}
+
+//---------------------------------------------------------------------------
+static void PrintUsage()
+{
+    fprintf(stderr, "usage: SkeletonStreamServer [-port n] [-jitter ms] [-drop p] [-loss p] [-burst every-s hold-ms] "
+                    "[-key frames] [-loop] [-seed n] [-bench seconds] <recording>...\n");
+}
+
+int main(int argc, char** argv)
+{
+    ReplaySettings settings;
+    double benchSeconds = 0.0;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "-port" && i + 1 < argc)
+            settings.Port = atoi(argv[++i]);
+        else if (arg == "-jitter" && i + 1 < argc)
+            settings.JitterMs = atof(argv[++i]);
+        else if (arg == "-drop" && i + 1 < argc)
+            settings.DropRate = atof(argv[++i]);
+        else if (arg == "-loss" && i + 1 < argc)
+            settings.LossRate = atof(argv[++i]);
+        else if (arg == "-burst" && i + 2 < argc)
+        {
+            settings.BurstEvery = atof(argv[++i]);
+            settings.BurstMs = atof(argv[++i]);
+        }
+        else if (arg == "-key" && i + 1 < argc)
+            settings.KeyInterval = atoi(argv[++i]);
+        else if (arg == "-loop")
+            settings.Loop = true;
+        else if (arg == "-seed" && i + 1 < argc)
+            settings.Seed = atoi(argv[++i]);
+        else if (arg == "-bench" && i + 1 < argc)
+            benchSeconds = atof(argv[++i]);
+        else if (arg[0] == '-')
+        {
+            PrintUsage();
+            return 2;
+        }
+        else
+            CollectRecordings(arg, files);
+    }
+    if (files.empty() || settings.Port <= 0 || settings.KeyInterval < 1)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<KinectClip> clips;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        KinectClip clip;
+        if (LoadRecording(files[i], clip))
+            clips.push_back(clip);
+        else
+            fprintf(stderr, "cannot read %s\n", files[i].c_str());
+    }
+    if (clips.empty())
+        return 1;
+
+    std::atomic<bool> quit(false), done(false);
+    ReplayCounts counts;
+    if (benchSeconds > 0.0)
+    {
+        std::thread server([&]() { Replay(clips, settings, quit, counts); done.store(true); });
+        Bench(settings, benchSeconds, done);
+        quit.store(true);
+        server.join();
+    }
+    else
+    {
+        printf("streaming %d recording(s) to 127.0.0.1:%d%s\n", (int)clips.size(), settings.Port, settings.Loop ? ", looping" : "");
+        Replay(clips, settings, quit, counts);
+    }
+    printf("server: %lld captured, %lld dropped by the sensor, %lld lost in transport, %lld sent, %lld bursts\n",
+           counts.Captured, counts.Dropped, counts.Lost, counts.Sent, counts.Bursts);
+    return 0;
+}
@@ -0,0 +1,240 @@
+#ifndef SKELETON_TOPOLOGY_H
+#define SKELETON_TOPOLOGY_H
+
+// Compile-time skeleton topologies.
+//
+// A topology is a type with the joint count and a constexpr parent table:
+//
+//   struct MyRig
+//   {
+//       enum { JointCount = 20, BoneCount = JointCount - 1 };
+//       static constexpr int Parent(int joint) { return MyRigParent[joint]; }
+//       static const char* Name(int joint) { return MyRigNames[joint]; }
+//   };
+//
+// Everything else is derived once, at compile time, by SkeletonTopologyTables:
+// the hierarchy order (depth first from the single root, children in joint
+// order) and the bones, one per non-root joint in that order, so bone b's
+// parent is always placed before bone b's child. A parent table that is not
+// one tree fails a static_assert where the topology is first used.
+//
+// ForEachJoint / ForEachBone expand into one call per joint / bone with the
+// indices as std::integral_constant, so per-skeleton loops unroll completely
+// and every index is a constant; the geometry and evaluation templates below
+// are built on them. Poses are SoA x/y/z arrays with at least JointCount
+// entries (a SkeletonFrame for anything up to KINECT_JOINT_STRIDE joints).
+
+#include "../Common/KinectSkeleton.h"
+
+#include <math.h>
+#include <type_traits>
+#include <utility>
+
+//---------------------------------------------------------------------------
+// Kinect v2, the sensor this project records with (KinectSkeleton.h)
+struct KinectV2Topology
+{
+    enum { JointCount = KinectJoint_Count, BoneCount = KinectJoint_Count - 1 };
+    static constexpr int Parent(int joint) { return KinectJointParent[joint]; }
+    static const char* Name(int joint) { return KinectJointNames[joint]; }
+};
+
+// Kinect v1 (Xbox 360 sensor), 20 joints in the NUI_SKELETON_POSITION order
+enum KinectV1Joint
+{
+    KinectV1Joint_HipCenter      = 0,
+    KinectV1Joint_Spine          = 1,
+    KinectV1Joint_ShoulderCenter = 2,
+    KinectV1Joint_Head           = 3,
+    KinectV1Joint_ShoulderLeft   = 4,
+    KinectV1Joint_ElbowLeft      = 5,
+    KinectV1Joint_WristLeft      = 6,
+    KinectV1Joint_HandLeft       = 7,
+    KinectV1Joint_ShoulderRight  = 8,
+    KinectV1Joint_ElbowRight     = 9,
+    KinectV1Joint_WristRight     = 10,
+    KinectV1Joint_HandRight      = 11,
+    KinectV1Joint_HipLeft        = 12,
+    KinectV1Joint_KneeLeft       = 13,
+    KinectV1Joint_AnkleLeft      = 14,
+    KinectV1Joint_FootLeft       = 15,
+    KinectV1Joint_HipRight       = 16,
+    KinectV1Joint_KneeRight      = 17,
+    KinectV1Joint_AnkleRight     = 18,
+    KinectV1Joint_FootRight      = 19,
+    KinectV1Joint_Count          = 20
+};
+
+static constexpr int KinectV1JointParent[KinectV1Joint_Count] =
+{
+    -1, KinectV1Joint_HipCenter, KinectV1Joint_Spine, KinectV1Joint_ShoulderCenter,
+    KinectV1Joint_ShoulderCenter, KinectV1Joint_ShoulderLeft, KinectV1Joint_ElbowLeft, KinectV1Joint_WristLeft,
+    KinectV1Joint_ShoulderCenter, KinectV1Joint_ShoulderRight, KinectV1Joint_ElbowRight, KinectV1Joint_WristRight,
+    KinectV1Joint_HipCenter, KinectV1Joint_HipLeft, KinectV1Joint_KneeLeft, KinectV1Joint_AnkleLeft,
+    KinectV1Joint_HipCenter, KinectV1Joint_HipRight, KinectV1Joint_KneeRight, KinectV1Joint_AnkleRight
+};
+
+static const char* const KinectV1JointNames[KinectV1Joint_Count] =
+{
+    "HipCenter", "Spine", "ShoulderCenter", "Head",
+    "ShoulderLeft", "ElbowLeft", "WristLeft", "HandLeft",
+    "ShoulderRight", "ElbowRight", "WristRight", "HandRight",
+    "HipLeft", "KneeLeft", "AnkleLeft", "FootLeft",
+    "HipRight", "KneeRight", "AnkleRight", "FootRight"
+};
+
+struct KinectV1Topology
+{
+    enum { JointCount = KinectV1Joint_Count, BoneCount = KinectV1Joint_Count - 1 };
+    static constexpr int Parent(int joint) { return KinectV1JointParent[joint]; }
+    static const char* Name(int joint) { return KinectV1JointNames[joint]; }
+};
+
+//---------------------------------------------------------------------------
+// Derived tables
+template <class Topology>
+struct SkeletonTables
+{
+    int  Order[Topology::JointCount];       // parents before children, Order[0] the root
+    int  BoneChild[Topology::BoneCount];    // bone b: BoneParent[b] -> BoneChild[b]
+    int  BoneParent[Topology::BoneCount];
+    bool Valid;                             // one root, every joint reachable from it
+
+    constexpr SkeletonTables() : Order(), BoneChild(), BoneParent(), Valid(false)
+    {
+        int root = -1, roots = 0;
+        for (int j = 0; j < Topology::JointCount; ++j)
+        {
+            int p = Topology::Parent(j);
+            if (p < 0)
+            {
+                root = j;
+                ++roots;
+            }
+            else if (p >= Topology::JointCount || p == j)
+                return;
+        }
+        if (roots != 1 || Topology::BoneCount != Topology::JointCount - 1)
+            return;
+
+        // depth first; every joint has one parent, so nothing is pushed twice
+        int stack[Topology::JointCount] = {};
+        int top = 0, placed = 0;
+        stack[top++] = root;
+        while (top > 0)
+        {
+            int j = stack[--top];
+            Order[placed] = j;
+            if (placed > 0)
+            {
+                BoneChild[placed - 1] = j;
+                BoneParent[placed - 1] = Topology::Parent(j);
+            }
+            ++placed;
+            for (int c = Topology::JointCount - 1; c >= 0; --c)
+                if (Topology::Parent(c) == j)
+                    stack[top++] = c;
+        }
+        // joints on a parent cycle are never reached
+        Valid = placed == Topology::JointCount;
+    }
+};
+
+template <class Topology>
+struct SkeletonTopologyTables
+{
+    static constexpr SkeletonTables<Topology> Value{};
+    static_assert(Value.Valid, "skeleton topology is not a single tree");
+};
+
+template <class Topology>
+constexpr SkeletonTables<Topology> SkeletonTopologyTables<Topology>::Value;
+
+// The v2 tables the rest of the code walks at run time match the derived ones
+constexpr bool KinectV2TablesMatch()
+{
+    for (int h = 0; h < KinectJoint_Count; ++h)
+        if (SkeletonTopologyTables<KinectV2Topology>::Value.Order[h] != KinectHierarchyOrder[h])
+            return false;
+    return true;
+}
+static_assert(KinectV2TablesMatch(), "KinectHierarchyOrder does not match KinectJointParent");
+
+//---------------------------------------------------------------------------
+// Unrolled traversal. f(joint) for every joint in index order, f(child,
+// parent) for every bone, parents first; the arguments are integral_constants
+// (they convert to int, or use decltype(joint)::value where a constant is needed).
+template <class F, int... J>
+inline void SkeletonExpandJoints(F& f, std::integer_sequence<int, J...>)
+{
+    int expand[] = { 0, (f(std::integral_constant<int, J>()), 0)... };
+    (void)expand;
+}
+
+template <class Topology, class F, int... B>
+inline void SkeletonExpandBones(F& f, std::integer_sequence<int, B...>)
+{
+    typedef SkeletonTopologyTables<Topology> Tables;
+    int expand[] = { 0, (f(std::integral_constant<int, Tables::Value.BoneChild[B]>(),
+                           std::integral_constant<int, Tables::Value.BoneParent[B]>()), 0)... };
+    (void)expand;
+}
+
+template <class Topology, class F>
+inline void ForEachJoint(F&& f)
+{
+    SkeletonExpandJoints(f, std::make_integer_sequence<int, Topology::JointCount>());
+}
+
+template <class Topology, class F>
+inline void ForEachBone(F&& f)
+{
+    SkeletonExpandBones<Topology>(f, std::make_integer_sequence<int, Topology::BoneCount>());
+}
+
+//---------------------------------------------------------------------------
+// Geometry: 2 * BoneCount line list indices, vertex j being joint j
+template <class Topology, class Index>
+inline void SkeletonLineIndices(Index* out, Index firstVertex)
+{
+    int i = 0;
+    ForEachBone<Topology>([&](int child, int parent)
+    {
+        out[i++] = Index(firstVertex + parent);
+        out[i++] = Index(firstVertex + child);
+    });
+}
+
+// Evaluation: parent -> child distance of every bone, in bone order
+template <class Topology>
+inline void SkeletonBoneLengths(const float* x, const float* y, const float* z, float* length)
+{
+    int b = 0;
+    ForEachBone<Topology>([&](int child, int parent)
+    {
+        float dx = x[child] - x[parent], dy = y[child] - y[parent], dz = z[child] - z[parent];
+        length[b++] = sqrtf(dx * dx + dy * dy + dz * dz);
+    });
+}
+
+// Rebuilds a pose from per-joint offsets to the parent (0 for the root),
+// root position given: the forward pass of every bone-length constraint
+template <class Topology>
+inline void SkeletonAccumulateOffsets(const float* dx, const float* dy, const float* dz, float* x, float* y, float* z)
+{
+    ForEachBone<Topology>([&](int child, int parent)
+    {
+        x[child] = x[parent] + dx[child];
+        y[child] = y[parent] + dy[child];
+        z[child] = z[parent] + dz[child];
+    });
+}
+
+template <class Topology>
+inline void SkeletonBoneLengths(const SkeletonFrame& frame, float* length)
+{
+    static_assert(Topology::JointCount <= KINECT_JOINT_STRIDE, "topology does not fit a SkeletonFrame");
+    SkeletonBoneLengths<Topology>(frame.X, frame.Y, frame.Z, length);
+}
+
+#endif // SKELETON_TOPOLOGY_H
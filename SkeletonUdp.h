@@ -0,0 +1,248 @@
+#ifndef SKELETON_UDP_H
+#define SKELETON_UDP_H
+
+// Skeleton stream over localhost UDP, so that a separate process (the
+// SkeletonStreamServer tool, later a Kinect bridge) can feed the scene.
+//
+// One datagram per frame, coded by MotionStreamEncoder (MotionCodec.h): ~90
+// bytes, a sequence number and a key frame every KeyInterval frames; a lost
+// datagram costs its own frame, a lost key the frames up to the next. The
+// time in the packet is the capture time on the steady clock, which is
+// system wide on both Windows (QueryPerformanceCounter) and Linux
+// (CLOCK_MONOTONIC), so the receiver can tell how long the frame was on its
+// way and restamp it on the consumer's clock.
+//
+// UdpSkeletonReceiver is a SkeletonSource: its thread blocks in recvfrom
+// (with a timeout, so Stop is prompt), decodes and pushes into the same
+// LiveSkeletonRing as the replay, so the render loop cannot tell them apart.
+
+#include "../Common/MotionCodec.h"
+#include "../Common/SkeletonStream.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+// windows.h without WIN32_LEAN_AND_MEAN has already brought in winsock 1.1,
+// which declares everything used here; including winsock2 after it clashes
+#ifndef _WINSOCKAPI_
+#include <winsock2.h>
+#endif
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET SkeletonSocket;
+#define SKELETON_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+typedef int SkeletonSocket;
+#define SKELETON_INVALID_SOCKET (-1)
+#endif
+
+#define SKELETON_STREAM_PORT 53530
+
+inline double SkeletonSteadySeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void CloseSkeletonSocket(SkeletonSocket s)
+{
+#if defined(_WIN32)
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+// A loopback UDP socket; bound to 'port' when it is not 0
+inline SkeletonSocket OpenSkeletonSocket(int port, int receiveTimeoutMs)
+{
+#if defined(_WIN32)
+    static bool started = false;
+    if (!started)
+    {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+            return SKELETON_INVALID_SOCKET;
+        started = true;
+    }
+#endif
+    SkeletonSocket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == SKELETON_INVALID_SOCKET)
+        return s;
+    if (receiveTimeoutMs > 0)
+    {
+#if defined(_WIN32)
+        DWORD timeout = (DWORD)receiveTimeoutMs;
+#else
+        timeval timeout;
+        timeout.tv_sec = receiveTimeoutMs / 1000;
+        timeout.tv_usec = (receiveTimeoutMs % 1000) * 1000;
+#endif
+        setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    }
+    if (port)
+    {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons((unsigned short)port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(s, (const sockaddr*)&address, sizeof(address)) != 0)
+        {
+            CloseSkeletonSocket(s);
+            return SKELETON_INVALID_SOCKET;
+        }
+    }
+    return s;
+}
+
+//---------------------------------------------------------------------------
+struct UdpSkeletonSender
+{
+    SkeletonSocket      Socket;
+    sockaddr_in         Target;
+    MotionStreamEncoder Encoder;
+
+    UdpSkeletonSender() : Socket(SKELETON_INVALID_SOCKET) {}
+    ~UdpSkeletonSender() { Close(); }
+
+    bool Open(int port)
+    {
+        Close();
+        Socket = OpenSkeletonSocket(0, 0);
+        memset(&Target, 0, sizeof(Target));
+        Target.sin_family = AF_INET;
+        Target.sin_port = htons((unsigned short)port);
+        Target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        Encoder.Reset();
+        return Socket != SKELETON_INVALID_SOCKET;
+    }
+
+    void Close()
+    {
+        if (Socket != SKELETON_INVALID_SOCKET)
+            CloseSkeletonSocket(Socket);
+        Socket = SKELETON_INVALID_SOCKET;
+    }
+
+    // frame.Time is the capture time in SkeletonSteadySeconds
+    void Encode(const SkeletonFrame& frame, std::vector<uint8_t>& packet) { Encoder.Encode(frame, packet); }
+
+    bool Send(const std::vector<uint8_t>& packet)
+    {
+        return sendto(Socket, (const char*)packet.data(), (int)packet.size(), 0, (const sockaddr*)&Target, sizeof(Target)) == (int)packet.size();
+    }
+};
+
+//---------------------------------------------------------------------------
+struct UdpReceiverStats
+{
+    uint32_t Packets;           // datagrams received
+    uint32_t Frames;            // decoded and pushed
+    uint32_t Lost;              // missing sequence numbers
+    uint32_t Skipped;           // late, or delta packets of a lost key frame
+    double   LatencySum;        // capture to receive, seconds
+    double   LatencyMax;
+};
+
+class UdpSkeletonReceiver : public SkeletonSource
+{
+public:
+    UdpSkeletonReceiver() : Socket(SKELETON_INVALID_SOCKET), Running(false), Ring(nullptr), ClockOffset(0.0),
+                            Packets(0), Frames(0), Lost(0), Skipped(0), LatencyUs(0), LatencyMaxUs(0) {}
+    ~UdpSkeletonReceiver() { Stop(); Close(); }
+
+    bool Open(int port)
+    {
+        Close();
+        Socket = OpenSkeletonSocket(port, 100);
+        return Socket != SKELETON_INVALID_SOCKET;
+    }
+
+    void Close()
+    {
+        if (Socket != SKELETON_INVALID_SOCKET)
+            CloseSkeletonSocket(Socket);
+        Socket = SKELETON_INVALID_SOCKET;
+    }
+
+    bool Start(LiveSkeletonRing& ring, double (*clock)())
+    {
+        if (Running.load() || Socket == SKELETON_INVALID_SOCKET || !clock)
+            return false;
+        Ring = &ring;
+        // both clocks are monotonic at the same rate: one offset maps capture times
+        ClockOffset = clock() - SkeletonSteadySeconds();
+        Decoder = MotionStreamDecoder();
+        Running.store(true);
+        Thread = std::thread(&UdpSkeletonReceiver::Main, this);
+        return true;
+    }
+
+    void Stop()
+    {
+        Running.store(false);
+        if (Thread.joinable())
+            Thread.join();
+    }
+
+    const char* Name() const { return "udp"; }
+
+    // Any thread; a snapshot
+    UdpReceiverStats Stats() const
+    {
+        UdpReceiverStats stats;
+        stats.Packets = Packets.load(std::memory_order_relaxed);
+        stats.Frames = Frames.load(std::memory_order_relaxed);
+        stats.Lost = Lost.load(std::memory_order_relaxed);
+        stats.Skipped = Skipped.load(std::memory_order_relaxed);
+        stats.LatencySum = LatencyUs.load(std::memory_order_relaxed) * 1e-6;
+        stats.LatencyMax = LatencyMaxUs.load(std::memory_order_relaxed) * 1e-6;
+        return stats;
+    }
+
+private:
+    void Main()
+    {
+        uint8_t packet[2048];
+        SkeletonFrame frame;
+        while (Running.load(std::memory_order_relaxed))
+        {
+            int n = (int)recvfrom(Socket, (char*)packet, sizeof(packet), 0, nullptr, nullptr);
+            if (n <= 0)
+                continue;       // timeout
+            Packets.fetch_add(1, std::memory_order_relaxed);
+            bool decoded = Decoder.Decode(packet, (size_t)n, frame);
+            Lost.store((uint32_t)Decoder.Lost, std::memory_order_relaxed);
+            Skipped.store((uint32_t)Decoder.Skipped, std::memory_order_relaxed);
+            if (!decoded)
+                continue;
+            double latency = SkeletonSteadySeconds() - frame.Time;
+            uint64_t us = latency > 0.0 ? (uint64_t)(latency * 1e6) : 0;
+            LatencyUs.fetch_add(us, std::memory_order_relaxed);
+            if (us > LatencyMaxUs.load(std::memory_order_relaxed))
+                LatencyMaxUs.store(us, std::memory_order_relaxed);
+            frame.Time += ClockOffset;
+            Ring->Push(frame);
+            Frames.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    SkeletonSocket        Socket;
+    std::atomic<bool>     Running;
+    std::thread           Thread;
+    LiveSkeletonRing*     Ring;
+    double                ClockOffset;
+    MotionStreamDecoder   Decoder;
+    std::atomic<uint32_t> Packets, Frames, Lost, Skipped;
+    std::atomic<uint64_t> LatencyUs, LatencyMaxUs;
+};
+
+#endif // SKELETON_UDP_H
@@ -0,0 +1,349 @@
+#ifndef STREAMING_DTW_H
+#define STREAMING_DTW_H
+
+// Live matching of the Kinect stream against reference exercise motions.
+//
+// Every pushed frame ends one candidate window per template: the last m
+// stream frames, m being the template's length. The window is compared with
+// dynamic time warping inside a Sakoe-Chiba band of Band frames, with an open
+// begin (the match may start anywhere in the window's first Band frames) and
+// a fixed end (it ends now). Work per frame and template is bounded by
+// m (2 Band + 1) distance evaluations and is usually far less, because each
+// window goes through a cascade that stops as soon as it cannot beat the
+// template's bound (Threshold, or the best candidate found so far):
+//   LB_Kim     the last frames must match:                   one distance
+//   LB_Keogh   every window frame against the template's
+//              band envelope, early abandoning:               m box distances
+//   DTW        row by row, abandoning once the row minimum plus
+//              the LB_Keogh tail of the frames not reached yet exceeds it
+// Distances are squared feature distances (PoseFeatures), 24 dims per
+// WideFloat loop. A match is reported once no better window has been seen
+// for half a template; Distance is the rms per template frame, in torso
+// lengths.
+
+#include "../Common/PoseFeatures.h"
+
+#include <algorithm>
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#define DTW_MAX_TEMPLATE_FRAMES 512    // longer templates are rejected
+
+struct DtwTemplate
+{
+    std::string        Name;
+    int                Length;          // m
+    int                Band;            // Sakoe-Chiba radius, frames
+    float              Threshold;       // accept windows below this rms distance
+    std::vector<float> Features;        // [i * POSE_FEATURE_DIM + d]
+    std::vector<float> Lower, Upper;    // envelope over [i - Band, i + Band]
+};
+
+struct DtwMatch
+{
+    int    Template;
+    int    StartFrame, EndFrame;        // stream frame numbers, inclusive
+    double StartTime, EndTime;
+    float  Distance;                    // rms per template frame
+};
+
+struct DtwMatcherStats
+{
+    long long Windows;
+    long long PrunedKim, PrunedKeogh, Abandoned, Completed;
+    double    LastUs, MaxUs;            // Push() time
+};
+
+struct StreamingDtwMatcher
+{
+    struct Candidate
+    {
+        bool   Active;
+        float  Cost;                    // summed squared distance
+        int    Start, End;
+        double StartTime, EndTime;      // taken while both frames are in the ring
+    };
+
+    float                    BandFraction;  // band as a fraction of the template length
+    std::vector<DtwTemplate> Templates;
+    std::vector<Candidate>   Candidates;
+    std::vector<int>         SuppressBefore;    // no new match may start before this frame
+    std::vector<float>       Latest;            // rms of the last completed window, FLT_MAX when pruned
+    std::vector<DtwMatch>    Matches;           // reported, not yet popped
+    DtwMatcherStats          Stats;
+
+    std::vector<float>       Ring;              // stream features, RingFrames frames
+    std::vector<double>      RingTime;          // only valid for the current window
+    int                      RingFrames;        // longest template
+    int                      RingFrom;          // oldest frame kept across the last ResizeRing
+    int                      Count;             // frames pushed
+
+    std::vector<float>       Tail;              // LB_Keogh of window frames [j, m)
+    std::vector<float>       Row[2];
+    std::vector<int>         RowStart[2];
+    std::vector<const float*> Window;
+
+    StreamingDtwMatcher() : BandFraction(0.15f), RingFrames(0)
+    {
+        Reset();
+        ResizeRing(2);
+    }
+
+    // Forgets the stream, keeps the templates
+    void Reset()
+    {
+        Count = RingFrom = 0;
+        Stats = DtwMatcherStats();
+        Matches.clear();
+        Candidates.assign(Templates.size(), Candidate());
+        SuppressBefore.assign(Templates.size(), 0);
+        Latest.assign(Templates.size(), FLT_MAX);
+    }
+
+    // Features are frame-major, at the stream's frame rate. The ring grows to
+    // the longest template. Returns the template's index, or -1 (nothing
+    // added) for fewer than 2 or more than DTW_MAX_TEMPLATE_FRAMES frames.
+    int AddTemplate(const std::string& name, const float* features, int numFrames, float threshold)
+    {
+        if (numFrames < 2 || numFrames > DTW_MAX_TEMPLATE_FRAMES)
+            return -1;
+        DtwTemplate t;
+        t.Name = name;
+        t.Threshold = threshold;
+        t.Length = numFrames;
+        t.Band = std::max(1, (int)(BandFraction * t.Length + 0.5f));
+        t.Features.assign(features, features + (size_t)t.Length * POSE_FEATURE_DIM);
+        t.Lower.resize(t.Features.size());
+        t.Upper.resize(t.Features.size());
+        for (int i = 0; i < t.Length; ++i)
+            for (int d = 0; d < POSE_FEATURE_DIM; ++d)
+            {
+                float lo = FLT_MAX, hi = -FLT_MAX;
+                for (int k = std::max(0, i - t.Band); k <= std::min(t.Length - 1, i + t.Band); ++k)
+                {
+                    lo = std::min(lo, t.Features[k * POSE_FEATURE_DIM + d]);
+                    hi = std::max(hi, t.Features[k * POSE_FEATURE_DIM + d]);
+                }
+                t.Lower[i * POSE_FEATURE_DIM + d] = lo;
+                t.Upper[i * POSE_FEATURE_DIM + d] = hi;
+            }
+        if (t.Length > RingFrames)
+            ResizeRing(t.Length);
+        Templates.push_back(t);
+        Candidates.push_back(Candidate());
+        SuppressBefore.push_back(0);
+        Latest.push_back(FLT_MAX);
+        return (int)Templates.size() - 1;
+    }
+
+    int AddTemplate(const std::string& name, const KinectClip& clip, int first, int count, float threshold)
+    {
+        if (count < 2 || count > DTW_MAX_TEMPLATE_FRAMES)
+            return -1;
+        std::vector<float> features;
+        ComputeClipPoseFeatures(clip, first, count, features);
+        return AddTemplate(name, features.data(), count, threshold);
+    }
+
+    //-----------------------------------------------------------------------
+    void Push(const SkeletonFrame& frame)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        int slot = Count % RingFrames;
+        ComputePoseFeatures(frame, &Ring[(size_t)slot * POSE_FEATURE_DIM]);
+        RingTime[slot] = frame.Time;
+        ++Count;
+
+        for (int t = 0; t < (int)Templates.size(); ++t)
+            Evaluate(t);
+
+        Stats.LastUs = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+        Stats.MaxUs = std::max(Stats.MaxUs, Stats.LastUs);
+    }
+
+    // End of stream: report the candidates still waiting for a better window
+    void Flush()
+    {
+        for (int t = 0; t < (int)Templates.size(); ++t)
+            if (Candidates[t].Active)
+                Report(t);
+    }
+
+    bool PopMatch(DtwMatch& out)
+    {
+        if (Matches.empty())
+            return false;
+        out = Matches.front();
+        Matches.erase(Matches.begin());
+        return true;
+    }
+
+private:
+    const float* StreamFrame(int frame) const
+    {
+        return &Ring[(size_t)(frame % RingFrames) * POSE_FEATURE_DIM];
+    }
+
+    // Keeps the frames already in the ring, at their slots for the new length
+    void ResizeRing(int frames)
+    {
+        std::vector<float> ring((size_t)frames * POSE_FEATURE_DIM, 0.0f);
+        std::vector<double> time(frames, 0.0);
+        for (int f = std::max(0, Count - RingFrames); f < Count; ++f)
+        {
+            std::copy(StreamFrame(f), StreamFrame(f) + POSE_FEATURE_DIM, &ring[(size_t)(f % frames) * POSE_FEATURE_DIM]);
+            time[f % frames] = RingTime[f % RingFrames];
+        }
+        Ring.swap(ring);
+        RingTime.swap(time);
+        RingFrom = std::max(RingFrom, Count - RingFrames);
+        RingFrames = frames;
+    }
+
+    void Report(int t)
+    {
+        Candidate& c = Candidates[t];
+        DtwMatch m;
+        m.Template = t;
+        m.StartFrame = c.Start;
+        m.EndFrame = c.End;
+        m.StartTime = c.StartTime;
+        m.EndTime = c.EndTime;
+        m.Distance = sqrtf(c.Cost / Templates[t].Length);
+        Matches.push_back(m);
+        SuppressBefore[t] = c.End + 1;
+        c.Active = false;
+    }
+
+    void Evaluate(int t)
+    {
+        const DtwTemplate& tpl = Templates[t];
+        Candidate& cand = Candidates[t];
+        int m = tpl.Length, r = tpl.Band, end = Count - 1;
+        Latest[t] = FLT_MAX;
+
+        // a candidate nobody improved on for half a template is final
+        if (cand.Active && end - cand.End > m / 2)
+            Report(t);
+
+        int first = Count - m;
+        if (first < RingFrom || first + r < SuppressBefore[t])
+            return;
+        ++Stats.Windows;
+
+        float bound = tpl.Threshold * tpl.Threshold * m;
+        if (cand.Active)
+            bound = std::min(bound, cand.Cost);
+
+        const float* tf = tpl.Features.data();
+        Window.resize(m);
+        for (int j = 0; j < m; ++j)
+            Window[j] = StreamFrame(first + j);
+
+        // LB_Kim: the end is fixed, so the last frames always pair up
+        float kim = PoseFeatureDistance2(Window[m - 1], tf + (size_t)(m - 1) * POSE_FEATURE_DIM);
+        if (kim >= bound)
+        {
+            ++Stats.PrunedKim;
+            return;
+        }
+
+        // LB_Keogh, from the end backwards so Tail[j] bounds frames [j, m).
+        // The first r frames may lie before an open begin and do not count.
+        Tail.resize(m + 1);
+        Tail[m] = 0.0f;
+        for (int j = m - 1; j >= 0; --j)
+        {
+            float e = j < r ? 0.0f : PoseEnvelopeDistance2(Window[j], &tpl.Lower[(size_t)j * POSE_FEATURE_DIM], &tpl.Upper[(size_t)j * POSE_FEATURE_DIM]);
+            Tail[j] = Tail[j + 1] + e;
+            if (Tail[j] >= bound)
+            {
+                ++Stats.PrunedKeogh;
+                return;
+            }
+        }
+
+        // banded DTW; row i is template frame i, columns are window frames
+        // j in [i - r, i + r]. Cells carry the window frame their path started on.
+        int width = 2 * r + 1;
+        for (int k = 0; k < 2; ++k)
+        {
+            Row[k].assign(width + 2, FLT_MAX);
+            RowStart[k].assign(width + 2, 0);
+        }
+        for (int i = 0; i < m; ++i)
+        {
+            std::vector<float>& cur = Row[i & 1];
+            std::vector<float>& prev = Row[(i & 1) ^ 1];
+            std::vector<int>& curStart = RowStart[i & 1];
+            std::vector<int>& prevStart = RowStart[(i & 1) ^ 1];
+            const float* ti = tf + (size_t)i * POSE_FEATURE_DIM;
+            float rowMin = FLT_MAX;
+            int j0 = std::max(0, i - r), j1 = std::min(m - 1, i + r);
+            std::fill(cur.begin(), cur.end(), FLT_MAX);
+            for (int j = j0; j <= j1; ++j)
+            {
+                // column j of row i sits at j - i + r + 1; row i - 1 keeps column j at one further right
+                int c = j - i + r + 1;
+                float best;
+                int from;
+                if (i == 0)
+                {
+                    best = j <= r && first + j >= SuppressBefore[t] ? 0.0f : FLT_MAX;    // open begin
+                    from = j;
+                    if (j > 0 && cur[c - 1] < best)
+                    {
+                        best = cur[c - 1];
+                        from = curStart[c - 1];
+                    }
+                }
+                else
+                {
+                    best = prev[c + 1];                 // (i - 1, j)
+                    from = prevStart[c + 1];
+                    if (prev[c] < best)                 // (i - 1, j - 1)
+                    {
+                        best = prev[c];
+                        from = prevStart[c];
+                    }
+                    if (cur[c - 1] < best)              // (i, j - 1)
+                    {
+                        best = cur[c - 1];
+                        from = curStart[c - 1];
+                    }
+                }
+                if (best == FLT_MAX)
+                    continue;
+                cur[c] = best + PoseFeatureDistance2(ti, Window[j]);
+                curStart[c] = from;
+                rowMin = std::min(rowMin, cur[c]);
+            }
+            // frames past j1 are still to be paired with some later template frame
+            float rest = j1 + 1 < m ? Tail[std::max(j1 + 1, r)] : 0.0f;
+            if (rowMin + rest >= bound)
+            {
+                ++Stats.Abandoned;
+                return;
+            }
+        }
+        ++Stats.Completed;
+
+        // row m - 1, column m - 1
+        float cost = Row[(m - 1) & 1][r + 1];
+        if (cost >= bound)
+            return;
+        Latest[t] = sqrtf(cost / m);
+        cand.Active = true;
+        cand.Cost = cost;
+        cand.Start = first + RowStart[(m - 1) & 1][r + 1];
+        cand.End = end;
+        // reported up to half a template later, when these slots may be reused
+        cand.StartTime = RingTime[cand.Start % RingFrames];
+        cand.EndTime = RingTime[end % RingFrames];
+    }
+};
+
+#endif // STREAMING_DTW_H
@@ -24,6 +24,26 @@
 #include "../Common/shader.h"
 #include "../Common/camara.h"
 #include "../Common/filesystem.h"
+#include "../Common/AnimationImport.h"
+#include "../Common/ClipCompression.h"
+#include "../Common/BlendTree.h"
+#include "../Common/KinectRetarget.h"
+#include "../Common/KinectRotationSolver.h"
+#include "../Common/KinectBoneLengths.h"
+#include "../Common/IKSolver.h"
+#include "../Common/JointPredictor.h"
+#include "../Common/RecordingSpace.h"
+#include "../Common/GapFilter.h"
+#include "../Common/JointAngles.h"
+#include "../Common/SessionAnalytics.h"
+#include "../Common/StreamingDtw.h"
+#include "../Common/KinectKeyframes.h"
+#include "../Common/SkeletonStream.h"
+#include "../Common/SkeletonUdp.h"
+#include "../Common/SessionRecorder.h"
+#include "../Common/SkeletonBatch.h"
+#include "../Common/SkeletonTopology.h"
+#include <time.h>
 
 using namespace OVR;
 using namespace std;
@@ -434,21 +454,64 @@ OVR_DEBUG_LOG(("Message from OpenGL: %s\n", message));
 // Global OpenGL state
 static OGL Platform;
 
+//------------------------------------------------------------------------------
+// Attribute slots bound before every link, so that one vertex array object
+// per model serves all of its programs
+enum VertexAttribute
+{
+VertexAttribute_Position = 0,
+VertexAttribute_Color    = 1,
+VertexAttribute_TexCoord = 2
+};
+
+// What the draws need of a linked program, looked up once after linking
+struct ProgramReflection
+{
+GLuint  program;
+GLint   matWVP;
+GLint   texture0;
+
+ProgramReflection() : program(0), matWVP(-1), texture0(-1) {}
+
+void Reflect(GLuint linked)
+{
+program = linked;
+matWVP = glGetUniformLocation(program, "matWVP");
+texture0 = glGetUniformLocation(program, "Texture0");
+// the sampler always reads unit 0
+if (texture0 >= 0) {
+glUseProgram(program);
+glUniform1i(texture0, 0);
+glUseProgram(0);
+}
+}
+};
+
 //------------------------------------------------------------------------------
 struct ShaderFill
 {
-GLuint            program;
+ProgramReflection Mono;
+ProgramReflection Stereo; // same pixel shader, both eyes per draw (Model::RenderStereo); program 0 without one
 TextureBuffer* texture;
 
-ShaderFill(GLuint vertexShader, GLuint pixelShader, TextureBuffer* _texture)
+ShaderFill(GLuint vertexShader, GLuint pixelShader, TextureBuffer* _texture, GLuint stereoVertexShader = 0)
 {
 texture = _texture;
+Mono.Reflect(Link(vertexShader, pixelShader));
+if (stereoVertexShader)
+Stereo.Reflect(Link(stereoVertexShader, pixelShader));
+}
 
-program = glCreateProgram();
+static GLuint Link(GLuint vertexShader, GLuint pixelShader)
+{
+GLuint program = glCreateProgram();
 
 glAttachShader(program, vertexShader);
 glAttachShader(program, pixelShader);
 
+glBindAttribLocation(program, VertexAttribute_Position, "Position");
+glBindAttribLocation(program, VertexAttribute_Color, "Color");
+glBindAttribLocation(program, VertexAttribute_TexCoord, "TexCoord");
 glLinkProgram(program);
 
 glDetachShader(program, vertexShader);
@@ -462,14 +525,20 @@ GLchar msg[1024];
 glGetProgramInfoLog(program, sizeof(msg), 0, msg);
 OVR_DEBUG_LOG(("Linking shaders failed: %s\n", msg));
 }
+return program;
 }
 
 ~ShaderFill()
 {
-if (program)
+if (Mono.program)
 {
-glDeleteProgram(program);
-program = 0;
+glDeleteProgram(Mono.program);
+Mono.program = 0;
+}
+if (Stereo.program)
+{
+glDeleteProgram(Stereo.program);
+Stereo.program = 0;
 }
 if (texture)
 {
@@ -484,11 +553,19 @@ struct VertexBuffer
 {
 GLuint    buffer;
 
-VertexBuffer(void* vertices, size_t size)
+// GL_DYNAMIC_DRAW for buffers rewritten with Update every frame
+VertexBuffer(void* vertices, size_t size, GLenum usage = GL_STATIC_DRAW)
 {
 glGenBuffers(1, &buffer);
 glBindBuffer(GL_ARRAY_BUFFER, buffer);
-glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+glBufferData(GL_ARRAY_BUFFER, size, vertices, usage);
+}
+// Rewrites the first 'size' bytes, for models whose vertices move
+void Update(const void* vertices, size_t size)
+{
+glBindBuffer(GL_ARRAY_BUFFER, buffer);
+glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 ~VertexBuffer()
 {
@@ -556,6 +633,8 @@ GLushort        Indices[20000];
 ShaderFill* Fill;
 VertexBuffer* vertexBuffer;
 IndexBuffer* indexBuffer;
+GLuint          texturedVao; // Render
+GLuint          plainVao; // RenderLines / RenderPoints, without TexCoord
 std::vector<Bones> _vecBones;
 
 Model(Vector3f pos, ShaderFill* fill) :
@@ -566,7 +645,9 @@ numVertices(0),
 numIndices(0),
 Fill(fill),
 vertexBuffer(nullptr),
-indexBuffer(nullptr)
+indexBuffer(nullptr),
+texturedVao(0),
+plainVao(0)
 {}
 
 ~Model()
@@ -584,18 +665,47 @@ return Mat;
 void AddVertex(const Vertex& v) { Vertices[numVertices++] = v; }
 void AddIndex(GLushort a) { Indices[numIndices++] = a; }
 
-void AllocateBuffers()
+void AllocateBuffers(GLenum vertexUsage = GL_STATIC_DRAW)
 {
-vertexBuffer = new VertexBuffer(&Vertices[0], numVertices * sizeof(Vertices[0]));
+vertexBuffer = new VertexBuffer(&Vertices[0], numVertices * sizeof(Vertices[0]), vertexUsage);
 indexBuffer = new IndexBuffer(&Indices[0], numIndices * sizeof(Indices[0]));
+texturedVao = CreateVertexArray(vertexBuffer->buffer, indexBuffer->buffer, true);
+plainVao = CreateVertexArray(vertexBuffer->buffer, indexBuffer->buffer, false);
 }
 
 void FreeBuffers()
 {
+if (texturedVao)
+glDeleteVertexArrays(1, &texturedVao);
+if (plainVao)
+glDeleteVertexArrays(1, &plainVao);
+texturedVao = plainVao = 0;
 delete vertexBuffer; vertexBuffer = nullptr;
 delete indexBuffer; indexBuffer = nullptr;
 }
 
+// Vertex layout over the two buffers, at the VertexAttribute slots
+static GLuint CreateVertexArray(GLuint vertices, GLuint indices, bool textured)
+{
+GLuint vao;
+glGenVertexArrays(1, &vao);
+glBindVertexArray(vao);
+glBindBuffer(GL_ARRAY_BUFFER, vertices);
+glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
+glEnableVertexAttribArray(VertexAttribute_Position);
+glEnableVertexAttribArray(VertexAttribute_Color);
+glVertexAttribPointer(VertexAttribute_Position, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, Pos));
+glVertexAttribPointer(VertexAttribute_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, C));
+if (textured) {
+glEnableVertexAttribArray(VertexAttribute_TexCoord);
+glVertexAttribPointer(VertexAttribute_TexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, U));
+}
+glBindVertexArray(0);
+glBindBuffer(GL_ARRAY_BUFFER, 0);
+glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+return vao;
+}
+
 void addPoint(const glm::vec3& vec3Point, const DWORD c)
 {
 AddIndex(0 + GLushort(numVertices));
@@ -618,32 +728,7 @@ AddVertex(vertex);
 void RenderPoints(Matrix4f view, Matrix4f proj)
 {
 Matrix4f combined = proj * view * GetMatrix();
-
-glUseProgram(Fill->program);
-glUniformMatrix4fv(glGetUniformLocation(Fill->program, "matWVP"), 1, GL_TRUE, (FLOAT*)&combined);
-
-glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->buffer);
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->buffer);
-
-GLuint posLoc = glGetAttribLocation(Fill->program, "Position");
-GLuint colorLoc = glGetAttribLocation(Fill->program, "Color");
-
-glEnableVertexAttribArray(posLoc);
-glEnableVertexAttribArray(colorLoc);
-
-glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, Pos));
-glVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, C));
-
-//glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, NULL);
-glDrawElements(GL_POINTS, numIndices, GL_UNSIGNED_SHORT, NULL);
-
-glDisableVertexAttribArray(posLoc);
-glDisableVertexAttribArray(colorLoc);
-
-glBindBuffer(GL_ARRAY_BUFFER, 0);
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-glUseProgram(0);
+Draw(Fill->Mono, &combined, 1, GL_POINTS);
 }
 
 void AddBox(float x1, float y1, float z1, float x2, float y2, float z2, DWORD c)
@@ -696,475 +781,39 @@ vvv.C = (c & 0xff000000) +
 AddVertex(vvv);
 }
 }
+// A 5 cm box per joint of the topology, at x/y/z[joint]
+template <class Topology>
+void AddJointBoxes(const float* x, const float* y, const float* z, DWORD c)
+{
+ForEachJoint<Topology>([&](int j) {
+AddBox(x[j], y[j], z[j], x[j] + 0.05f, y[j] + 0.05f, z[j] + 0.05f, c);
+});
+}
 void AddBox25(float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3, float x4, float y4, float z4, float x5, float y5, float z5, float x6, float y6, float z6, float x7, float y7, float z7, float x8, float y8, float z8, float x9, float y9, float z9, float x10, float y10, float z10, float x11, float y11, float z11, float x12, float y12, float z12, float x13, float y13, float z13, float x14, float y14, float z14, float x15, float y15, float z15, float x16, float y16, float z16, float x17, float y17, float z17, float x18, float y18, float z18, float x19, float y19, float z19, float x20, float y20, float z20, float x21, float y21, float z21, float x22, float y22, float z22, float x23, float y23, float z23, float x24, float y24, float z24, float x25, float y25, float z25, DWORD c)
 {
-Vector3f Vert[][2] =
+const float x[] = { x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15, x16, x17, x18, x19, x20, x21, x22, x23, x24, x25 };
+const float y[] = { y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11, y12, y13, y14, y15, y16, y17, y18, y19, y20, y21, y22, y23, y24, y25 };
+const float z[] = { z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11, z12, z13, z14, z15, z16, z17, z18, z19, z20, z21, z22, z23, z24, z25 };
+AddJointBoxes<KinectV2Topology>(x, y, z, c);
+}
+void Render(Matrix4f view, Matrix4f proj)
 {
-{Vector3f(x1, y1 + 0.05f, z1), Vector3f(z1, x1)}, {Vector3f(x1 + 0.05f, y1 + 0.05f, z1), Vector3f(z1, x1 + 0.05f)},
-{Vector3f(x1 + 0.05f, y1 + 0.05f, z1 + 0.05f), Vector3f(z1 + 0.05f, x1 + 0.05f)}, {Vector3f(x1, y1 + 0.05f, z1 + 0.05f), Vector3f(z1 + 0.05f, x1)},
-{Vector3f(x1, y1, z1), Vector3f(z1, x1)}, {Vector3f(x1 + 0.05f, y1, z1), Vector3f(z1, x1 + 0.05f)},
-{Vector3f(x1 + 0.05f, y1, z1 + 0.05f), Vector3f(z1 + 0.05f, x1 + 0.05f)}, {Vector3f(x1, y1, z1 + 0.05f), Vector3f(z1 + 0.05f, x1)},
-{Vector3f(x1, y1, z1 + 0.05f), Vector3f(z1 + 0.05f, y1)}, {Vector3f(x1, y1, z1), Vector3f(z1, y1)},
-{Vector3f(x1, y1 + 0.05f, z1), Vector3f(z1, y1 + 0.05f)}, {Vector3f(x1, y1 + 0.05f, z1 + 0.05f), Vector3f(z1 + 0.05f, y1 + 0.05f)},
-{Vector3f(x1 + 0.05f, y1, z1 + 0.05f), Vector3f(z1 + 0.05f, y1)}, {Vector3f(x1 + 0.05f, y1, z1), Vector3f(z1, y1)},
-{Vector3f(x1 + 0.05f, y1 + 0.05f, z1), Vector3f(z1, y1 + 0.05f)}, {Vector3f(x1 + 0.05f, y1 + 0.05f, z1 + 0.05f), Vector3f(z1 + 0.05f, y1 + 0.05f)},
-{Vector3f(x1, y1, z1), Vector3f(x1, y1)}, {Vector3f(x1 + 0.05f, y1, z1), Vector3f(x1 + 0.05f, y1)},
-{Vector3f(x1 + 0.05f, y1 + 0.05f, z1), Vector3f(x1 + 0.05f, y1 + 0.05f)}, {Vector3f(x1, y1 + 0.05f, z1), Vector3f(x1, y1 + 0.05f)},
-{Vector3f(x1, y1, z1 + 0.05f), Vector3f(x1, y1)}, {Vector3f(x1 + 0.05f, y1, z1 + 0.05f), Vector3f(x1 + 0.05f, y1)},
-{Vector3f(x1 + 0.05f, y1 + 0.05f, z1 + 0.05f), Vector3f(x1 + 0.05f, y1 + 0.05f)}, {Vector3f(x1, y1 + 0.05f, z1 + 0.05f), Vector3f(x1, y1 + 0.05f)},
-{Vector3f(x2, y2 + 0.05f, z2), Vector3f(z2, x2)}, {Vector3f(x2 + 0.05f, y2 + 0.05f, z2), Vector3f(z2, x2 + 0.05f)},
-{Vector3f(x2 + 0.05f, y2 + 0.05f, z2 + 0.05f), Vector3f(z2 + 0.05f, x2 + 0.05f)}, {Vector3f(x2, y2 + 0.05f, z2 + 0.05f), Vector3f(z2 + 0.05f, x2)},
-{Vector3f(x2, y2, z2), Vector3f(z2, x2)}, {Vector3f(x2 + 0.05f, y2, z2), Vector3f(z2, x2 + 0.05f)},
-{Vector3f(x2 + 0.05f, y2, z2 + 0.05f), Vector3f(z2 + 0.05f, x2 + 0.05f)}, {Vector3f(x2, y2, z2 + 0.05f), Vector3f(z2 + 0.05f, x2)},
-{Vector3f(x2, y2, z2 + 0.05f), Vector3f(z2 + 0.05f, y2)}, {Vector3f(x2, y2, z2), Vector3f(z2, y2)},
-{Vector3f(x2, y2 + 0.05f, z2), Vector3f(z2, y2 + 0.05f)}, {Vector3f(x2, y2 + 0.05f, z2 + 0.05f), Vector3f(z2 + 0.05f, y2 + 0.05f)},
-{Vector3f(x2 + 0.05f, y2, z2 + 0.05f), Vector3f(z2 + 0.05f, y2)}, {Vector3f(x2 + 0.05f, y2, z2), Vector3f(z2, y2)},
-{Vector3f(x2 + 0.05f, y2 + 0.05f, z2), Vector3f(z2, y2 + 0.05f)}, {Vector3f(x2 + 0.05f, y2 + 0.05f, z2 + 0.05f), Vector3f(z2 + 0.05f, y2 + 0.05f)},
-{Vector3f(x2, y2, z2), Vector3f(x2, y2)}, {Vector3f(x2 + 0.05f, y2, z2), Vector3f(x2 + 0.05f, y2)},
-{Vector3f(x2 + 0.05f, y2 + 0.05f, z2), Vector3f(x2 + 0.05f, y2 + 0.05f)}, {Vector3f(x2, y2 + 0.05f, z2), Vector3f(x2, y2 + 0.05f)},
-{Vector3f(x2, y2, z2 + 0.05f), Vector3f(x2, y2)}, {Vector3f(x2 + 0.05f, y2, z2 + 0.05f), Vector3f(x2 + 0.05f, y2)},
-{Vector3f(x2 + 0.05f, y2 + 0.05f, z2 + 0.05f), Vector3f(x2 + 0.05f, y2 + 0.05f)}, {Vector3f(x2, y2 + 0.05f, z2 + 0.05f), Vector3f(x2, y2 + 0.05f)},
-{Vector3f(x3, y3 + 0.05f, z3), Vector3f(z3, x3)}, {Vector3f(x3 + 0.05f, y3 + 0.05f, z3), Vector3f(z3, x3 + 0.05f)},
-{Vector3f(x3 + 0.05f, y3 + 0.05f, z3 + 0.05f), Vector3f(z3 + 0.05f, x3 + 0.05f)}, {Vector3f(x3, y3 + 0.05f, z3 + 0.05f), Vector3f(z3 + 0.05f, x3)},
-{Vector3f(x3, y3, z3), Vector3f(z3, x3)}, {Vector3f(x3 + 0.05f, y3, z3), Vector3f(z3, x3 + 0.05f)},
-{Vector3f(x3 + 0.05f, y3, z3 + 0.05f), Vector3f(z3 + 0.05f, x3 + 0.05f)}, {Vector3f(x3, y3, z3 + 0.05f), Vector3f(z3 + 0.05f, x3)},
-{Vector3f(x3, y3, z3 + 0.05f), Vector3f(z3 + 0.05f, y3)}, {Vector3f(x3, y3, z3), Vector3f(z3, y3)},
-{Vector3f(x3, y3 + 0.05f, z3), Vector3f(z3, y3 + 0.05f)}, {Vector3f(x3, y3 + 0.05f, z3 + 0.05f), Vector3f(z3 + 0.05f, y3 + 0.05f)},
-{Vector3f(x3 + 0.05f, y3, z3 + 0.05f), Vector3f(z3 + 0.05f, y3)}, {Vector3f(x3 + 0.05f, y3, z3), Vector3f(z3, y3)},
-{Vector3f(x3 + 0.05f, y3 + 0.05f, z3), Vector3f(z3, y3 + 0.05f)}, {Vector3f(x3 + 0.05f, y3 + 0.05f, z3 + 0.05f), Vector3f(z3 + 0.05f, y3 + 0.05f)},
-{Vector3f(x3, y3, z3), Vector3f(x3, y3)}, {Vector3f(x3 + 0.05f, y3, z3), Vector3f(x3 + 0.05f, y3)},
-{Vector3f(x3 + 0.05f, y3 + 0.05f, z3), Vector3f(x3 + 0.05f, y3 + 0.05f)}, {Vector3f(x3, y3 + 0.05f, z3), Vector3f(x3, y3 + 0.05f)},
-{Vector3f(x3, y3, z3 + 0.05f), Vector3f(x3, y3)}, {Vector3f(x3 + 0.05f, y3, z3 + 0.05f), Vector3f(x3 + 0.05f, y3)},
-{Vector3f(x3 + 0.05f, y3 + 0.05f, z3 + 0.05f), Vector3f(x3 + 0.05f, y3 + 0.05f)}, {Vector3f(x3, y3 + 0.05f, z3 + 0.05f), Vector3f(x3, y3 + 0.05f)},
-{Vector3f(x4, y4 + 0.05f, z4), Vector3f(z4, x4)}, {Vector3f(x4 + 0.05f, y4 + 0.05f, z4), Vector3f(z4, x4 + 0.05f)},
-{Vector3f(x4 + 0.05f, y4 + 0.05f, z4 + 0.05f), Vector3f(z4 + 0.05f, x4 + 0.05f)}, {Vector3f(x4, y4 + 0.05f, z4 + 0.05f), Vector3f(z4 + 0.05f, x4)},
-{Vector3f(x4, y4, z4), Vector3f(z4, x4)}, {Vector3f(x4 + 0.05f, y4, z4), Vector3f(z4, x4 + 0.05f)},
-{Vector3f(x4 + 0.05f, y4, z4 + 0.05f), Vector3f(z4 + 0.05f, x4 + 0.05f)}, {Vector3f(x4, y4, z4 + 0.05f), Vector3f(z4 + 0.05f, x4)},
-{Vector3f(x4, y4, z4 + 0.05f), Vector3f(z4 + 0.05f, y4)}, {Vector3f(x4, y4, z4), Vector3f(z4, y4)},
-{Vector3f(x4, y4 + 0.05f, z4), Vector3f(z4, y4 + 0.05f)}, {Vector3f(x4, y4 + 0.05f, z4 + 0.05f), Vector3f(z4 + 0.05f, y4 + 0.05f)},
-{Vector3f(x4 + 0.05f, y4, z4 + 0.05f), Vector3f(z4 + 0.05f, y4)}, {Vector3f(x4 + 0.05f, y4, z4), Vector3f(z4, y4)},
-{Vector3f(x4 + 0.05f, y4 + 0.05f, z4), Vector3f(z4, y4 + 0.05f)}, {Vector3f(x4 + 0.05f, y4 + 0.05f, z4 + 0.05f), Vector3f(z4 + 0.05f, y4 + 0.05f)},
-{Vector3f(x4, y4, z4), Vector3f(x4, y4)}, {Vector3f(x4 + 0.05f, y4, z4), Vector3f(x4 + 0.05f, y4)},
-{Vector3f(x4 + 0.05f, y4 + 0.05f, z4), Vector3f(x4 + 0.05f, y4 + 0.05f)}, {Vector3f(x4, y4 + 0.05f, z4), Vector3f(x4, y4 + 0.05f)},
-{Vector3f(x4, y4, z4 + 0.05f), Vector3f(x4, y4)}, {Vector3f(x4 + 0.05f, y4, z4 + 0.05f), Vector3f(x4 + 0.05f, y4)},
-{Vector3f(x4 + 0.05f, y4 + 0.05f, z4 + 0.05f), Vector3f(x4 + 0.05f, y4 + 0.05f)}, {Vector3f(x4, y4 + 0.05f, z4 + 0.05f), Vector3f(x4, y4 + 0.05f)},
-{Vector3f(x5, y5 + 0.05f, z5), Vector3f(z5, x5)}, {Vector3f(x5 + 0.05f, y5 + 0.05f, z5), Vector3f(z5, x5 + 0.05f)},
-{Vector3f(x5 + 0.05f, y5 + 0.05f, z5 + 0.05f), Vector3f(z5 + 0.05f, x5 + 0.05f)}, {Vector3f(x5, y5 + 0.05f, z5 + 0.05f), Vector3f(z5 + 0.05f, x5)},
-{Vector3f(x5, y5, z5), Vector3f(z5, x5)}, {Vector3f(x5 + 0.05f, y5, z5), Vector3f(z5, x5 + 0.05f)},
-{Vector3f(x5 + 0.05f, y5, z5 + 0.05f), Vector3f(z5 + 0.05f, x5 + 0.05f)}, {Vector3f(x5, y5, z5 + 0.05f), Vector3f(z5 + 0.05f, x5)},
-{Vector3f(x5, y5, z5 + 0.05f), Vector3f(z5 + 0.05f, y5)}, {Vector3f(x5, y5, z5), Vector3f(z5, y5)},
-{Vector3f(x5, y5 + 0.05f, z5), Vector3f(z5, y5 + 0.05f)}, {Vector3f(x5, y5 + 0.05f, z5 + 0.05f), Vector3f(z5 + 0.05f, y5 + 0.05f)},
-{Vector3f(x5 + 0.05f, y5, z5 + 0.05f), Vector3f(z5 + 0.05f, y5)}, {Vector3f(x5 + 0.05f, y5, z5), Vector3f(z5, y5)},
-{Vector3f(x5 + 0.05f, y5 + 0.05f, z5), Vector3f(z5, y5 + 0.05f)}, {Vector3f(x5 + 0.05f, y5 + 0.05f, z5 + 0.05f), Vector3f(z5 + 0.05f, y5 + 0.05f)},
-{Vector3f(x5, y5, z5), Vector3f(x5, y5)}, {Vector3f(x5 + 0.05f, y5, z5), Vector3f(x5 + 0.05f, y5)},
-{Vector3f(x5 + 0.05f, y5 + 0.05f, z5), Vector3f(x5 + 0.05f, y5 + 0.05f)}, {Vector3f(x5, y5 + 0.05f, z5), Vector3f(x5, y5 + 0.05f)},
-{Vector3f(x5, y5, z5 + 0.05f), Vector3f(x5, y5)}, {Vector3f(x5 + 0.05f, y5, z5 + 0.05f), Vector3f(x5 + 0.05f, y5)},
-{Vector3f(x5 + 0.05f, y5 + 0.05f, z5 + 0.05f), Vector3f(x5 + 0.05f, y5 + 0.05f)}, {Vector3f(x5, y5 + 0.05f, z5 + 0.05f), Vector3f(x5, y5 + 0.05f)},
-{Vector3f(x6, y6 + 0.05f, z6), Vector3f(z6, x6)}, {Vector3f(x6 + 0.05f, y6 + 0.05f, z6), Vector3f(z6, x6 + 0.05f)},
-{Vector3f(x6 + 0.05f, y6 + 0.05f, z6 + 0.05f), Vector3f(z6 + 0.05f, x6 + 0.05f)}, {Vector3f(x6, y6 + 0.05f, z6 + 0.05f), Vector3f(z6 + 0.05f, x6)},
-{Vector3f(x6, y6, z6), Vector3f(z6, x6)}, {Vector3f(x6 + 0.05f, y6, z6), Vector3f(z6, x6 + 0.05f)},
-{Vector3f(x6 + 0.05f, y6, z6 + 0.05f), Vector3f(z6 + 0.05f, x6 + 0.05f)}, {Vector3f(x6, y6, z6 + 0.05f), Vector3f(z6 + 0.05f, x6)},
-{Vector3f(x6, y6, z6 + 0.05f), Vector3f(z6 + 0.05f, y6)}, {Vector3f(x6, y6, z6), Vector3f(z6, y6)},
-{Vector3f(x6, y6 + 0.05f, z6), Vector3f(z6, y6 + 0.05f)}, {Vector3f(x6, y6 + 0.05f, z6 + 0.05f), Vector3f(z6 + 0.05f, y6 + 0.05f)},
-{Vector3f(x6 + 0.05f, y6, z6 + 0.05f), Vector3f(z6 + 0.05f, y6)}, {Vector3f(x6 + 0.05f, y6, z6), Vector3f(z6, y6)},
-{Vector3f(x6 + 0.05f, y6 + 0.05f, z6), Vector3f(z6, y6 + 0.05f)}, {Vector3f(x6 + 0.05f, y6 + 0.05f, z6 + 0.05f), Vector3f(z6 + 0.05f, y6 + 0.05f)},
-{Vector3f(x6, y6, z6), Vector3f(x6, y6)}, {Vector3f(x6 + 0.05f, y6, z6), Vector3f(x6 + 0.05f, y6)},
-{Vector3f(x6 + 0.05f, y6 + 0.05f, z6), Vector3f(x6 + 0.05f, y6 + 0.05f)}, {Vector3f(x6, y6 + 0.05f, z6), Vector3f(x6, y6 + 0.05f)},
-{Vector3f(x6, y6, z6 + 0.05f), Vector3f(x6, y6)}, {Vector3f(x6 + 0.05f, y6, z6 + 0.05f), Vector3f(x6 + 0.05f, y6)},
-{Vector3f(x6 + 0.05f, y6 + 0.05f, z6 + 0.05f), Vector3f(x6 + 0.05f, y6 + 0.05f)}, {Vector3f(x6, y6 + 0.05f, z6 + 0.05f), Vector3f(x6, y6 + 0.05f)},
-{Vector3f(x7, y7 + 0.05f, z7), Vector3f(z7, x7)}, {Vector3f(x7 + 0.05f, y7 + 0.05f, z7), Vector3f(z7, x7 + 0.05f)},
-{Vector3f(x7 + 0.05f, y7 + 0.05f, z7 + 0.05f), Vector3f(z7 + 0.05f, x7 + 0.05f)}, {Vector3f(x7, y7 + 0.05f, z7 + 0.05f), Vector3f(z7 + 0.05f, x7)},
-{Vector3f(x7, y7, z7), Vector3f(z7, x7)}, {Vector3f(x7 + 0.05f, y7, z7), Vector3f(z7, x7 + 0.05f)},
-{Vector3f(x7 + 0.05f, y7, z7 + 0.05f), Vector3f(z7 + 0.05f, x7 + 0.05f)}, {Vector3f(x7, y7, z7 + 0.05f), Vector3f(z7 + 0.05f, x7)},
-{Vector3f(x7, y7, z7 + 0.05f), Vector3f(z7 + 0.05f, y7)}, {Vector3f(x7, y7, z7), Vector3f(z7, y7)},
-{Vector3f(x7, y7 + 0.05f, z7), Vector3f(z7, y7 + 0.05f)}, {Vector3f(x7, y7 + 0.05f, z7 + 0.05f), Vector3f(z7 + 0.05f, y7 + 0.05f)},
-{Vector3f(x7 + 0.05f, y7, z7 + 0.05f), Vector3f(z7 + 0.05f, y7)}, {Vector3f(x7 + 0.05f, y7, z7), Vector3f(z7, y7)},
-{Vector3f(x7 + 0.05f, y7 + 0.05f, z7), Vector3f(z7, y7 + 0.05f)}, {Vector3f(x7 + 0.05f, y7 + 0.05f, z7 + 0.05f), Vector3f(z7 + 0.05f, y7 + 0.05f)},
-{Vector3f(x7, y7, z7), Vector3f(x7, y7)}, {Vector3f(x7 + 0.05f, y7, z7), Vector3f(x7 + 0.05f, y7)},
-{Vector3f(x7 + 0.05f, y7 + 0.05f, z7), Vector3f(x7 + 0.05f, y7 + 0.05f)}, {Vector3f(x7, y7 + 0.05f, z7), Vector3f(x7, y7 + 0.05f)},
-{Vector3f(x7, y7, z7 + 0.05f), Vector3f(x7, y7)}, {Vector3f(x7 + 0.05f, y7, z7 + 0.05f), Vector3f(x7 + 0.05f, y7)},
-{Vector3f(x7 + 0.05f, y7 + 0.05f, z7 + 0.05f), Vector3f(x7 + 0.05f, y7 + 0.05f)}, {Vector3f(x7, y7 + 0.05f, z7 + 0.05f), Vector3f(x7, y7 + 0.05f)},
-{Vector3f(x8, y8 + 0.05f, z8), Vector3f(z8, x8)}, {Vector3f(x8 + 0.05f, y8 + 0.05f, z8), Vector3f(z8, x8 + 0.05f)},
-{Vector3f(x8 + 0.05f, y8 + 0.05f, z8 + 0.05f), Vector3f(z8 + 0.05f, x8 + 0.05f)}, {Vector3f(x8, y8 + 0.05f, z8 + 0.05f), Vector3f(z8 + 0.05f, x8)},
-{Vector3f(x8, y8, z8), Vector3f(z8, x8)}, {Vector3f(x8 + 0.05f, y8, z8), Vector3f(z8, x8 + 0.05f)},
-{Vector3f(x8 + 0.05f, y8, z8 + 0.05f), Vector3f(z8 + 0.05f, x8 + 0.05f)}, {Vector3f(x8, y8, z8 + 0.05f), Vector3f(z8 + 0.05f, x8)},
-{Vector3f(x8, y8, z8 + 0.05f), Vector3f(z8 + 0.05f, y8)}, {Vector3f(x8, y8, z8), Vector3f(z8, y8)},
-{Vector3f(x8, y8 + 0.05f, z8), Vector3f(z8, y8 + 0.05f)}, {Vector3f(x8, y8 + 0.05f, z8 + 0.05f), Vector3f(z8 + 0.05f, y8 + 0.05f)},
-{Vector3f(x8 + 0.05f, y8, z8 + 0.05f), Vector3f(z8 + 0.05f, y8)}, {Vector3f(x8 + 0.05f, y8, z8), Vector3f(z8, y8)},
-{Vector3f(x8 + 0.05f, y8 + 0.05f, z8), Vector3f(z8, y8 + 0.05f)}, {Vector3f(x8 + 0.05f, y8 + 0.05f, z8 + 0.05f), Vector3f(z8 + 0.05f, y8 + 0.05f)},
-{Vector3f(x8, y8, z8), Vector3f(x8, y8)}, {Vector3f(x8 + 0.05f, y8, z8), Vector3f(x8 + 0.05f, y8)},
-{Vector3f(x8 + 0.05f, y8 + 0.05f, z8), Vector3f(x8 + 0.05f, y8 + 0.05f)}, {Vector3f(x8, y8 + 0.05f, z8), Vector3f(x8, y8 + 0.05f)},
-{Vector3f(x8, y8, z8 + 0.05f), Vector3f(x8, y8)}, {Vector3f(x8 + 0.05f, y8, z8 + 0.05f), Vector3f(x8 + 0.05f, y8)},
-{Vector3f(x8 + 0.05f, y8 + 0.05f, z8 + 0.05f), Vector3f(x8 + 0.05f, y8 + 0.05f)}, {Vector3f(x8, y8 + 0.05f, z8 + 0.05f), Vector3f(x8, y8 + 0.05f)},
-{Vector3f(x9, y9 + 0.05f, z9), Vector3f(z9, x9)}, {Vector3f(x9 + 0.05f, y9 + 0.05f, z9), Vector3f(z9, x9 + 0.05f)},
-{Vector3f(x9 + 0.05f, y9 + 0.05f, z9 + 0.05f), Vector3f(z9 + 0.05f, x9 + 0.05f)}, {Vector3f(x9, y9 + 0.05f, z9 + 0.05f), Vector3f(z9 + 0.05f, x9)},
-{Vector3f(x9, y9, z9), Vector3f(z9, x9)}, {Vector3f(x9 + 0.05f, y9, z9), Vector3f(z9, x9 + 0.05f)},
-{Vector3f(x9 + 0.05f, y9, z9 + 0.05f), Vector3f(z9 + 0.05f, x9 + 0.05f)}, {Vector3f(x9, y9, z9 + 0.05f), Vector3f(z9 + 0.05f, x9)},
-{Vector3f(x9, y9, z9 + 0.05f), Vector3f(z9 + 0.05f, y9)}, {Vector3f(x9, y9, z9), Vector3f(z9, y9)},
-{Vector3f(x9, y9 + 0.05f, z9), Vector3f(z9, y9 + 0.05f)}, {Vector3f(x9, y9 + 0.05f, z9 + 0.05f), Vector3f(z9 + 0.05f, y9 + 0.05f)},
-{Vector3f(x9 + 0.05f, y9, z9 + 0.05f), Vector3f(z9 + 0.05f, y9)}, {Vector3f(x9 + 0.05f, y9, z9), Vector3f(z9, y9)},
-{Vector3f(x9 + 0.05f, y9 + 0.05f, z9), Vector3f(z9, y9 + 0.05f)}, {Vector3f(x9 + 0.05f, y9 + 0.05f, z9 + 0.05f), Vector3f(z9 + 0.05f, y9 + 0.05f)},
-{Vector3f(x9, y9, z9), Vector3f(x9, y9)}, {Vector3f(x9 + 0.05f, y9, z9), Vector3f(x9 + 0.05f, y9)},
-{Vector3f(x9 + 0.05f, y9 + 0.05f, z9), Vector3f(x9 + 0.05f, y9 + 0.05f)}, {Vector3f(x9, y9 + 0.05f, z9), Vector3f(x9, y9 + 0.05f)},
-{Vector3f(x9, y9, z9 + 0.05f), Vector3f(x9, y9)}, {Vector3f(x9 + 0.05f, y9, z9 + 0.05f), Vector3f(x9 + 0.05f, y9)},
-{Vector3f(x9 + 0.05f, y9 + 0.05f, z9 + 0.05f), Vector3f(x9 + 0.05f, y9 + 0.05f)}, {Vector3f(x9, y9 + 0.05f, z9 + 0.05f), Vector3f(x9, y9 + 0.05f)},
-{Vector3f(x10, y10 + 0.05f, z10), Vector3f(z10, x10)}, {Vector3f(x10 + 0.05f, y10 + 0.05f, z10), Vector3f(z10, x10 + 0.05f)},
-{Vector3f(x10 + 0.05f, y10 + 0.05f, z10 + 0.05f), Vector3f(z10 + 0.05f, x10 + 0.05f)}, {Vector3f(x10, y10 + 0.05f, z10 + 0.05f), Vector3f(z10 + 0.05f, x10)},
-{Vector3f(x10, y10, z10), Vector3f(z10, x10)}, {Vector3f(x10 + 0.05f, y10, z10), Vector3f(z10, x10 + 0.05f)},
-{Vector3f(x10 + 0.05f, y10, z10 + 0.05f), Vector3f(z10 + 0.05f, x10 + 0.05f)}, {Vector3f(x10, y10, z10 + 0.05f), Vector3f(z10 + 0.05f, x10)},
-{Vector3f(x10, y10, z10 + 0.05f), Vector3f(z10 + 0.05f, y10)}, {Vector3f(x10, y10, z10), Vector3f(z10, y10)},
-{Vector3f(x10, y10 + 0.05f, z10), Vector3f(z10, y10 + 0.05f)}, {Vector3f(x10, y10 + 0.05f, z10 + 0.05f), Vector3f(z10 + 0.05f, y10 + 0.05f)},
-{Vector3f(x10 + 0.05f, y10, z10 + 0.05f), Vector3f(z10 + 0.05f, y10)}, {Vector3f(x10 + 0.05f, y10, z10), Vector3f(z10, y10)},
-{Vector3f(x10 + 0.05f, y10 + 0.05f, z10), Vector3f(z10, y10 + 0.05f)}, {Vector3f(x10 + 0.05f, y10 + 0.05f, z10 + 0.05f), Vector3f(z10 + 0.05f, y10 + 0.05f)},
-{Vector3f(x10, y10, z10), Vector3f(x10, y10)}, {Vector3f(x10 + 0.05f, y10, z10), Vector3f(x10 + 0.05f, y10)},
-{Vector3f(x10 + 0.05f, y10 + 0.05f, z10), Vector3f(x10 + 0.05f, y10 + 0.05f)}, {Vector3f(x10, y10 + 0.05f, z10), Vector3f(x10, y10 + 0.05f)},
-{Vector3f(x10, y10, z10 + 0.05f), Vector3f(x10, y10)}, {Vector3f(x10 + 0.05f, y10, z10 + 0.05f), Vector3f(x10 + 0.05f, y10)},
-{Vector3f(x10 + 0.05f, y10 + 0.05f, z10 + 0.05f), Vector3f(x10 + 0.05f, y10 + 0.05f)}, {Vector3f(x10, y10 + 0.05f, z10 + 0.05f), Vector3f(x10, y10 + 0.05f)},
-{Vector3f(x11, y11 + 0.05f, z11), Vector3f(z11, x11)}, {Vector3f(x11 + 0.05f, y11 + 0.05f, z11), Vector3f(z11, x11 + 0.05f)},
-{Vector3f(x11 + 0.05f, y11 + 0.05f, z11 + 0.05f), Vector3f(z11 + 0.05f, x11 + 0.05f)}, {Vector3f(x11, y11 + 0.05f, z11 + 0.05f), Vector3f(z11 + 0.05f, x11)},
-{Vector3f(x11, y11, z11), Vector3f(z11, x11)}, {Vector3f(x11 + 0.05f, y11, z11), Vector3f(z11, x11 + 0.05f)},
-{Vector3f(x11 + 0.05f, y11, z11 + 0.05f), Vector3f(z11 + 0.05f, x11 + 0.05f)}, {Vector3f(x11, y11, z11 + 0.05f), Vector3f(z11 + 0.05f, x11)},
-{Vector3f(x11, y11, z11 + 0.05f), Vector3f(z11 + 0.05f, y11)}, {Vector3f(x11, y11, z11), Vector3f(z11, y11)},
-{Vector3f(x11, y11 + 0.05f, z11), Vector3f(z11, y11 + 0.05f)}, {Vector3f(x11, y11 + 0.05f, z11 + 0.05f), Vector3f(z11 + 0.05f, y11 + 0.05f)},
-{Vector3f(x11 + 0.05f, y11, z11 + 0.05f), Vector3f(z11 + 0.05f, y11)}, {Vector3f(x11 + 0.05f, y11, z11), Vector3f(z11, y11)},
-{Vector3f(x11 + 0.05f, y11 + 0.05f, z11), Vector3f(z11, y11 + 0.05f)}, {Vector3f(x11 + 0.05f, y11 + 0.05f, z11 + 0.05f), Vector3f(z11 + 0.05f, y11 + 0.05f)},
-{Vector3f(x11, y11, z11), Vector3f(x11, y11)}, {Vector3f(x11 + 0.05f, y11, z11), Vector3f(x11 + 0.05f, y11)},
-{Vector3f(x11 + 0.05f, y11 + 0.05f, z11), Vector3f(x11 + 0.05f, y11 + 0.05f)}, {Vector3f(x11, y11 + 0.05f, z11), Vector3f(x11, y11 + 0.05f)},
-{Vector3f(x11, y11, z11 + 0.05f), Vector3f(x11, y11)}, {Vector3f(x11 + 0.05f, y11, z11 + 0.05f), Vector3f(x11 + 0.05f, y11)},
-{Vector3f(x11 + 0.05f, y11 + 0.05f, z11 + 0.05f), Vector3f(x11 + 0.05f, y11 + 0.05f)}, {Vector3f(x11, y11 + 0.05f, z11 + 0.05f), Vector3f(x11, y11 + 0.05f)},
-{Vector3f(x12, y12 + 0.05f, z12), Vector3f(z12, x12)}, {Vector3f(x12 + 0.05f, y12 + 0.05f, z12), Vector3f(z12, x12 + 0.05f)},
-{Vector3f(x12 + 0.05f, y12 + 0.05f, z12 + 0.05f), Vector3f(z12 + 0.05f, x12 + 0.05f)}, {Vector3f(x12, y12 + 0.05f, z12 + 0.05f), Vector3f(z12 + 0.05f, x12)},
-{Vector3f(x12, y12, z12), Vector3f(z12, x12)}, {Vector3f(x12 + 0.05f, y12, z12), Vector3f(z12, x12 + 0.05f)},
-{Vector3f(x12 + 0.05f, y12, z12 + 0.05f), Vector3f(z12 + 0.05f, x12 + 0.05f)}, {Vector3f(x12, y12, z12 + 0.05f), Vector3f(z12 + 0.05f, x12)},
-{Vector3f(x12, y12, z12 + 0.05f), Vector3f(z12 + 0.05f, y12)}, {Vector3f(x12, y12, z12), Vector3f(z12, y12)},
-{Vector3f(x12, y12 + 0.05f, z12), Vector3f(z12, y12 + 0.05f)}, {Vector3f(x12, y12 + 0.05f, z12 + 0.05f), Vector3f(z12 + 0.05f, y12 + 0.05f)},
-{Vector3f(x12 + 0.05f, y12, z12 + 0.05f), Vector3f(z12 + 0.05f, y12)}, {Vector3f(x12 + 0.05f, y12, z12), Vector3f(z12, y12)},
-{Vector3f(x12 + 0.05f, y12 + 0.05f, z12), Vector3f(z12, y12 + 0.05f)}, {Vector3f(x12 + 0.05f, y12 + 0.05f, z12 + 0.05f), Vector3f(z12 + 0.05f, y12 + 0.05f)},
-{Vector3f(x12, y12, z12), Vector3f(x12, y12)}, {Vector3f(x12 + 0.05f, y12, z12), Vector3f(x12 + 0.05f, y12)},
-{Vector3f(x12 + 0.05f, y12 + 0.05f, z12), Vector3f(x12 + 0.05f, y12 + 0.05f)}, {Vector3f(x12, y12 + 0.05f, z12), Vector3f(x12, y12 + 0.05f)},
-{Vector3f(x12, y12, z12 + 0.05f), Vector3f(x12, y12)}, {Vector3f(x12 + 0.05f, y12, z12 + 0.05f), Vector3f(x12 + 0.05f, y12)},
-{Vector3f(x12 + 0.05f, y12 + 0.05f, z12 + 0.05f), Vector3f(x12 + 0.05f, y12 + 0.05f)}, {Vector3f(x12, y12 + 0.05f, z12 + 0.05f), Vector3f(x12, y12 + 0.05f)},
-{Vector3f(x13, y13 + 0.05f, z13), Vector3f(z13, x13)}, {Vector3f(x13 + 0.05f, y13 + 0.05f, z13), Vector3f(z13, x13 + 0.05f)},
-{Vector3f(x13 + 0.05f, y13 + 0.05f, z13 + 0.05f), Vector3f(z13 + 0.05f, x13 + 0.05f)}, {Vector3f(x13, y13 + 0.05f, z13 + 0.05f), Vector3f(z13 + 0.05f, x13)},
-{Vector3f(x13, y13, z13), Vector3f(z13, x13)}, {Vector3f(x13 + 0.05f, y13, z13), Vector3f(z13, x13 + 0.05f)},
-{Vector3f(x13 + 0.05f, y13, z13 + 0.05f), Vector3f(z13 + 0.05f, x13 + 0.05f)}, {Vector3f(x13, y13, z13 + 0.05f), Vector3f(z13 + 0.05f, x13)},
-{Vector3f(x13, y13, z13 + 0.05f), Vector3f(z13 + 0.05f, y13)}, {Vector3f(x13, y13, z13), Vector3f(z13, y13)},
-{Vector3f(x13, y13 + 0.05f, z13), Vector3f(z13, y13 + 0.05f)}, {Vector3f(x13, y13 + 0.05f, z13 + 0.05f), Vector3f(z13 + 0.05f, y13 + 0.05f)},
-{Vector3f(x13 + 0.05f, y13, z13 + 0.05f), Vector3f(z13 + 0.05f, y13)}, {Vector3f(x13 + 0.05f, y13, z13), Vector3f(z13, y13)},
-{Vector3f(x13 + 0.05f, y13 + 0.05f, z13), Vector3f(z13, y13 + 0.05f)}, {Vector3f(x13 + 0.05f, y13 + 0.05f, z13 + 0.05f), Vector3f(z13 + 0.05f, y13 + 0.05f)},
-{Vector3f(x13, y13, z13), Vector3f(x13, y13)}, {Vector3f(x13 + 0.05f, y13, z13), Vector3f(x13 + 0.05f, y13)},
-{Vector3f(x13 + 0.05f, y13 + 0.05f, z13), Vector3f(x13 + 0.05f, y13 + 0.05f)}, {Vector3f(x13, y13 + 0.05f, z13), Vector3f(x13, y13 + 0.05f)},
-{Vector3f(x13, y13, z13 + 0.05f), Vector3f(x13, y13)}, {Vector3f(x13 + 0.05f, y13, z13 + 0.05f), Vector3f(x13 + 0.05f, y13)},
-{Vector3f(x13 + 0.05f, y13 + 0.05f, z13 + 0.05f), Vector3f(x13 + 0.05f, y13 + 0.05f)}, {Vector3f(x13, y13 + 0.05f, z13 + 0.05f), Vector3f(x13, y13 + 0.05f)},
-{Vector3f(x14, y14 + 0.05f, z14), Vector3f(z14, x14)}, {Vector3f(x14 + 0.05f, y14 + 0.05f, z14), Vector3f(z14, x14 + 0.05f)},
-{Vector3f(x14 + 0.05f, y14 + 0.05f, z14 + 0.05f), Vector3f(z14 + 0.05f, x14 + 0.05f)}, {Vector3f(x14, y14 + 0.05f, z14 + 0.05f), Vector3f(z14 + 0.05f, x14)},
-{Vector3f(x14, y14, z14), Vector3f(z14, x14)}, {Vector3f(x14 + 0.05f, y14, z14), Vector3f(z14, x14 + 0.05f)},
-{Vector3f(x14 + 0.05f, y14, z14 + 0.05f), Vector3f(z14 + 0.05f, x14 + 0.05f)}, {Vector3f(x14, y14, z14 + 0.05f), Vector3f(z14 + 0.05f, x14)},
-{Vector3f(x14, y14, z14 + 0.05f), Vector3f(z14 + 0.05f, y14)}, {Vector3f(x14, y14, z14), Vector3f(z14, y14)},
-{Vector3f(x14, y14 + 0.05f, z14), Vector3f(z14, y14 + 0.05f)}, {Vector3f(x14, y14 + 0.05f, z14 + 0.05f), Vector3f(z14 + 0.05f, y14 + 0.05f)},
-{Vector3f(x14 + 0.05f, y14, z14 + 0.05f), Vector3f(z14 + 0.05f, y14)}, {Vector3f(x14 + 0.05f, y14, z14), Vector3f(z14, y14)},
-{Vector3f(x14 + 0.05f, y14 + 0.05f, z14), Vector3f(z14, y14 + 0.05f)}, {Vector3f(x14 + 0.05f, y14 + 0.05f, z14 + 0.05f), Vector3f(z14 + 0.05f, y14 + 0.05f)},
-{Vector3f(x14, y14, z14), Vector3f(x14, y14)}, {Vector3f(x14 + 0.05f, y14, z14), Vector3f(x14 + 0.05f, y14)},
-{Vector3f(x14 + 0.05f, y14 + 0.05f, z14), Vector3f(x14 + 0.05f, y14 + 0.05f)}, {Vector3f(x14, y14 + 0.05f, z14), Vector3f(x14, y14 + 0.05f)},
-{Vector3f(x14, y14, z14 + 0.05f), Vector3f(x14, y14)}, {Vector3f(x14 + 0.05f, y14, z14 + 0.05f), Vector3f(x14 + 0.05f, y14)},
-{Vector3f(x14 + 0.05f, y14 + 0.05f, z14 + 0.05f), Vector3f(x14 + 0.05f, y14 + 0.05f)}, {Vector3f(x14, y14 + 0.05f, z14 + 0.05f), Vector3f(x14, y14 + 0.05f)},
-{Vector3f(x15, y15 + 0.05f, z15), Vector3f(z15, x15)}, {Vector3f(x15 + 0.05f, y15 + 0.05f, z15), Vector3f(z15, x15 + 0.05f)},
-{Vector3f(x15 + 0.05f, y15 + 0.05f, z15 + 0.05f), Vector3f(z15 + 0.05f, x15 + 0.05f)}, {Vector3f(x15, y15 + 0.05f, z15 + 0.05f), Vector3f(z15 + 0.05f, x15)},
-{Vector3f(x15, y15, z15), Vector3f(z15, x15)}, {Vector3f(x15 + 0.05f, y15, z15), Vector3f(z15, x15 + 0.05f)},
-{Vector3f(x15 + 0.05f, y15, z15 + 0.05f), Vector3f(z15 + 0.05f, x15 + 0.05f)}, {Vector3f(x15, y15, z15 + 0.05f), Vector3f(z15 + 0.05f, x15)},
-{Vector3f(x15, y15, z15 + 0.05f), Vector3f(z15 + 0.05f, y15)}, {Vector3f(x15, y15, z15), Vector3f(z15, y15)},
-{Vector3f(x15, y15 + 0.05f, z15), Vector3f(z15, y15 + 0.05f)}, {Vector3f(x15, y15 + 0.05f, z15 + 0.05f), Vector3f(z15 + 0.05f, y15 + 0.05f)},
-{Vector3f(x15 + 0.05f, y15, z15 + 0.05f), Vector3f(z15 + 0.05f, y15)}, {Vector3f(x15 + 0.05f, y15, z15), Vector3f(z15, y15)},
-{Vector3f(x15 + 0.05f, y15 + 0.05f, z15), Vector3f(z15, y15 + 0.05f)}, {Vector3f(x15 + 0.05f, y15 + 0.05f, z15 + 0.05f), Vector3f(z15 + 0.05f, y15 + 0.05f)},
-{Vector3f(x15, y15, z15), Vector3f(x15, y15)}, {Vector3f(x15 + 0.05f, y15, z15), Vector3f(x15 + 0.05f, y15)},
-{Vector3f(x15 + 0.05f, y15 + 0.05f, z15), Vector3f(x15 + 0.05f, y15 + 0.05f)}, {Vector3f(x15, y15 + 0.05f, z15), Vector3f(x15, y15 + 0.05f)},
-{Vector3f(x15, y15, z15 + 0.05f), Vector3f(x15, y15)}, {Vector3f(x15 + 0.05f, y15, z15 + 0.05f), Vector3f(x15 + 0.05f, y15)},
-{Vector3f(x15 + 0.05f, y15 + 0.05f, z15 + 0.05f), Vector3f(x15 + 0.05f, y15 + 0.05f)}, {Vector3f(x15, y15 + 0.05f, z15 + 0.05f), Vector3f(x15, y15 + 0.05f)},
-{Vector3f(x16, y16 + 0.05f, z16), Vector3f(z16, x16)}, {Vector3f(x16 + 0.05f, y16 + 0.05f, z16), Vector3f(z16, x16 + 0.05f)},
-{Vector3f(x16 + 0.05f, y16 + 0.05f, z16 + 0.05f), Vector3f(z16 + 0.05f, x16 + 0.05f)}, {Vector3f(x16, y16 + 0.05f, z16 + 0.05f), Vector3f(z16 + 0.05f, x16)},
-{Vector3f(x16, y16, z16), Vector3f(z16, x16)}, {Vector3f(x16 + 0.05f, y16, z16), Vector3f(z16, x16 + 0.05f)},
-{Vector3f(x16 + 0.05f, y16, z16 + 0.05f), Vector3f(z16 + 0.05f, x16 + 0.05f)}, {Vector3f(x16, y16, z16 + 0.05f), Vector3f(z16 + 0.05f, x16)},
-{Vector3f(x16, y16, z16 + 0.05f), Vector3f(z16 + 0.05f, y16)}, {Vector3f(x16, y16, z16), Vector3f(z16, y16)},
-{Vector3f(x16, y16 + 0.05f, z16), Vector3f(z16, y16 + 0.05f)}, {Vector3f(x16, y16 + 0.05f, z16 + 0.05f), Vector3f(z16 + 0.05f, y16 + 0.05f)},
-{Vector3f(x16 + 0.05f, y16, z16 + 0.05f), Vector3f(z16 + 0.05f, y16)}, {Vector3f(x16 + 0.05f, y16, z16), Vector3f(z16, y16)},
-{Vector3f(x16 + 0.05f, y16 + 0.05f, z16), Vector3f(z16, y16 + 0.05f)}, {Vector3f(x16 + 0.05f, y16 + 0.05f, z16 + 0.05f), Vector3f(z16 + 0.05f, y16 + 0.05f)},
-{Vector3f(x16, y16, z16), Vector3f(x16, y16)}, {Vector3f(x16 + 0.05f, y16, z16), Vector3f(x16 + 0.05f, y16)},
-{Vector3f(x16 + 0.05f, y16 + 0.05f, z16), Vector3f(x16 + 0.05f, y16 + 0.05f)}, {Vector3f(x16, y16 + 0.05f, z16), Vector3f(x16, y16 + 0.05f)},
-{Vector3f(x16, y16, z16 + 0.05f), Vector3f(x16, y16)}, {Vector3f(x16 + 0.05f, y16, z16 + 0.05f), Vector3f(x16 + 0.05f, y16)},
-{Vector3f(x16 + 0.05f, y16 + 0.05f, z16 + 0.05f), Vector3f(x16 + 0.05f, y16 + 0.05f)}, {Vector3f(x16, y16 + 0.05f, z16 + 0.05f), Vector3f(x16, y16 + 0.05f)},
-{Vector3f(x17, y17 + 0.05f, z17), Vector3f(z17, x17)}, {Vector3f(x17 + 0.05f, y17 + 0.05f, z17), Vector3f(z17, x17 + 0.05f)},
-{Vector3f(x17 + 0.05f, y17 + 0.05f, z17 + 0.05f), Vector3f(z17 + 0.05f, x17 + 0.05f)}, {Vector3f(x17, y17 + 0.05f, z17 + 0.05f), Vector3f(z17 + 0.05f, x17)},
-{Vector3f(x17, y17, z17), Vector3f(z17, x17)}, {Vector3f(x17 + 0.05f, y17, z17), Vector3f(z17, x17 + 0.05f)},
-{Vector3f(x17 + 0.05f, y17, z17 + 0.05f), Vector3f(z17 + 0.05f, x17 + 0.05f)}, {Vector3f(x17, y17, z17 + 0.05f), Vector3f(z17 + 0.05f, x17)},
-{Vector3f(x17, y17, z17 + 0.05f), Vector3f(z17 + 0.05f, y17)}, {Vector3f(x17, y17, z17), Vector3f(z17, y17)},
-{Vector3f(x17, y17 + 0.05f, z17), Vector3f(z17, y17 + 0.05f)}, {Vector3f(x17, y17 + 0.05f, z17 + 0.05f), Vector3f(z17 + 0.05f, y17 + 0.05f)},
-{Vector3f(x17 + 0.05f, y17, z17 + 0.05f), Vector3f(z17 + 0.05f, y17)}, {Vector3f(x17 + 0.05f, y17, z17), Vector3f(z17, y17)},
-{Vector3f(x17 + 0.05f, y17 + 0.05f, z17), Vector3f(z17, y17 + 0.05f)}, {Vector3f(x17 + 0.05f, y17 + 0.05f, z17 + 0.05f), Vector3f(z17 + 0.05f, y17 + 0.05f)},
-{Vector3f(x17, y17, z17), Vector3f(x17, y17)}, {Vector3f(x17 + 0.05f, y17, z17), Vector3f(x17 + 0.05f, y17)},
-{Vector3f(x17 + 0.05f, y17 + 0.05f, z17), Vector3f(x17 + 0.05f, y17 + 0.05f)}, {Vector3f(x17, y17 + 0.05f, z17), Vector3f(x17, y17 + 0.05f)},
-{Vector3f(x17, y17, z17 + 0.05f), Vector3f(x17, y17)}, {Vector3f(x17 + 0.05f, y17, z17 + 0.05f), Vector3f(x17 + 0.05f, y17)},
-{Vector3f(x17 + 0.05f, y17 + 0.05f, z17 + 0.05f), Vector3f(x17 + 0.05f, y17 + 0.05f)}, {Vector3f(x17, y17 + 0.05f, z17 + 0.05f), Vector3f(x17, y17 + 0.05f)},
-{Vector3f(x18, y18 + 0.05f, z18), Vector3f(z18, x18)}, {Vector3f(x18 + 0.05f, y18 + 0.05f, z18), Vector3f(z18, x18 + 0.05f)},
-{Vector3f(x18 + 0.05f, y18 + 0.05f, z18 + 0.05f), Vector3f(z18 + 0.05f, x18 + 0.05f)}, {Vector3f(x18, y18 + 0.05f, z18 + 0.05f), Vector3f(z18 + 0.05f, x18)},
-{Vector3f(x18, y18, z18), Vector3f(z18, x18)}, {Vector3f(x18 + 0.05f, y18, z18), Vector3f(z18, x18 + 0.05f)},
-{Vector3f(x18 + 0.05f, y18, z18 + 0.05f), Vector3f(z18 + 0.05f, x18 + 0.05f)}, {Vector3f(x18, y18, z18 + 0.05f), Vector3f(z18 + 0.05f, x18)},
-{Vector3f(x18, y18, z18 + 0.05f), Vector3f(z18 + 0.05f, y18)}, {Vector3f(x18, y18, z18), Vector3f(z18, y18)},
-{Vector3f(x18, y18 + 0.05f, z18), Vector3f(z18, y18 + 0.05f)}, {Vector3f(x18, y18 + 0.05f, z18 + 0.05f), Vector3f(z18 + 0.05f, y18 + 0.05f)},
-{Vector3f(x18 + 0.05f, y18, z18 + 0.05f), Vector3f(z18 + 0.05f, y18)}, {Vector3f(x18 + 0.05f, y18, z18), Vector3f(z18, y18)},
-{Vector3f(x18 + 0.05f, y18 + 0.05f, z18), Vector3f(z18, y18 + 0.05f)}, {Vector3f(x18 + 0.05f, y18 + 0.05f, z18 + 0.05f), Vector3f(z18 + 0.05f, y18 + 0.05f)},
-{Vector3f(x18, y18, z18), Vector3f(x18, y18)}, {Vector3f(x18 + 0.05f, y18, z18), Vector3f(x18 + 0.05f, y18)},
-{Vector3f(x18 + 0.05f, y18 + 0.05f, z18), Vector3f(x18 + 0.05f, y18 + 0.05f)}, {Vector3f(x18, y18 + 0.05f, z18), Vector3f(x18, y18 + 0.05f)},
-{Vector3f(x18, y18, z18 + 0.05f), Vector3f(x18, y18)}, {Vector3f(x18 + 0.05f, y18, z18 + 0.05f), Vector3f(x18 + 0.05f, y18)},
-{Vector3f(x18 + 0.05f, y18 + 0.05f, z18 + 0.05f), Vector3f(x18 + 0.05f, y18 + 0.05f)}, {Vector3f(x18, y18 + 0.05f, z18 + 0.05f), Vector3f(x18, y18 + 0.05f)},
-{Vector3f(x19, y19 + 0.05f, z19), Vector3f(z19, x19)}, {Vector3f(x19 + 0.05f, y19 + 0.05f, z19), Vector3f(z19, x19 + 0.05f)},
-{Vector3f(x19 + 0.05f, y19 + 0.05f, z19 + 0.05f), Vector3f(z19 + 0.05f, x19 + 0.05f)}, {Vector3f(x19, y19 + 0.05f, z19 + 0.05f), Vector3f(z19 + 0.05f, x19)},
-{Vector3f(x19, y19, z19), Vector3f(z19, x19)}, {Vector3f(x19 + 0.05f, y19, z19), Vector3f(z19, x19 + 0.05f)},
-{Vector3f(x19 + 0.05f, y19, z19 + 0.05f), Vector3f(z19 + 0.05f, x19 + 0.05f)}, {Vector3f(x19, y19, z19 + 0.05f), Vector3f(z19 + 0.05f, x19)},
-{Vector3f(x19, y19, z19 + 0.05f), Vector3f(z19 + 0.05f, y19)}, {Vector3f(x19, y19, z19), Vector3f(z19, y19)},
-{Vector3f(x19, y19 + 0.05f, z19), Vector3f(z19, y19 + 0.05f)}, {Vector3f(x19, y19 + 0.05f, z19 + 0.05f), Vector3f(z19 + 0.05f, y19 + 0.05f)},
-{Vector3f(x19 + 0.05f, y19, z19 + 0.05f), Vector3f(z19 + 0.05f, y19)}, {Vector3f(x19 + 0.05f, y19, z19), Vector3f(z19, y19)},
-{Vector3f(x19 + 0.05f, y19 + 0.05f, z19), Vector3f(z19, y19 + 0.05f)}, {Vector3f(x19 + 0.05f, y19 + 0.05f, z19 + 0.05f), Vector3f(z19 + 0.05f, y19 + 0.05f)},
-{Vector3f(x19, y19, z19), Vector3f(x19, y19)}, {Vector3f(x19 + 0.05f, y19, z19), Vector3f(x19 + 0.05f, y19)},
-{Vector3f(x19 + 0.05f, y19 + 0.05f, z19), Vector3f(x19 + 0.05f, y19 + 0.05f)}, {Vector3f(x19, y19 + 0.05f, z19), Vector3f(x19, y19 + 0.05f)},
-{Vector3f(x19, y19, z19 + 0.05f), Vector3f(x19, y19)}, {Vector3f(x19 + 0.05f, y19, z19 + 0.05f), Vector3f(x19 + 0.05f, y19)},
-{Vector3f(x19 + 0.05f, y19 + 0.05f, z19 + 0.05f), Vector3f(x19 + 0.05f, y19 + 0.05f)}, {Vector3f(x19, y19 + 0.05f, z19 + 0.05f), Vector3f(x19, y19 + 0.05f)},
-{Vector3f(x20, y20 + 0.05f, z20), Vector3f(z20, x20)}, {Vector3f(x20 + 0.05f, y20 + 0.05f, z20), Vector3f(z20, x20 + 0.05f)},
-{Vector3f(x20 + 0.05f, y20 + 0.05f, z20 + 0.05f), Vector3f(z20 + 0.05f, x20 + 0.05f)}, {Vector3f(x20, y20 + 0.05f, z20 + 0.05f), Vector3f(z20 + 0.05f, x20)},
-{Vector3f(x20, y20, z20), Vector3f(z20, x20)}, {Vector3f(x20 + 0.05f, y20, z20), Vector3f(z20, x20 + 0.05f)},
-{Vector3f(x20 + 0.05f, y20, z20 + 0.05f), Vector3f(z20 + 0.05f, x20 + 0.05f)}, {Vector3f(x20, y20, z20 + 0.05f), Vector3f(z20 + 0.05f, x20)},
-{Vector3f(x20, y20, z20 + 0.05f), Vector3f(z20 + 0.05f, y20)}, {Vector3f(x20, y20, z20), Vector3f(z20, y20)},
-{Vector3f(x20, y20 + 0.05f, z20), Vector3f(z20, y20 + 0.05f)}, {Vector3f(x20, y20 + 0.05f, z20 + 0.05f), Vector3f(z20 + 0.05f, y20 + 0.05f)},
-{Vector3f(x20 + 0.05f, y20, z20 + 0.05f), Vector3f(z20 + 0.05f, y20)}, {Vector3f(x20 + 0.05f, y20, z20), Vector3f(z20, y20)},
-{Vector3f(x20 + 0.05f, y20 + 0.05f, z20), Vector3f(z20, y20 + 0.05f)}, {Vector3f(x20 + 0.05f, y20 + 0.05f, z20 + 0.05f), Vector3f(z20 + 0.05f, y20 + 0.05f)},
-{Vector3f(x20, y20, z20), Vector3f(x20, y20)}, {Vector3f(x20 + 0.05f, y20, z20), Vector3f(x20 + 0.05f, y20)},
-{Vector3f(x20 + 0.05f, y20 + 0.05f, z20), Vector3f(x20 + 0.05f, y20 + 0.05f)}, {Vector3f(x20, y20 + 0.05f, z20), Vector3f(x20, y20 + 0.05f)},
-{Vector3f(x20, y20, z20 + 0.05f), Vector3f(x20, y20)}, {Vector3f(x20 + 0.05f, y20, z20 + 0.05f), Vector3f(x20 + 0.05f, y20)},
-{Vector3f(x20 + 0.05f, y20 + 0.05f, z20 + 0.05f), Vector3f(x20 + 0.05f, y20 + 0.05f)}, {Vector3f(x20, y20 + 0.05f, z20 + 0.05f), Vector3f(x20, y20 + 0.05f)},
-{Vector3f(x21, y21 + 0.05f, z21), Vector3f(z21, x21)}, {Vector3f(x21 + 0.05f, y21 + 0.05f, z21), Vector3f(z21, x21 + 0.05f)},
-{Vector3f(x21 + 0.05f, y21 + 0.05f, z21 + 0.05f), Vector3f(z21 + 0.05f, x21 + 0.05f)}, {Vector3f(x21, y21 + 0.05f, z21 + 0.05f), Vector3f(z21 + 0.05f, x21)},
-{Vector3f(x21, y21, z21), Vector3f(z21, x21)}, {Vector3f(x21 + 0.05f, y21, z21), Vector3f(z21, x21 + 0.05f)},
-{Vector3f(x21 + 0.05f, y21, z21 + 0.05f), Vector3f(z21 + 0.05f, x21 + 0.05f)}, {Vector3f(x21, y21, z21 + 0.05f), Vector3f(z21 + 0.05f, x21)},
-{Vector3f(x21, y21, z21 + 0.05f), Vector3f(z21 + 0.05f, y21)}, {Vector3f(x21, y21, z21), Vector3f(z21, y21)},
-{Vector3f(x21, y21 + 0.05f, z21), Vector3f(z21, y21 + 0.05f)}, {Vector3f(x21, y21 + 0.05f, z21 + 0.05f), Vector3f(z21 + 0.05f, y21 + 0.05f)},
-{Vector3f(x21 + 0.05f, y21, z21 + 0.05f), Vector3f(z21 + 0.05f, y21)}, {Vector3f(x21 + 0.05f, y21, z21), Vector3f(z21, y21)},
-{Vector3f(x21 + 0.05f, y21 + 0.05f, z21), Vector3f(z21, y21 + 0.05f)}, {Vector3f(x21 + 0.05f, y21 + 0.05f, z21 + 0.05f), Vector3f(z21 + 0.05f, y21 + 0.05f)},
-{Vector3f(x21, y21, z21), Vector3f(x21, y21)}, {Vector3f(x21 + 0.05f, y21, z21), Vector3f(x21 + 0.05f, y21)},
-{Vector3f(x21 + 0.05f, y21 + 0.05f, z21), Vector3f(x21 + 0.05f, y21 + 0.05f)}, {Vector3f(x21, y21 + 0.05f, z21), Vector3f(x21, y21 + 0.05f)},
-{Vector3f(x21, y21, z21 + 0.05f), Vector3f(x21, y21)}, {Vector3f(x21 + 0.05f, y21, z21 + 0.05f), Vector3f(x21 + 0.05f, y21)},
-{Vector3f(x21 + 0.05f, y21 + 0.05f, z21 + 0.05f), Vector3f(x21 + 0.05f, y21 + 0.05f)}, {Vector3f(x21, y21 + 0.05f, z21 + 0.05f), Vector3f(x21, y21 + 0.05f)},
-{Vector3f(x22, y22 + 0.05f, z22), Vector3f(z22, x22)}, {Vector3f(x22 + 0.05f, y22 + 0.05f, z22), Vector3f(z22, x22 + 0.05f)},
-{Vector3f(x22 + 0.05f, y22 + 0.05f, z22 + 0.05f), Vector3f(z22 + 0.05f, x22 + 0.05f)}, {Vector3f(x22, y22 + 0.05f, z22 + 0.05f), Vector3f(z22 + 0.05f, x22)},
-{Vector3f(x22, y22, z22), Vector3f(z22, x22)}, {Vector3f(x22 + 0.05f, y22, z22), Vector3f(z22, x22 + 0.05f)},
-{Vector3f(x22 + 0.05f, y22, z22 + 0.05f), Vector3f(z22 + 0.05f, x22 + 0.05f)}, {Vector3f(x22, y22, z22 + 0.05f), Vector3f(z22 + 0.05f, x22)},
-{Vector3f(x22, y22, z22 + 0.05f), Vector3f(z22 + 0.05f, y22)}, {Vector3f(x22, y22, z22), Vector3f(z22, y22)},
-{Vector3f(x22, y22 + 0.05f, z22), Vector3f(z22, y22 + 0.05f)}, {Vector3f(x22, y22 + 0.05f, z22 + 0.05f), Vector3f(z22 + 0.05f, y22 + 0.05f)},
-{Vector3f(x22 + 0.05f, y22, z22 + 0.05f), Vector3f(z22 + 0.05f, y22)}, {Vector3f(x22 + 0.05f, y22, z22), Vector3f(z22, y22)},
-{Vector3f(x22 + 0.05f, y22 + 0.05f, z22), Vector3f(z22, y22 + 0.05f)}, {Vector3f(x22 + 0.05f, y22 + 0.05f, z22 + 0.05f), Vector3f(z22 + 0.05f, y22 + 0.05f)},
-{Vector3f(x22, y22, z22), Vector3f(x22, y22)}, {Vector3f(x22 + 0.05f, y22, z22), Vector3f(x22 + 0.05f, y22)},
-{Vector3f(x22 + 0.05f, y22 + 0.05f, z22), Vector3f(x22 + 0.05f, y22 + 0.05f)}, {Vector3f(x22, y22 + 0.05f, z22), Vector3f(x22, y22 + 0.05f)},
-{Vector3f(x22, y22, z22 + 0.05f), Vector3f(x22, y22)}, {Vector3f(x22 + 0.05f, y22, z22 + 0.05f), Vector3f(x22 + 0.05f, y22)},
-{Vector3f(x22 + 0.05f, y22 + 0.05f, z22 + 0.05f), Vector3f(x22 + 0.05f, y22 + 0.05f)}, {Vector3f(x22, y22 + 0.05f, z22 + 0.05f), Vector3f(x22, y22 + 0.05f)},
-{Vector3f(x23, y23 + 0.05f, z23), Vector3f(z23, x23)}, {Vector3f(x23 + 0.05f, y23 + 0.05f, z23), Vector3f(z23, x23 + 0.05f)},
-{Vector3f(x23 + 0.05f, y23 + 0.05f, z23 + 0.05f), Vector3f(z23 + 0.05f, x23 + 0.05f)}, {Vector3f(x23, y23 + 0.05f, z23 + 0.05f), Vector3f(z23 + 0.05f, x23)},
-{Vector3f(x23, y23, z23), Vector3f(z23, x23)}, {Vector3f(x23 + 0.05f, y23, z23), Vector3f(z23, x23 + 0.05f)},
-{Vector3f(x23 + 0.05f, y23, z23 + 0.05f), Vector3f(z23 + 0.05f, x23 + 0.05f)}, {Vector3f(x23, y23, z23 + 0.05f), Vector3f(z23 + 0.05f, x23)},
-{Vector3f(x23, y23, z23 + 0.05f), Vector3f(z23 + 0.05f, y23)}, {Vector3f(x23, y23, z23), Vector3f(z23, y23)},
-{Vector3f(x23, y23 + 0.05f, z23), Vector3f(z23, y23 + 0.05f)}, {Vector3f(x23, y23 + 0.05f, z23 + 0.05f), Vector3f(z23 + 0.05f, y23 + 0.05f)},
-{Vector3f(x23 + 0.05f, y23, z23 + 0.05f), Vector3f(z23 + 0.05f, y23)}, {Vector3f(x23 + 0.05f, y23, z23), Vector3f(z23, y23)},
-{Vector3f(x23 + 0.05f, y23 + 0.05f, z23), Vector3f(z23, y23 + 0.05f)}, {Vector3f(x23 + 0.05f, y23 + 0.05f, z23 + 0.05f), Vector3f(z23 + 0.05f, y23 + 0.05f)},
-{Vector3f(x23, y23, z23), Vector3f(x23, y23)}, {Vector3f(x23 + 0.05f, y23, z23), Vector3f(x23 + 0.05f, y23)},
-{Vector3f(x23 + 0.05f, y23 + 0.05f, z23), Vector3f(x23 + 0.05f, y23 + 0.05f)}, {Vector3f(x23, y23 + 0.05f, z23), Vector3f(x23, y23 + 0.05f)},
-{Vector3f(x23, y23, z23 + 0.05f), Vector3f(x23, y23)}, {Vector3f(x23 + 0.05f, y23, z23 + 0.05f), Vector3f(x23 + 0.05f, y23)},
-{Vector3f(x23 + 0.05f, y23 + 0.05f, z23 + 0.05f), Vector3f(x23 + 0.05f, y23 + 0.05f)}, {Vector3f(x23, y23 + 0.05f, z23 + 0.05f), Vector3f(x23, y23 + 0.05f)},
-{Vector3f(x24, y24 + 0.05f, z24), Vector3f(z24, x24)}, {Vector3f(x24 + 0.05f, y24 + 0.05f, z24), Vector3f(z24, x24 + 0.05f)},
-{Vector3f(x24 + 0.05f, y24 + 0.05f, z24 + 0.05f), Vector3f(z24 + 0.05f, x24 + 0.05f)}, {Vector3f(x24, y24 + 0.05f, z24 + 0.05f), Vector3f(z24 + 0.05f, x24)},
-{Vector3f(x24, y24, z24), Vector3f(z24, x24)}, {Vector3f(x24 + 0.05f, y24, z24), Vector3f(z24, x24 + 0.05f)},
-{Vector3f(x24 + 0.05f, y24, z24 + 0.05f), Vector3f(z24 + 0.05f, x24 + 0.05f)}, {Vector3f(x24, y24, z24 + 0.05f), Vector3f(z24 + 0.05f, x24)},
-{Vector3f(x24, y24, z24 + 0.05f), Vector3f(z24 + 0.05f, y24)}, {Vector3f(x24, y24, z24), Vector3f(z24, y24)},
-{Vector3f(x24, y24 + 0.05f, z24), Vector3f(z24, y24 + 0.05f)}, {Vector3f(x24, y24 + 0.05f, z24 + 0.05f), Vector3f(z24 + 0.05f, y24 + 0.05f)},
-{Vector3f(x24 + 0.05f, y24, z24 + 0.05f), Vector3f(z24 + 0.05f, y24)}, {Vector3f(x24 + 0.05f, y24, z24), Vector3f(z24, y24)},
-{Vector3f(x24 + 0.05f, y24 + 0.05f, z24), Vector3f(z24, y24 + 0.05f)}, {Vector3f(x24 + 0.05f, y24 + 0.05f, z24 + 0.05f), Vector3f(z24 + 0.05f, y24 + 0.05f)},
-{Vector3f(x24, y24, z24), Vector3f(x24, y24)}, {Vector3f(x24 + 0.05f, y24, z24), Vector3f(x24 + 0.05f, y24)},
-{Vector3f(x24 + 0.05f, y24 + 0.05f, z24), Vector3f(x24 + 0.05f, y24 + 0.05f)}, {Vector3f(x24, y24 + 0.05f, z24), Vector3f(x24, y24 + 0.05f)},
-{Vector3f(x24, y24, z24 + 0.05f), Vector3f(x24, y24)}, {Vector3f(x24 + 0.05f, y24, z24 + 0.05f), Vector3f(x24 + 0.05f, y24)},
-{Vector3f(x24 + 0.05f, y24 + 0.05f, z24 + 0.05f), Vector3f(x24 + 0.05f, y24 + 0.05f)}, {Vector3f(x24, y24 + 0.05f, z24 + 0.05f), Vector3f(x24, y24 + 0.05f)},
-{Vector3f(x25, y25 + 0.05f, z25), Vector3f(z25, x25)}, {Vector3f(x25 + 0.05f, y25 + 0.05f, z25), Vector3f(z25, x25 + 0.05f)},
-{Vector3f(x25 + 0.05f, y25 + 0.05f, z25 + 0.05f), Vector3f(z25 + 0.05f, x25 + 0.05f)}, {Vector3f(x25, y25 + 0.05f, z25 + 0.05f), Vector3f(z25 + 0.05f, x25)},
-{Vector3f(x25, y25, z25), Vector3f(z25, x25)}, {Vector3f(x25 + 0.05f, y25, z25), Vector3f(z25, x25 + 0.05f)},
-{Vector3f(x25 + 0.05f, y25, z25 + 0.05f), Vector3f(z25 + 0.05f, x25 + 0.05f)}, {Vector3f(x25, y25, z25 + 0.05f), Vector3f(z25 + 0.05f, x25)},
-{Vector3f(x25, y25, z25 + 0.05f), Vector3f(z25 + 0.05f, y25)}, {Vector3f(x25, y25, z25), Vector3f(z25, y25)},
-{Vector3f(x25, y25 + 0.05f, z25), Vector3f(z25, y25 + 0.05f)}, {Vector3f(x25, y25 + 0.05f, z25 + 0.05f), Vector3f(z25 + 0.05f, y25 + 0.05f)},
-{Vector3f(x25 + 0.05f, y25, z25 + 0.05f), Vector3f(z25 + 0.05f, y25)}, {Vector3f(x25 + 0.05f, y25, z25), Vector3f(z25, y25)},
-{Vector3f(x25 + 0.05f, y25 + 0.05f, z25), Vector3f(z25, y25 + 0.05f)}, {Vector3f(x25 + 0.05f, y25 + 0.05f, z25 + 0.05f), Vector3f(z25 + 0.05f, y25 + 0.05f)},
-{Vector3f(x25, y25, z25), Vector3f(x25, y25)}, {Vector3f(x25 + 0.05f, y25, z25), Vector3f(x25 + 0.05f, y25)},
-{Vector3f(x25 + 0.05f, y25 + 0.05f, z25), Vector3f(x25 + 0.05f, y25 + 0.05f)}, {Vector3f(x25, y25 + 0.05f, z25), Vector3f(x25, y25 + 0.05f)},
-{Vector3f(x25, y25, z25 + 0.05f), Vector3f(x25, y25)}, {Vector3f(x25 + 0.05f, y25, z25 + 0.05f), Vector3f(x25 + 0.05f, y25)},
-{Vector3f(x25 + 0.05f, y25 + 0.05f, z25 + 0.05f), Vector3f(x25 + 0.05f, y25 + 0.05f)}, {Vector3f(x25, y25 + 0.05f, z25 + 0.05f), Vector3f(x25, y25 + 0.05f)}
-};
+Matrix4f combined = proj * view * GetMatrix();
+Draw(Fill->Mono, &combined, 1, GL_TRIANGLES);
+}
 
-GLushort CubeIndices25[] =
+// Stick figure: a vertex per joint of the topology, a line per bone
+template <class Topology>
+void AddSkeleton(const float* x, const float* y, const float* z, DWORD c)
 {
-0, 1, 3, 3, 1, 2,
-5, 4, 6, 6, 4, 7,
-8, 9, 11, 11, 9, 10,
-13, 12, 14, 14, 12, 15,
-16, 17, 19, 19, 17, 18,
-21, 20, 22, 22, 20, 23,
-24, 25, 27, 27, 25, 26,
-29, 28, 30, 30, 28, 31,
-32, 33, 35, 35, 33, 34,
-37, 36, 38, 38, 36, 39,
-40, 41, 43, 43, 41, 42,
-45, 44, 46, 46, 44, 47,
-48, 49, 51, 51, 49, 50,
-53, 52, 54, 54, 52, 55,
-56, 57, 59, 59, 57, 58,
-61, 60, 62, 62, 60, 63,
-64, 65, 67, 67, 65, 66,
-69, 68, 70, 70, 68, 71,
-72, 73, 75, 75, 73, 74,
-77, 76, 78, 78, 76, 79,
-80, 81, 83, 83, 81, 82,
-85, 84, 86, 86, 84, 87,
-88, 89, 91, 91, 89, 90,
-93, 92, 94, 94, 92, 95,
-96, 97, 99, 99, 97, 98,
-101, 100, 102, 102, 100, 103,
-104, 105, 107, 107, 105, 106,
-109, 108, 110, 110, 108, 111,
-112, 113, 115, 115, 113, 114,
-117, 116, 118, 118, 116, 119,
-120, 121, 123, 123, 121, 122,
-125, 124, 126, 126, 124, 127,
-128, 129, 131, 131, 129, 130,
-133, 132, 134, 134, 132, 135,
-136, 137, 139, 139, 137, 138,
-141, 140, 142, 142, 140, 143,
-144, 145, 147, 147, 145, 146,
-149, 148, 150, 150, 148, 151,
-152, 153, 155, 155, 153, 154,
-157, 156, 158, 158, 156, 159,
-160, 161, 163, 163, 161, 162,
-165, 164, 166, 166, 164, 167,
-168, 169, 171, 171, 169, 170,
-173, 172, 174, 174, 172, 175,
-176, 177, 179, 179, 177, 178,
-181, 180, 182, 182, 180, 183,
-184, 185, 187, 187, 185, 186,
-189, 188, 190, 190, 188, 191,
-192, 193, 195, 195, 193, 194,
-197, 196, 198, 198, 196, 199,
-200, 201, 203, 203, 201, 202,
-205, 204, 206, 206, 204, 207,
-208, 209, 211, 211, 209, 210,
-213, 212, 214, 214, 212, 215,
-216, 217, 219, 219, 217, 218,
-221, 220, 222, 222, 220, 223,
-224, 225, 227, 227, 225, 226,
-229, 228, 230, 230, 228, 231,
-232, 233, 235, 235, 233, 234,
-237, 236, 238, 238, 236, 239,
-240, 241, 243, 243, 241, 242,
-245, 244, 246, 246, 244, 247,
-248, 249, 251, 251, 249, 250,
-253, 252, 254, 254, 252, 255,
-256, 257, 259, 259, 257, 258,
-261, 260, 262, 262, 260, 263,
-264, 265, 267, 267, 265, 266,
-269, 268, 270, 270, 268, 271,
-272, 273, 275, 275, 273, 274,
-277, 276, 278, 278, 276, 279,
-280, 281, 283, 283, 281, 282,
-285, 284, 286, 286, 284, 287,
-288, 289, 291, 291, 289, 290,
-293, 292, 294, 294, 292, 295,
-296, 297, 299, 299, 297, 298,
-301, 300, 302, 302, 300, 303,
-304, 305, 307, 307, 305, 306,
-309, 308, 310, 310, 308, 311,
-312, 313, 315, 315, 313, 314,
-317, 316, 318, 318, 316, 319,
-320, 321, 323, 323, 321, 322,
-325, 324, 326, 326, 324, 327,
-328, 329, 331, 331, 329, 330,
-333, 332, 334, 334, 332, 335,
-336, 337, 339, 339, 337, 338,
-341, 340, 342, 342, 340, 343,
-344, 345, 347, 347, 345, 346,
-349, 348, 350, 350, 348, 351,
-352, 353, 355, 355, 353, 354,
-357, 356, 358, 358, 356, 359,
-360, 361, 363, 363, 361, 362,
-365, 364, 366, 366, 364, 367,
-368, 369, 371, 371, 369, 370,
-373, 372, 374, 374, 372, 375,
-376, 377, 379, 379, 377, 378,
-381, 380, 382, 382, 380, 383,
-384, 385, 387, 387, 385, 386,
-389, 388, 390, 390, 388, 391,
-392, 393, 395, 395, 393, 394,
-397, 396, 398, 398, 396, 399,
-400, 401, 403, 403, 401, 402,
-405, 404, 406, 406, 404, 407,
-408, 409, 411, 411, 409, 410,
-413, 412, 414, 414, 412, 415,
-416, 417, 419, 419, 417, 418,
-421, 420, 422, 422, 420, 423,
-424, 425, 427, 427, 425, 426,
-429, 428, 430, 430, 428, 431,
-432, 433, 435, 435, 433, 434,
-437, 436, 438, 438, 436, 439,
-440, 441, 443, 443, 441, 442,
-445, 444, 446, 446, 444, 447,
-448, 449, 451, 451, 449, 450,
-453, 452, 454, 454, 452, 455,
-456, 457, 459, 459, 457, 458,
-461, 460, 462, 462, 460, 463,
-464, 465, 467, 467, 465, 466,
-469, 468, 470, 470, 468, 471,
-472, 473, 475, 475, 473, 474,
-477, 476, 478, 478, 476, 479,
-480, 481, 483, 483, 481, 482,
-485, 484, 486, 486, 484, 487,
-488, 489, 491, 491, 489, 490,
-493, 492, 494, 494, 492, 495,
-496, 497, 499, 499, 497, 498,
-501, 500, 502, 502, 500, 503,
-504, 505, 507, 507, 505, 506,
-509, 508, 510, 510, 508, 511,
-512, 513, 515, 515, 513, 514,
-517, 516, 518, 518, 516, 519,
-520, 521, 523, 523, 521, 522,
-525, 524, 526, 526, 524, 527,
-528, 529, 531, 531, 529, 530,
-533, 532, 534, 534, 532, 535,
-536, 537, 539, 539, 537, 538,
-541, 540, 542, 542, 540, 543,
-544, 545, 547, 547, 545, 546,
-549, 548, 550, 550, 548, 551,
-552, 553, 555, 555, 553, 554,
-557, 556, 558, 558, 556, 559,
-560, 561, 563, 563, 561, 562,
-565, 564, 566, 566, 564, 567,
-568, 569, 571, 571, 569, 570,
-573, 572, 574, 574, 572, 575,
-576, 577, 579, 579, 577, 578,
-581, 580, 582, 582, 580, 583,
-584, 585, 587, 587, 585, 586,
-589, 588, 590, 590, 588, 591,
-592, 593, 595, 595, 593, 594,
-597, 596, 598, 598, 596, 599
-};
+GLushort indices[2 * Topology::BoneCount];
+SkeletonLineIndices<Topology>(indices, GLushort(numVertices));
+for (int i = 0; i < 2 * Topology::BoneCount; ++i)
+AddIndex(indices[i]);
 
-for (int i = 0; i < sizeof(CubeIndices25) / sizeof(CubeIndices25[0]); ++i)
-AddIndex(CubeIndices25[i] + GLushort(numVertices));
-
-// Generate a quad for each box face
-//for (int v = 0; v < 6 * 4; v++)
-for (int v = 0; v < 600; v++)
-{
+ForEachJoint<Topology>([&](int j) {
 // Make vertices, with some token lighting
-Vertex vvv; vvv.Pos = Vert[v][0]; vvv.U = Vert[v][1].x; vvv.V = Vert[v][1].y;
+Vertex vvv; vvv.Pos = Vector3f(x[j], y[j], z[j]); vvv.U = 0; vvv.V = 0;
 float dist1 = (vvv.Pos - Vector3f(-2, 4, -2)).Length();
 float dist2 = (vvv.Pos - Vector3f(3, 4, -3)).Length();
 float dist3 = (vvv.Pos - Vector3f(-4, 3, 25)).Length();
@@ -1177,138 +826,309 @@ vvv.C = (c & 0xff000000) +
 ((G > 255 ? 255 : DWORD(G)) << 8) +
 (B > 255 ? 255 : DWORD(B));
 AddVertex(vvv);
+});
 }
+void AddSkeleton(const float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3, float x4, float y4, float z4, float x5, float y5, float z5, float x6, float y6, float z6, float x7, float y7, float z7, float x8, float y8, float z8, float x9, float y9, float z9, float x10, float y10, float z10, float x11, float y11, float z11, float x12, float y12, float z12, float x13, float y13, float z13, float x14, float y14, float z14, float x15, float y15, float z15, float x16, float y16, float z16, float x17, float y17, float z17, float x18, float y18, float z18, float x19, float y19, float z19, float x20, float y20, float z20, float x21, float y21, float z21, float x22, float y22, float z22, float x23, float y23, float z23, float x24, float y24, float z24, float x25, float y25, float z25, DWORD c)
+{
+const float x[] = { x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15, x16, x17, x18, x19, x20, x21, x22, x23, x24, x25 };
+const float y[] = { y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11, y12, y13, y14, y15, y16, y17, y18, y19, y20, y21, y22, y23, y24, y25 };
+const float z[] = { z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11, z12, z13, z14, z15, z16, z17, z18, z19, z20, z21, z22, z23, z24, z25 };
+AddSkeleton<KinectV2Topology>(x, y, z, c);
 }
-void Render(Matrix4f view, Matrix4f proj)
+// Room for KINECT_MAX_BODIES skeletons drawn as lines; UpdateSkeletonBatch
+// moves them. Call before AllocateBuffers, on an otherwise empty model.
+void AddSkeletonBatch()
+{
+GLushort indices[2 * KinectV2Topology::BoneCount];
+Vertex vertex;
+vertex.Pos = Vector3f(0, 0, 0); vertex.C = 0; vertex.U = vertex.V = 0;
+for (int b = 0; b < KINECT_MAX_BODIES; ++b) {
+SkeletonLineIndices<KinectV2Topology>(indices, GLushort(numVertices));
+for (int i = 0; i < 2 * KinectV2Topology::BoneCount; ++i)
+AddIndex(indices[i]);
+for (int j = 0; j < KinectJoint_Count; ++j)
+AddVertex(vertex);
+}
+}
+// One buffer update for every tracked body of the batch (colors per lane,
+// 0xAABBGGRR like AddSkeleton); untracked lanes are not drawn
+void UpdateSkeletonBatch(const SkeletonBatch& batch, const DWORD* colors)
+{
+int bodies = 0;
+for (int l = 0; l < KINECT_MAX_BODIES; ++l) {
+if (!batch.TrackingId[l])
+continue;
+DWORD c = colors[l];
+DWORD argb = (c & 0xff00ff00) | ((c & 0xff) << 16) | ((c >> 16) & 0xff);
+Vertex* v = &Vertices[bodies++ * KinectJoint_Count];
+for (int j = 0; j < KinectJoint_Count; ++j) {
+v[j].Pos = Vector3f(batch.X[j][l], batch.Y[j][l], batch.Z[j][l]);
+v[j].C = argb;
+}
+}
+if (bodies)
+vertexBuffer->Update(&Vertices[0], bodies * KinectJoint_Count * sizeof(Vertices[0]));
+numIndices = bodies * 2 * KinectV2Topology::BoneCount;
+}
+// A vertex per rig bone and a line to its parent; UpdateRigSkeleton moves
+// them. Call before AllocateBuffers, on an otherwise empty model.
+void AddRigSkeleton(const AnimRig& rig)
+{
+Vertex vertex;
+vertex.Pos = Vector3f(0, 0, 0); vertex.C = 0; vertex.U = vertex.V = 0;
+for (int i = 0; i < rig.NumBones(); ++i) {
+if (rig.Bones[i].Parent < 0)
+continue;
+AddIndex(GLushort(numVertices + rig.Bones[i].Parent));
+AddIndex(GLushort(numVertices + i));
+}
+for (int i = 0; i < rig.NumBones(); ++i)
+AddVertex(vertex);
+}
+// Model-space joints in rig units, moved to origin and scaled to metres
+// (color 0xAABBGGRR like AddSkeleton)
+void UpdateRigSkeleton(const vector<Float3>& joints, const Float3& origin, float scale, DWORD c)
+{
+DWORD argb = (c & 0xff00ff00) | ((c & 0xff) << 16) | ((c >> 16) & 0xff);
+for (size_t i = 0; i < joints.size(); ++i) {
+Vertices[i].Pos = Vector3f((joints[i].x - origin.x) * scale, (joints[i].y - origin.y) * scale, (joints[i].z - origin.z) * scale);
+Vertices[i].C = argb;
+}
+vertexBuffer->Update(&Vertices[0], joints.size() * sizeof(Vertices[0]));
+}
+void RenderLines(Matrix4f view, Matrix4f proj)
 {
 Matrix4f combined = proj * view * GetMatrix();
-
-glUseProgram(Fill->program);
-glUniform1i(glGetUniformLocation(Fill->program, "Texture0"), 0);
-glUniformMatrix4fv(glGetUniformLocation(Fill->program, "matWVP"), 1, GL_TRUE, (FLOAT*)&combined);
-
+Draw(Fill->Mono, &combined, 1, GL_LINES);
+}
+// Both eyes in one instanced draw: instance 0 lands in the left half of the
+// render target, instance 1 in the right (see the stereo vertex shader in
+// Scene::Init). GL_TRIANGLES is textured like Render, other modes are not.
+void RenderStereo(const Matrix4f viewProj[2], GLenum mode)
+{
+Matrix4f combined[2] = { viewProj[0] * GetMatrix(), viewProj[1] * GetMatrix() };
+Draw(Fill->Stereo, combined, 2, mode);
+}
+// One matrix per eye; GL_TRIANGLES is textured, the other modes draw
+// without TexCoord (the sampler reads texel 0, 0)
+void Draw(const ProgramReflection& program, const Matrix4f* combined, int eyes, GLenum mode)
+{
+bool textured = mode == GL_TRIANGLES;
+glUseProgram(program.program);
+glUniformMatrix4fv(program.matWVP, eyes, GL_TRUE, (FLOAT*)combined);
+if (textured) {
 glActiveTexture(GL_TEXTURE0);
 glBindTexture(GL_TEXTURE_2D, Fill->texture->texId);
-
-glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->buffer);
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->buffer);
-
-GLuint posLoc = glGetAttribLocation(Fill->program, "Position");
-GLuint colorLoc = glGetAttribLocation(Fill->program, "Color");
-GLuint uvLoc = glGetAttribLocation(Fill->program, "TexCoord");
-
-glEnableVertexAttribArray(posLoc);
-glEnableVertexAttribArray(colorLoc);
-glEnableVertexAttribArray(uvLoc);
-
-glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, Pos));
-glVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, C));
-glVertexAttribPointer(uvLoc, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, U));
-
-glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, NULL);
-
-glDisableVertexAttribArray(posLoc);
-glDisableVertexAttribArray(colorLoc);
-glDisableVertexAttribArray(uvLoc);
-
-glBindBuffer(GL_ARRAY_BUFFER, 0);
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
+}
+glBindVertexArray(textured ? texturedVao : plainVao);
+if (eyes == 1)
+glDrawElements(mode, numIndices, GL_UNSIGNED_SHORT, NULL);
+else
+glDrawElementsInstanced(mode, numIndices, GL_UNSIGNED_SHORT, NULL, eyes);
+glBindVertexArray(0);
 glUseProgram(0);
 }
+};
 
-void AddSkeleton(const float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3, float x4, float y4, float z4, float x5, float y5, float z5, float x6, float y6, float z6, float x7, float y7, float z7, float x8, float y8, float z8, float x9, float y9, float z9, float x10, float y10, float z10, float x11, float y11, float z11, float x12, float y12, float z12, float x13, float y13, float z13, float x14, float y14, float z14, float x15, float y15, float z15, float x16, float y16, float z16, float x17, float y17, float z17, float x18, float y18, float z18, float x19, float y19, float z19, float x20, float y20, float z20, float x21, float y21, float z21, float x22, float y22, float z22, float x23, float y23, float z23, float x24, float y24, float z24, float x25, float y25, float z25, DWORD c)
+//---------------------------------------------------------------------------
+// Static room geometry in one vertex / index pool.
+//
+// Models added here are finished (no AllocateBuffers) and never move again:
+// their transform is baked into the vertices, their indices are rebased into
+// 32-bit ones and they are grouped by material, so every material's models
+// sit back to back in the pool. Each model becomes one indirect draw command
+// and each material one glMultiDrawElementsIndirect, per pass. Without GL 4.3
+// the contiguous range of a material is drawn with a single glDrawElements,
+// which is why every model is padded to a multiple of 6 indices with its last
+// one: the padding is degenerate as triangles, lines and points alike, and a
+// model's lines never pair up with the next model's. RenderStereo draws
+// every command with two instances, one per eye, like Model::RenderStereo.
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+typedef void (APIENTRY* MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+struct StaticBatch
 {
-Vector3f Vert[][2] =
+struct DrawCommand // DrawElementsIndirectCommand
 {
-{Vector3f(x1, y1, z1)},
-{Vector3f(x2, y2, z2)},
-{Vector3f(x3, y3, z3)},
-{Vector3f(x4, y4, z4)},
-{Vector3f(x5, y5, z5)},
-{Vector3f(x6, y6, z6)},
-{Vector3f(x7, y7, z7)},
-{Vector3f(x8, y8, z8)},
-{Vector3f(x9, y9, z9)},
-{Vector3f(x10, y10, z10)},
-{Vector3f(x11, y11, z11)},
-{Vector3f(x12, y12, z12)},
-{Vector3f(x13, y13, z13)},
-{Vector3f(x14, y14, z14)},
-{Vector3f(x15, y15, z15)},
-{Vector3f(x16, y16, z16)},
-{Vector3f(x17, y17, z17)},
-{Vector3f(x18, y18, z18)},
-{Vector3f(x19, y19, z19)},
-{Vector3f(x20, y20, z20)},
-{Vector3f(x21, y21, z21)},
-{Vector3f(x22, y22, z22)},
-{Vector3f(x23, y23, z23)},
-{Vector3f(x24, y24, z24)},
-{Vector3f(x25, y25, z25)}
+GLuint  count;
+GLuint  instanceCount;
+GLuint  firstIndex;
+GLint   baseVertex;
+GLuint  baseInstance;
 };
-
-GLushort SkeletonIndices[] =
+struct Material
 {
-3, 2, 2, 20,
-20, 4, 4, 5, 5, 6, 6, 22, 6, 7, 7, 21,
-20, 8, 8, 9, 9, 10, 10, 24, 10, 11, 11, 23,
-20, 1, 1, 0,
-0, 12, 12, 13, 13, 14, 14, 15,
-0, 16, 16, 17, 17, 18, 18, 19
+ShaderFill* Fill;
+GLuint      firstCommand, numCommands;
+GLuint      firstIndex, numIndices;
 };
 
-for (int i = 0; i < sizeof(SkeletonIndices) / sizeof(SkeletonIndices[0]); ++i)
-AddIndex(SkeletonIndices[i] + GLushort(numVertices));
+vector<Model*>          Sources; // until Build
+vector<DrawCommand>     Commands;
+vector<Material>        Materials;
+GLuint                  vertexBuffer, indexBuffer, indirectBuffer;
+GLuint                  texturedVao, plainVao; // as Model's
+int                     numVertices, numIndices;
+MultiDrawElementsIndirectProc MultiDrawElementsIndirect; // null without GL 4.3 / ARB_multi_draw_indirect
+
+StaticBatch() : vertexBuffer(0), indexBuffer(0), indirectBuffer(0), texturedVao(0), plainVao(0), numVertices(0), numIndices(0), MultiDrawElementsIndirect(nullptr) {}
+~StaticBatch() { Release(); }
+
+// Takes ownership; the same model twice is merged once
+void Add(Model* m)
+{
+if (std::find(Sources.begin(), Sources.end(), m) == Sources.end())
+Sources.push_back(m);
+}
+
+// Uploads everything added so far and frees the source models
+void Build()
+{
+std::stable_sort(Sources.begin(), Sources.end(), [](const Model* a, const Model* b) { return a->Fill < b->Fill; });
+vector<Model::Vertex> vertices;
+vector<GLuint> indices;
+for (size_t s = 0; s < Sources.size(); ++s) {
+Model* m = Sources[s];
+if (!m->numIndices)
+continue;
+if (Materials.empty() || Materials.back().Fill != m->Fill) {
+Material material = {};
+material.Fill = m->Fill;
+material.firstCommand = GLuint(Commands.size());
+material.firstIndex = GLuint(indices.size());
+Materials.push_back(material);
+}
+Matrix4f world = m->GetMatrix();
+GLuint base = GLuint(vertices.size());
+for (int v = 0; v < m->numVertices; ++v) {
+Model::Vertex vertex = m->Vertices[v];
+vertex.Pos = world.Transform(vertex.Pos);
+vertices.push_back(vertex);
+}
+DrawCommand command = { 0, 1, GLuint(indices.size()), 0, 0 };
+for (int i = 0; i < m->numIndices; ++i)
+indices.push_back(base + m->Indices[i]);
+while ((indices.size() - command.firstIndex) % 6)
+indices.push_back(indices.back());
+command.count = GLuint(indices.size() - command.firstIndex);
+Commands.push_back(command);
+Materials.back().numCommands++;
+Materials.back().numIndices += command.count;
+}
+for (size_t s = 0; s < Sources.size(); ++s)
+delete Sources[s];
+Sources.clear();
+
+numVertices = int(vertices.size());
+numIndices = int(indices.size());
+if (!numIndices)
+return;
+glGenBuffers(1, &vertexBuffer);
+glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), &vertices[0], GL_STATIC_DRAW);
+glBindBuffer(GL_ARRAY_BUFFER, 0);
+glGenBuffers(1, &indexBuffer);
+glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), &indices[0], GL_STATIC_DRAW);
+glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+texturedVao = Model::CreateVertexArray(vertexBuffer, indexBuffer, true);
+plainVao = Model::CreateVertexArray(vertexBuffer, indexBuffer, false);
+
+// drivers return small bogus values for entry points they lack
+PROC proc = wglGetProcAddress("glMultiDrawElementsIndirect");
+if (proc && proc != (PROC)1 && proc != (PROC)2 && proc != (PROC)3 && proc != (PROC)-1) {
+MultiDrawElementsIndirect = (MultiDrawElementsIndirectProc)proc;
+// the mono commands, then the same with an instance per eye
+vector<DrawCommand> commands(Commands);
+for (size_t c = 0; c < Commands.size(); ++c) {
+commands.push_back(Commands[c]);
+commands.back().instanceCount = 2;
+}
+glGenBuffers(1, &indirectBuffer);
+glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(commands[0]), &commands[0], GL_STATIC_DRAW);
+glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+char buffer[160];
+snprintf(buffer, sizeof(buffer), "static batch: %d models, %d materials, %d vertices, %d indices, %s\n",
+(int)Commands.size(), (int)Materials.size(), numVertices, numIndices,
+MultiDrawElementsIndirect ? "multi-draw indirect" : "one draw per material");
+OutputDebugStringA(buffer);
+}
 
-// Generate a quad for each box face
-for (int v = 0; v < 25; v++)
+// GL_TRIANGLES is textured like Model::Render, GL_LINES / GL_POINTS are not,
+// like Model::RenderLines / RenderPoints
+void Render(Matrix4f view, Matrix4f proj, GLenum mode)
 {
-// Make vertices, with some token lighting
-Vertex vvv; vvv.Pos = Vert[v][0]; vvv.U = Vert[v][1].x; vvv.V = Vert[v][1].y;
-float dist1 = (vvv.Pos - Vector3f(-2, 4, -2)).Length();
-float dist2 = (vvv.Pos - Vector3f(3, 4, -3)).Length();
-float dist3 = (vvv.Pos - Vector3f(-4, 3, 25)).Length();
-int   bri = rand() % 160;
-float B = ((c >> 16) & 0xff) * (bri + 192.0f * (0.65f + 8 / dist1 + 1 / dist2 + 4 / dist3)) / 255.0f;
-float G = ((c >> 8) & 0xff) * (bri + 192.0f * (0.65f + 8 / dist1 + 1 / dist2 + 4 / dist3)) / 255.0f;
-float R = ((c >> 0) & 0xff) * (bri + 192.0f * (0.65f + 8 / dist1 + 1 / dist2 + 4 / dist3)) / 255.0f;
-vvv.C = (c & 0xff000000) +
-((R > 255 ? 255 : DWORD(R)) << 16) +
-((G > 255 ? 255 : DWORD(G)) << 8) +
-(B > 255 ? 255 : DWORD(B));
-AddVertex(vvv);
+Matrix4f combined = proj * view;
+Draw(&combined, 1, mode);
 }
-}
-void RenderLines(Matrix4f view, Matrix4f proj)
-{
-Matrix4f combined = proj * view * GetMatrix();
-
-glUseProgram(Fill->program);
-glUniformMatrix4fv(glGetUniformLocation(Fill->program, "matWVP"), 1, GL_TRUE, (FLOAT*)&combined);
-
-glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer->buffer);
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer->buffer);
-
-GLuint posLoc = glGetAttribLocation(Fill->program, "Position");
-GLuint colorLoc = glGetAttribLocation(Fill->program, "Color");
-
-glEnableVertexAttribArray(posLoc);
-glEnableVertexAttribArray(colorLoc);
 
-glVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, Pos));
-glVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)OVR_OFFSETOF(Vertex, C));
-
-glDrawElements(GL_LINES, numIndices, GL_UNSIGNED_SHORT, NULL);
+// Needs every material to have a stereo program
+void RenderStereo(const Matrix4f viewProj[2], GLenum mode)
+{
+Draw(viewProj, 2, mode);
+}
 
-glDisableVertexAttribArray(posLoc);
-glDisableVertexAttribArray(colorLoc);
+void Draw(const Matrix4f* combined, int eyes, GLenum mode)
+{
+if (!numIndices)
+return;
+bool textured = mode == GL_TRIANGLES;
+
+glBindVertexArray(textured ? texturedVao : plainVao);
+if (MultiDrawElementsIndirect)
+glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+
+for (size_t i = 0; i < Materials.size(); ++i) {
+const Material& material = Materials[i];
+const ProgramReflection& program = eyes == 2 ? material.Fill->Stereo : material.Fill->Mono;
+glUseProgram(program.program);
+glUniformMatrix4fv(program.matWVP, eyes, GL_TRUE, (FLOAT*)combined);
+if (textured) {
+glActiveTexture(GL_TEXTURE0);
+glBindTexture(GL_TEXTURE_2D, material.Fill->texture->texId);
+}
 
-glBindBuffer(GL_ARRAY_BUFFER, 0);
-glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+if (MultiDrawElementsIndirect) {
+GLuint first = material.firstCommand + (eyes == 2 ? GLuint(Commands.size()) : 0);
+MultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawCommand)), material.numCommands, 0);
+}
+else
+glDrawElementsInstanced(mode, material.numIndices, GL_UNSIGNED_INT, (void*)(material.firstIndex * sizeof(GLuint)), eyes);
+}
 
+if (MultiDrawElementsIndirect)
+glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+glBindVertexArray(0);
 glUseProgram(0);
 }
+
+void Release()
+{
+for (size_t s = 0; s < Sources.size(); ++s)
+delete Sources[s];
+Sources.clear();
+if (vertexBuffer)
+glDeleteBuffers(1, &vertexBuffer);
+if (indexBuffer)
+glDeleteBuffers(1, &indexBuffer);
+if (indirectBuffer)
+glDeleteBuffers(1, &indirectBuffer);
+if (texturedVao)
+glDeleteVertexArrays(1, &texturedVao);
+if (plainVao)
+glDeleteVertexArrays(1, &plainVao);
+vertexBuffer = indexBuffer = indirectBuffer = texturedVao = plainVao = 0;
+Commands.clear();
+Materials.clear();
+numVertices = numIndices = 0;
+MultiDrawElementsIndirect = nullptr;
+}
 };
 
 
@@ -1318,6 +1138,41 @@ struct Scene
 int     numModels;
 Model* Models[10];
 vector<Mesh>    meshes;
+AnimRig         ZombieRig;
+vector<CompressedClip> ZombieClips;
+BlendTree       ZombieBlend;
+LocalPose       LivePose; // written by the Kinect stream, layered over the upper body
+KinectRetargeter ZombieRetarget;
+KinectClip      Recording; // the exercise recording, joint-major
+KinectRotationClip RecordingRotations;
+JointAngleTable RecordingAngles; // clinical joint angles, velocities and range of motion
+SkeletonFrame   RecordingRest; // the frame the first rep starts from, standing at rest: the retarget calibration
+KinectBoneLengths LiveBones; // calibrated over the first second of the live stream
+IKSolverBank    ZombieIK; // feet, pinned to the floor when the blend sinks them
+int             ZombieFeet[2]; // ZombieIK chains, -1 when the rig lacks the bones
+float           ZombieFootFloor[2]; // bind-pose height of each foot joint, rig units
+LocalPose       ZombiePose; // blend tree output after IK
+vector<Float3>  ZombieJoints; // ZombiePose in model space, rig units
+vector<Quat4>   ZombieRotations;
+int             ZombieHips; // root motion bone, held in place on the figure
+float           ZombieFloor; // lowest bind-pose joint, rig units
+float           ZombieScale; // rig units to metres
+Model*          ZombieFigure; // stick figure of ZombiePose beside the live bodies
+JointPredictor  LivePredictor; // extrapolates the late Kinect body to display time
+GapFilter       LiveGaps; // fills dropped frames and bad joints, a few frames behind
+StreamingDtwMatcher LiveMatcher; // finds the recording's reps in the live stream
+LiveSkeletonRing LiveStream; // sensor / replay thread -> render loop
+SkeletonReplay  LiveReplay; // plays Recording into LiveStream until there is a sensor
+UdpSkeletonReceiver LiveReceiver; // SkeletonStreamServer / sensor bridge, when SKELETON_STREAM_PORT is set
+SkeletonSource* LiveSource; // one of the two, feeding LiveStream
+SessionRecorder SessionRec; // cleaned live bodies to session_<time>.kmc, toggled with R
+SkeletonBatch   LiveBatch; // every tracked body, one lane each: the stream's in lane 0, GroupBodies after it
+SkeletonBatchClip GroupBodies; // the further people of a group recording, replayed alongside the stream
+double          GroupStart; // live time of the first frame, GroupBodies loop from there
+SkeletonBatchFilter LiveBatchFilter; // smooths and predicts all lanes in one pass
+SessionRuleConfig LiveRules[SessionRule_Count]; // the recording's rules, checked per body
+Model*          LiveBodies; // stick figures of LiveBatch, red while a rule is broken
+StaticBatch     Room; // walls, floors, ceiling and furniture, one multi-draw per material
 
 void addModel(Model* n)
 {
@@ -1328,16 +1183,184 @@ void Render(Matrix4f view, Matrix4f proj)
 {
 for (int i = 0; i < numModels; ++i)
 Models[i]->Render(view, proj);
+Room.Render(view, proj, GL_TRIANGLES);
 }
 void RenderLines(Matrix4f view, Matrix4f proj)
 {
 for (int i = 0; i < numModels; ++i)
 Models[i]->RenderLines(view, proj);
+Room.Render(view, proj, GL_LINES);
+if (LiveBodies && LiveBodies->numIndices)
+LiveBodies->RenderLines(view, proj);
+if (ZombieFigure)
+ZombieFigure->RenderLines(view, proj);
 }
 void RenderPoints(Matrix4f view, Matrix4f proj)
 {
 for (int i = 0; i < numModels; ++i)
 Models[i]->RenderPoints(view, proj);
+Room.Render(view, proj, GL_POINTS);
+}
+// Render + RenderLines for both eyes at once, into a target whose left half
+// is eye 0's viewport and right half eye 1's (same size each)
+void RenderStereo(const Matrix4f view[2], const Matrix4f proj[2])
+{
+Matrix4f viewProj[2] = { proj[0] * view[0], proj[1] * view[1] };
+glEnable(GL_CLIP_DISTANCE0);
+for (int i = 0; i < numModels; ++i)
+Models[i]->RenderStereo(viewProj, GL_TRIANGLES);
+Room.RenderStereo(viewProj, GL_TRIANGLES);
+for (int i = 0; i < numModels; ++i)
+Models[i]->RenderStereo(viewProj, GL_LINES);
+Room.RenderStereo(viewProj, GL_LINES);
+if (LiveBodies && LiveBodies->numIndices)
+LiveBodies->RenderStereo(viewProj, GL_LINES);
+if (ZombieFigure)
+ZombieFigure->RenderStereo(viewProj, GL_LINES);
+glDisable(GL_CLIP_DISTANCE0);
+}
+// Drives the live layer of the zombie from one Kinect body frame
+void SetLiveSkeleton(const SkeletonFrame& frame)
+{
+LiveGaps.Push(frame);
+SkeletonFrame body;
+while (LiveGaps.Pop(body)) {
+if (LiveBones.Calibrated())
+LiveBones.Apply(body);
+else
+LiveBones.AddCalibrationFrame(body);
+LivePredictor.Push(body);
+LiveMatcher.Push(body);
+SessionRec.Record(body);
+LiveBatch.SetBody(0, 1, body);
+SetGroupBodies(body.Time);
+LiveBatch.Time = body.Time;
+LiveBatchFilter.Push(LiveBatch);
+}
+DtwMatch match;
+while (LiveMatcher.PopMatch(match)) {
+char buffer[160];
+snprintf(buffer, sizeof(buffer), "live: %s from %.2f to %.2f s, distance %.3f\n",
+LiveMatcher.Templates[match.Template].Name.c_str(), match.StartTime, match.EndTime, match.Distance);
+OutputDebugStringA(buffer);
+}
+}
+// Lanes 1.. of LiveBatch from GroupBodies, looping like the replay of lane 0
+void SetGroupBodies(double time)
+{
+if (GroupBodies.NumFrames() < 2)
+return;
+if (GroupStart < 0.0)
+GroupStart = time;
+SkeletonBatch group;
+GroupBodies.Sample(fmod(time - GroupStart, GroupBodies.NumFrames() / GroupBodies.SampleRate), group);
+SkeletonFrame body;
+for (int l = 1; l < KINECT_MAX_BODIES; ++l) {
+if (!group.TrackingId[l]) {
+LiveBatch.ClearBody(l);
+continue;
+}
+group.GetBody(l, body);
+LiveBatch.SetBody(l, group.TrackingId[l], body);
+}
+}
+// Starts a new session file, or stops the running one (the writer thread
+// finishes the file, PollSessionRecording reports it)
+void ToggleSessionRecording()
+{
+char buffer[200];
+if (SessionRec.IsRecording()) {
+SessionRec.Stop();
+snprintf(buffer, sizeof(buffer), "session: finishing %s\n", SessionRec.FilePath().c_str());
+OutputDebugStringA(buffer);
+return;
+}
+char name[64];
+time_t now = time(nullptr);
+strftime(name, sizeof(name), "session_%Y%m%d_%H%M%S.kmc", localtime(&now));
+bool ok = SessionRec.Start(name, Recording.SampleRate, Recording.Parameters);
+snprintf(buffer, sizeof(buffer), "session: %s %s\n", ok ? "recording to" : "cannot record to", name);
+OutputDebugStringA(buffer);
+}
+// Once per frame; reports a session file the writer has finished
+void PollSessionRecording()
+{
+SessionRecorderState state = SessionRec.Poll();
+if (state != SessionRecorder_Saved && state != SessionRecorder_Failed)
+return;
+char buffer[200];
+SessionRecorderStats stats = SessionRec.Stats();
+snprintf(buffer, sizeof(buffer), "session: %s %s, %u frames, %u dropped, slowest sync %.1f ms\n",
+state == SessionRecorder_Saved ? "saved" : "FAILED, journal kept for",
+SessionRec.FilePath().c_str(), stats.Frames, stats.Dropped, stats.MaxSyncMs);
+OutputDebugStringA(buffer);
+}
+// Render thread: runs every frame that arrived since the last call, in order
+void PumpLiveStream()
+{
+SkeletonFrame frame;
+while (LiveStream.Pop(frame))
+SetLiveSkeleton(frame);
+}
+static double LiveClock()
+{
+return ovr_GetTimeInSeconds();
+}
+// Poses the live layer as the body should look at displayTime
+void UpdateLiveBody(double displayTime)
+{
+UpdateLiveBodies(displayTime);
+if (!LivePredictor.Count || !ZombieRetarget.NumEntries)
+return;
+SkeletonFrame predicted;
+LivePredictor.Predict(displayTime, predicted);
+ZombieRetarget.Retarget(predicted, LivePose);
+}
+// All bodies in one pass: prediction, rules, one vertex buffer update
+void UpdateLiveBodies(double displayTime)
+{
+if (!LiveBodies || !LiveBatchFilter.HasBodies())
+return;
+static const DWORD BodyColors[KINECT_MAX_BODIES] = { 0xff50a050, 0xffa05050, 0xff5050a0, 0xffa0a050, 0xffa050a0, 0xff50a0a0 };
+SkeletonBatch predicted;
+LiveBatchFilter.Predict(displayTime, predicted);
+float deviation[SessionRule_Count][SKELETON_BATCH_LANES];
+EvaluateSessionRulesBatch(LiveBatchFilter.Latest(), LiveRules, SessionSettings(), deviation);
+DWORD colors[KINECT_MAX_BODIES];
+for (int l = 0; l < KINECT_MAX_BODIES; ++l) {
+colors[l] = BodyColors[l];
+for (int r = 0; r < SessionRule_Count; ++r)
+if (deviation[r][l] > 0.0f)
+colors[l] = 0xff2020ff;
+}
+LiveBodies->UpdateSkeletonBatch(predicted, colors);
+}
+// Advances the blend tree and poses the zombie figure from its output
+void UpdateAnimation(float dt)
+{
+if (!ZombieFigure)
+return;
+ZombieBlend.Update(dt);
+ZombiePose = ZombieBlend.Evaluate();
+LocalToGlobal(ZombieRig, ZombiePose, ZombieJoints, ZombieRotations);
+// a foot below its bind-pose height is lifted back onto the floor
+bool pinned = false;
+for (int i = 0; i < 2; ++i) {
+if (ZombieFeet[i] < 0)
+continue;
+IKTwoBoneChain& leg = ZombieIK.TwoBone[ZombieFeet[i]];
+Float3 foot = ZombieJoints[leg.End];
+leg.Weight = foot.y < ZombieFootFloor[i] ? 1.0f : 0.0f;
+leg.Target = MakeFloat3(foot.x, ZombieFootFloor[i], foot.z);
+pinned = pinned || leg.Weight > 0.0f;
+}
+if (pinned) {
+ZombieIK.SolveRig(ZombieRig, ZombiePose);
+LocalToGlobal(ZombieRig, ZombiePose, ZombieJoints, ZombieRotations);
+}
+// walks in place: the clip's root motion is taken out horizontally
+Float3 origin = MakeFloat3(ZombieJoints[ZombieHips].x, ZombieFloor, ZombieJoints[ZombieHips].z);
+ZombieFigure->UpdateRigSkeleton(ZombieJoints, origin, ZombieScale, 0xff2080c0);
 }
 void Draw(Shader& shader)
 {
@@ -1521,6 +1544,38 @@ VALIDATE(false, "mesh has no positions.");
 return true;
 }
 
+// Imports every animation of an FBX file and keeps it compressed in ZombieClips
+bool importClips(const std::string& sFile)
+{
+vector<AnimationClip> rawClips;
+if (!ImportAnimationClips(sFile, ZombieRig, rawClips)) {
+return false;
+}
+
+ClipCompressionSettings settings;
+for (size_t i = 0; i < rawClips.size(); ++i) {
+CompressedClip clip;
+CompressClip(rawClips[i], ZombieRig, settings, clip);
+
+ClipCompressionStats stats = MeasureClipCompression(rawClips[i], ZombieRig, clip, settings);
+char buffer[256];
+FormatClipCompressionStats(clip.Name.c_str(), stats, buffer, sizeof(buffer));
+OutputDebugStringA(buffer);
+
+ZombieClips.push_back(clip);
+}
+
+return true;
+}
+
+const CompressedClip* findClip(const char* name)
+{
+for (size_t i = 0; i < ZombieClips.size(); ++i)
+if (ZombieClips[i].Name.find(name) != string::npos)
+return &ZombieClips[i];
+return nullptr;
+}
+
 void Init(int includeIntensiveGPUobject)
 {
 static const GLchar* VertexShaderSrc =
@@ -1539,6 +1594,30 @@ static const GLchar* VertexShaderSrc =
 "   oColor.a    = Color.a;\n"
 "}\n";
 
+// Single-pass stereo: the instance picks the eye, and the eye's clip space
+// is squeezed into its half of a double-wide target; the clip distance cuts
+// what would spill into the other half.
+static const GLchar* StereoVertexShaderSrc =
+"#version 150\n"
+"uniform mat4 matWVP[2];\n"
+"in      vec4 Position;\n"
+"in      vec4 Color;\n"
+"in      vec2 TexCoord;\n"
+"out     vec2 oTexCoord;\n"
+"out     vec4 oColor;\n"
+"out float gl_ClipDistance[1];\n"
+"void main()\n"
+"{\n"
+"   int  eye    = gl_InstanceID & 1;\n"
+"   vec4 clip   = matWVP[eye] * Position;\n"
+"   float side  = eye == 0 ? -1.0 : 1.0;\n"
+"   gl_Position = vec4(0.5 * (clip.x + side * clip.w), clip.yzw);\n"
+"   gl_ClipDistance[0] = clip.w + side * clip.x;\n"
+"   oTexCoord   = TexCoord;\n"
+"   oColor.rgb  = pow(Color.rgb, vec3(2.2));\n"   // convert from sRGB to linear
+"   oColor.a    = Color.a;\n"
+"}\n";
+
 static const char* FragmentShaderSrc =
 "#version 150\n"
 "uniform sampler2D Texture0;\n"
@@ -1552,6 +1631,7 @@ static const char* FragmentShaderSrc =
 
 GLuint    vshader = CreateShader(GL_VERTEX_SHADER, VertexShaderSrc);
 GLuint    fshader = CreateShader(GL_FRAGMENT_SHADER, FragmentShaderSrc);
+GLuint    stereoVshader = CreateShader(GL_VERTEX_SHADER, StereoVertexShaderSrc);
 
 // Make textures
 ShaderFill* grid_material[4] = {};
@@ -1570,19 +1650,97 @@ if (k == 3) tex_pixels[j * 256 + i] = 0xffffffff;// blank
 }
 }
 TextureBuffer* generated_texture = new TextureBuffer(false, Sizei(256, 256), 4, (unsigned char*)tex_pixels);
-grid_material[k] = new ShaderFill(vshader, fshader, generated_texture);
+grid_material[k] = new ShaderFill(vshader, fshader, generated_texture, stereoVshader);
 }
 
 glDeleteShader(vshader);
 glDeleteShader(fshader);
+glDeleteShader(stereoVshader);
 
-ifstream myfile("motionBothArms_Lars.txt");
-if (!myfile.is_open())
+if (!LoadRecording("motionBothArms_Lars.txt", Recording))
 {
 cout << "Unable to open myfile";
 //system("pause");
 exit(1);
 }
+{
+std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+RecordingSpaceReport space;
+KinectBoneLengths recordingBones;
+GapFilterStats gaps;
+CleanRecording(Recording, recordingBones, &space, &gaps);
+SolveClipRotations(Recording, RecordingRotations);
+ComputeJointAngles(Recording, RecordingAngles);
+double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+char buffer[128];
+snprintf(buffer, sizeof(buffer), "motion file: %d frames, %d joints flagged (%d filled, %d held), cleaned and solved in %.2f ms\n",
+Recording.NumFrames, gaps.JointsFlagged, gaps.JointsFilled, gaps.JointsHeld, ms);
+OutputDebugStringA(buffer);
+string spaceReport;
+FormatRecordingSpaceReport(space, spaceReport);
+OutputDebugStringA(spaceReport.c_str());
+
+LiveGaps.Reset(GapFilterSettings(), &LiveBones);
+
+string rangeReport;
+FormatRangeOfMotion(RecordingAngles, rangeReport);
+OutputDebugStringA(rangeReport.c_str());
+
+KeyframedKinectClip keyframes;
+if (ReduceKinectClip(Recording, KeyframeSettings(), keyframes)) {
+string keyframeReport;
+FormatKeyframeReport(MeasureKeyframeReduction(Recording, keyframes), keyframeReport);
+OutputDebugStringA(keyframeReport.c_str());
+}
+
+// the first reps of the recording are the references for the live stream
+vector<int> reps;
+int primary = FindRecordingReps(Recording, RecordingAngles, SessionSettings(), reps);
+Recording.GetFrame(reps.empty() ? 0 : reps[0], RecordingRest);
+for (int i = 0; i + 1 < (int)reps.size() && i < 3; ++i) {
+string name = string(JointAngleNames[primary]) + " rep " + to_string(i + 1);
+if (LiveMatcher.AddTemplate(name, Recording, reps[i], reps[i + 1] - reps[i], 0.25f) < 0) {
+snprintf(buffer, sizeof(buffer), "%s: %d frames, over the %d frame template limit, not matched\n", name.c_str(), reps[i + 1] - reps[i], DTW_MAX_TEMPLATE_FRAMES);
+OutputDebugStringA(buffer);
+}
+}
+
+static const float PredictionHorizons[] = { 0.033f, 0.066f, 0.1f };
+string report;
+FormatPredictionReport(Recording, PredictionHorizons, 3, report);
+OutputDebugStringA(report.c_str());
+
+const char* streamPort = getenv("SKELETON_STREAM_PORT");
+if (streamPort && LiveReceiver.Open(atoi(streamPort)))
+LiveSource = &LiveReceiver;
+else {
+LiveReplay.Open(Recording);
+LiveSource = &LiveReplay;
+}
+LiveSource->Start(LiveStream, LiveClock);
+snprintf(buffer, sizeof(buffer), "live skeletons: %s\n", LiveSource->Name());
+OutputDebugStringA(buffer);
+
+// a group recording brings its other people along; lane 0 stays the stream
+vector<KinectClip> bodies;
+if (LoadMotionBodies("motionBothArms_Lars.txt", bodies, KINECT_MAX_BODIES) && bodies.size() > 1) {
+for (size_t b = 1; b < bodies.size(); ++b) {
+KinectBoneLengths bodyBones;
+CleanRecordingBody(bodies[b], space, bodyBones, nullptr);
+}
+MakeSkeletonBatchClip(bodies, GroupBodies);
+snprintf(buffer, sizeof(buffer), "group recording: %d further bodies\n", (int)bodies.size() - 1);
+OutputDebugStringA(buffer);
+}
+GroupStart = -1.0;
+
+ParseSessionRules(Recording, LiveRules);
+LiveBatch.Clear();
+LiveBodies = new Model(Vector3f(0, 0, 0), grid_material[2]);
+LiveBodies->AddSkeletonBatch();
+LiveBodies->AllocateBuffers(GL_DYNAMIC_DRAW);
+LiveBodies->numIndices = 0;
+}
 
 vector<glm::vec3> vecVec3Positions;
 
@@ -1743,32 +1901,78 @@ m->addPoint(vecVec3Positions[i], 0xff552582);
 m->AllocateBuffers();
 addModel(m);
 
+// the zombie clip library
+static const char* ZombieClipFiles[] = {
+"Male_Zombie/Zombie Idle.fbx", "Male_Zombie/Zombie Walk.fbx", "Male_Zombie/Zombie Running.fbx",
+"Male_Zombie/Zombie Attack.fbx", "Male_Zombie/Zombie Scream.fbx", "Male_Zombie/Zombie Death.fbx"
+};
+for (int i = 0; i < sizeof(ZombieClipFiles) / sizeof(ZombieClipFiles[0]); ++i)
+importClips(ZombieClipFiles[i]);
+
+// canned locomotion below the spine, the live patient's upper body above it
+if (const CompressedClip* walk = findClip("Zombie Walk")) {
+LivePose.SetBindPose(ZombieRig);
+ZombieBlend.Init(ZombieRig);
+
+vector<float> upperBody;
+BuildSubtreeMask(ZombieRig, ZombieRig.FindBoneBySuffix("Spine1"), 1.0f, upperBody);
+
+int locomotion = ZombieBlend.AddClip(walk);
+int live = ZombieBlend.AddPose(&LivePose);
+ZombieBlend.AddOverride(locomotion, live, ZombieBlend.AddMask(upperBody));
+
+ZombieFeet[0] = ZombieIK.AddRigTwoBone(ZombieRig, "LeftUpLeg", "LeftLeg", "LeftFoot");
+ZombieFeet[1] = ZombieIK.AddRigTwoBone(ZombieRig, "RightUpLeg", "RightLeg", "RightFoot");
+
+if (ZombieRetarget.Build(ZombieRig, &RecordingRest)) {
+string report;
+ZombieRetarget.FormatCoverage(ZombieRig, report);
+OutputDebugStringA(report.c_str());
+}
+
+// debug figure, scaled so the bind pose stands 1.75 m tall
+LocalToGlobal(ZombieRig, LivePose, ZombieJoints, ZombieRotations);
+float top = ZombieJoints[0].y;
+ZombieFloor = ZombieJoints[0].y;
+for (size_t i = 1; i < ZombieJoints.size(); ++i) {
+if (ZombieJoints[i].y < ZombieFloor)
+ZombieFloor = ZombieJoints[i].y;
+if (ZombieJoints[i].y > top)
+top = ZombieJoints[i].y;
+}
+ZombieScale = top > ZombieFloor ? 1.75f / (top - ZombieFloor) : 0.01f;
+for (int i = 0; i < 2; ++i)
+ZombieFootFloor[i] = ZombieFeet[i] >= 0 ? ZombieJoints[ZombieIK.TwoBone[ZombieFeet[i]].End].y : ZombieFloor;
+ZombieHips = ZombieRig.FindBoneBySuffix("Hips");
+if (ZombieHips < 0)
+ZombieHips = 0;
+ZombieFigure = new Model(Vector3f(1.0f, 0, 0), grid_material[2]);
+ZombieFigure->AddRigSkeleton(ZombieRig);
+ZombieFigure->AllocateBuffers(GL_DYNAMIC_DRAW);
+}
+
 m = new Model(Vector3f(0, 0, 0), grid_material[1]);  // Walls
 m->AddBox(-10.1f, 0.0f, -20.0f, -10.0f, 4.0f, 20.0f, 0xff808080); // Left Wall
 m->AddBox(-10.0f, -0.1f, -20.1f, 10.0f, 4.0f, -20.0f, 0xff808080); // Back Wall
 m->AddBox(10.0f, -0.1f, -20.0f, 10.1f, 4.0f, 20.0f, 0xff808080); // Right Wall
-m->AllocateBuffers();
-addModel(m);
+Room.Add(m);
 
 if (includeIntensiveGPUobject)
 {
 m = new Model(Vector3f(0, 0, 0), grid_material[0]);  // Floors
 for (float depth = 0.0f; depth > -3.0f; depth -= 0.1f)
 m->AddBox(9.0f, 0.5f, -depth, -9.0f, 3.5f, -depth, 0x10ff80ff); // Partition
-m->AllocateBuffers();
-addModel(m);
+Room.Add(m);
 }
 
 m = new Model(Vector3f(0, 0, 0), grid_material[0]);  // Floors
 //m->AddBox(-10.0f, -0.1f, -20.0f, 10.0f, 0.0f, 20.1f, 0xff808080); // Main floor
 //m->AddBox(-15.0f, -6.1f, 18.0f, 15.0f, -6.0f, 30.0f, 0xff808080); // Bottom floor
-m->AllocateBuffers();
-addModel(m);
+Room.Add(m);
 
 m = new Model(Vector3f(0, 0, 0), grid_material[2]);  // Ceiling
 m->AddBox(-10.0f, 4.0f, -20.0f, 10.0f, 4.1f, 20.1f, 0xff808080);
-m->AllocateBuffers();
-addModel(m);
+Room.Add(m);
 
 m = new Model(Vector3f(0, 0, 0), grid_material[3]);  // Fixtures & furniture
 m->AddBox(9.5f, 0.75f, 3.0f, 10.1f, 2.5f, 3.1f, 0xff383838);   // Right side shelf// Verticals
@@ -1796,8 +2000,6 @@ m->AddBox(-1.4f, 0.97f, -1.05f, -0.8f, 0.92f, -1.10f, 0xff202050); // Chair Back
 
 for (float f = 3.0f; f <= 6.6f; f += 0.4f)
 m->AddBox(-3, 0.0f, f, -2.9f, 1.3f, f + 0.1f, 0xff404040); // Posts
-m->AllocateBuffers();
-addModel(m);
 
 /*static int skeletonClock;
 while (skeletonClock <= 10) //1066
@@ -1817,25 +2019,31 @@ Add(m);
 }*/
 m->AddBox25(-0.115309f, 0.153283f, 2.54885f, -0.110507f, 0.467882f, 2.53528f, -0.104767f, 0.771282f, 2.50816f, -0.109963f, 0.920778f, 2.50027f, -0.310304f, 0.67454f, 2.51035f, -0.569052f, 0.731407f, 2.5307f, -0.747203f, 0.893473f, 2.48447f, -0.822246f, 0.947171f, 2.46095f, 0.086728f, 0.678407f, 2.54589f, 0.322395f, 0.710698f, 2.60683f, 0.558251f, 0.873975f, 2.57669f, 0.627528f, 0.921758f, 2.56421f, -0.195207f, 0.150241f, 2.50342f, -0.246323f, -0.257108f, 2.52936f, -0.264987f, -0.608919f, 2.57752f, -0.288185f, -0.69964f, 2.51592f, -0.031919f, 0.151915f, 2.51837f, 0.003236f, -0.245277f, 2.55707f, 0.026294f, -0.598516f, 2.63814f, 0.042509f, -0.692563f, 2.57974f, -0.106299f, 0.697082f, 2.51725f, -0.893856f, 0.98753f, 2.4282f, -0.84078f, 0.914722f, 2.462f, 0.709409f, 0.967994f, 2.56752f, 0.612942f, 0.923567f, 2.502f, 0xff500000);
 //m->AddBox25(-0.111627f, 0.132741f, 2.55047f, -0.110303f, 0.45632f, 2.54037f, -0.108415f, 0.767295f, 2.51797f, -0.11094f, 0.918947f, 2.49887f, -0.291579f, 0.651342f, 2.50697f, -0.414845f, 0.401152f, 2.55766f, -0.465615f, 0.176591f, 2.45156f, -0.462083f, 0.113145f, 2.43146f, 0.077786f, 0.645957f, 2.53628f, 0.157761f, 0.376136f, 2.59783f, 0.227156f, 0.138311f, 2.55891f, 0.226286f, 0.079826f, 2.53629f, -0.193704f, 0.129932f, 2.50709f, -0.244439f, -0.262458f, 2.53318f, -0.264592f, -0.609974f, 2.5783f, -0.28752f, -0.700562f, 2.51635f, -0.02623f, 0.131467f, 2.51784f, 0.008341f, -0.252826f, 2.55952f, 0.02879f, -0.598299f, 2.64088f, 0.040088f, -0.69244f, 2.58032f, -0.108917f, 0.691213f, 2.52566f, -0.480792f, 0.012016f, 2.41654f, -0.484713f, 0.152369f, 2.44643f, 0.254225f, -0.020079f, 2.53627f, 0.203793f, 0.069199f, 2.53283f, 0xff202050);
-m->AllocateBuffers();
-addModel(m);
 
 m->AddSkeleton(-0.115309f, 0.153283f, 2.54885f, -0.110507f, 0.467882f, 2.53528f, -0.104767f, 0.771282f, 2.50816f, -0.109963f, 0.920778f, 2.50027f, -0.310304f, 0.67454f, 2.51035f, -0.569052f, 0.731407f, 2.5307f, -0.747203f, 0.893473f, 2.48447f, -0.822246f, 0.947171f, 2.46095f, 0.086728f, 0.678407f, 2.54589f, 0.322395f, 0.710698f, 2.60683f, 0.558251f, 0.873975f, 2.57669f, 0.627528f, 0.921758f, 2.56421f, -0.195207f, 0.150241f, 2.50342f, -0.246323f, -0.257108f, 2.52936f, -0.264987f, -0.608919f, 2.57752f, -0.288185f, -0.69964f, 2.51592f, -0.031919f, 0.151915f, 2.51837f, 0.003236f, -0.245277f, 2.55707f, 0.026294f, -0.598516f, 2.63814f, 0.042509f, -0.692563f, 2.57974f, -0.106299f, 0.697082f, 2.51725f, -0.893856f, 0.98753f, 2.4282f, -0.84078f, 0.914722f, 2.462f, 0.709409f, 0.967994f, 2.56752f, 0.612942f, 0.923567f, 2.502f, 0xff505000);
 //m->AddSkeleton(-0.111627f, 0.132741f, 2.55047f, -0.110303f, 0.45632f, 2.54037f, -0.108415f, 0.767295f, 2.51797f, -0.11094f, 0.918947f, 2.49887f, -0.291579f, 0.651342f, 2.50697f, -0.414845f, 0.401152f, 2.55766f, -0.465615f, 0.176591f, 2.45156f, -0.462083f, 0.113145f, 2.43146f, 0.077786f, 0.645957f, 2.53628f, 0.157761f, 0.376136f, 2.59783f, 0.227156f, 0.138311f, 2.55891f, 0.226286f, 0.079826f, 2.53629f, -0.193704f, 0.129932f, 2.50709f, -0.244439f, -0.262458f, 2.53318f, -0.264592f, -0.609974f, 2.5783f, -0.28752f, -0.700562f, 2.51635f, -0.02623f, 0.131467f, 2.51784f, 0.008341f, -0.252826f, 2.55952f, 0.02879f, -0.598299f, 2.64088f, 0.040088f, -0.69244f, 2.58032f, -0.108917f, 0.691213f, 2.52566f, -0.480792f, 0.012016f, 2.41654f, -0.484713f, 0.152369f, 2.44643f, 0.254225f, -0.020079f, 2.53627f, 0.203793f, 0.069199f, 2.53283f, 0xff202050);
-m->AllocateBuffers();
-addModel(m);
+Room.Add(m);
+Room.Build();
 }
 
-Scene() : numModels(0) {}
+Scene() : numModels(0), ZombieFigure(nullptr), LiveSource(nullptr), GroupStart(-1.0), LiveBodies(nullptr) {}
 Scene(bool includeIntensiveGPUobject) :
-numModels(0)
+numModels(0), ZombieFigure(nullptr), LiveSource(nullptr), GroupStart(-1.0), LiveBodies(nullptr)
 {
 Init(includeIntensiveGPUobject);
 }
 void Release()
 {
+if (LiveSource)
+LiveSource->Stop();
+SessionRec.Finish();
 while (numModels-- > 0)
 delete Models[numModels];
+delete LiveBodies;
+LiveBodies = nullptr;
+delete ZombieFigure;
+ZombieFigure = nullptr;
+Room.Release();
 }
 ~Scene()
 {
@@ -1843,4 +2051,57 @@ Release();
 }
 };
 
+//---------------------------------------------------------------------------
+// Offscreen harness for Scene::RenderStereo: one double-wide target drawn per
+// eye (a viewport per half) and then in a single pass, both read back and
+// compared. A driver that gets the instancing or the clip distance wrong
+// shows up as differing pixels, and the caller keeps rendering per eye.
+struct StereoCheck
+{
+int     Pixels;
+int     Differing; // some channel off by more than 2
+int     MaxDifference;
+double  MonoMs, StereoMs; // submission on the CPU
+bool Passed() const { return Differing <= Pixels / 1000; }
+};
+
+static StereoCheck CheckStereoRendering(Scene& scene, const Matrix4f view[2], const Matrix4f proj[2], Sizei eyeSize)
+{
+typedef std::chrono::high_resolution_clock Clock;
+StereoCheck check = {};
+Sizei size(eyeSize.w * 2, eyeSize.h);
+TextureBuffer target(true, size, 1, nullptr);
+DepthBuffer depth(size);
+vector<unsigned char> mono(size_t(size.w) * size.h * 4), stereo(mono.size());
+
+target.SetAndClearRenderSurface(&depth);
+Clock::time_point start = Clock::now();
+for (int eye = 0; eye < 2; ++eye) {
+glViewport(eye * eyeSize.w, 0, eyeSize.w, eyeSize.h);
+scene.Render(view[eye], proj[eye]);
+scene.RenderLines(view[eye], proj[eye]);
+}
+check.MonoMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+glReadPixels(0, 0, size.w, size.h, GL_RGBA, GL_UNSIGNED_BYTE, &mono[0]);
+
+glViewport(0, 0, size.w, size.h);
+glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+start = Clock::now();
+scene.RenderStereo(view, proj);
+check.StereoMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+glReadPixels(0, 0, size.w, size.h, GL_RGBA, GL_UNSIGNED_BYTE, &stereo[0]);
+target.UnsetRenderSurface();
+glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+check.Pixels = size.w * size.h;
+for (int i = 0; i < check.Pixels; ++i) {
+int worst = 0;
+for (int c = 0; c < 4; ++c)
+worst = std::max(worst, abs(int(mono[i * 4 + c]) - int(stereo[i * 4 + c])));
+check.MaxDifference = std::max(check.MaxDifference, worst);
+check.Differing += worst > 2 ? 1 : 0;
+}
+return check;
+}
+
 #endif // OVR_Win32_GLAppUtil_h
@@ -0,0 +1,378 @@
+#ifndef WINDOW_INDEX_H
+#define WINDOW_INDEX_H
+
+// Window aggregates over the derived signals of a recording, for dashboard
+// questions such as "max shoulder elevation held over any 2 s" or "mean hand
+// speed between 40 s and 75 s".
+//
+// BuildWindowIndex runs once at ingest over every JointAngle (smoothed) and
+// every joint's speed. Per signal it keeps
+//   prefix sums of the value and its square  -> mean / std dev in O(1)
+//   a sparse table of per-block min / max    -> min / max in O(1): the
+//                                              whole blocks inside the
+//                                              window come from two
+//                                              overlapping table entries, the
+//                                              partial blocks at either end
+//                                              are scanned (< 2 blocks)
+// Blocks of WINDOW_INDEX_BLOCK frames keep the table at n/16 log(n/16)
+// entries instead of n log n. The index is stored next to the recording
+// (WriteWindowIndex) with the frame count and a checksum of the clip it was
+// built from. Only values and block tables are written; the prefix sums are
+// doubles, would triple the file and take one pass to rebuild on load.
+
+#include "../Common/JointAngles.h"
+#include "../Common/MotionFile.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define WINDOW_INDEX_BLOCK 16
+
+enum WindowStat
+{
+    WindowStat_Min,
+    WindowStat_Max,
+    WindowStat_Mean
+};
+
+struct WindowStats
+{
+    int   Frames;
+    float Min, Max, Mean, StdDev;
+};
+
+struct WindowSignal
+{
+    std::string         Name;
+    std::vector<float>  Values;             // one per frame
+    std::vector<double> Sum, SumSq;         // prefix, NumFrames + 1 entries
+    int                 Levels;
+    std::vector<float>  BlockMin, BlockMax; // [level * numBlocks + block], level l covers 2^l blocks
+
+    WindowSignal() : Levels(0) {}
+};
+
+// Sparse table levels for 'blocks' blocks: floor(log2(blocks)) + 1, 0 for none
+inline int WindowIndexLevels(int blocks)
+{
+    int levels = 0;
+    while ((1 << levels) <= blocks)
+        ++levels;
+    return levels;
+}
+
+struct WindowIndex
+{
+    float                     SampleRate;
+    int                       NumFrames;
+    uint32_t                  Checksum;     // of the clip the index was built from
+    std::vector<WindowSignal> Signals;
+
+    WindowIndex() : SampleRate(30.0f), NumFrames(0), Checksum(0) {}
+
+    int NumBlocks() const { return (NumFrames + WINDOW_INDEX_BLOCK - 1) / WINDOW_INDEX_BLOCK; }
+
+    int FindSignal(const char* name) const
+    {
+        for (size_t i = 0; i < Signals.size(); ++i)
+            if (Signals[i].Name == name)
+                return (int)i;
+        return -1;
+    }
+
+    // Frames [first, last)
+    WindowStats Query(int signal, int first, int last) const
+    {
+        WindowStats stats = { 0, 0.0f, 0.0f, 0.0f, 0.0f };
+        first = std::max(first, 0);
+        last = std::min(last, NumFrames);
+        if (signal < 0 || first >= last)
+            return stats;
+        const WindowSignal& s = Signals[signal];
+        int n = last - first;
+        double mean = (s.Sum[last] - s.Sum[first]) / n;
+        double var = (s.SumSq[last] - s.SumSq[first]) / n - mean * mean;
+        stats.Frames = n;
+        stats.Mean = (float)mean;
+        stats.StdDev = (float)sqrt(var > 0.0 ? var : 0.0);
+        MinMax(s, first, last, stats.Min, stats.Max);
+        return stats;
+    }
+
+    WindowStats QueryTime(int signal, float start, float end) const
+    {
+        return Query(signal, (int)ceilf(start * SampleRate), (int)floorf(end * SampleRate) + 1);
+    }
+
+    // Best value of 'stat' over every window of 'frames' frames, e.g. the
+    // highest elevation held for the whole window (WindowStat_Min) or the
+    // highest window mean. O(NumFrames).
+    float BestWindow(int signal, int frames, WindowStat stat, int* bestFirst) const
+    {
+        float best = -1e30f;
+        int at = -1;
+        for (int f = 0; signal >= 0 && f + frames <= NumFrames; ++f)
+        {
+            const WindowSignal& s = Signals[signal];
+            float v;
+            if (stat == WindowStat_Mean)
+                v = (float)((s.Sum[f + frames] - s.Sum[f]) / frames);
+            else
+            {
+                float lo, hi;
+                MinMax(s, f, f + frames, lo, hi);
+                v = stat == WindowStat_Min ? lo : hi;
+            }
+            if (v > best)
+            {
+                best = v;
+                at = f;
+            }
+        }
+        if (bestFirst)
+            *bestFirst = at;
+        return at >= 0 ? best : 0.0f;
+    }
+
+private:
+    void MinMax(const WindowSignal& s, int first, int last, float& lo, float& hi) const
+    {
+        lo = 1e30f;
+        hi = -1e30f;
+        int b0 = (first + WINDOW_INDEX_BLOCK - 1) / WINDOW_INDEX_BLOCK;    // first whole block
+        int b1 = last / WINDOW_INDEX_BLOCK;                                 // one past the last whole block
+        if (b1 <= b0)
+        {
+            for (int f = first; f < last; ++f)
+            {
+                lo = std::min(lo, s.Values[f]);
+                hi = std::max(hi, s.Values[f]);
+            }
+            return;
+        }
+        for (int f = first; f < b0 * WINDOW_INDEX_BLOCK; ++f)
+        {
+            lo = std::min(lo, s.Values[f]);
+            hi = std::max(hi, s.Values[f]);
+        }
+        for (int f = b1 * WINDOW_INDEX_BLOCK; f < last; ++f)
+        {
+            lo = std::min(lo, s.Values[f]);
+            hi = std::max(hi, s.Values[f]);
+        }
+        int level = 0;
+        while ((2 << level) <= b1 - b0)
+            ++level;
+        size_t row = (size_t)level * NumBlocks();
+        lo = std::min(lo, std::min(s.BlockMin[row + b0], s.BlockMin[row + b1 - (1 << level)]));
+        hi = std::max(hi, std::max(s.BlockMax[row + b0], s.BlockMax[row + b1 - (1 << level)]));
+    }
+};
+
+//---------------------------------------------------------------------------
+// FNV-1a over the clip's frames
+inline uint32_t ClipChecksum(const KinectClip& clip)
+{
+    uint32_t h = 2166136261u;
+    if (clip.NumFrames <= 0)
+        return h;
+    const std::vector<float>* channels[3] = { &clip.X, &clip.Y, &clip.Z };
+    for (int c = 0; c < 3; ++c)
+        for (int j = 0; j < KinectJoint_Count; ++j)
+        {
+            const unsigned char* p = (const unsigned char*)&(*channels[c])[clip.Index(j, 0)];
+            for (size_t i = 0; i < (size_t)clip.NumFrames * sizeof(float); ++i)
+                h = (h ^ p[i]) * 16777619u;
+        }
+    return h;
+}
+
+inline void BuildPrefixSums(WindowSignal& s, int numFrames)
+{
+    s.Sum.resize(numFrames + 1);
+    s.SumSq.resize(numFrames + 1);
+    s.Sum[0] = s.SumSq[0] = 0.0;
+    for (int f = 0; f < numFrames; ++f)
+    {
+        double v = s.Values[f];
+        s.Sum[f + 1] = s.Sum[f] + v;
+        s.SumSq[f + 1] = s.SumSq[f] + v * v;
+    }
+}
+
+// Prefix sums and block sparse table for a signal whose Values are set
+inline void BuildWindowSignal(WindowSignal& s, int numFrames)
+{
+    BuildPrefixSums(s, numFrames);
+    int blocks = (numFrames + WINDOW_INDEX_BLOCK - 1) / WINDOW_INDEX_BLOCK;
+    s.Levels = WindowIndexLevels(blocks);
+    s.BlockMin.resize((size_t)s.Levels * blocks);
+    s.BlockMax.resize((size_t)s.Levels * blocks);
+    for (int b = 0; b < blocks; ++b)
+    {
+        int end = std::min(numFrames, (b + 1) * WINDOW_INDEX_BLOCK);
+        float lo = s.Values[b * WINDOW_INDEX_BLOCK], hi = lo;
+        for (int f = b * WINDOW_INDEX_BLOCK + 1; f < end; ++f)
+        {
+            lo = std::min(lo, s.Values[f]);
+            hi = std::max(hi, s.Values[f]);
+        }
+        s.BlockMin[b] = lo;
+        s.BlockMax[b] = hi;
+    }
+    for (int l = 1; l < s.Levels; ++l)
+    {
+        size_t row = (size_t)l * blocks, prev = (size_t)(l - 1) * blocks;
+        int half = 1 << (l - 1);
+        for (int b = 0; b + (1 << l) <= blocks; ++b)
+        {
+            s.BlockMin[row + b] = std::min(s.BlockMin[prev + b], s.BlockMin[prev + b + half]);
+            s.BlockMax[row + b] = std::max(s.BlockMax[prev + b], s.BlockMax[prev + b + half]);
+        }
+    }
+}
+
+// Signals: every JointAngle (smoothed, degrees), then every joint's speed
+// (m/s, central difference)
+inline void BuildWindowIndex(const KinectClip& clip, const JointAngleTable& angles, WindowIndex& index)
+{
+    int n = clip.NumFrames;
+    index.SampleRate = clip.SampleRate;
+    index.NumFrames = n;
+    index.Checksum = ClipChecksum(clip);
+    if (n == 0)
+    {
+        // nothing to reuse; levels 0 is what an empty index reads back with
+        index.Signals.assign(JointAngle_Count + KinectJoint_Count, WindowSignal());
+        return;
+    }
+    index.Signals.resize(JointAngle_Count + KinectJoint_Count);
+
+    for (int a = 0; a < JointAngle_Count; ++a)
+    {
+        WindowSignal& s = index.Signals[a];
+        s.Name = JointAngleNames[a];
+        const float* column = angles.Column(a, JointAngleChannel_Smoothed);
+        s.Values.assign(column, column + n);
+        BuildWindowSignal(s, n);
+    }
+    for (int j = 0; j < KinectJoint_Count; ++j)
+    {
+        WindowSignal& s = index.Signals[JointAngle_Count + j];
+        s.Name = std::string(KinectJointNames[j]) + "Speed";
+        s.Values.resize(n);
+        for (int f = 0; f < n; ++f)
+        {
+            int a = std::max(f - 1, 0), b = std::min(f + 1, n - 1);
+            s.Values[f] = b > a ? Length(clip.Get(j, b) - clip.Get(j, a)) * clip.SampleRate / (b - a) : 0.0f;
+        }
+        BuildWindowSignal(s, n);
+    }
+}
+
+//---------------------------------------------------------------------------
+// File layout, little endian:
+//   "WIDX" u32 version, u32 frames, f32 sample rate, u32 checksum,
+//   u32 block size, u32 signals
+//   per signal: u16 name length, name, u32 levels,
+//               f32 values[frames], f32 blockMin[levels * blocks],
+//               f32 blockMax[levels * blocks]
+inline bool WriteWindowIndex(const WindowIndex& index, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+    uint32_t header[7];
+    memcpy(header, "WIDX", 4);
+    header[1] = 1;
+    header[2] = (uint32_t)index.NumFrames;
+    memcpy(&header[3], &index.SampleRate, 4);
+    header[4] = index.Checksum;
+    header[5] = WINDOW_INDEX_BLOCK;
+    header[6] = (uint32_t)index.Signals.size();
+    fwrite(header, sizeof(header), 1, file);
+    for (size_t i = 0; i < index.Signals.size(); ++i)
+    {
+        const WindowSignal& s = index.Signals[i];
+        uint16_t len = (uint16_t)s.Name.size();
+        uint32_t levels = (uint32_t)s.Levels;
+        fwrite(&len, 2, 1, file);
+        fwrite(s.Name.data(), 1, len, file);
+        fwrite(&levels, 4, 1, file);
+        if (s.Values.empty())
+            continue;
+        fwrite(s.Values.data(), sizeof(float), s.Values.size(), file);
+        fwrite(s.BlockMin.data(), sizeof(float), s.BlockMin.size(), file);
+        fwrite(s.BlockMax.data(), sizeof(float), s.BlockMax.size(), file);
+    }
+    return fclose(file) == 0;
+}
+
+// Every count in the file is checked against the others and against the
+// bytes left before anything is allocated for it
+inline bool ReadWindowIndex(const char* path, WindowIndex& index)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint32_t header[7];
+    bool ok = size >= (long)sizeof(header) && fread(header, sizeof(header), 1, file) == 1 && memcmp(header, "WIDX", 4) == 0 &&
+              header[1] == 1 && header[5] == WINDOW_INDEX_BLOCK && header[2] <= (uint32_t)(size / sizeof(float));
+    size_t left = ok ? (size_t)size - sizeof(header) : 0;
+    // a signal is at least its name length and level count
+    ok = ok && header[6] <= left / 6;
+    if (ok)
+    {
+        index.NumFrames = (int)header[2];
+        memcpy(&index.SampleRate, &header[3], 4);
+        index.Checksum = header[4];
+        index.Signals.resize(header[6]);
+        size_t n = (size_t)index.NumFrames, blocks = (size_t)index.NumBlocks();
+        uint32_t expectedLevels = (uint32_t)WindowIndexLevels((int)blocks);
+        size_t signalBytes = (n + 2 * expectedLevels * blocks) * sizeof(float);
+        for (size_t i = 0; ok && i < index.Signals.size(); ++i)
+        {
+            WindowSignal& s = index.Signals[i];
+            uint16_t len = 0;
+            uint32_t levels = 0;
+            ok = left >= 2 && fread(&len, 2, 1, file) == 1 && left - 2 >= (size_t)len + 4;
+            if (!ok)
+                break;
+            left -= 2 + (size_t)len + 4;
+            s.Name.resize(len);
+            ok = (len == 0 || fread(&s.Name[0], 1, len, file) == len) && fread(&levels, 4, 1, file) == 1 &&
+                 levels == expectedLevels && signalBytes <= left;
+            if (!ok)
+                break;
+            left -= signalBytes;
+            s.Levels = (int)levels;
+            s.Values.resize(n);
+            s.BlockMin.resize(levels * blocks);
+            s.BlockMax.resize(levels * blocks);
+            ok = fread(s.Values.data(), sizeof(float), n, file) == n &&
+                 fread(s.BlockMin.data(), sizeof(float), s.BlockMin.size(), file) == s.BlockMin.size() &&
+                 fread(s.BlockMax.data(), sizeof(float), s.BlockMax.size(), file) == s.BlockMax.size();
+            BuildPrefixSums(s, index.NumFrames);
+        }
+    }
+    fclose(file);
+    if (!ok)
+        index = WindowIndex();
+    return ok;
+}
+
+// Index file stored next to a recording
+inline std::string WindowIndexPath(const std::string& recording)
+{
+    return recording + ".widx";
+}
+
+#endif // WINDOW_INDEX_H
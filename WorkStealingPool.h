@@ -0,0 +1,155 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+// Fixed set of worker threads for batches of independent jobs of uneven
+// cost (one recording each, say).
+//
+// Run(count, job) deals the indices [0, count) out in contiguous blocks, one
+// deque per worker. A worker takes jobs from the back of its own deque and,
+// once that is empty, steals from the front of another worker's, so long
+// files on one worker are picked up by the idle ones instead of leaving a
+// tail at the end of the batch. Jobs never spawn jobs, so a worker that
+// finds every deque empty is done.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+public:
+    // numThreads <= 0 uses every hardware thread
+    explicit WorkStealingPool(int numThreads = 0) : Steals(0), Generation(0), Running(0), Quit(false)
+    {
+        if (numThreads <= 0)
+            numThreads = (int)std::thread::hardware_concurrency();
+        if (numThreads <= 0)
+            numThreads = 1;
+        Queues.reset(new WorkQueue[numThreads]);
+        JobsRun.assign(numThreads, 0);
+        for (int w = 0; w < numThreads; ++w)
+            Workers.push_back(std::thread(&WorkStealingPool::WorkerMain, this, w));
+    }
+
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(StateMutex);
+            Quit = true;
+        }
+        Wake.notify_all();
+        for (size_t w = 0; w < Workers.size(); ++w)
+            Workers[w].join();
+    }
+
+    int NumThreads() const { return (int)Workers.size(); }
+
+    // Calls job(index, worker) for every index in [0, count) and returns
+    // when all of them have finished. 'worker' is in [0, NumThreads()) and
+    // lets jobs keep per-thread scratch without locking.
+    void Run(int count, const std::function<void(int, int)>& job)
+    {
+        int n = NumThreads();
+        for (int w = 0; w < n; ++w)
+        {
+            std::lock_guard<std::mutex> lock(Queues[w].Mutex);
+            Queues[w].Jobs.clear();
+            for (int i = (int)((long long)count * w / n); i < (int)((long long)count * (w + 1) / n); ++i)
+                Queues[w].Jobs.push_back(i);
+            JobsRun[w] = 0;
+        }
+        Steals = 0;
+
+        std::unique_lock<std::mutex> lock(StateMutex);
+        Job = job;
+        Running = n;
+        ++Generation;
+        Wake.notify_all();
+        Done.wait(lock, [this] { return Running == 0; });
+        Job = nullptr;
+    }
+
+    // Statistics of the last Run
+    int StealCount() const { return Steals; }
+    int JobsRunBy(int worker) const { return JobsRun[worker]; }
+
+private:
+    struct WorkQueue
+    {
+        std::mutex      Mutex;
+        std::deque<int> Jobs;
+    };
+
+    bool PopOwn(int w, int& index)
+    {
+        std::lock_guard<std::mutex> lock(Queues[w].Mutex);
+        if (Queues[w].Jobs.empty())
+            return false;
+        index = Queues[w].Jobs.back();
+        Queues[w].Jobs.pop_back();
+        return true;
+    }
+
+    bool Steal(int w, int& index)
+    {
+        int n = NumThreads();
+        for (int k = 1; k < n; ++k)
+        {
+            WorkQueue& victim = Queues[(w + k) % n];
+            std::lock_guard<std::mutex> lock(victim.Mutex);
+            if (victim.Jobs.empty())
+                continue;
+            index = victim.Jobs.front();
+            victim.Jobs.pop_front();
+            ++Steals;
+            return true;
+        }
+        return false;
+    }
+
+    void WorkerMain(int w)
+    {
+        unsigned seen = 0;
+        for (;;)
+        {
+            std::function<void(int, int)> job;
+            {
+                std::unique_lock<std::mutex> lock(StateMutex);
+                Wake.wait(lock, [&] { return Quit || Generation != seen; });
+                if (Quit)
+                    return;
+                seen = Generation;
+                job = Job;
+            }
+
+            int index;
+            while (PopOwn(w, index) || Steal(w, index))
+            {
+                job(index, w);
+                ++JobsRun[w];
+            }
+
+            std::lock_guard<std::mutex> lock(StateMutex);
+            if (--Running == 0)
+                Done.notify_one();
+        }
+    }
+
+    std::vector<std::thread>       Workers;
+    std::unique_ptr<WorkQueue[]>   Queues;
+    std::vector<int>               JobsRun;
+    std::atomic<int>               Steals;
+    std::function<void(int, int)>  Job;
+    std::mutex                     StateMutex;
+    std::condition_variable        Wake, Done;
+    unsigned                       Generation;
+    int                            Running;
+    bool                           Quit;
+};
+
+#endif // WORK_STEALING_POOL_H
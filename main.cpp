@@ -212,6 +212,11 @@ static bool MainLoop(bool retryCreate)
 {
     //__debugbreak;
     OculusTextureBuffer* eyeRenderTexture[2];// = { nullptr, nullptr };
+    OculusTextureBuffer* stereoRenderTexture = nullptr; // both eyes side by side, for single-pass stereo
+    Sizei           stereoEyeSize;
+    bool            singlePassStereo = false;
+    bool            stereoChecked = false;
+    bool            stereoPassed = false;  // result of the check; a failed check keeps the per-eye path
     ovrMirrorTexture mirrorTexture = nullptr;
     GLuint          mirrorFBO = 0;
     Scene         * roomScene = nullptr;
@@ -247,6 +252,14 @@ static bool MainLoop(bool retryCreate)
             //if (retryCreate) goto Done;
             VALIDATE(false, "Failed to create texture.");
         }
+        stereoEyeSize.w = std::max(stereoEyeSize.w, idealTextureSize.w);
+        stereoEyeSize.h = std::max(stereoEyeSize.h, idealTextureSize.h);
+    }
+    stereoRenderTexture = new OculusTextureBuffer(session, Sizei(stereoEyeSize.w * 2, stereoEyeSize.h), 1);
+    if (!stereoRenderTexture->ColorTextureChain || !stereoRenderTexture->DepthTextureChain)
+    {
+        delete stereoRenderTexture;
+        stereoRenderTexture = nullptr;
     }
 
     ovrMirrorTextureDesc desc;
@@ -289,6 +302,9 @@ static bool MainLoop(bool retryCreate)
     //importModel("Male_Zombie/Zombie.obj");
     
 
+    // checked offscreen against the per-eye path on the first frame
+    singlePassStereo = stereoRenderTexture != nullptr;
+
     // Main loop
     while (Platform.HandleMessages())
     {
@@ -303,6 +319,9 @@ static bool MainLoop(bool retryCreate)
         if (sessionStatus.ShouldRecenter)
             ovr_RecenterTrackingOrigin(session);
 
+        // skeleton frames from the sensor thread, also while not visible so the ring never fills
+        roomScene->PumpLiveStream();
+
         if (sessionStatus.IsVisible)
         {
             // Keyboard inputs to adjust player orientation
@@ -317,6 +336,26 @@ static bool MainLoop(bool retryCreate)
             if (Platform.Key['D'])                            Pos2 += Matrix4f::RotationY(Yaw).Transform(Vector3f(+0.05f, 0, 0));
             if (Platform.Key['A'])                            Pos2 += Matrix4f::RotationY(Yaw).Transform(Vector3f(-0.05f, 0, 0));
 
+            // P cycles the body prediction mode (off / velocity / acceleration)
+            static bool predictionKey = false;
+            if (Platform.Key['P'] && !predictionKey)
+                roomScene->LivePredictor.Mode = (PredictionMode)((roomScene->LivePredictor.Mode + 1) % Prediction_Count);
+            predictionKey = Platform.Key['P'];
+
+            // R starts / finishes recording the live body (SessionRecorder, off the render thread)
+            static bool recordKey = false;
+            if (Platform.Key['R'] && !recordKey)
+                roomScene->ToggleSessionRecording();
+            recordKey = Platform.Key['R'];
+            roomScene->PollSessionRecording();
+
+            // I switches between single-pass (instanced) stereo and one pass per eye,
+            // unless single pass has failed its check
+            static bool stereoKey = false;
+            if (Platform.Key['I'] && !stereoKey && stereoRenderTexture && (!stereoChecked || stereoPassed))
+                singlePassStereo = !singlePassStereo;
+            stereoKey = Platform.Key['I'];
+
             // don't forget to enable shader before setting uniforms
             ourShader.use();
             // view/projection transformations
@@ -329,6 +368,8 @@ static bool MainLoop(bool retryCreate)
             static float cubeClock = 0;
 			if (sessionStatus.HasInputFocus) {// Pause the application if we are not supposed to have input.
 				roomScene->Models[1]->Pos = Vector3f(9 * (float)sin(cubeClock), 3, 9 * (float)cos(cubeClock += 0.015f));	// roomScene->Models[0] = moving cube
+				roomScene->UpdateLiveBody(ovr_GetPredictedDisplayTime(session, frameIndex));
+				roomScene->UpdateAnimation(1.0f / 90.0f);
 			}
             // render the loaded model
             glm::mat4 model = glm::mat4(1.0f);
@@ -352,26 +393,50 @@ static bool MainLoop(bool retryCreate)
 
             ovrTimewarpProjectionDesc posTimewarpProjectionDesc = {};
 
-            // Render Scene to Eye Buffers
+            // Get view and projection matrices
+            Matrix4f view[2], proj[2];
             for (int eye = 0; eye < 2; ++eye)
             {
-                // Switch to eye render target
-                eyeRenderTexture[eye]->SetAndClearRenderSurface();
-
-                // Get view and projection matrices
                 Matrix4f rollPitchYaw = Matrix4f::RotationY(Yaw);
                 Matrix4f finalRollPitchYaw = rollPitchYaw * Matrix4f(EyeRenderPose[eye].Orientation);
                 Vector3f finalUp = finalRollPitchYaw.Transform(Vector3f(0, 1, 0));
                 Vector3f finalForward = finalRollPitchYaw.Transform(Vector3f(0, 0, -1));
                 Vector3f shiftedEyePos = Pos2 + rollPitchYaw.Transform(EyeRenderPose[eye].Position);
 
-                Matrix4f view = Matrix4f::LookAtRH(shiftedEyePos, shiftedEyePos + finalForward, finalUp);
-                Matrix4f proj = ovrMatrix4f_Projection(hmdDesc.DefaultEyeFov[eye], 0.2f, 1000.0f, ovrProjection_None);
-                posTimewarpProjectionDesc = ovrTimewarpProjectionDesc_FromProjection(proj, ovrProjection_None);
+                view[eye] = Matrix4f::LookAtRH(shiftedEyePos, shiftedEyePos + finalForward, finalUp);
+                proj[eye] = ovrMatrix4f_Projection(hmdDesc.DefaultEyeFov[eye], 0.2f, 1000.0f, ovrProjection_None);
+                posTimewarpProjectionDesc = ovrTimewarpProjectionDesc_FromProjection(proj[eye], ovrProjection_None);
+            }
+
+            // Single-pass stereo only once it draws what the per-eye path draws
+            if (singlePassStereo && !stereoChecked)
+            {
+                StereoCheck check = CheckStereoRendering(*roomScene, view, proj, stereoEyeSize);
+                stereoPassed = singlePassStereo = check.Passed();
+                stereoChecked = true;
+                char buffer[200];
+                snprintf(buffer, sizeof(buffer), "stereo check: %d of %d pixels differ (max %d), submit %.3f ms per eye pass, %.3f ms single pass: %s\n",
+                         check.Differing, check.Pixels, check.MaxDifference, check.MonoMs, check.StereoMs,
+                         singlePassStereo ? "single pass" : "per eye");
+                OutputDebugStringA(buffer);
+            }
+
+            // Render Scene to Eye Buffers
+            if (singlePassStereo)
+            {
+                stereoRenderTexture->SetAndClearRenderSurface();
+                roomScene->RenderStereo(view, proj);
+                stereoRenderTexture->UnsetRenderSurface();
+                stereoRenderTexture->Commit();
+            }
+            else for (int eye = 0; eye < 2; ++eye)
+            {
+                // Switch to eye render target
+                eyeRenderTexture[eye]->SetAndClearRenderSurface();
 
                 // Render world
-                roomScene->Render(view, proj);
-                roomScene->RenderLines(view, proj);
+                roomScene->Render(view[eye], proj[eye]);
+                roomScene->RenderLines(view[eye], proj[eye]);
                 //roomScene->renderPoints(view, proj);
                 //roomScene->Draw(ourShader);
 
@@ -395,9 +460,18 @@ static bool MainLoop(bool retryCreate)
 
             for (int eye = 0; eye < 2; ++eye)
             {
-                ld.ColorTexture[eye] = eyeRenderTexture[eye]->ColorTextureChain;
-                ld.DepthTexture[eye] = eyeRenderTexture[eye]->DepthTextureChain;
-                ld.Viewport[eye]     = Recti(eyeRenderTexture[eye]->GetSize());
+                if (singlePassStereo)
+                {
+                    ld.ColorTexture[eye] = stereoRenderTexture->ColorTextureChain;
+                    ld.DepthTexture[eye] = stereoRenderTexture->DepthTextureChain;
+                    ld.Viewport[eye]     = Recti(eye * stereoEyeSize.w, 0, stereoEyeSize.w, stereoEyeSize.h);
+                }
+                else
+                {
+                    ld.ColorTexture[eye] = eyeRenderTexture[eye]->ColorTextureChain;
+                    ld.DepthTexture[eye] = eyeRenderTexture[eye]->DepthTextureChain;
+                    ld.Viewport[eye]     = Recti(eyeRenderTexture[eye]->GetSize());
+                }
                 ld.Fov[eye]          = hmdDesc.DefaultEyeFov[eye];
                 ld.RenderPose[eye]   = EyeRenderPose[eye];
             }
@@ -432,6 +506,7 @@ Done:
     {
         delete eyeRenderTexture[eye];
     }
+    delete stereoRenderTexture;
     Platform.ReleaseDevice();
     ovr_Destroy(session);
 
@@ -44,6 +44,8 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    // sampler uniform per texture (diffuse_texture1, ...), named once in setupMesh
+    vector<string>       samplerNames;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -51,6 +53,7 @@ public:
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        samplerProgram = 0;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
@@ -59,28 +62,21 @@ public:
     // render the mesh
     void Draw(Shader &shader)
     {
+        // sampler locations are looked up again only when the shader changes
+        if (samplerProgram != shader.ID)
+        {
+            samplerLocations.resize(samplerNames.size());
+            for (unsigned int i = 0; i < samplerNames.size(); i++)
+                samplerLocations[i] = glGetUniformLocation(shader.ID, samplerNames[i].c_str());
+            samplerProgram = shader.ID;
+        }
+
         // bind appropriate textures
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr = 1;
-        unsigned int heightNr = 1;
         for (unsigned int i = 0; i < textures.size(); i++)
         {
             glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if (name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if (name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if (name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
             // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            glUniform1i(samplerLocations[i], i);
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
@@ -97,10 +93,33 @@ public:
 private:
     // render data 
     unsigned int VBO, EBO;
+    unsigned int samplerProgram;        // shader the locations below belong to
+    vector<int>  samplerLocations;
 
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
+        // sampler names: the N in diffuse_textureN counts per texture type
+        unsigned int diffuseNr = 1;
+        unsigned int specularNr = 1;
+        unsigned int normalNr = 1;
+        unsigned int heightNr = 1;
+        samplerNames.clear();
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            string number;
+            string name = textures[i].type;
+            if (name == "texture_diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (name == "texture_specular")
+                number = std::to_string(specularNr++); // transfer unsigned int to string
+            else if (name == "texture_normal")
+                number = std::to_string(normalNr++); // transfer unsigned int to string
+            else if (name == "texture_height")
+                number = std::to_string(heightNr++); // transfer unsigned int to string
+            samplerNames.push_back(name + number);
+        }
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);